@@ -0,0 +1,260 @@
+/*
+ * Copyright (c) 2024 Microsoft, Inc. and others.  All rights reserved.
+ *
+ * This program and the accompanying materials are made available under the
+ * terms of the Eclipse Public License v1.0 which accompanies this distribution,
+ * and is available at http://www.eclipse.org/legal/epl-v10.html
+ *
+ */
+
+#include <sys/mman.h>
+#include <cstring>
+#include <algorithm>
+
+#include "BufferPool.h"
+
+/**
+ * Constructor for class
+ *
+ *  \param [in] logPtr  Pointer to existing Logger for app logging
+ *  \param [in] config  Pointer to the loaded configuration
+ */
+BufferPool::BufferPool(Logger *logPtr, Config *config) {
+    logger = logPtr;
+    cfg = config;
+    debug = cfg->debug_general;
+
+    budget = cfg->bmp_buffer_pool_size / cfg->workers;
+    routerMin = std::min((size_t)cfg->bmp_buffer_min, (size_t)cfg->bmp_buffer_size);
+    committed = 0;
+    exhausted = false;
+
+    LOG_INFO("Router buffer pool budget is %zu MB, router min %zu KB, max %d MB",
+             budget / (1024 * 1024), routerMin / 1024, cfg->bmp_buffer_size / (1024 * 1024));
+}
+
+BufferPool::~BufferPool() {
+    for (auto it = freeChunks.begin(); it != freeChunks.end(); it++) {
+        for (size_t i = 0; i < it->second.size(); i++)
+            munmap(it->second[i], BUFFER_POOL_CHUNK_SIZE);
+    }
+}
+
+void BufferPool::addRouter() {
+    std::lock_guard<std::mutex> lock(mutex);
+
+    committed += routerMin;
+
+    if (committed > budget)
+        LOG_WARN("Router buffer minimums (%zu MB) exceed the buffer pool budget", committed / (1024 * 1024));
+}
+
+void BufferPool::removeRouter() {
+    std::lock_guard<std::mutex> lock(mutex);
+
+    committed -= routerMin;
+}
+
+unsigned char *BufferPool::alloc(size_t held, int node_id, bool force) {
+    std::lock_guard<std::mutex> lock(mutex);
+
+    // Only bytes above the router minimum are taken from the budget
+    size_t grow = std::max(held + BUFFER_POOL_CHUNK_SIZE, routerMin) - std::max(held, routerMin);
+
+    if (grow > 0 and committed + grow > budget and not force) {
+        if (not exhausted) {
+            exhausted = true;
+            LOG_NOTICE("Router buffer pool budget exhausted, routers above their minimum pause reading");
+        }
+        return NULL;
+    }
+
+    std::vector<unsigned char *> &free_chunks = freeChunks[node_id];
+
+    if (free_chunks.size()) {
+        committed += grow;
+
+        unsigned char *chunk = free_chunks.back();
+        free_chunks.pop_back();
+        return chunk;
+    }
+
+    // Chunks are mapped so the pages are placed on the router node, not reused heap memory
+    void *chunk = mmap(NULL, BUFFER_POOL_CHUNK_SIZE, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+    if (chunk == MAP_FAILED)
+        return NULL;
+
+    CpuAffinity::bindMemory(chunk, BUFFER_POOL_CHUNK_SIZE, node_id);
+
+    committed += grow;
+    return (unsigned char *)chunk;
+}
+
+void BufferPool::free(unsigned char *chunk, size_t held, int node_id) {
+    std::lock_guard<std::mutex> lock(mutex);
+
+    committed -= std::max(held, routerMin) - std::max(held - BUFFER_POOL_CHUNK_SIZE, routerMin);
+
+    if (exhausted and committed + BUFFER_POOL_CHUNK_SIZE <= budget) {
+        exhausted = false;
+        SELF_DEBUG("Router buffer pool budget available again");
+    }
+
+    std::vector<unsigned char *> &free_chunks = freeChunks[node_id];
+
+    if (free_chunks.size() < BUFFER_POOL_FREE_CHUNKS)
+        free_chunks.push_back(chunk);
+    else
+        munmap(chunk, BUFFER_POOL_CHUNK_SIZE);
+}
+
+size_t BufferPool::getRouterMin() {
+    return routerMin;
+}
+
+int BufferPool::getFill() {
+    std::lock_guard<std::mutex> lock(mutex);
+
+    return budget ? 100 * committed / budget : 100;
+}
+
+/**
+ * Constructor for class
+ *
+ *  \param [in] pool        Pool to take chunks from
+ *  \param [in] max_size    Max bytes buffered (buffers.router)
+ *  \param [in] node_id     NUMA node of the router, -1 for any
+ */
+RouterBuffer::RouterBuffer(BufferPool *pool, size_t max_size, int node_id) {
+    this->pool = pool;
+    maxSize = max_size;
+    nodeId = node_id;
+    head = 0;
+    tail = 0;
+    bytes = 0;
+    spill = NULL;
+    spilling = false;
+
+    pool->addRouter();
+}
+
+RouterBuffer::~RouterBuffer() {
+    while (chunks.size()) {
+        pool->free(chunks.back(), chunks.size() * BUFFER_POOL_CHUNK_SIZE, nodeId);
+        chunks.pop_back();
+    }
+
+    pool->removeRouter();
+
+    if (spill != NULL)
+        delete spill;
+}
+
+void RouterBuffer::enableSpill(const std::string &dir, size_t quota) {
+    spill = new SpillFile(dir, quota);
+}
+
+size_t RouterBuffer::writable(unsigned char *&ptr) {
+    // Bytes are appended to the spill file until it is drained
+    spilling = (spill != NULL and spill->size() > 0);
+
+    if (not spilling and ((chunks.empty() or tail == BUFFER_POOL_CHUNK_SIZE) and not grow(false)))
+        spilling = (spill != NULL);
+
+    if (spilling)
+        return spill->writable(ptr);
+
+    if (chunks.empty() or tail == BUFFER_POOL_CHUNK_SIZE)
+        return 0;
+
+    ptr = chunks.back() + tail;
+    return BUFFER_POOL_CHUNK_SIZE - tail;
+}
+
+void RouterBuffer::commit(size_t len) {
+    if (spilling) {
+        spill->commit(len);
+        return;
+    }
+
+    tail += len;
+    bytes += len;
+}
+
+size_t RouterBuffer::readable(unsigned char *&ptr) {
+    // Chunks hold the older bytes
+    if (bytes == 0)
+        return spill != NULL ? spill->readable(ptr) : 0;
+
+    ptr = chunks.front() + head;
+    return (chunks.size() == 1 ? tail : BUFFER_POOL_CHUNK_SIZE) - head;
+}
+
+void RouterBuffer::consume(size_t len) {
+    if (bytes == 0) {
+        spill->consume(len);
+        return;
+    }
+
+    head += len;
+    bytes -= len;
+
+    // Return the written chunks, a drained buffer holds no chunks
+    while (chunks.size() and (head == BUFFER_POOL_CHUNK_SIZE or bytes == 0)) {
+        pool->free(chunks.front(), chunks.size() * BUFFER_POOL_CHUNK_SIZE, nodeId);
+        chunks.pop_front();
+        head = 0;
+    }
+
+    if (chunks.empty())
+        tail = 0;
+}
+
+bool RouterBuffer::append(const unsigned char *data, size_t len) {
+    if (bytes + len > maxSize)
+        return false;
+
+    while (len > 0) {
+        if ((chunks.empty() or tail == BUFFER_POOL_CHUNK_SIZE) and not grow(true))
+            return false;
+
+        size_t n = std::min(len, BUFFER_POOL_CHUNK_SIZE - tail);
+        memcpy(chunks.back() + tail, data, n);
+        commit(n);
+
+        data += n;
+        len -= n;
+    }
+
+    return true;
+}
+
+size_t RouterBuffer::size() {
+    return bytes + getSpillDepth();
+}
+
+size_t RouterBuffer::getSpillDepth() {
+    return spill != NULL ? spill->size() : 0;
+}
+
+int RouterBuffer::getFill() {
+    if (getSpillDepth() > 0)
+        return 100;
+
+    return 100 * bytes / maxSize;
+}
+
+bool RouterBuffer::grow(bool force) {
+    size_t held = chunks.size() * BUFFER_POOL_CHUNK_SIZE;
+
+    if (held >= maxSize)
+        return false;
+
+    unsigned char *chunk = pool->alloc(held, nodeId, force);
+    if (chunk == NULL)
+        return false;
+
+    chunks.push_back(chunk);
+    tail = 0;
+    return true;
+}
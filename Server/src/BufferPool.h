@@ -0,0 +1,226 @@
+/*
+ * Copyright (c) 2024 Microsoft, Inc. and others.  All rights reserved.
+ *
+ * This program and the accompanying materials are made available under the
+ * terms of the Eclipse Public License v1.0 which accompanies this distribution,
+ * and is available at http://www.eclipse.org/legal/epl-v10.html
+ *
+ */
+
+#ifndef BUFFERPOOL_H_
+#define BUFFERPOOL_H_
+
+#include <deque>
+#include <map>
+#include <vector>
+#include <mutex>
+#include <cstddef>
+
+#include "Config.h"
+#include "Logger.h"
+#include "SpillFile.h"
+#include "CpuAffinity.h"
+
+#define BUFFER_POOL_CHUNK_SIZE      (256 * 1024)    ///< Bytes per router buffer chunk
+#define BUFFER_POOL_FREE_CHUNKS     64              ///< Free chunks kept for reuse instead of freed
+
+/**
+ * \class   BufferPool
+ *
+ * \brief   Collector wide pool of router buffer chunks with a memory budget
+ * \details
+ *      Router buffers (see RouterBuffer) are made of chunks taken from this pool, so a
+ *      router only holds memory for the bytes it has buffered.  The budget applies to
+ *      all routers: each router reserves its minimum (buffers.router_min) when it is
+ *      added and can always use it, chunks above the minimum are only allocated while
+ *      the budget (buffers.pool) is not exhausted.  A router that cannot get a chunk
+ *      stops reading its socket until its buffer drains.
+ *
+ *      With workers, each worker has its own pool with an equal share of the budget.
+ *
+ *      Chunks are bound to the NUMA node of the router (see CpuAffinity), free chunks are
+ *      kept per node so a router does not reuse a chunk of another node.
+ */
+class BufferPool {
+public:
+    /**
+     * Constructor for class
+     *
+     *  \param [in] logPtr  Pointer to existing Logger for app logging
+     *  \param [in] config  Pointer to the loaded configuration
+     */
+    BufferPool(Logger *logPtr, Config *config);
+
+    virtual ~BufferPool();
+
+    /**
+     * Add a router, reserves the per router minimum
+     */
+    void addRouter();
+
+    /**
+     * Remove a router, the router must have freed all chunks
+     */
+    void removeRouter();
+
+    /**
+     * Allocate a chunk for a router
+     *
+     * \param [in] held     Bytes in chunks the router already holds
+     * \param [in] node_id  NUMA node of the router, -1 for any
+     * \param [in] force    Allocate even if the budget is exhausted
+     *
+     * \return chunk of BUFFER_POOL_CHUNK_SIZE bytes, NULL if the budget is exhausted
+     */
+    unsigned char *alloc(size_t held, int node_id, bool force = false);
+
+    /**
+     * Return a chunk of a router to the pool
+     *
+     * \param [in] chunk    Chunk to return
+     * \param [in] held     Bytes in chunks the router held, including this chunk
+     * \param [in] node_id  NUMA node of the router, -1 for any
+     */
+    void free(unsigned char *chunk, size_t held, int node_id);
+
+    /**
+     * Get the router minimum, in bytes
+     */
+    size_t getRouterMin();
+
+    /**
+     * Get the percent of the budget in use (including router minimums)
+     */
+    int getFill();
+
+private:
+    Logger      *logger;                    ///< Logging class pointer
+    Config      *cfg;                       ///< Config pointer
+    bool        debug;                      ///< debug flag to indicate debugging
+
+    std::mutex                      mutex;
+    std::map<int, std::vector<unsigned char *>> freeChunks;  ///< Chunks kept for reuse, by NUMA node
+    size_t                          budget;         ///< Max bytes committed to routers
+    size_t                          routerMin;      ///< Bytes reserved per router
+    size_t                          committed;      ///< Sum of max(held, routerMin) of all routers
+    bool                            exhausted;      ///< Budget was exhausted, for logging
+};
+
+/**
+ * \class   RouterBuffer
+ *
+ * \brief   Router socket buffer made of BufferPool chunks
+ * \details
+ *      FIFO of bytes read from the router socket and not yet written to the BMP reader.
+ *      Chunks are added as the buffer grows (up to buffers.router) and returned to the
+ *      pool as soon as they are written, so an idle router holds no chunks.
+ *
+ *      With a spill file, bytes that do not fit (buffer full or pool budget used) are
+ *      appended to the file instead, and all bytes go to the file until it is drained so
+ *      that the order is kept.  The router is only throttled when the file quota is used.
+ *
+ *      Not thread safe, used by the client thread only.
+ */
+class RouterBuffer {
+public:
+    /**
+     * Constructor for class
+     *
+     *  \param [in] pool        Pool to take chunks from
+     *  \param [in] max_size    Max bytes buffered (buffers.router)
+     *  \param [in] node_id     NUMA node of the router, -1 for any
+     */
+    RouterBuffer(BufferPool *pool, size_t max_size, int node_id = -1);
+
+    virtual ~RouterBuffer();
+
+    /**
+     * Spill bytes that do not fit to a file
+     *
+     * \param [in] dir      Directory to create the spill file in
+     * \param [in] quota    Max bytes spilled
+     *
+     * \throws const char * with the error message
+     */
+    void enableSpill(const std::string &dir, size_t quota);
+
+    /**
+     * Get the contiguous space to read into, a chunk is added if needed
+     *
+     * \param [out] ptr     Where to write
+     *
+     * \return bytes that can be written at ptr, zero if the buffer is full or the pool
+     *         budget is exhausted and there is no spill space (stop reading)
+     */
+    size_t writable(unsigned char *&ptr);
+
+    /**
+     * Add bytes written at the pointer returned by writable()
+     *
+     * \param [in] len      Bytes written
+     */
+    void commit(size_t len);
+
+    /**
+     * Get the contiguous bytes to write to the reader
+     *
+     * \param [out] ptr     Where to read
+     *
+     * \return bytes that can be read at ptr, zero if empty
+     */
+    size_t readable(unsigned char *&ptr);
+
+    /**
+     * Remove bytes read at the pointer returned by readable()
+     *
+     * \param [in] len      Bytes read
+     */
+    void consume(size_t len);
+
+    /**
+     * Append bytes, ignores the pool budget
+     *
+     * \param [in] data     Bytes to append
+     * \param [in] len      Length of data
+     *
+     * \return false if the bytes do not fit in max_size
+     */
+    bool append(const unsigned char *data, size_t len);
+
+    /**
+     * Bytes buffered, including spilled bytes
+     */
+    size_t size();
+
+    /**
+     * Bytes in the spill file
+     */
+    size_t getSpillDepth();
+
+    /**
+     * Percent of max_size buffered, 100 while spilling
+     */
+    int getFill();
+
+private:
+    BufferPool                      *pool;
+    size_t                          maxSize;
+    int                             nodeId;     ///< NUMA node of the chunks, -1 for any
+    std::deque<unsigned char *>     chunks;
+    size_t                          head;       ///< Read offset in the first chunk
+    size_t                          tail;       ///< Write offset in the last chunk
+    size_t                          bytes;      ///< Bytes buffered in chunks
+    SpillFile                       *spill;     ///< Spill file, NULL if not enabled
+    bool                            spilling;   ///< Last writable() was in the spill file
+
+    /**
+     * Add a chunk at the end
+     *
+     * \param [in] force    Allocate even if the budget is exhausted
+     *
+     * \return false if the buffer is full or the budget is exhausted
+     */
+    bool grow(bool force);
+};
+
+#endif /* BUFFERPOOL_H_ */
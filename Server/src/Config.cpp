@@ -37,7 +37,14 @@ Config::Config() {
     debug_bgp           = false;
     debug_bmp           = false;
     debug_msgbus        = false;
+    debug_redis         = false;
+    debug_profile       = false;
+    profile_file        = "";
     bmp_buffer_size     = 15 * 1024 * 1024; // 15MB
+    bmp_buffer_min      = 512 * 1024;       // 512KB
+    bmp_buffer_pool_size = 1024UL * 1024 * 1024; // 1GB
+    bmp_spill_dir       = "";
+    bmp_spill_quota     = 1024UL * 1024 * 1024; // 1GB
     svr_ipv6            = false;
     svr_ipv4            = true;
     bind_ipv4           = "";
@@ -57,7 +64,35 @@ Config::Config() {
     max_concurrent_routers = 2;
     initial_router_time = 60;
     calculate_baseline  = true;
+    startup_adaptive    = true;
+    startup_max_cpu     = 75;
     pat_enabled		= false;
+    log_async = true;
+    log_flush_ms = 100;
+    log_ring_kb = 16;
+    workers = 1;
+    listen_backlog = 128;
+    affinity_policy = AFFINITY_POLICY_NONE;
+    affinity_cpus = "";
+    pipeline_enabled = false;
+    pipeline_queue_size = 256;
+    parse_pool_workers = 0;
+    parse_pool_max_pending = 1024;
+    sink_type = SINK_MSGBUS;
+    sink_hash = false;
+    record_dir = "";
+    record_segment_size = 256UL * 1024 * 1024;     // 256MB
+    record_max_disk = 10240UL * 1024 * 1024;       // 10GB
+    record_queue_size = 64UL * 1024 * 1024;        // 64MB
+    record_compress = false;
+    latency_enabled = false;
+    metrics_address = "127.0.0.1";
+    metrics_port = 0;
+    redis_compact_schema = false;
+    redis_queue_size = 8192;
+    redis_connections = 2;
+    redis_notifications = false;
+    redis_attr_sweep_secs = 3600;
     bzero(admin_id, sizeof(admin_id));
 
     /*
@@ -109,6 +144,8 @@ void Config::load(const char *cfg_filename) {
                         parseDebug(node);
                     else if (key.compare("kafka") == 0)
                         parseKafka(node);
+                    else if (key.compare("redis") == 0)
+                        parseRedis(node);
                     else if (key.compare("mapping") == 0)
                         parseMapping(node);
 
@@ -136,6 +173,36 @@ void Config::load(const char *cfg_filename) {
         std::cout << "---| Done Loading configuration file |------------------------- " << std::endl;
 }
 
+/*********************************************************************//**
+ * Reload only the debug configuration from file in YAML format
+ *
+ * \param [in] cfg_filename     Yaml configuration filename
+ ***********************************************************************/
+void Config::reloadDebug(const char *cfg_filename) {
+    debug_general       = false;
+    debug_bgp           = false;
+    debug_bmp           = false;
+    debug_msgbus        = false;
+    debug_redis         = false;
+    debug_profile       = false;
+    profile_file        = "";
+
+    try {
+        YAML::Node root = YAML::LoadFile(cfg_filename);
+
+        if (root.Type() == YAML::NodeType::Map and root["debug"]
+                and root["debug"].Type() == YAML::NodeType::Map)
+            parseDebug(root["debug"]);
+
+    } catch (YAML::BadFile err) {
+        throw err.what();
+    } catch (YAML::ParserException err) {
+        throw err.what();
+    } catch (YAML::InvalidNode err) {
+        throw err.what();
+    }
+}
+
 /**
  * Parse the base configuration
  *
@@ -230,6 +297,69 @@ void Config::parseBase(const YAML::Node &node) {
                 printWarning("buffers.router is not of type int", node["buffers"]["router"]);
             }
         }
+
+        if (node["buffers"]["router_min"]) {
+            try {
+                bmp_buffer_min = node["buffers"]["router_min"].as<int>();
+
+                if (bmp_buffer_min < 256 || bmp_buffer_min > 65536)
+                    throw "invalid router min buffer size, not within range of 256 - 65536)";
+
+                bmp_buffer_min *= 1024;  // KB to bytes
+
+                if (debug_general)
+                    std::cout << "   Config: bmp buffer min: " << bmp_buffer_min << std::endl;
+
+            } catch (YAML::TypedBadConversion<int> err) {
+                printWarning("buffers.router_min is not of type int", node["buffers"]["router_min"]);
+            }
+        }
+
+        if (node["buffers"]["pool"]) {
+            try {
+                int pool_size = node["buffers"]["pool"].as<int>();
+
+                if (pool_size < 16 || pool_size > 1048576)
+                    throw "invalid buffer pool size, not within range of 16 - 1048576)";
+
+                bmp_buffer_pool_size = (size_t)pool_size * 1024 * 1024;  // MB to bytes
+
+                if (debug_general)
+                    std::cout << "   Config: bmp buffer pool: " << bmp_buffer_pool_size << std::endl;
+
+            } catch (YAML::TypedBadConversion<int> err) {
+                printWarning("buffers.pool is not of type int", node["buffers"]["pool"]);
+            }
+        }
+
+        if (node["buffers"]["spill_dir"]) {
+            try {
+                bmp_spill_dir = node["buffers"]["spill_dir"].as<std::string>();
+
+                if (debug_general)
+                    std::cout << "   Config: bmp spill dir: " << bmp_spill_dir << std::endl;
+
+            } catch (YAML::TypedBadConversion<std::string> err) {
+                printWarning("buffers.spill_dir is not of type string", node["buffers"]["spill_dir"]);
+            }
+        }
+
+        if (node["buffers"]["spill_quota"]) {
+            try {
+                int spill_quota = node["buffers"]["spill_quota"].as<int>();
+
+                if (spill_quota < 16 || spill_quota > 1048576)
+                    throw "invalid spill quota, not within range of 16 - 1048576)";
+
+                bmp_spill_quota = (size_t)spill_quota * 1024 * 1024;  // MB to bytes
+
+                if (debug_general)
+                    std::cout << "   Config: bmp spill quota: " << bmp_spill_quota << std::endl;
+
+            } catch (YAML::TypedBadConversion<int> err) {
+                printWarning("buffers.spill_quota is not of type int", node["buffers"]["spill_quota"]);
+            }
+        }
     }
 
     if (node["heartbeat"]) {
@@ -251,6 +381,343 @@ void Config::parseBase(const YAML::Node &node) {
         }
     }
 
+    if (node["handoff_socket"]) {
+        try {
+            handoff_socket = node["handoff_socket"].as<std::string>();
+
+            if (debug_general)
+                std::cout << "   Config: handoff socket: " << handoff_socket << std::endl;
+
+        } catch (YAML::TypedBadConversion<std::string> err) {
+            printWarning("handoff_socket is not of type string", node["handoff_socket"]);
+        }
+    }
+
+    if (node["workers"]) {
+        try {
+            workers = node["workers"].as<int>();
+
+            if (workers < 1 || workers > MAX_WORKERS)
+                throw "invalid workers not within range of 1 - 64)";
+
+            if (debug_general)
+                std::cout << "   Config: workers: " << workers << std::endl;
+
+        } catch (YAML::TypedBadConversion<int> err) {
+            printWarning("workers is not of type int", node["workers"]);
+        }
+    }
+
+    if (node["listen_backlog"]) {
+        try {
+            listen_backlog = node["listen_backlog"].as<int>();
+
+            if (listen_backlog < 1 || listen_backlog > 65535)
+                throw "invalid listen backlog not within range of 1 - 65535)";
+
+            if (debug_general)
+                std::cout << "   Config: listen backlog: " << listen_backlog << std::endl;
+
+        } catch (YAML::TypedBadConversion<int> err) {
+            printWarning("listen_backlog is not of type int", node["listen_backlog"]);
+        }
+    }
+
+    if (node["affinity"]) {
+        if (node["affinity"]["policy"]) {
+            try {
+                value = node["affinity"]["policy"].as<std::string>();
+
+                if (value.compare("none") == 0)
+                    affinity_policy = AFFINITY_POLICY_NONE;
+                else if (value.compare("node") == 0)
+                    affinity_policy = AFFINITY_POLICY_NODE;
+                else if (value.compare("core") == 0)
+                    affinity_policy = AFFINITY_POLICY_CORE;
+                else
+                    throw "invalid affinity policy, must be none, node or core";
+
+                if (debug_general)
+                    std::cout << "   Config: affinity policy: " << value << std::endl;
+
+            } catch (YAML::TypedBadConversion<std::string> err) {
+                printWarning("affinity.policy is not of type string", node["affinity"]["policy"]);
+            }
+        }
+
+        if (node["affinity"]["cpus"]) {
+            try {
+                affinity_cpus = node["affinity"]["cpus"].as<std::string>();
+
+                if (debug_general)
+                    std::cout << "   Config: affinity cpus: " << affinity_cpus << std::endl;
+
+            } catch (YAML::TypedBadConversion<std::string> err) {
+                printWarning("affinity.cpus is not of type string", node["affinity"]["cpus"]);
+            }
+        }
+    }
+
+    if (node["pipeline"]) {
+        if (node["pipeline"]["enabled"]) {
+            try {
+                pipeline_enabled = node["pipeline"]["enabled"].as<bool>();
+
+                if (debug_general)
+                    std::cout << "   Config: pipeline enabled: " << pipeline_enabled << std::endl;
+
+            } catch (YAML::TypedBadConversion<bool> err) {
+                printWarning("pipeline.enabled is not of type bool", node["pipeline"]["enabled"]);
+            }
+        }
+
+        if (node["pipeline"]["queue_size"]) {
+            try {
+                pipeline_queue_size = node["pipeline"]["queue_size"].as<int>();
+
+                if (pipeline_queue_size < 16 || pipeline_queue_size > 65536)
+                    throw "invalid pipeline queue size not within range of 16 - 65536)";
+
+                if (debug_general)
+                    std::cout << "   Config: pipeline queue size: " << pipeline_queue_size << std::endl;
+
+            } catch (YAML::TypedBadConversion<int> err) {
+                printWarning("pipeline.queue_size is not of type int", node["pipeline"]["queue_size"]);
+            }
+        }
+    }
+
+    if (node["parse_pool"]) {
+        if (node["parse_pool"]["workers"]) {
+            try {
+                parse_pool_workers = node["parse_pool"]["workers"].as<int>();
+
+                if (parse_pool_workers < 0 || parse_pool_workers > 256)
+                    throw "invalid parse pool workers not within range of 0 - 256)";
+
+                if (debug_general)
+                    std::cout << "   Config: parse pool workers: " << parse_pool_workers << std::endl;
+
+            } catch (YAML::TypedBadConversion<int> err) {
+                printWarning("parse_pool.workers is not of type int", node["parse_pool"]["workers"]);
+            }
+        }
+
+        if (node["parse_pool"]["max_pending"]) {
+            try {
+                parse_pool_max_pending = node["parse_pool"]["max_pending"].as<int>();
+
+                if (parse_pool_max_pending < 16 || parse_pool_max_pending > 65536)
+                    throw "invalid parse pool max pending not within range of 16 - 65536)";
+
+                if (debug_general)
+                    std::cout << "   Config: parse pool max pending: " << parse_pool_max_pending << std::endl;
+
+            } catch (YAML::TypedBadConversion<int> err) {
+                printWarning("parse_pool.max_pending is not of type int", node["parse_pool"]["max_pending"]);
+            }
+        }
+    }
+
+    if (node["sink"]) {
+        if (node["sink"]["type"]) {
+            try {
+                value = node["sink"]["type"].as<std::string>();
+
+                if (value.compare("msgbus") == 0)
+                    sink_type = SINK_MSGBUS;
+                else if (value.compare("null") == 0)
+                    sink_type = SINK_NULL;
+                else if (value.compare("counting") == 0)
+                    sink_type = SINK_COUNTING;
+                else
+                    throw "invalid sink type, must be msgbus, null or counting";
+
+                if (debug_general)
+                    std::cout << "   Config: sink type: " << value << std::endl;
+
+            } catch (YAML::TypedBadConversion<std::string> err) {
+                printWarning("sink.type is not of type string", node["sink"]["type"]);
+            }
+        }
+
+        if (node["sink"]["hash"]) {
+            try {
+                sink_hash = node["sink"]["hash"].as<bool>();
+
+                if (debug_general)
+                    std::cout << "   Config: sink hash: " << sink_hash << std::endl;
+
+            } catch (YAML::TypedBadConversion<bool> err) {
+                printWarning("sink.hash is not of type bool", node["sink"]["hash"]);
+            }
+        }
+    }
+
+    if (node["record"]) {
+        if (node["record"]["dir"]) {
+            try {
+                record_dir = node["record"]["dir"].as<std::string>();
+
+                if (debug_general)
+                    std::cout << "   Config: record dir: " << record_dir << std::endl;
+
+            } catch (YAML::TypedBadConversion<std::string> err) {
+                printWarning("record.dir is not of type string", node["record"]["dir"]);
+            }
+        }
+
+        if (node["record"]["segment_size"]) {
+            try {
+                int segment_size = node["record"]["segment_size"].as<int>();
+
+                if (segment_size < 1 || segment_size > 65536)
+                    throw "invalid record segment size not within range of 1 - 65536)";
+
+                record_segment_size = (size_t)segment_size * 1024 * 1024;  // MB to bytes
+
+                if (debug_general)
+                    std::cout << "   Config: record segment size: " << record_segment_size << std::endl;
+
+            } catch (YAML::TypedBadConversion<int> err) {
+                printWarning("record.segment_size is not of type int", node["record"]["segment_size"]);
+            }
+        }
+
+        if (node["record"]["max_disk"]) {
+            try {
+                int max_disk = node["record"]["max_disk"].as<int>();
+
+                if (max_disk < 16 || max_disk > 16777216)
+                    throw "invalid record max disk not within range of 16 - 16777216)";
+
+                record_max_disk = (size_t)max_disk * 1024 * 1024;  // MB to bytes
+
+                if (debug_general)
+                    std::cout << "   Config: record max disk: " << record_max_disk << std::endl;
+
+            } catch (YAML::TypedBadConversion<int> err) {
+                printWarning("record.max_disk is not of type int", node["record"]["max_disk"]);
+            }
+        }
+
+        if (node["record"]["queue_size"]) {
+            try {
+                int queue_size = node["record"]["queue_size"].as<int>();
+
+                if (queue_size < 1 || queue_size > 4096)
+                    throw "invalid record queue size not within range of 1 - 4096)";
+
+                record_queue_size = (size_t)queue_size * 1024 * 1024;  // MB to bytes
+
+                if (debug_general)
+                    std::cout << "   Config: record queue size: " << record_queue_size << std::endl;
+
+            } catch (YAML::TypedBadConversion<int> err) {
+                printWarning("record.queue_size is not of type int", node["record"]["queue_size"]);
+            }
+        }
+
+        if (node["record"]["compress"]) {
+            try {
+                record_compress = node["record"]["compress"].as<bool>();
+
+                if (debug_general)
+                    std::cout << "   Config: record compress: " << record_compress << std::endl;
+
+            } catch (YAML::TypedBadConversion<bool> err) {
+                printWarning("record.compress is not of type bool", node["record"]["compress"]);
+            }
+        }
+    }
+
+    if (node["latency"]) {
+        if (node["latency"]["enabled"]) {
+            try {
+                latency_enabled = node["latency"]["enabled"].as<bool>();
+
+                if (debug_general)
+                    std::cout << "   Config: latency enabled: " << latency_enabled << std::endl;
+
+            } catch (YAML::TypedBadConversion<bool> err) {
+                printWarning("latency.enabled is not of type bool", node["latency"]["enabled"]);
+            }
+        }
+    }
+
+    if (node["metrics"]) {
+        if (node["metrics"]["address"]) {
+            try {
+                metrics_address = node["metrics"]["address"].as<std::string>();
+
+                if (debug_general)
+                    std::cout << "   Config: metrics address: " << metrics_address << std::endl;
+
+            } catch (YAML::TypedBadConversion<std::string> err) {
+                printWarning("metrics.address is not of type string", node["metrics"]["address"]);
+            }
+        }
+
+        if (node["metrics"]["port"]) {
+            try {
+                metrics_port = node["metrics"]["port"].as<int>();
+
+                if (metrics_port < 0 || metrics_port > 65535)
+                    throw "invalid metrics port not within range of 0 - 65535";
+
+                if (debug_general)
+                    std::cout << "   Config: metrics port: " << metrics_port << std::endl;
+
+            } catch (YAML::TypedBadConversion<int> err) {
+                printWarning("metrics.port is not of type int", node["metrics"]["port"]);
+            }
+        }
+    }
+
+    if (node["logging"]) {
+        if (node["logging"]["async"]) {
+            try {
+                log_async = node["logging"]["async"].as<bool>();
+
+                if (debug_general)
+                    std::cout << "   Config: logging async: " << log_async << std::endl;
+
+            } catch (YAML::TypedBadConversion<bool> err) {
+                printWarning("logging.async is not of type bool", node["logging"]["async"]);
+            }
+        }
+
+        if (node["logging"]["flush_interval"]) {
+            try {
+                log_flush_ms = node["logging"]["flush_interval"].as<int>();
+
+                if (log_flush_ms < 10 || log_flush_ms > 5000)
+                    throw "invalid logging flush interval not within range of 10 - 5000 ms)";
+
+                if (debug_general)
+                    std::cout << "   Config: logging flush interval: " << log_flush_ms << std::endl;
+
+            } catch (YAML::TypedBadConversion<int> err) {
+                printWarning("logging.flush_interval is not of type int", node["logging"]["flush_interval"]);
+            }
+        }
+
+        if (node["logging"]["ring_size"]) {
+            try {
+                log_ring_kb = node["logging"]["ring_size"].as<int>();
+
+                if (log_ring_kb < 4 || log_ring_kb > 4096)
+                    throw "invalid logging ring size not within range of 4 - 4096 KB)";
+
+                if (debug_general)
+                    std::cout << "   Config: logging ring size: " << log_ring_kb << std::endl;
+
+            } catch (YAML::TypedBadConversion<int> err) {
+                printWarning("logging.ring_size is not of type int", node["logging"]["ring_size"]);
+            }
+        }
+    }
+
     if (node["startup"]) {
         if (node["startup"]["max_concurrent_routers"]) {
             try {
@@ -297,6 +764,45 @@ void Config::parseBase(const YAML::Node &node) {
             }
         }
 
+        if (node["startup"]["baseline_file"]) {
+            try {
+                baseline_file = node["startup"]["baseline_file"].as<std::string>();
+
+                if (debug_general)
+                    std::cout << "   Config: baseline_file: " << baseline_file << std::endl;
+
+            } catch (YAML::TypedBadConversion<std::string> err) {
+                printWarning("baseline_file is not of type string", node["startup"]["baseline_file"]);
+            }
+        }
+
+        if (node["startup"]["adaptive"]) {
+            try {
+                startup_adaptive = node["startup"]["adaptive"].as<bool>();
+
+                if (debug_general)
+                    std::cout << "   Config: adaptive: " << startup_adaptive << std::endl;
+
+            } catch (YAML::TypedBadConversion<bool> err) {
+                printWarning("adaptive is not of type bool", node["startup"]["adaptive"]);
+            }
+        }
+
+        if (node["startup"]["max_cpu"]) {
+            try {
+                startup_max_cpu = node["startup"]["max_cpu"].as<int>();
+
+                if (startup_max_cpu < 10 || startup_max_cpu > 100)
+                    throw "invalid max cpu not within range of 10-100 percent)";
+
+                if (debug_general)
+                    std::cout << "   Config: max_cpu: " << startup_max_cpu << std::endl;
+
+            } catch (YAML::TypedBadConversion<int> err) {
+                printWarning("max_cpu is not of type int", node["startup"]["max_cpu"]);
+            }
+        }
+
         if (node["startup"]["pat_enabled"]) {
             try {
                 pat_enabled = node["startup"]["pat_enabled"].as<bool>();
@@ -365,6 +871,42 @@ void Config::parseDebug(const YAML::Node &node) {
             printWarning("debug.msgbus is not of type boolean", node["msgbus"]);
         }
     }
+
+    if (!debug_redis and node["redis"]) {
+        try {
+            debug_redis = node["redis"].as<bool>();
+
+            if (debug_general)
+                std::cout << "   Config: debug redis : " << debug_redis << std::endl;
+
+        } catch (YAML::TypedBadConversion<bool> err) {
+            printWarning("debug.redis is not of type boolean", node["redis"]);
+        }
+    }
+
+    if (!debug_profile and node["profile"]) {
+        try {
+            debug_profile = node["profile"].as<bool>();
+
+            if (debug_general)
+                std::cout << "   Config: debug profile : " << debug_profile << std::endl;
+
+        } catch (YAML::TypedBadConversion<bool> err) {
+            printWarning("debug.profile is not of type boolean", node["profile"]);
+        }
+    }
+
+    if (node["profile_file"]) {
+        try {
+            profile_file = node["profile_file"].as<std::string>();
+
+            if (debug_general)
+                std::cout << "   Config: debug profile file : " << profile_file << std::endl;
+
+        } catch (YAML::TypedBadConversion<std::string> err) {
+            printWarning("debug.profile_file is not of type string", node["profile_file"]);
+        }
+    }
 }
 
 /**
@@ -583,6 +1125,90 @@ void Config::parseKafka(const YAML::Node &node) {
     }
 }
 
+/**
+ * Parse the redis configuration
+ *
+ * \param [in] node     Reference to the yaml NODE
+ */
+void Config::parseRedis(const YAML::Node &node) {
+    std::string value;
+
+    if (node["schema"] && node["schema"].Type() == YAML::NodeType::Scalar) {
+        try {
+            value = node["schema"].as<std::string>();
+
+            if (value.compare("compact") == 0)
+                redis_compact_schema = true;
+            else if (value.compare("default") == 0)
+                redis_compact_schema = false;
+            else
+                throw "invalid value for redis.schema, should be one of default or compact";
+
+            if (debug_general)
+                std::cout << "   Config: redis schema : " << value << std::endl;
+
+        } catch (YAML::TypedBadConversion<std::string> err) {
+            printWarning("redis.schema is not of type string", node["schema"]);
+        }
+    }
+
+    if (node["queue_size"] && node["queue_size"].Type() == YAML::NodeType::Scalar) {
+        try {
+            redis_queue_size = node["queue_size"].as<int>();
+
+            if (redis_queue_size < 64 || redis_queue_size > 1048576)
+                throw "invalid value for redis.queue_size, should be between 64 and 1048576";
+
+            if (debug_general)
+                std::cout << "   Config: redis queue size : " << redis_queue_size << std::endl;
+
+        } catch (YAML::TypedBadConversion<int> err) {
+            printWarning("redis.queue_size is not of type int", node["queue_size"]);
+        }
+    }
+
+    if (node["connections"] && node["connections"].Type() == YAML::NodeType::Scalar) {
+        try {
+            redis_connections = node["connections"].as<int>();
+
+            if (redis_connections < 1 || redis_connections > 16)
+                throw "invalid value for redis.connections, should be between 1 and 16";
+
+            if (debug_general)
+                std::cout << "   Config: redis connections : " << redis_connections << std::endl;
+
+        } catch (YAML::TypedBadConversion<int> err) {
+            printWarning("redis.connections is not of type int", node["connections"]);
+        }
+    }
+
+    if (node["notifications"] && node["notifications"].Type() == YAML::NodeType::Scalar) {
+        try {
+            redis_notifications = node["notifications"].as<bool>();
+
+            if (debug_general)
+                std::cout << "   Config: redis notifications : " << redis_notifications << std::endl;
+
+        } catch (YAML::TypedBadConversion<bool> err) {
+            printWarning("redis.notifications is not of type bool", node["notifications"]);
+        }
+    }
+
+    if (node["attr_sweep_interval"] && node["attr_sweep_interval"].Type() == YAML::NodeType::Scalar) {
+        try {
+            redis_attr_sweep_secs = node["attr_sweep_interval"].as<int>();
+
+            if (redis_attr_sweep_secs < 0 || redis_attr_sweep_secs > 86400)
+                throw "invalid value for redis.attr_sweep_interval, should be between 0 and 86400";
+
+            if (debug_general)
+                std::cout << "   Config: redis attr sweep interval : " << redis_attr_sweep_secs << std::endl;
+
+        } catch (YAML::TypedBadConversion<int> err) {
+            printWarning("redis.attr_sweep_interval is not of type int", node["attr_sweep_interval"]);
+        }
+    }
+}
 
 
 /**
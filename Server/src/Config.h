@@ -17,7 +17,18 @@
 #include <boost/xpressive/xpressive.hpp>
 #include <boost/exception/all.hpp>
 
+#include "RouterBaseline.h"
+
 #define MAX_THREADS 200
+#define MAX_WORKERS 64
+
+#define AFFINITY_POLICY_NONE    0       ///< Router threads run on any CPU
+#define AFFINITY_POLICY_NODE    1       ///< Router threads and buffers are placed on a NUMA node
+#define AFFINITY_POLICY_CORE    2       ///< Node placement, router I/O and parse threads pinned to sibling CPUs
+
+#define SINK_MSGBUS             0       ///< Routers are sent to the message bus (Kafka or Redis)
+#define SINK_NULL               1       ///< Routers are parsed and discarded, see MsgBusNull
+#define SINK_COUNTING           2       ///< Routers are parsed and counted, see MsgBusCounting
 
 using namespace boost::xpressive;
 
@@ -38,7 +49,11 @@ public:
     std::string bind_ipv4;                ///< IP to listen on for IPv4
     std::string bind_ipv6;                ///< IP to listen on for IPv6
 
-    int         bmp_buffer_size;          ///< BMP buffer size in bytes (min is 2M max is 128M)
+    int         bmp_buffer_size;          ///< Max BMP buffer size per router in bytes (min is 2M max is 384M)
+    int         bmp_buffer_min;           ///< BMP buffer bytes reserved per router in the buffer pool
+    size_t      bmp_buffer_pool_size;     ///< BMP buffer pool budget in bytes for all routers
+    std::string bmp_spill_dir;            ///< Directory for router buffer spill files, empty to disable
+    size_t      bmp_spill_quota;          ///< Max bytes spilled per router
     bool        svr_ipv4;                 ///< Indicates if server should listen for IPv4 connections
     bool        svr_ipv6;                 ///< Indicates if server should listen for IPv6 connections
 
@@ -46,6 +61,9 @@ public:
     bool        debug_bgp;
     bool        debug_bmp;
     bool        debug_msgbus;
+    bool        debug_redis;
+    bool        debug_profile;            ///< Time the parsers and sinks, dumped on SIGUSR2
+    std::string profile_file;             ///< File the profile is appended to, empty to log it
 
     int         heartbeat_interval;      ///< Heartbeat interval in seconds for collector updates
     int   	tx_max_bytes;            ///< Maximum transmit message size
@@ -62,6 +80,37 @@ public:
     int         initial_router_time;     ///<Initial time in allowing another concurrent router
     bool        calculate_baseline;      ///<Indicates if router baseline time should be calculated
     bool        pat_enabled;             ///<Indicates if router hash needs to be based on INIT message instead of source IP
+    std::string baseline_file;           ///< File to persist router baselines, empty to not persist
+    bool        startup_adaptive;        ///< Indicates if the concurrent router limit adapts to the collector load
+    int         startup_max_cpu;         ///< Collector CPU percent (of all CPUs) above which the adaptive limit is lowered
+    bool        log_async;               ///< Indicates if logging is done by a background writer thread
+    int         log_flush_ms;            ///< Max time in milliseconds before async log records are written
+    int         log_ring_kb;             ///< KB of the async log ring of each thread
+    std::string handoff_socket;          ///< Unix socket path for collector handoff, empty to disable
+    int         workers;                 ///< Number of collector worker processes sharing the BMP port
+    int         listen_backlog;          ///< Listen backlog of the BMP listening sockets
+    int         affinity_policy;         ///< One of AFFINITY_POLICY_*
+    std::string affinity_cpus;           ///< CPU list router threads are placed on, empty for all
+    bool        pipeline_enabled;        ///< Indicates if routers are parsed and sent to the message bus by separate threads
+    int         pipeline_queue_size;     ///< Max BMP messages queued per router between the parse and message bus threads
+    int         parse_pool_workers;      ///< BGP parse workers shared by the routers, zero to parse in the router threads
+    int         parse_pool_max_pending;  ///< Max route monitoring messages per router in the parse pool
+    int         sink_type;               ///< One of SINK_*
+    bool        sink_hash;               ///< Indicates if the counting sink hashes the objects
+    std::string record_dir;              ///< Directory for raw BMP recordings of the routers, empty to disable
+    size_t      record_segment_size;     ///< Bytes of a recording segment before it is rotated
+    size_t      record_max_disk;         ///< Max bytes of all recording segments, the oldest are removed
+    size_t      record_queue_size;       ///< Max bytes queued to the recording writer, more is dropped
+    bool        record_compress;         ///< Indicates if recording segments are gzip compressed
+    bool        latency_enabled;         ///< Indicates if the read to sink commit latency of the routers is measured
+    std::string metrics_address;         ///< Address the metrics endpoint listens on
+    int         metrics_port;            ///< Port of the metrics endpoint (plus the worker number), zero to disable
+
+    bool        redis_compact_schema;    ///< Indicates if the compact (per-peer hash + shared attribute) redis layout is used
+    int         redis_queue_size;        ///< Max redis operations queued to the writer threads
+    int         redis_connections;       ///< Number of redis connections/writers shared by all router sessions
+    bool        redis_notifications;     ///< Indicates if change records are published for BMP_STATE_DB writes
+    int         redis_attr_sweep_secs;   ///< Interval in seconds of the unreferenced attribute set sweep, 0 to disable
 
     /**
      * matching structs and maps
@@ -111,10 +160,9 @@ public:
     typedef std::map<std::string, std::string>::iterator topic_names_map_iter;
 
     /**
-     * map for router baseline times
+     * Router baseline (RIB dump) times, shared by all router threads
      */
-    std::map<std::string, float> router_baseline_time;
-    typedef std::map<std::string, float>::iterator router_baseline_time_iter;
+    RouterBaseline router_baseline;
 
     /*********************************************************************//**
      * Constructor for class
@@ -128,6 +176,16 @@ public:
      ***********************************************************************/
     void load(const char *cfg_filename);
 
+    /*********************************************************************//**
+     * Reload only the debug configuration from file in YAML format
+     *
+     * \details Debug flags are reset first, so debug set on the command line
+     *          is replaced by the file settings.
+     *
+     * \param [in] cfg_filename     Yaml configuration filename
+     ***********************************************************************/
+    void reloadDebug(const char *cfg_filename);
+
 private:
     /**
      * Parse the base configuration
@@ -150,6 +208,13 @@ private:
      */
     void parseKafka(const YAML::Node &node);
 
+    /**
+     * Parse the redis configuration
+     *
+     * \param [in] node     Reference to the yaml NODE
+     */
+    void parseRedis(const YAML::Node &node);
+
     /**
      * Parse the kafka topics configuration
      *
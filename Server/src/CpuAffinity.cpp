@@ -0,0 +1,357 @@
+/*
+ * Copyright (c) 2024 Microsoft, Inc. and others.  All rights reserved.
+ *
+ * This program and the accompanying materials are made available under the
+ * terms of the Eclipse Public License v1.0 which accompanies this distribution,
+ * and is available at http://www.eclipse.org/legal/epl-v10.html
+ *
+ */
+
+#include <pthread.h>
+#include <dirent.h>
+#include <unistd.h>
+#include <sys/syscall.h>
+#include <linux/mempolicy.h>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <algorithm>
+
+#include "CpuAffinity.h"
+
+#define NODE_MASK_LONGS     (AFFINITY_MAX_NODES / (8 * sizeof(unsigned long)))
+
+/**
+ * Read the first line of a sysfs file
+ *
+ * \param [in]  path    File path
+ * \param [out] line    First line without the newline
+ *
+ * \return false if the file cannot be read
+ */
+static bool readLine(const char *path, std::string &line) {
+    FILE *fp = fopen(path, "r");
+    if (fp == NULL)
+        return false;
+
+    char buf[4096];
+    bool ok = fgets(buf, sizeof(buf), fp) != NULL;
+    fclose(fp);
+
+    if (ok) {
+        buf[strcspn(buf, "\n")] = 0;
+        line = buf;
+    }
+
+    return ok;
+}
+
+/**
+ * Set the mask of a single NUMA node
+ *
+ * \return false if the node id is not supported
+ */
+static bool nodeMask(int node_id, unsigned long *mask) {
+    if (node_id < 0 or node_id >= AFFINITY_MAX_NODES - 1)
+        return false;
+
+    memset(mask, 0, NODE_MASK_LONGS * sizeof(unsigned long));
+    mask[node_id / (8 * sizeof(unsigned long))] |= 1UL << (node_id % (8 * sizeof(unsigned long)));
+    return true;
+}
+
+/**
+ * Constructor for class
+ *
+ *  \param [in] logPtr  Pointer to existing Logger for app logging
+ *  \param [in] config  Pointer to the loaded configuration
+ *  \param [in] worker  Worker index, workers start placing routers on different nodes
+ *
+ *  \throws const char * if affinity.cpus is invalid or has no usable CPU
+ */
+CpuAffinity::CpuAffinity(Logger *logPtr, Config *config, int worker) {
+    logger = logPtr;
+    cfg = config;
+    debug = cfg->debug_general;
+
+    cpu_set_t allowed;
+    CPU_ZERO(&allowed);
+    sched_getaffinity(0, sizeof(allowed), &allowed);
+
+    if (cfg->affinity_cpus.size()) {
+        cpu_set_t cpus;
+
+        if (not parseCpuList(cfg->affinity_cpus, cpus))
+            throw "ERROR: Invalid affinity cpus list";
+
+        CPU_AND(&allowed, &allowed, &cpus);
+    }
+
+    if (CPU_COUNT(&allowed) == 0)
+        throw "ERROR: No usable CPU in the affinity cpus list";
+
+    // NUMA nodes in id order, nodes without usable CPUs are not used
+    DIR *dir = opendir("/sys/devices/system/node");
+    std::vector<int> ids;
+
+    if (dir != NULL) {
+        struct dirent *ent;
+        int id;
+
+        while ((ent = readdir(dir)) != NULL) {
+            if (sscanf(ent->d_name, "node%d", &id) == 1)
+                ids.push_back(id);
+        }
+        closedir(dir);
+    }
+
+    std::sort(ids.begin(), ids.end());
+
+    for (size_t i = 0; i < ids.size(); i++) {
+        char path[128];
+        std::string list;
+        node_info node;
+
+        snprintf(path, sizeof(path), "/sys/devices/system/node/node%d/cpulist", ids[i]);
+
+        if (not readLine(path, list) or not parseCpuList(list, node.cpus))
+            continue;
+
+        CPU_AND(&node.cpus, &node.cpus, &allowed);
+        if (CPU_COUNT(&node.cpus) == 0)
+            continue;
+
+        node.id = ids[i];
+        node.routers = 0;
+        nodes.push_back(node);
+    }
+
+    // Without NUMA, all CPUs are one node and memory is not bound
+    if (nodes.empty()) {
+        node_info node;
+        node.id = -1;
+        node.cpus = allowed;
+        node.routers = 0;
+        nodes.push_back(node);
+    }
+
+    if (cfg->affinity_policy == AFFINITY_POLICY_CORE) {
+        for (int i = 0; i < (int)nodes.size(); i++)
+            addPairs(i);
+    }
+
+    offset = worker > 0 ? worker % nodes.size() : 0;
+
+    LOG_INFO("Router CPU affinity by %s: %d usable CPUs on %zu NUMA nodes, %zu CPU pairs",
+             cfg->affinity_policy == AFFINITY_POLICY_CORE ? "core" : "node",
+             CPU_COUNT(&allowed), nodes.size(), pairs.size());
+}
+
+void CpuAffinity::addPairs(int index) {
+    std::vector<std::vector<int>> cores;
+    std::vector<int> singles;
+    cpu_set_t &cpus = nodes[index].cpus;
+
+    // Group the node CPUs by core, a core is identified by its lowest sibling
+    for (int cpu = 0; cpu < CPU_SETSIZE; cpu++) {
+        if (not CPU_ISSET(cpu, &cpus))
+            continue;
+
+        char path[128];
+        std::string list;
+        cpu_set_t siblings;
+        int core = cpu;
+
+        snprintf(path, sizeof(path), "/sys/devices/system/cpu/cpu%d/topology/thread_siblings_list", cpu);
+
+        if (readLine(path, list) and parseCpuList(list, siblings)) {
+            for (int c = 0; c < cpu; c++) {
+                if (CPU_ISSET(c, &siblings) and CPU_ISSET(c, &cpus)) {
+                    core = c;
+                    break;
+                }
+            }
+        }
+
+        size_t i;
+        for (i = 0; i < cores.size(); i++) {
+            if (cores[i].front() == core)
+                break;
+        }
+
+        if (i == cores.size())
+            cores.push_back(std::vector<int>());
+
+        cores[i].push_back(cpu);
+    }
+
+    for (size_t i = 0; i < cores.size(); i++) {
+        size_t c;
+        for (c = 0; c + 1 < cores[i].size(); c += 2) {
+            pair_info pair = { index, cores[i][c], cores[i][c + 1], 0 };
+            pairs.push_back(pair);
+        }
+
+        if (c < cores[i].size())
+            singles.push_back(cores[i][c]);
+    }
+
+    // Cores without a usable sibling are paired with the next core
+    for (size_t c = 0; c < singles.size(); c += 2) {
+        pair_info pair = { index, singles[c], singles[c + 1 < singles.size() ? c + 1 : c], 0 };
+        pairs.push_back(pair);
+    }
+}
+
+void CpuAffinity::assign(placement &p) {
+    int n = nodes.size();
+
+    p.node = -1;
+    for (int k = 0; k < n; k++) {
+        int i = (offset + k) % n;
+
+        if (p.node < 0 or nodes[i].routers < nodes[p.node].routers)
+            p.node = i;
+    }
+
+    nodes[p.node].routers++;
+
+    p.pair = -1;
+    p.io_cpu = -1;
+    p.parse_cpu = -1;
+
+    for (int i = 0; i < (int)pairs.size(); i++) {
+        if (pairs[i].node == p.node and (p.pair < 0 or pairs[i].routers < pairs[p.pair].routers))
+            p.pair = i;
+    }
+
+    if (p.pair >= 0) {
+        pairs[p.pair].routers++;
+        p.io_cpu = pairs[p.pair].io_cpu;
+        p.parse_cpu = pairs[p.pair].parse_cpu;
+    }
+
+    SELF_DEBUG("Router placed on node %d, io cpu %d, parse cpu %d", nodes[p.node].id, p.io_cpu, p.parse_cpu);
+}
+
+void CpuAffinity::release(placement &p) {
+    if (p.node >= 0)
+        nodes[p.node].routers--;
+
+    if (p.pair >= 0)
+        pairs[p.pair].routers--;
+
+    p.node = p.pair = p.io_cpu = p.parse_cpu = -1;
+}
+
+bool CpuAffinity::bindNode(const placement &p) {
+    if (p.node < 0)
+        return true;
+
+    if (pthread_setaffinity_np(pthread_self(), sizeof(cpu_set_t), &nodes[p.node].cpus) != 0)
+        return false;
+
+    unsigned long mask[NODE_MASK_LONGS];
+    if (nodeMask(nodes[p.node].id, mask) and
+            syscall(SYS_set_mempolicy, MPOL_PREFERRED, mask, AFFINITY_MAX_NODES) != 0)
+        return false;
+
+    return true;
+}
+
+bool CpuAffinity::pinCpu(int cpu) {
+    if (cpu < 0)
+        return true;
+
+    cpu_set_t cpus;
+    CPU_ZERO(&cpus);
+    CPU_SET(cpu, &cpus);
+
+    return pthread_setaffinity_np(pthread_self(), sizeof(cpus), &cpus) == 0;
+}
+
+int CpuAffinity::getNodeId(const placement &p) {
+    return p.node >= 0 ? nodes[p.node].id : -1;
+}
+
+void CpuAffinity::bindMemory(void *addr, size_t len, int node_id) {
+    unsigned long mask[NODE_MASK_LONGS];
+
+    // Best effort, memory is still usable if it cannot be bound
+    if (nodeMask(node_id, mask))
+        syscall(SYS_mbind, addr, len, MPOL_PREFERRED, mask, AFFINITY_MAX_NODES, 0);
+}
+
+bool CpuAffinity::getThreadCpu(pid_t tid, uint64_t &ticks, int &cpu) {
+    char path[64];
+    std::string stat;
+
+    snprintf(path, sizeof(path), "/proc/self/task/%d/stat", tid);
+    if (not readLine(path, stat))
+        return false;
+
+    // The thread name may have spaces, fields are counted after it (state is field 3)
+    size_t pos = stat.rfind(')');
+    if (pos == std::string::npos)
+        return false;
+
+    const char *ptr = stat.c_str() + pos + 1;
+    unsigned long long utime = 0, stime = 0;
+
+    for (int field = 3; field <= 39 and *ptr; field++) {
+        while (*ptr == ' ')
+            ptr++;
+
+        if (field == 14)
+            utime = strtoull(ptr, NULL, 10);
+        else if (field == 15)
+            stime = strtoull(ptr, NULL, 10);
+        else if (field == 39) {
+            cpu = atoi(ptr);
+            ticks = utime + stime;
+            return true;
+        }
+
+        while (*ptr and *ptr != ' ')
+            ptr++;
+    }
+
+    return false;
+}
+
+bool CpuAffinity::parseCpuList(const std::string &list, cpu_set_t &cpus) {
+    const char *ptr = list.c_str();
+
+    CPU_ZERO(&cpus);
+
+    while (*ptr) {
+        char *end;
+        long first = strtol(ptr, &end, 10);
+        long last = first;
+
+        if (end == ptr)
+            return false;
+
+        if (*end == '-') {
+            ptr = end + 1;
+            last = strtol(ptr, &end, 10);
+
+            if (end == ptr)
+                return false;
+        }
+
+        if (first < 0 or last < first or last >= CPU_SETSIZE)
+            return false;
+
+        for (long cpu = first; cpu <= last; cpu++)
+            CPU_SET(cpu, &cpus);
+
+        ptr = end;
+        if (*ptr == ',')
+            ptr++;
+        else if (*ptr)
+            return false;
+    }
+
+    return CPU_COUNT(&cpus) > 0;
+}
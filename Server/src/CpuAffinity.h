@@ -0,0 +1,167 @@
+/*
+ * Copyright (c) 2024 Microsoft, Inc. and others.  All rights reserved.
+ *
+ * This program and the accompanying materials are made available under the
+ * terms of the Eclipse Public License v1.0 which accompanies this distribution,
+ * and is available at http://www.eclipse.org/legal/epl-v10.html
+ *
+ */
+
+#ifndef CPUAFFINITY_H_
+#define CPUAFFINITY_H_
+
+#include <sched.h>
+#include <sys/types.h>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+#include "Config.h"
+#include "Logger.h"
+
+#define AFFINITY_MAX_NODES          1024        ///< Max NUMA node id + 1 supported for memory binding
+
+/**
+ * \class   CpuAffinity
+ *
+ * \brief   Places router threads and buffers on CPUs and NUMA nodes
+ * \details
+ *      The CPU topology is read from sysfs (/sys/devices/system/node and the cpu thread
+ *      siblings), limited to the CPUs the collector may run on and to affinity.cpus.
+ *
+ *      With the node policy, each router is placed on the NUMA node with the fewest
+ *      routers.  The router threads (socket I/O, parse and the message bus threads they
+ *      start) only run on the CPUs of that node, and prefer memory of that node.  Router
+ *      buffer chunks are bound to the node (see BufferPool).
+ *
+ *      With the core policy, the I/O and parse threads of a router are additionally pinned
+ *      to a pair of sibling CPUs (hyperthreads of one core, or two cores of the node
+ *      without SMT), the pair with the fewest routers on the node.  Message bus threads
+ *      stay on the node.
+ *
+ *      Routers are placed by the server thread only, the apply methods are called by the
+ *      router threads.
+ */
+class CpuAffinity {
+public:
+    /**
+     * Placement of a router
+     */
+    struct placement {
+        int     node;                       ///< Index in nodes, -1 if not placed
+        int     pair;                       ///< Index in pairs, -1 for node policy
+        int     io_cpu;                     ///< CPU of the router I/O thread, -1 for any CPU of the node
+        int     parse_cpu;                  ///< CPU of the router parse thread, -1 for any CPU of the node
+    };
+
+    /**
+     * Constructor for class
+     *
+     *  \param [in] logPtr  Pointer to existing Logger for app logging
+     *  \param [in] config  Pointer to the loaded configuration
+     *  \param [in] worker  Worker index, workers start placing routers on different nodes
+     *
+     *  \throws const char * if affinity.cpus is invalid or has no usable CPU
+     */
+    CpuAffinity(Logger *logPtr, Config *config, int worker);
+
+    /**
+     * Place a router on the node (and CPU pair) with the fewest routers
+     *
+     * \param [out] p       Placement of the router
+     */
+    void assign(placement &p);
+
+    /**
+     * Remove a router placed by assign()
+     *
+     * \param [in,out] p    Placement of the router, reset
+     */
+    void release(placement &p);
+
+    /**
+     * Restrict the calling thread to the node CPUs and prefer node memory
+     *
+     * \details Threads created afterwards by the calling thread inherit both.
+     *
+     * \param [in] p        Placement of the router
+     *
+     * \return false if the affinity or memory policy could not be set
+     */
+    bool bindNode(const placement &p);
+
+    /**
+     * Pin the calling thread to a CPU
+     *
+     * \param [in] cpu      CPU, -1 does nothing
+     *
+     * \return false if the affinity could not be set
+     */
+    bool pinCpu(int cpu);
+
+    /**
+     * Get the NUMA node id of a placement, -1 if not placed
+     */
+    int getNodeId(const placement &p);
+
+    /**
+     * Bind memory to a NUMA node
+     *
+     * \param [in] addr     Page aligned address
+     * \param [in] len      Length in bytes
+     * \param [in] node_id  NUMA node id, -1 does nothing
+     */
+    static void bindMemory(void *addr, size_t len, int node_id);
+
+    /**
+     * Get the CPU time and last CPU of a thread of this process
+     *
+     * \param [in]  tid     Thread id (gettid)
+     * \param [out] ticks   User and system time in clock ticks
+     * \param [out] cpu     CPU the thread last ran on
+     *
+     * \return false if the thread does not exist
+     */
+    static bool getThreadCpu(pid_t tid, uint64_t &ticks, int &cpu);
+
+    /**
+     * Parse a CPU list, such as 0-3,8,10-11
+     *
+     * \param [in]  list    CPU list
+     * \param [out] cpus    CPUs in the list
+     *
+     * \return false if the list is invalid
+     */
+    static bool parseCpuList(const std::string &list, cpu_set_t &cpus);
+
+private:
+    Logger      *logger;                    ///< Logging class pointer
+    Config      *cfg;                       ///< Config pointer
+    bool        debug;                      ///< debug flag to indicate debugging
+
+    struct node_info {
+        int         id;                     ///< NUMA node id
+        cpu_set_t   cpus;                   ///< Usable CPUs of the node
+        int         routers;                ///< Routers placed on the node
+    };
+
+    struct pair_info {
+        int         node;                   ///< Index in nodes
+        int         io_cpu;
+        int         parse_cpu;
+        int         routers;                ///< Routers placed on the pair
+    };
+
+    std::vector<node_info>  nodes;
+    std::vector<pair_info>  pairs;
+    int                     offset;         ///< First node for ties, spreads the workers
+
+    /**
+     * Add the CPU pairs of a node, sibling CPUs first
+     *
+     * \param [in] index    Index in nodes
+     */
+    void addPairs(int index);
+};
+
+#endif /* CPUAFFINITY_H_ */
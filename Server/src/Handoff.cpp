@@ -0,0 +1,366 @@
+/*
+ * Copyright (c) 2024 Microsoft, Inc. and others.  All rights reserved.
+ *
+ * This program and the accompanying materials are made available under the
+ * terms of the Eclipse Public License v1.0 which accompanies this distribution,
+ * and is available at http://www.eclipse.org/legal/epl-v10.html
+ *
+ */
+
+#include <sys/socket.h>
+#include <sys/stat.h>
+#include <sys/un.h>
+#include <sys/time.h>
+#include <cstring>
+#include <cerrno>
+#include <fcntl.h>
+#include <unistd.h>
+
+#include "Handoff.h"
+
+/**
+ * Constructor for class
+ *
+ *  \param [in] logPtr  Pointer to existing Logger for app logging
+ *  \param [in] config  Pointer to the loaded configuration
+ */
+Handoff::Handoff(Logger *logPtr, Config *config) {
+    logger = logPtr;
+    cfg = config;
+    debug = cfg->debug_general;
+
+    listenSock = -1;
+    sock = -1;
+}
+
+Handoff::~Handoff() {
+    if (sock >= 0)
+        close(sock);
+
+    if (listenSock >= 0) {
+        close(listenSock);
+        unlink(cfg->handoff_socket.c_str());
+    }
+}
+
+/**
+ * Listen for handoff requests on base.handoff_socket
+ *
+ * \throws const char * with the error message
+ */
+void Handoff::listen() {
+    sockaddr_un addr;
+
+    if (cfg->handoff_socket.size() >= sizeof(addr.sun_path))
+        throw "ERROR: handoff socket path is too long";
+
+    bzero(&addr, sizeof(addr));
+    addr.sun_family = AF_UNIX;
+    strncpy(addr.sun_path, cfg->handoff_socket.c_str(), sizeof(addr.sun_path) - 1);
+
+    if ((listenSock = socket(AF_UNIX, SOCK_STREAM | SOCK_NONBLOCK | SOCK_CLOEXEC, 0)) < 0)
+        throw "ERROR: Cannot open handoff socket";
+
+    // Only one collector runs with this config, a left over socket file is stale
+    unlink(addr.sun_path);
+
+    if (bind(listenSock, (sockaddr *)&addr, sizeof(addr)) < 0) {
+        close(listenSock);
+        listenSock = -1;
+        throw "ERROR: Cannot bind handoff socket";
+    }
+
+    chmod(addr.sun_path, S_IRUSR | S_IWUSR);
+
+    if (::listen(listenSock, 1) < 0) {
+        close(listenSock);
+        listenSock = -1;
+        unlink(addr.sun_path);
+        throw "ERROR: Cannot listen on handoff socket";
+    }
+
+    LOG_INFO("Listening for collector handoff requests on %s", addr.sun_path);
+}
+
+/**
+ * Accept a handoff request, does not block
+ *
+ * \return true if a new collector connected and its version matches
+ */
+bool Handoff::acceptRequest() {
+    if (listenSock < 0)
+        return false;
+
+    int fd = accept4(listenSock, NULL, NULL, SOCK_CLOEXEC);
+    if (fd < 0)
+        return false;
+
+    sock = fd;
+    setTimeout(sock);
+
+    hello_msg hello;
+    if (not recvAll(&hello, sizeof(hello)) or hello.magic != HANDOFF_MAGIC) {
+        LOG_WARN("Ignoring invalid handoff request");
+        close(sock);
+        sock = -1;
+        return false;
+    }
+
+    if (hello.version != HANDOFF_VERSION or hello.info_len != sizeof(BMPListener::ClientInfo)) {
+        LOG_WARN("Rejecting handoff request from version %u (info %u), this collector is version %u (info %zu)",
+                 hello.version, hello.info_len, HANDOFF_VERSION, sizeof(BMPListener::ClientInfo));
+        close(sock);
+        sock = -1;
+        return false;
+    }
+
+    // The new collector listens on the path once it took over
+    close(listenSock);
+    listenSock = -1;
+    unlink(cfg->handoff_socket.c_str());
+
+    LOG_NOTICE("Collector handoff requested");
+    return true;
+}
+
+/**
+ * Send a router connection to the new collector
+ *
+ * \param [in] router   Router to send, the socket is c_sock
+ *
+ * \return false if the record could not be sent
+ */
+bool Handoff::sendRouter(const Router &router) {
+    record_hdr hdr;
+    hdr.magic = HANDOFF_MAGIC;
+    hdr.type = RECORD_ROUTER;
+    hdr.info_len = sizeof(router.client);
+    hdr.peers_len = router.peers.size();
+    hdr.data_len = router.data.size();
+
+    // The socket is attached to the header
+    iovec iov;
+    iov.iov_base = &hdr;
+    iov.iov_len = sizeof(hdr);
+
+    char cbuf[CMSG_SPACE(sizeof(int))];
+    bzero(cbuf, sizeof(cbuf));
+
+    msghdr msg;
+    bzero(&msg, sizeof(msg));
+    msg.msg_iov = &iov;
+    msg.msg_iovlen = 1;
+    msg.msg_control = cbuf;
+    msg.msg_controllen = sizeof(cbuf);
+
+    cmsghdr *cmsg = CMSG_FIRSTHDR(&msg);
+    cmsg->cmsg_level = SOL_SOCKET;
+    cmsg->cmsg_type = SCM_RIGHTS;
+    cmsg->cmsg_len = CMSG_LEN(sizeof(int));
+    memcpy(CMSG_DATA(cmsg), &router.client.c_sock, sizeof(int));
+
+    ssize_t sent = sendmsg(sock, &msg, MSG_NOSIGNAL);
+    if (sent <= 0)
+        return false;
+
+    if ((size_t)sent < sizeof(hdr) and not sendAll((char *)&hdr + sent, sizeof(hdr) - sent))
+        return false;
+
+    SELF_DEBUG("%s: handoff with %zu peer info bytes and %zu buffered bytes", router.client.c_ip,
+               router.peers.size(), router.data.size());
+
+    return sendAll(&router.client, sizeof(router.client))
+           and sendAll(router.peers.data(), router.peers.size())
+           and sendAll(router.data.data(), router.data.size());
+}
+
+/**
+ * Send the END record and wait for the new collector to take over
+ *
+ * \return false if the new collector did not acknowledge
+ */
+bool Handoff::finish() {
+    record_hdr hdr;
+    bzero(&hdr, sizeof(hdr));
+    hdr.magic = HANDOFF_MAGIC;
+    hdr.type = RECORD_END;
+
+    char ack;
+    bool rval = sendAll(&hdr, sizeof(hdr)) and recvAll(&ack, 1);
+
+    close(sock);
+    sock = -1;
+
+    return rval;
+}
+
+/**
+ * Connect to the running collector and request the handoff
+ *
+ * \throws const char * with the error message
+ */
+void Handoff::connect() {
+    sockaddr_un addr;
+
+    if (cfg->handoff_socket.size() >= sizeof(addr.sun_path))
+        throw "ERROR: handoff socket path is too long";
+
+    bzero(&addr, sizeof(addr));
+    addr.sun_family = AF_UNIX;
+    strncpy(addr.sun_path, cfg->handoff_socket.c_str(), sizeof(addr.sun_path) - 1);
+
+    if ((sock = socket(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0)) < 0)
+        throw "ERROR: Cannot open handoff socket";
+
+    if (::connect(sock, (sockaddr *)&addr, sizeof(addr)) < 0) {
+        close(sock);
+        sock = -1;
+        throw "ERROR: Cannot connect to the running collector handoff socket";
+    }
+
+    hello_msg hello;
+    hello.magic = HANDOFF_MAGIC;
+    hello.version = HANDOFF_VERSION;
+    hello.info_len = sizeof(BMPListener::ClientInfo);
+
+    if (not sendAll(&hello, sizeof(hello))) {
+        close(sock);
+        sock = -1;
+        throw "ERROR: Failed to send handoff request";
+    }
+}
+
+/**
+ * Receive all router connections, returns after the END record
+ *
+ * \param [out] routers     Routers received
+ *
+ * \return false if the handoff failed, routers received so far are still valid
+ */
+bool Handoff::receiveRouters(std::vector<Router> &routers) {
+    while (true) {
+        record_hdr hdr;
+        int fd = -1;
+
+        iovec iov;
+        iov.iov_base = &hdr;
+        iov.iov_len = sizeof(hdr);
+
+        char cbuf[CMSG_SPACE(sizeof(int))];
+        msghdr msg;
+        bzero(&msg, sizeof(msg));
+        msg.msg_iov = &iov;
+        msg.msg_iovlen = 1;
+        msg.msg_control = cbuf;
+        msg.msg_controllen = sizeof(cbuf);
+
+        // Routers are quiesced one by one, so there is no receive timeout here
+        ssize_t len = recvmsg(sock, &msg, MSG_CMSG_CLOEXEC);
+        if (len <= 0)
+            return false;
+
+        cmsghdr *cmsg = CMSG_FIRSTHDR(&msg);
+        if (cmsg != NULL and cmsg->cmsg_level == SOL_SOCKET and cmsg->cmsg_type == SCM_RIGHTS)
+            memcpy(&fd, CMSG_DATA(cmsg), sizeof(int));
+
+        if ((size_t)len < sizeof(hdr) and not recvAll((char *)&hdr + len, sizeof(hdr) - len)) {
+            if (fd >= 0)
+                close(fd);
+            return false;
+        }
+
+        if (hdr.magic != HANDOFF_MAGIC) {
+            if (fd >= 0)
+                close(fd);
+            return false;
+        }
+
+        if (hdr.type == RECORD_END)
+            return true;
+
+        Router router;
+        router.peers.resize(hdr.peers_len);
+        router.data.resize(hdr.data_len);
+
+        if (fd < 0 or hdr.info_len != sizeof(router.client)
+                or not recvAll(&router.client, sizeof(router.client))
+                or not recvAll(&router.peers[0], hdr.peers_len)
+                or not recvAll(&router.data[0], hdr.data_len)) {
+            if (fd >= 0)
+                close(fd);
+            return false;
+        }
+
+        router.client.c_sock = fd;
+        router.client.pipe_sock = 0;
+        routers.push_back(std::move(router));
+
+        LOG_INFO("%s: Received router connection from handoff", routers.back().client.c_ip);
+    }
+}
+
+/**
+ * Acknowledge the END record, the running collector exits after this
+ */
+void Handoff::ack() {
+    char ack = 1;
+    sendAll(&ack, 1);
+
+    close(sock);
+    sock = -1;
+}
+
+bool Handoff::sendAll(const void *buf, size_t len) {
+    const char *ptr = static_cast<const char *>(buf);
+
+    while (len > 0) {
+        ssize_t sent = send(sock, ptr, len, MSG_NOSIGNAL);
+        if (sent < 0 and errno == EINTR)
+            continue;
+        if (sent <= 0)
+            return false;
+
+        ptr += sent;
+        len -= sent;
+    }
+    return true;
+}
+
+bool Handoff::recvAll(void *buf, size_t len) {
+    char *ptr = static_cast<char *>(buf);
+
+    while (len > 0) {
+        ssize_t got = recv(sock, ptr, len, 0);
+        if (got < 0 and errno == EINTR)
+            continue;
+        if (got <= 0)
+            return false;
+
+        ptr += got;
+        len -= got;
+    }
+    return true;
+}
+
+void Handoff::setTimeout(int fd) {
+    timeval tv;
+    tv.tv_sec = HANDOFF_TIMEOUT;
+    tv.tv_usec = 0;
+
+    // Accepted socket may inherit O_NONBLOCK on some platforms
+    fcntl(fd, F_SETFL, fcntl(fd, F_GETFL) & ~O_NONBLOCK);
+
+    setsockopt(fd, SOL_SOCKET, SO_RCVTIMEO, &tv, sizeof(tv));
+    setsockopt(fd, SOL_SOCKET, SO_SNDTIMEO, &tv, sizeof(tv));
+}
+
+/*
+ * Enable/Disable debug
+ */
+void Handoff::enableDebug() {
+    debug = true;
+}
+
+void Handoff::disableDebug() {
+    debug = false;
+}
@@ -0,0 +1,163 @@
+/*
+ * Copyright (c) 2024 Microsoft, Inc. and others.  All rights reserved.
+ *
+ * This program and the accompanying materials are made available under the
+ * terms of the Eclipse Public License v1.0 which accompanies this distribution,
+ * and is available at http://www.eclipse.org/legal/epl-v10.html
+ *
+ */
+
+#ifndef HANDOFF_H_
+#define HANDOFF_H_
+
+#include <string>
+#include <vector>
+#include <cstdint>
+
+#include "BMPListener.h"
+#include "Config.h"
+#include "Logger.h"
+
+#define HANDOFF_MAGIC           0x4F424D48      ///< "OBMH"
+#define HANDOFF_VERSION         1               ///< Bump when the record or ClientInfo layout changes
+#define HANDOFF_TIMEOUT         10              ///< Seconds to wait for the peer/router threads
+
+/**
+ * \class   Handoff
+ *
+ * \brief   Hands live router connections from a running collector to a new collector
+ * \details
+ *      The running collector listens on a unix socket (base.handoff_socket).  A new
+ *      collector started with -handoff connects to it and sends a hello with its
+ *      version.  The running collector then stops accepting routers, quiesces each
+ *      router at a BMP message boundary and sends one record per router:
+ *
+ *          record header + router socket (SCM_RIGHTS)
+ *          ClientInfo
+ *          peer info (see BMPReader::exportPeerInfo)
+ *          buffered bytes that have not been parsed yet
+ *
+ *      The END record is sent after the running collector has committed all parsed
+ *      messages to the message bus.  The new collector starts the router threads
+ *      after END, so parsing continues without a BMP session reset.
+ */
+class Handoff {
+public:
+    /**
+     * Router connection handed off
+     */
+    struct Router {
+        BMPListener::ClientInfo client;     ///< Client info, c_sock is the received socket
+        std::string             peers;      ///< Exported peer info
+        std::string             data;       ///< Buffered, not yet parsed, BMP bytes
+    };
+
+    /**
+     * Constructor for class
+     *
+     *  \param [in] logPtr  Pointer to existing Logger for app logging
+     *  \param [in] config  Pointer to the loaded configuration
+     */
+    Handoff(Logger *logPtr, Config *config);
+
+    virtual ~Handoff();
+
+    /*
+     * Running collector
+     */
+
+    /**
+     * Listen for handoff requests on base.handoff_socket
+     *
+     * \throws const char * with the error message
+     */
+    void listen();
+
+    /**
+     * Accept a handoff request, does not block
+     *
+     * \return true if a new collector connected and its version matches
+     */
+    bool acceptRequest();
+
+    /**
+     * Send a router connection to the new collector
+     *
+     * \param [in] router   Router to send, the socket is c_sock
+     *
+     * \return false if the record could not be sent
+     */
+    bool sendRouter(const Router &router);
+
+    /**
+     * Send the END record and wait for the new collector to take over
+     *
+     * \return false if the new collector did not acknowledge
+     */
+    bool finish();
+
+    /*
+     * New collector
+     */
+
+    /**
+     * Connect to the running collector and request the handoff
+     *
+     * \throws const char * with the error message
+     */
+    void connect();
+
+    /**
+     * Receive all router connections, returns after the END record
+     *
+     * \param [out] routers     Routers received
+     *
+     * \return false if the handoff failed, routers received so far are still valid
+     */
+    bool receiveRouters(std::vector<Router> &routers);
+
+    /**
+     * Acknowledge the END record, the running collector exits after this
+     */
+    void ack();
+
+    // Debug methods
+    void enableDebug();
+    void disableDebug();
+
+private:
+    /**
+     * Record header, sent with the router socket as ancillary data
+     */
+    struct record_hdr {
+        uint32_t    magic;
+        uint32_t    type;                   ///< One of RECORD_*
+        uint32_t    info_len;
+        uint32_t    peers_len;
+        uint32_t    data_len;
+    } __attribute__ ((__packed__));
+
+    /**
+     * Hello sent by the new collector
+     */
+    struct hello_msg {
+        uint32_t    magic;
+        uint32_t    version;
+        uint32_t    info_len;               ///< sizeof(ClientInfo) of the new collector
+    } __attribute__ ((__packed__));
+
+    enum record_type { RECORD_ROUTER = 1, RECORD_END };
+
+    Logger      *logger;                    ///< Logging class pointer
+    Config      *cfg;                       ///< Config pointer
+    bool        debug;                      ///< debug flag to indicate debugging
+
+    int         listenSock;                 ///< Unix listening socket (running collector)
+    int         sock;                       ///< Unix socket to the other collector
+
+    bool sendAll(const void *buf, size_t len);
+    bool recvAll(void *buf, size_t len);
+    void setTimeout(int fd);
+};
+
+#endif /* HANDOFF_H_ */
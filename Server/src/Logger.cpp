@@ -18,6 +18,61 @@
 
 #include "Logger.h"
 
+#include <chrono>
+#include <string>
+#include <cinttypes>
+
+/**
+ * Enabled trace categories, see TRACE_* in Logger.h
+ */
+std::atomic<uint32_t> trace_mask(0);
+
+/**
+ * Async log record, the message body is rendered by the calling thread and follows the record
+ */
+struct LogRecord {
+    struct timeval  tv;
+    const char      *sev;
+    const char      *filename;              ///< NULL if filename/line are not printed
+    int             line_num;
+    uint32_t        size;                   ///< Bytes of the record and message, 8 byte aligned
+    const char      *func_name;
+    FILE            *output;                ///< NULL if the rest of the ring is skipped
+
+    inline char *msg() { return (char *)(this + 1); }
+};
+
+/**
+ * Single producer (owning thread) / single consumer (writer thread) ring of log records
+ *
+ * \details A record that does not fit before the end of the ring is written at the start,
+ *          the bytes up to the end are skipped.
+ */
+struct Logger::LogRing {
+    std::unique_ptr<char[]> buf;
+    size_t                  size;           ///< Bytes of buf (power of 2)
+    std::atomic<uint64_t>   head;           ///< Bytes written, owning thread only
+    std::atomic<uint64_t>   tail;           ///< Bytes read, writer only
+    std::atomic<bool>       orphaned;       ///< Owning thread ended, free once drained
+
+    explicit LogRing(size_t size) : buf(new char[size]), size(size), head(0), tail(0), orphaned(false) { }
+};
+
+/**
+ * Rings of the thread by logger id, marked as orphaned when the thread ends
+ */
+struct LogRingOwner {
+    std::vector<std::pair<uint64_t, std::shared_ptr<Logger::LogRing>>> rings;
+
+    ~LogRingOwner() {
+        for (auto &ring : rings)
+            ring.second->orphaned.store(true, std::memory_order_release);
+    }
+};
+
+static thread_local LogRingOwner tls_rings;
+static std::atomic<uint64_t>     next_logger_id(0);
+
 /*********************************************************************//**
  * Constructor for class
  *
@@ -37,6 +92,14 @@ Logger::Logger(const char *log_filename, const char *debug_filename) {
     width_filename      = 20;
     width_function      = 20;
 
+    asyncEnabled        = false;
+    asyncStop           = false;
+    dropCount           = 0;
+    dropReported        = 0;
+    flushMs             = 100;
+    ringSize            = LOGGER_RING_SIZE;
+    loggerId            = ++next_logger_id;
+
     /*
      * Open log file
      */
@@ -73,6 +136,17 @@ Logger::Logger(const char *log_filename, const char *debug_filename) {
  ***********************************************************************/
 Logger::~Logger() {
 
+    // Stop the writer thread and write what is pending
+    if (writerThread.joinable()) {
+        asyncStop = true;
+        writerCond.notify_one();
+        writerThread.join();
+    }
+    drain();
+
+    // Threads that are still running free their ring when they end
+    rings.clear();
+
     /*
      * Close open files
      */
@@ -88,6 +162,7 @@ Logger::~Logger() {
  ***********************************************************************/
 void Logger::enableDebug(void) {
     debugEnabled = true;
+    trace_mask.fetch_or(TRACE_GENERAL, std::memory_order_relaxed);
 }
 
 /*********************************************************************//**
@@ -95,6 +170,7 @@ void Logger::enableDebug(void) {
  ***********************************************************************/
 void Logger::disableDebug(void) {
     debugEnabled = false;
+    trace_mask.fetch_and(~(uint32_t)TRACE_GENERAL, std::memory_order_relaxed);
 }
 
 /*********************************************************************//**
@@ -138,12 +214,39 @@ void Logger::DebugPrint(const char *filename, int line_num, const char *func_nam
     // Begin the args
     va_start (args, msg);
 
-    printV("DEBUG", debugFile, filename, line_num, func_name, msg, args);
+    if (asyncEnabled.load(std::memory_order_relaxed))
+        queueV("DEBUG", debugFile, filename, line_num, func_name, msg, args);
+    else
+        printV("DEBUG", debugFile, filename, line_num, func_name, msg, args);
 
     // Free/end the args
     va_end(args);
 }
 
+/*********************************************************************//**
+ * Prints trace message, the caller checks that the category is enabled
+ *
+ * \param[in]  filename     the source file that originated the trace message
+ * \param[in]  line_num     the line number from the file that originated the trace message
+ * \param[in]  func_name    function name of the calling function
+ * \param[in]  msg          message to print, can contain sprintf formats
+ * \param[in]  ...          Optional list of args for vfprintf
+ *
+ ***********************************************************************/
+void Logger::TracePrint(const char *filename, int line_num, const char *func_name, const char *msg, ...)
+{
+    va_list     args;
+
+    va_start (args, msg);
+
+    if (asyncEnabled.load(std::memory_order_relaxed))
+        queueV("TRACE", debugFile, filename, line_num, func_name, msg, args);
+    else
+        printV("TRACE", debugFile, filename, line_num, func_name, msg, args);
+
+    va_end(args);
+}
+
 void Logger::Print(const char *sev, const char *func_name, const char *msg, ...)
 {
     va_list     args;                                     // varialbe args
@@ -152,8 +255,13 @@ void Logger::Print(const char *sev, const char *func_name, const char *msg, ...)
     va_start (args, msg);
 
     // Print without the filename and line number included
-    printV(sev, logFile, NULL, 0, func_name, msg, args);
-    fflush(logFile);
+    if (asyncEnabled.load(std::memory_order_relaxed)) {
+        queueV(sev, logFile, NULL, 0, func_name, msg, args);
+
+    } else {
+        printV(sev, logFile, NULL, 0, func_name, msg, args);
+        fflush(logFile);
+    }
 
     // Free/end the args
     va_end(args);
@@ -221,3 +329,218 @@ void Logger::printV(const char *sev,
     vfprintf(output, bufmsg, args);
 }
 
+
+/*********************************************************************//**
+ * Enable async logging
+ *
+ * \param[in]  flush_ms     Max time in milliseconds before records are written
+ * \param[in]  ring_size    Bytes of each thread ring, rounded up to a power of 2
+ ***********************************************************************/
+void Logger::enableAsync(int flush_ms, size_t ring_size) {
+    if (asyncEnabled)
+        return;
+
+    // At least a couple of records with the longest message
+    for (ringSize = 1024; ringSize < ring_size; ringSize <<= 1)
+        ;
+
+    flushMs = flush_ms;
+    asyncStop = false;
+    writerThread = std::thread(&Logger::writerThreadLoop, this);
+    asyncEnabled = true;
+}
+
+/*********************************************************************//**
+ * Write all pending records and flush the log files
+ ***********************************************************************/
+void Logger::flush() {
+    drain();
+
+    fflush(logFile);
+    if (debugFile != logFile)
+        fflush(debugFile);
+}
+
+/*********************************************************************//**
+ * Get the number of records dropped because a ring was full
+ ***********************************************************************/
+uint64_t Logger::getDropCount() {
+    return dropCount;
+}
+
+/*********************************************************************//**
+ * Get the ring for the calling thread, creates it on first use
+ ***********************************************************************/
+Logger::LogRing *Logger::getRing() {
+    for (auto &ring : tls_rings.rings) {
+        if (ring.first == loggerId)
+            return ring.second.get();
+    }
+
+    std::shared_ptr<LogRing> ring = std::make_shared<LogRing>(ringSize);
+    {
+        std::lock_guard<std::mutex> lock(ringsMutex);
+        rings.push_back(ring);
+    }
+
+    tls_rings.rings.emplace_back(loggerId, ring);
+    return ring.get();
+}
+
+/*********************************************************************//**
+ * Queue the message to the calling thread ring
+ *
+ * \details Never blocks.  The record is dropped if the ring is full.
+ ***********************************************************************/
+void Logger::queueV(const char *sev, FILE *output, const char *filename, int line_num,
+                    const char *func_name, const char *msg, va_list args) {
+    LogRing *ring = getRing();
+    char    body[LOGGER_MSG_MAX];
+
+    int len = vsnprintf(body, sizeof(body), msg, args);
+    if (len < 0)
+        len = 0;
+    else if (len >= LOGGER_MSG_MAX)
+        len = LOGGER_MSG_MAX - 1;
+
+    uint32_t size = (sizeof(LogRecord) + len + 1 + 7) & ~7U;
+
+    uint64_t head = ring->head.load(std::memory_order_relaxed);
+    size_t offset = head & (ring->size - 1);
+    size_t skip = (ring->size - offset < size) ? ring->size - offset : 0;
+
+    if (head + skip + size - ring->tail.load(std::memory_order_acquire) > ring->size) {
+        dropCount.fetch_add(1, std::memory_order_relaxed);
+        return;
+    }
+
+    // The writer skips to the start of the ring
+    if (skip >= sizeof(LogRecord))
+        ((LogRecord *)(ring->buf.get() + offset))->output = NULL;
+
+    LogRecord *rec = (LogRecord *)(ring->buf.get() + ((head + skip) & (ring->size - 1)));
+
+    gettimeofday(&rec->tv, NULL);
+    rec->sev = sev;
+    rec->output = output;
+    rec->filename = filename;
+    rec->line_num = line_num;
+    rec->func_name = func_name;
+    rec->size = size;
+    memcpy(rec->msg(), body, len);
+    rec->msg()[len] = 0;
+
+    ring->head.store(head + skip + size, std::memory_order_release);
+}
+
+/*********************************************************************//**
+ * Writer thread loop
+ ***********************************************************************/
+void Logger::writerThreadLoop() {
+    std::mutex mutex;
+    std::unique_lock<std::mutex> lock(mutex);
+
+    while (not asyncStop) {
+        writerCond.wait_for(lock, std::chrono::milliseconds(flushMs));
+        drain();
+    }
+}
+
+/*********************************************************************//**
+ * Format and write all pending records
+ ***********************************************************************/
+void Logger::drain() {
+    std::lock_guard<std::mutex> drain_lock(drainMutex);
+
+    std::string log_buf;
+    std::string debug_buf;
+    char        line[LOGGER_MSG_MAX + 256];
+    char        time_str[32];
+    struct tm   t;
+    time_t      last_sec = 0;
+
+    std::vector<std::shared_ptr<LogRing>> ring_list;
+    {
+        std::lock_guard<std::mutex> lock(ringsMutex);
+        ring_list = rings;
+    }
+
+    for (auto ring : ring_list) {
+        bool orphaned = ring->orphaned.load(std::memory_order_acquire);
+        uint64_t tail = ring->tail.load(std::memory_order_relaxed);
+        uint64_t head = ring->head.load(std::memory_order_acquire);
+
+        while (tail < head) {
+            size_t offset = tail & (ring->size - 1);
+            LogRecord &rec = *(LogRecord *)(ring->buf.get() + offset);
+            const char *fname;
+
+            if (ring->size - offset < sizeof(LogRecord) or rec.output == NULL) {
+                tail += ring->size - offset;
+                continue;
+            }
+
+            if (rec.tv.tv_sec != last_sec) {
+                gmtime_r(&rec.tv.tv_sec, &t);
+                strftime(time_str, sizeof(time_str), "%Y-%m-%dT%H:%M:%S", &t);
+                last_sec = rec.tv.tv_sec;
+            }
+
+            if (rec.filename != NULL) {
+                // Strip off the path on filename if exists
+                (fname = strrchr(rec.filename, '/')) != NULL ? fname++ : fname = rec.filename;
+
+                snprintf(line, sizeof(line), "%s.%06u | %-8s | %*s[%05d] | %-*s | %s\n",
+                         time_str, (unsigned int)rec.tv.tv_usec, rec.sev,
+                         width_filename, fname, rec.line_num, width_function, rec.func_name, rec.msg());
+            } else {
+                snprintf(line, sizeof(line), "%s.%06u | %-8s | %-*s | %s\n",
+                         time_str, (unsigned int)rec.tv.tv_usec, rec.sev,
+                         width_function, rec.func_name, rec.msg());
+            }
+
+            if (rec.output == logFile)
+                log_buf.append(line);
+            else
+                debug_buf.append(line);
+
+            tail += rec.size;
+        }
+
+        ring->tail.store(tail, std::memory_order_release);
+
+        // Ring owner has ended and everything it queued before ending has been written
+        if (orphaned) {
+            std::lock_guard<std::mutex> lock(ringsMutex);
+            for (auto it = rings.begin(); it != rings.end(); ++it) {
+                if (*it == ring) {
+                    rings.erase(it);
+                    break;
+                }
+            }
+        }
+    }
+
+    uint64_t drops = dropCount.load(std::memory_order_relaxed);
+    if (drops != dropReported) {
+        struct timeval tv;
+        gettimeofday(&tv, NULL);
+        gmtime_r(&tv.tv_sec, &t);
+        strftime(time_str, sizeof(time_str), "%Y-%m-%dT%H:%M:%S", &t);
+
+        snprintf(line, sizeof(line), "%s.%06u | %-8s | %-*s | dropped %" PRIu64 " log messages, ring full\n",
+                 time_str, (unsigned int)tv.tv_usec, "WARN", width_function, "Logger", drops - dropReported);
+        log_buf.append(line);
+        dropReported = drops;
+    }
+
+    if (log_buf.size() > 0) {
+        fwrite(log_buf.data(), 1, log_buf.size(), logFile);
+        fflush(logFile);
+    }
+
+    if (debug_buf.size() > 0) {
+        fwrite(debug_buf.data(), 1, debug_buf.size(), debugFile);
+        fflush(debugFile);
+    }
+}
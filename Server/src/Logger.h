@@ -12,13 +12,75 @@
 #include <cstdio>
 #include <iostream>
 #include <cstdint>
+#include <cstdarg>
+#include <atomic>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <vector>
+#include <memory>
+#include <sys/types.h>
 
+/*
+ * Async logging ring settings
+ */
+#define LOGGER_RING_SIZE        (16 * 1024) ///< Default bytes per thread ring, records are sized to the message
+#define LOGGER_MSG_MAX          384         ///< Max size of the rendered message body in a record
+
+
+/*
+ * Compile time trace level (cmake -DTRACE_LEVEL=<n>)
+ *      0 = DEBUG, SELF_DEBUG and TRACE are compiled out
+ *      1 = DEBUG and SELF_DEBUG are compiled in
+ *      2 = DEBUG, SELF_DEBUG and per category TRACE are compiled in (default)
+ *
+ * Compiled out macros still reference their arguments, without evaluating them.
+ */
+#ifndef OPENBMP_TRACE_LEVEL
+#define OPENBMP_TRACE_LEVEL     2
+#endif
+
+/*
+ * Trace categories, can be toggled at runtime by updating trace_mask
+ */
+#define TRACE_GENERAL           0x01        ///< Global debug, mirrors Logger::enableDebug()
+#define TRACE_BMP               0x02
+#define TRACE_BGP               0x04
+#define TRACE_MSGBUS            0x08
+#define TRACE_REDIS             0x10
+
+extern std::atomic<uint32_t> trace_mask;
+
+#define TRACE_UNLIKELY(x)       __builtin_expect(!!(x), 0)
+#define TRACE_ON(cat)           TRACE_UNLIKELY(trace_mask.load(std::memory_order_relaxed) & (cat))
 
 /*
  * DEBUG is a macro for DebugPrint with FILE, LINE, FUNCTION added
+ *
+ * Arguments are only evaluated when debug is enabled.
  */
-#define DEBUG(...) logger->DebugPrint(__FILE__, __LINE__, __FUNCTION__, __VA_ARGS__)
-#define SELF_DEBUG(...) if (debug) logger->DebugPrint(__FILE__, __LINE__, __FUNCTION__, __VA_ARGS__)
+#if OPENBMP_TRACE_LEVEL >= 1
+#define DEBUG(...) do { if (TRACE_ON(TRACE_GENERAL)) \
+                            logger->DebugPrint(__FILE__, __LINE__, __FUNCTION__, __VA_ARGS__); } while (0)
+#define SELF_DEBUG(...) do { if (TRACE_UNLIKELY(debug)) \
+                                 logger->DebugPrint(__FILE__, __LINE__, __FUNCTION__, __VA_ARGS__); } while (0)
+#else
+#define DEBUG(...)              do { if (false) logger->DebugPrint(__FILE__, __LINE__, __FUNCTION__, __VA_ARGS__); } while (0)
+#define SELF_DEBUG(...)         do { if (false) logger->DebugPrint(__FILE__, __LINE__, __FUNCTION__, __VA_ARGS__); } while (0)
+#endif
+
+/*
+ * TRACE is for high volume (per field/per prefix) debug of a category.  TRACE_ENABLED()
+ * can be used to skip building the trace data, e.g. loops, when the category is off.
+ */
+#if OPENBMP_TRACE_LEVEL >= 2
+#define TRACE_ENABLED(cat)      TRACE_ON(cat)
+#define TRACE(cat, ...) do { if (TRACE_ON(cat)) \
+                                 logger->TracePrint(__FILE__, __LINE__, __FUNCTION__, __VA_ARGS__); } while (0)
+#else
+#define TRACE_ENABLED(cat)      false
+#define TRACE(cat, ...)         do { if (false) logger->TracePrint(__FILE__, __LINE__, __FUNCTION__, __VA_ARGS__); } while (0)
+#endif
 
 /*
  * Below defines LOG macros for various severities
@@ -46,8 +108,18 @@
  *          The DEBUG() macro will log when global debug has been
  *          enabled, which is the default when any debug has been toggled.
  *
+ *          The TRACE() macro logs when the category bit is set in trace_mask.
+ *          Neither macro evaluates its arguments when it is off.
+ *
  *          LOG_<sev>() macros are used for general logging, not DEBUG.
  *
+ *          When async logging is enabled (enableAsync), the calling thread only
+ *          renders the message body into its own ring buffer.  A background thread
+ *          adds the timestamp/columns and writes the records in batches.  The
+ *          calling thread never blocks; records are dropped and counted when the
+ *          ring is full.  A thread gets a ring of each logger it logs to, when it
+ *          logs the first time.
+ *
  *      \code{.cpp}
  *      public:
  *      void Logger::disableDebug(void) {
@@ -129,6 +201,39 @@ public:
      ***********************************************************************/
     void DebugPrint(const char *filename, int line_num, const char *func_name, const char *msg, ...);
 
+    /*********************************************************************//**
+     * Prints trace message, the caller checks that the category is enabled
+     *
+     * \param[in]  filename     the source file that originated the trace message
+     * \param[in]  line_num     the line number from the file that originated the trace message
+     * \param[in]  func_name    function name of the calling function
+     * \param[in]  msg          message to print, can contain sprintf formats
+     * \param[in]  ...          Optional list of args for vfprintf
+     *
+     ***********************************************************************/
+    void TracePrint(const char *filename, int line_num, const char *func_name, const char *msg, ...);
+
+    /*********************************************************************//**
+     * Enable async logging
+     *
+     * \details Starts the background writer thread.  This must be called after
+     *          daemonize() since threads do not survive fork().
+     *
+     * \param[in]  flush_ms     Max time in milliseconds before records are written
+     * \param[in]  ring_size    Bytes of each thread ring, rounded up to a power of 2
+     ***********************************************************************/
+    void enableAsync(int flush_ms, size_t ring_size = LOGGER_RING_SIZE);
+
+    /*********************************************************************//**
+     * Write all pending records and flush the log files
+     ***********************************************************************/
+    void flush();
+
+    /*********************************************************************//**
+     * Get the number of records dropped because a ring was full
+     ***********************************************************************/
+    uint64_t getDropCount();
+
 
 private:
     bool    logFile_REALFILE;           ///< Indicates if the log file is using a real file or not
@@ -141,6 +246,56 @@ private:
     u_char  width_function;             ///< Defines the width of the function field when printed
     u_char  width_filename;             ///< Defines the width of the filename field when printed
 
+    /*
+     * Async logging
+     */
+    struct LogRing;
+    friend struct LogRingOwner;
+
+    uint64_t                loggerId;           ///< Key of the thread rings of this logger
+    size_t                  ringSize;           ///< Bytes of each thread ring (power of 2)
+
+    std::atomic<bool>       asyncEnabled;       ///< Indicates if records are queued to the writer thread
+    std::atomic<bool>       asyncStop;          ///< Stop the writer thread
+    std::atomic<uint64_t>   dropCount;          ///< Records dropped due to a full ring
+    uint64_t                dropReported;       ///< Drop count already reported in the log
+    int                     flushMs;            ///< Max time before records are written
+
+    std::thread             writerThread;       ///< Background writer
+    std::mutex              ringsMutex;         ///< Protects rings (thread register/unregister)
+    std::mutex              drainMutex;         ///< Serializes draining (writer thread and flush())
+    std::condition_variable writerCond;         ///< Wakes the writer thread
+    std::vector<std::shared_ptr<LogRing>> rings;    ///< Per thread rings, also held by the thread
+
+    /**
+     * Get the ring for the calling thread, creates it on first use
+     */
+    LogRing *getRing();
+
+    /**
+     * Queue the message to the calling thread ring
+     *
+     * \param [in]  sev         the logging severity
+     * \param [in]  output      file to write to
+     * \param [in]  filename    the source file, NULL to not include the filename and line number
+     * \param [in]  line_num    the line number
+     * \param [in]  func_name   function name of the calling function
+     * \param [in]  msg         message to print, can contain sprintf formats
+     * \param [in]  args        variable list of args
+     */
+    void queueV(const char *sev, FILE *output, const char *filename, int line_num,
+                const char *func_name, const char *msg, va_list args);
+
+    /**
+     * Writer thread loop
+     */
+    void writerThreadLoop();
+
+    /**
+     * Format and write all pending records
+     */
+    void drain();
+
 
     /**
      * Prints the message using a variable arg list
@@ -0,0 +1,306 @@
+/*
+ * Copyright (c) 2024 Microsoft, Inc. and others.  All rights reserved.
+ *
+ * This program and the accompanying materials are made available under the
+ * terms of the Eclipse Public License v1.0 which accompanies this distribution,
+ * and is available at http://www.eclipse.org/legal/epl-v10.html
+ *
+ */
+
+#include "MetricsServer.h"
+
+#include <sys/socket.h>
+#include <sys/time.h>
+#include <netinet/in.h>
+#include <arpa/inet.h>
+#include <unistd.h>
+#include <poll.h>
+#include <cstring>
+#include <cinttypes>
+#include <algorithm>
+
+MetricsServer::MetricsServer(Logger *logPtr, const std::string &address, int port) {
+    logger = logPtr;
+    stop = false;
+    thr = NULL;
+
+    sockaddr_storage addr;
+    socklen_t addr_len;
+    bzero(&addr, sizeof(addr));
+
+    if (address.find(':') != std::string::npos) {
+        sockaddr_in6 *addr6 = (sockaddr_in6 *)&addr;
+        addr6->sin6_family = AF_INET6;
+        addr6->sin6_port = htons(port);
+        addr_len = sizeof(sockaddr_in6);
+
+        if (inet_pton(AF_INET6, address.c_str(), &addr6->sin6_addr) != 1)
+            throw "invalid metrics address";
+
+    } else {
+        sockaddr_in *addr4 = (sockaddr_in *)&addr;
+        addr4->sin_family = AF_INET;
+        addr4->sin_port = htons(port);
+        addr_len = sizeof(sockaddr_in);
+
+        if (inet_pton(AF_INET, address.c_str(), &addr4->sin_addr) != 1)
+            throw "invalid metrics address";
+    }
+
+    if ((sock = socket(addr.ss_family, SOCK_STREAM, 0)) < 0)
+        throw "cannot open the metrics socket";
+
+    int on = 1;
+    setsockopt(sock, SOL_SOCKET, SO_REUSEADDR, &on, sizeof(on));
+
+    if (::bind(sock, (sockaddr *)&addr, addr_len) < 0 or listen(sock, 16) < 0) {
+        close(sock);
+        throw "cannot listen on the metrics address and port";
+    }
+
+    LOG_INFO("Serving metrics on %s port %d", address.c_str(), port);
+
+    thr = new std::thread(&MetricsServer::run, this);
+}
+
+MetricsServer::~MetricsServer() {
+    stop = true;
+
+    if (thr != NULL) {
+        thr->join();
+        delete thr;
+    }
+
+    close(sock);
+}
+
+void MetricsServer::setCollectorMetrics(collector_metrics writer) {
+    std::unique_lock<std::mutex> lock(routersMutex);
+    collector = writer;
+}
+
+void MetricsServer::addRouter(const std::shared_ptr<RouterMetrics> &router) {
+    std::unique_lock<std::mutex> lock(routersMutex);
+    routers.push_back(router);
+}
+
+void MetricsServer::removeRouter(const std::shared_ptr<RouterMetrics> &router) {
+    std::unique_lock<std::mutex> lock(routersMutex);
+    routers.erase(std::remove(routers.begin(), routers.end(), router), routers.end());
+}
+
+void MetricsServer::run() {
+    while (not stop) {
+        pollfd pfd = { sock, POLLIN, 0 };
+
+        if (poll(&pfd, 1, 500) <= 0)
+            continue;
+
+        int fd = accept(sock, NULL, NULL);
+        if (fd < 0)
+            continue;
+
+        serve(fd);
+        close(fd);
+    }
+}
+
+void MetricsServer::serve(int fd) {
+    timeval tv = { METRICS_TIMEOUT_MS / 1000, (METRICS_TIMEOUT_MS % 1000) * 1000 };
+    setsockopt(fd, SOL_SOCKET, SO_RCVTIMEO, &tv, sizeof(tv));
+    setsockopt(fd, SOL_SOCKET, SO_SNDTIMEO, &tv, sizeof(tv));
+
+    // Read the request header, the body (if any) is ignored
+    std::string request;
+    char buf[1024];
+    ssize_t len;
+
+    while (request.find("\r\n\r\n") == std::string::npos and request.size() < METRICS_REQUEST_MAX) {
+        if ((len = recv(fd, buf, sizeof(buf), 0)) <= 0)
+            return;
+
+        request.append(buf, len);
+    }
+
+    std::string status = "200 OK";
+    std::string body;
+
+    if (request.compare(0, 13, "GET /metrics ") == 0 or request.compare(0, 6, "GET / ") == 0)
+        getMetrics(body);
+
+    else if (request.compare(0, 4, "GET ") == 0) {
+        status = "404 Not Found";
+        body = "Not found, metrics are served on /metrics\n";
+
+    } else {
+        status = "405 Method Not Allowed";
+        body = "Only GET is supported\n";
+    }
+
+    std::string response = "HTTP/1.0 " + status + "\r\n"
+                           "Content-Type: text/plain; version=0.0.4\r\n"
+                           "Content-Length: " + std::to_string(body.size()) + "\r\n"
+                           "Connection: close\r\n\r\n";
+    response += body;
+
+    for (size_t off = 0; off < response.size(); off += len) {
+        if ((len = send(fd, response.data() + off, response.size() - off, MSG_NOSIGNAL)) <= 0)
+            break;
+    }
+}
+
+void MetricsServer::addFamily(std::string &out, const char *name, const char *type, const char *help) {
+    out += "# HELP ";
+    out += name;
+    out += ' ';
+    out += help;
+    out += "\n# TYPE ";
+    out += name;
+    out += ' ';
+    out += type;
+    out += '\n';
+}
+
+void MetricsServer::addSample(std::string &out, const char *name, const std::string &labels, uint64_t value) {
+    out += name;
+
+    if (labels.size()) {
+        out += '{';
+        out += labels;
+        out += '}';
+    }
+
+    out += ' ';
+    out += std::to_string(value);
+    out += '\n';
+}
+
+std::string MetricsServer::getLabel(const char *name, const std::string &value) {
+    std::string label = name;
+    label += "=\"";
+
+    for (char c : value) {
+        if (c == '\\' or c == '"')
+            label += '\\';
+
+        if (c == '\n')
+            label += "\\n";
+        else
+            label += c;
+    }
+
+    label += '"';
+    return label;
+}
+
+void MetricsServer::getMetrics(std::string &out) {
+    std::vector<std::shared_ptr<RouterMetrics>> snapshot;
+    collector_metrics writer;
+
+    {
+        std::unique_lock<std::mutex> lock(routersMutex);
+        snapshot = routers;
+        writer = collector;
+    }
+
+    std::vector<std::string> labels;
+    for (auto &r : snapshot)
+        labels.push_back(getLabel("router", r->router));
+
+    addFamily(out, "openbmp_routers", "gauge", "Routers connected");
+    addSample(out, "openbmp_routers", "", snapshot.size());
+
+    /*
+     * Counters and gauges of the routers, one family at a time
+     */
+    struct router_metric {
+        const char *name;
+        const char *type;
+        const char *help;
+        MetricCounter RouterMetrics::*counter;
+    };
+
+    static const router_metric router_metrics[] = {
+        { "openbmp_router_bytes_total", "counter", "Bytes received from the router", &RouterMetrics::bytes },
+        { "openbmp_router_messages_total", "counter", "BMP messages received from the router", &RouterMetrics::messages },
+        { "openbmp_router_parse_errors_total", "counter", "BMP messages the router connection was closed on",
+          &RouterMetrics::parse_errors },
+        { "openbmp_router_buffer_fill_percent", "gauge", "Router buffer in use", &RouterMetrics::buffer_fill },
+        { "openbmp_router_buffer_spill_bytes", "gauge", "Bytes in the router buffer spill file",
+          &RouterMetrics::spill_bytes },
+        { "openbmp_router_pipeline_queue_depth", "gauge", "BMP messages queued to the message bus thread",
+          &RouterMetrics::pipeline_depth },
+        { "openbmp_router_producer_queue_depth", "gauge", "Messages in the Kafka producer queue",
+          &RouterMetrics::producer_depth },
+        { "openbmp_router_produce_errors_total", "counter", "Messages the Kafka producer did not accept",
+          &RouterMetrics::produce_errors },
+    };
+
+    for (const router_metric &m : router_metrics) {
+        addFamily(out, m.name, m.type, m.help);
+
+        for (size_t i = 0; i < snapshot.size(); i++)
+            addSample(out, m.name, labels[i], (snapshot[i].get()->*m.counter).get());
+    }
+
+    addFamily(out, "openbmp_router_messages_by_type_total", "counter", "BMP messages received per type");
+    for (size_t i = 0; i < snapshot.size(); i++) {
+        for (int t = 0; t < RouterMetrics::BMP_TYPES; t++) {
+            uint64_t value = snapshot[i]->msg_types[t].get();
+
+            if (value > 0)
+                addSample(out, "openbmp_router_messages_by_type_total",
+                          labels[i] + "," + getLabel("type", RouterMetrics::getTypeName(t)), value);
+        }
+    }
+
+    // Latency, only for routers it is measured for (latency.enabled)
+    addFamily(out, "openbmp_router_latency_us", "summary", "BMP message latency per stage since the router connected");
+    for (size_t i = 0; i < snapshot.size(); i++) {
+        if (not snapshot[i]->latency)
+            continue;
+
+        for (int s = 0; s < RouterLatency::STAGE_MAX; s++) {
+            const HdrHistogram &h = snapshot[i]->latency->getHistogram((RouterLatency::stage)s);
+            std::string stage = labels[i] + "," + getLabel("stage", RouterLatency::getStageName((RouterLatency::stage)s));
+
+            if (h.count() == 0)
+                continue;
+
+            addSample(out, "openbmp_router_latency_us", stage + ",quantile=\"0.5\"", h.percentile(50));
+            addSample(out, "openbmp_router_latency_us", stage + ",quantile=\"0.99\"", h.percentile(99));
+            addSample(out, "openbmp_router_latency_us", stage + ",quantile=\"1\"", h.max());
+            addSample(out, "openbmp_router_latency_us_count", stage, h.count());
+        }
+    }
+
+    /*
+     * Counters of the peers
+     */
+    std::vector<std::string> peer_labels;
+    std::vector<PeerMetrics *> peers;
+
+    for (size_t i = 0; i < snapshot.size(); i++) {
+        size_t first = peers.size();
+        snapshot[i]->getPeers(peers);
+
+        for (size_t p = first; p < peers.size(); p++)
+            peer_labels.push_back(labels[i] + "," + getLabel("peer", peers[p]->peer_addr) + "," +
+                                  getLabel("rd", peers[p]->peer_rd));
+    }
+
+    addFamily(out, "openbmp_peer_prefixes_added_total", "counter", "Prefixes advertised by the peer");
+    for (size_t p = 0; p < peers.size(); p++)
+        addSample(out, "openbmp_peer_prefixes_added_total", peer_labels[p], peers[p]->prefixes_added.get());
+
+    addFamily(out, "openbmp_peer_prefixes_withdrawn_total", "counter", "Prefixes withdrawn by the peer");
+    for (size_t p = 0; p < peers.size(); p++)
+        addSample(out, "openbmp_peer_prefixes_withdrawn_total", peer_labels[p], peers[p]->prefixes_withdrawn.get());
+
+    addFamily(out, "openbmp_peer_parse_errors_total", "counter", "Route monitoring messages of the peer that failed to parse");
+    for (size_t p = 0; p < peers.size(); p++)
+        addSample(out, "openbmp_peer_parse_errors_total", peer_labels[p], peers[p]->parse_errors.get());
+
+    if (writer)
+        writer(out);
+}
@@ -0,0 +1,131 @@
+/*
+ * Copyright (c) 2024 Microsoft, Inc. and others.  All rights reserved.
+ *
+ * This program and the accompanying materials are made available under the
+ * terms of the Eclipse Public License v1.0 which accompanies this distribution,
+ * and is available at http://www.eclipse.org/legal/epl-v10.html
+ *
+ */
+
+#ifndef METRICSSERVER_H_
+#define METRICSSERVER_H_
+
+#include <string>
+#include <vector>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <atomic>
+#include <functional>
+
+#include "RouterMetrics.h"
+#include "Logger.h"
+
+#define METRICS_REQUEST_MAX     8192        ///< Max bytes of an HTTP request
+#define METRICS_TIMEOUT_MS      1000        ///< Max time to read a request or write a response
+
+/**
+ * \class   MetricsServer
+ *
+ * \brief   Local HTTP endpoint serving the collector counters in the Prometheus text format
+ * \details
+ *      Listens on metrics.address and metrics.port and answers GET /metrics, one request
+ *      per connection, on its own thread.  The counters are read when the endpoint is
+ *      scraped: routers register their RouterMetrics when started and the counters are
+ *      updated by the router threads without locks.  Collector wide counters, such as
+ *      those of the Redis writers, are added by a callback.
+ */
+class MetricsServer {
+public:
+    /**
+     * Writer of collector wide metrics, appends them to the response
+     */
+    typedef std::function<void(std::string &out)> collector_metrics;
+
+    /**
+     * Constructor for class, listens and starts the endpoint thread
+     *
+     * \param [in] logPtr       Pointer to existing Logger for app logging
+     * \param [in] address      IP address to listen on
+     * \param [in] port         TCP port to listen on
+     *
+     * \throws const char * if the port cannot be listened on
+     */
+    MetricsServer(Logger *logPtr, const std::string &address, int port);
+
+    /**
+     * Destructor, stops the endpoint thread
+     */
+    virtual ~MetricsServer();
+
+    /**
+     * Set the writer of the collector wide metrics, call before routers are started
+     */
+    void setCollectorMetrics(collector_metrics writer);
+
+    /**
+     * Add a router to the metrics
+     */
+    void addRouter(const std::shared_ptr<RouterMetrics> &router);
+
+    /**
+     * Remove a router from the metrics, its counters are no longer served
+     */
+    void removeRouter(const std::shared_ptr<RouterMetrics> &router);
+
+    /**
+     * Get the metrics in the Prometheus text format
+     *
+     * \param [out] out     Metrics are appended
+     */
+    void getMetrics(std::string &out);
+
+    /**
+     * Append the header of a metric family
+     *
+     * \param [out] out     Metrics are appended
+     * \param [in] name     Metric name
+     * \param [in] type     counter or gauge
+     * \param [in] help     Description
+     */
+    static void addFamily(std::string &out, const char *name, const char *type, const char *help);
+
+    /**
+     * Append a sample
+     *
+     * \param [out] out     Metrics are appended
+     * \param [in] name     Metric name
+     * \param [in] labels   Labels, such as router="10.0.0.1", empty for none
+     * \param [in] value    Value
+     */
+    static void addSample(std::string &out, const char *name, const std::string &labels, uint64_t value);
+
+    /**
+     * Get a label, the value is escaped
+     */
+    static std::string getLabel(const char *name, const std::string &value);
+
+private:
+    Logger                  *logger;        ///< Logging class pointer
+    int                     sock;           ///< Listening socket
+    std::thread             *thr;
+    std::atomic<bool>       stop;
+
+    std::mutex              routersMutex;   ///< Only taken when a router is added, removed or read
+    std::vector<std::shared_ptr<RouterMetrics>> routers;
+    collector_metrics       collector;
+
+    /**
+     * Endpoint thread loop
+     */
+    void run();
+
+    /**
+     * Answer the request of a connection
+     *
+     * \param [in] fd       Accepted connection
+     */
+    void serve(int fd);
+};
+
+#endif /* METRICSSERVER_H_ */
@@ -0,0 +1,241 @@
+/*
+ * Copyright (c) 2024 Microsoft, Inc. and others.  All rights reserved.
+ *
+ * This program and the accompanying materials are made available under the
+ * terms of the Eclipse Public License v1.0 which accompanies this distribution,
+ * and is available at http://www.eclipse.org/legal/epl-v10.html
+ *
+ */
+
+#include <cstring>
+#include <memory>
+
+#include "MsgBusBatch.h"
+
+/**
+ * Constructor for class
+ *
+ * \param [in] logPtr       Pointer to existing Logger for app logging
+ */
+MsgBusBatch::MsgBusBatch(Logger *logPtr) {
+    logger = logPtr;
+    mbus = NULL;
+    ribSeq = 0;
+}
+
+MsgBusBatch::~MsgBusBatch() {
+}
+
+void MsgBusBatch::replay(MsgBusInterface *mbus_ptr) {
+    mbus = mbus_ptr;
+
+    for (size_t i = 0; i < calls.size(); i++) {
+        try {
+            calls[i]();
+
+        } catch (char const *str) {
+            LOG_ERR("Failed to add a queued object to the message bus: %s", str);
+        }
+    }
+
+    hashes.clear();
+    mbus = NULL;
+}
+
+void MsgBusBatch::add(std::function<void()> call) {
+    calls.push_back(std::move(call));
+}
+
+bool MsgBusBatch::empty() {
+    return calls.empty();
+}
+
+void MsgBusBatch::getHash(const void *src, u_char *hash_id) {
+    if (src == NULL)
+        return;
+
+    std::map<const void *, std::vector<u_char>>::iterator it = hashes.find(src);
+    if (it != hashes.end())
+        memcpy(hash_id, it->second.data(), it->second.size());
+}
+
+void MsgBusBatch::setHash(const void *src, const u_char *hash_id) {
+    if (src != NULL)
+        hashes[src].assign(hash_id, hash_id + 16);
+}
+
+/**
+ * Abstract method Implementation - See MsgBusInterface.hpp for details
+ */
+void MsgBusBatch::update_Collector(struct obj_collector &c_obj, collector_action_code action_code) {
+    add([this, c_obj, action_code] () mutable {
+        mbus->update_Collector(c_obj, action_code);
+    });
+}
+
+/**
+ * Abstract method Implementation - See MsgBusInterface.hpp for details
+ */
+void MsgBusBatch::update_Router(struct obj_router &r_object, router_action_code code) {
+    add([this, r_object, code] () mutable {
+        mbus->update_Router(r_object, code);
+    });
+}
+
+/**
+ * Abstract method Implementation - See MsgBusInterface.hpp for details
+ */
+void MsgBusBatch::update_Peer(obj_bgp_peer &peer, obj_peer_up_event *up, obj_peer_down_event *down,
+                               peer_action_code code) {
+    const void *src = &peer;
+    std::shared_ptr<obj_peer_up_event> up_copy(up != NULL ? new obj_peer_up_event(*up) : NULL);
+    std::shared_ptr<obj_peer_down_event> down_copy(down != NULL ? new obj_peer_down_event(*down) : NULL);
+
+    add([this, src, peer, up_copy, down_copy, code] () mutable {
+        getHash(src, peer.hash_id);
+        mbus->update_Peer(peer, up_copy.get(), down_copy.get(), code);
+        setHash(src, peer.hash_id);
+    });
+}
+
+/**
+ * Abstract method Implementation - See MsgBusInterface.hpp for details
+ */
+void MsgBusBatch::update_baseAttribute(obj_bgp_peer &peer, obj_path_attr &attr, base_attr_action_code code) {
+    const void *peer_src = &peer;
+    const void *attr_src = &attr;
+
+    add([this, peer_src, attr_src, peer, attr, code] () mutable {
+        getHash(peer_src, peer.hash_id);
+        getHash(attr_src, attr.hash_id);
+        mbus->update_baseAttribute(peer, attr, code);
+        setHash(attr_src, attr.hash_id);
+    });
+}
+
+/**
+ * Abstract method Implementation - See MsgBusInterface.hpp for details
+ */
+void MsgBusBatch::update_unicastPrefix(obj_bgp_peer &peer, std::vector<obj_rib> &rib, obj_path_attr *attr,
+                                        unicast_prefix_action_code code) {
+    const void *peer_src = &peer;
+    const void *attr_src = attr;
+    std::shared_ptr<obj_path_attr> attr_copy(attr != NULL ? new obj_path_attr(*attr) : NULL);
+
+    ribSeq += rib.size();
+
+    add([this, peer_src, attr_src, peer, rib, attr_copy, code] () mutable {
+        getHash(peer_src, peer.hash_id);
+        if (attr_copy)
+            getHash(attr_src, attr_copy->hash_id);
+
+        mbus->update_unicastPrefix(peer, rib, attr_copy.get(), code);
+    });
+}
+
+/**
+ * Abstract method Implementation - See MsgBusInterface.hpp for details
+ */
+void MsgBusBatch::update_L3Vpn(obj_bgp_peer &peer, std::vector<obj_vpn> &vpn, obj_path_attr *attr,
+                                vpn_action_code code) {
+    const void *peer_src = &peer;
+    const void *attr_src = attr;
+    std::shared_ptr<obj_path_attr> attr_copy(attr != NULL ? new obj_path_attr(*attr) : NULL);
+
+    add([this, peer_src, attr_src, peer, vpn, attr_copy, code] () mutable {
+        getHash(peer_src, peer.hash_id);
+        if (attr_copy)
+            getHash(attr_src, attr_copy->hash_id);
+
+        mbus->update_L3Vpn(peer, vpn, attr_copy.get(), code);
+    });
+}
+
+/**
+ * Abstract method Implementation - See MsgBusInterface.hpp for details
+ */
+void MsgBusBatch::update_eVPN(obj_bgp_peer &peer, std::vector<obj_evpn> &vpn, obj_path_attr *attr,
+                               vpn_action_code code) {
+    const void *peer_src = &peer;
+    const void *attr_src = attr;
+    std::shared_ptr<obj_path_attr> attr_copy(attr != NULL ? new obj_path_attr(*attr) : NULL);
+
+    add([this, peer_src, attr_src, peer, vpn, attr_copy, code] () mutable {
+        getHash(peer_src, peer.hash_id);
+        if (attr_copy)
+            getHash(attr_src, attr_copy->hash_id);
+
+        mbus->update_eVPN(peer, vpn, attr_copy.get(), code);
+    });
+}
+
+/**
+ * Abstract method Implementation - See MsgBusInterface.hpp for details
+ */
+void MsgBusBatch::add_StatReport(obj_bgp_peer &peer, obj_stats_report &stats) {
+    const void *peer_src = &peer;
+
+    add([this, peer_src, peer, stats] () mutable {
+        getHash(peer_src, peer.hash_id);
+        mbus->add_StatReport(peer, stats);
+    });
+}
+
+/**
+ * Abstract method Implementation - See MsgBusInterface.hpp for details
+ */
+void MsgBusBatch::update_LsNode(obj_bgp_peer &peer, obj_path_attr &attr, std::list<MsgBusInterface::obj_ls_node> &nodes,
+                                 ls_action_code code) {
+    const void *peer_src = &peer;
+    const void *attr_src = &attr;
+
+    add([this, peer_src, attr_src, peer, attr, nodes, code] () mutable {
+        getHash(peer_src, peer.hash_id);
+        getHash(attr_src, attr.hash_id);
+        mbus->update_LsNode(peer, attr, nodes, code);
+    });
+}
+
+/**
+ * Abstract method Implementation - See MsgBusInterface.hpp for details
+ */
+void MsgBusBatch::update_LsLink(obj_bgp_peer &peer, obj_path_attr &attr, std::list<MsgBusInterface::obj_ls_link> &links,
+                                 ls_action_code code) {
+    const void *peer_src = &peer;
+    const void *attr_src = &attr;
+
+    add([this, peer_src, attr_src, peer, attr, links, code] () mutable {
+        getHash(peer_src, peer.hash_id);
+        getHash(attr_src, attr.hash_id);
+        mbus->update_LsLink(peer, attr, links, code);
+    });
+}
+
+/**
+ * Abstract method Implementation - See MsgBusInterface.hpp for details
+ */
+void MsgBusBatch::update_LsPrefix(obj_bgp_peer &peer, obj_path_attr &attr,
+                                   std::list<MsgBusInterface::obj_ls_prefix> &prefixes, ls_action_code code) {
+    const void *peer_src = &peer;
+    const void *attr_src = &attr;
+
+    add([this, peer_src, attr_src, peer, attr, prefixes, code] () mutable {
+        getHash(peer_src, peer.hash_id);
+        getHash(attr_src, attr.hash_id);
+        mbus->update_LsPrefix(peer, attr, prefixes, code);
+    });
+}
+
+/**
+ * Abstract method Implementation - See MsgBusInterface.hpp for details
+ */
+void MsgBusBatch::send_bmp_raw(u_char *r_hash, obj_bgp_peer &peer, u_char *data, size_t data_len) {
+    const void *peer_src = &peer;
+    std::vector<u_char> hash(r_hash, r_hash + 16);
+    std::vector<u_char> raw(data, data + data_len);
+
+    add([this, peer_src, hash, peer, raw] () mutable {
+        getHash(peer_src, peer.hash_id);
+        mbus->send_bmp_raw(hash.data(), peer, raw.data(), raw.size());
+    });
+}
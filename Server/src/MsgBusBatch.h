@@ -0,0 +1,112 @@
+/*
+ * Copyright (c) 2024 Microsoft, Inc. and others.  All rights reserved.
+ *
+ * This program and the accompanying materials are made available under the
+ * terms of the Eclipse Public License v1.0 which accompanies this distribution,
+ * and is available at http://www.eclipse.org/legal/epl-v10.html
+ *
+ */
+
+#ifndef MSGBUSBATCH_H_
+#define MSGBUSBATCH_H_
+
+#include <sys/types.h>
+#include <functional>
+#include <map>
+#include <vector>
+
+#include "MsgBusInterface.hpp"
+#include "Logger.h"
+
+/**
+ * \class   MsgBusBatch
+ *
+ * \brief   Objects added by the parser for one BMP message, added to a message bus later
+ * \details
+ *      The objects are copied when they are added and added to another message bus, in
+ *      the same order, by replay().  Used to parse a BMP message on one thread and send
+ *      it on another.
+ *
+ *      The message bus sets hash ids of the objects it is given (peer, path attribute),
+ *      which later calls of the same BMP message use.  These are carried from one call
+ *      to the next while replaying, by address of the object in the parser.  ribSeq is
+ *      counted when prefixes are added.
+ */
+class MsgBusBatch : public MsgBusInterface {
+public:
+    /**
+     * Constructor for class
+     *
+     * \param [in] logPtr       Pointer to existing Logger for app logging
+     */
+    MsgBusBatch(Logger *logPtr);
+
+    virtual ~MsgBusBatch();
+
+    /**
+     * Add the objects to a message bus, in the order they were added to the batch
+     *
+     * \details Errors of a call are logged and the next calls are still made.
+     *
+     * \param [in] mbus         Message bus to add the objects to
+     */
+    void replay(MsgBusInterface *mbus);
+
+    /**
+     * Add a call to the batch, made by replay() in order with the objects
+     */
+    void add(std::function<void()> call);
+
+    /**
+     * Indicates if nothing was added to the batch
+     */
+    bool empty();
+
+    /*
+     * abstract methods implemented
+     * See MsgBusInterface.hpp for method details
+     */
+    void update_Collector(struct obj_collector &c_obj, collector_action_code action_code);
+    void update_Router(struct obj_router &r_object, router_action_code code);
+    void update_Peer(obj_bgp_peer &peer, obj_peer_up_event *up, obj_peer_down_event *down, peer_action_code code);
+    void update_baseAttribute(obj_bgp_peer &peer, obj_path_attr &attr, base_attr_action_code code);
+    void update_unicastPrefix(obj_bgp_peer &peer, std::vector<obj_rib> &rib, obj_path_attr *attr, unicast_prefix_action_code code);
+    void update_L3Vpn(obj_bgp_peer &peer, std::vector<obj_vpn> &vpn, obj_path_attr *attr, vpn_action_code code);
+    void update_eVPN(obj_bgp_peer &peer, std::vector<obj_evpn> &vpn, obj_path_attr *attr, vpn_action_code code);
+    void add_StatReport(obj_bgp_peer &peer, obj_stats_report &stats);
+    void update_LsNode(obj_bgp_peer &peer, obj_path_attr &attr, std::list<MsgBusInterface::obj_ls_node> &nodes,
+                       ls_action_code code);
+    void update_LsLink(obj_bgp_peer &peer, obj_path_attr &attr, std::list<MsgBusInterface::obj_ls_link> &links,
+                       ls_action_code code);
+    void update_LsPrefix(obj_bgp_peer &peer, obj_path_attr &attr, std::list<MsgBusInterface::obj_ls_prefix> &prefixes,
+                         ls_action_code code);
+    void send_bmp_raw(u_char *r_hash, obj_bgp_peer &peer, u_char *data, size_t data_len);
+
+private:
+    Logger                              *logger;        ///< Logging class pointer
+    MsgBusInterface                     *mbus;          ///< Message bus being replayed to
+    std::vector<std::function<void()>>  calls;          ///< Calls in the order they were added
+
+    /*
+     * Hash ids set by the message bus while replaying, by address of the parser object.
+     */
+    std::map<const void *, std::vector<u_char>> hashes;
+
+    /**
+     * Set the hash id of an object from the last call with the same parser object
+     *
+     * \param [in]  src     Address of the object in the parser, NULL does nothing
+     * \param [out] hash_id Hash id of the copy, updated
+     */
+    void getHash(const void *src, u_char *hash_id);
+
+    /**
+     * Save the hash id of an object after a call
+     *
+     * \param [in] src      Address of the object in the parser, NULL does nothing
+     * \param [in] hash_id  Hash id of the copy
+     */
+    void setHash(const void *src, const u_char *hash_id);
+};
+
+#endif /* MSGBUSBATCH_H_ */
@@ -0,0 +1,434 @@
+/*
+ * Copyright (c) 2024 Microsoft, Inc. and others.  All rights reserved.
+ *
+ * This program and the accompanying materials are made available under the
+ * terms of the Eclipse Public License v1.0 which accompanies this distribution,
+ * and is available at http://www.eclipse.org/legal/epl-v10.html
+ *
+ */
+
+#include <cstring>
+#include <cinttypes>
+
+#include "MsgBusCounting.h"
+
+#define FNV_OFFSET_BASIS    0xcbf29ce484222325ULL
+#define FNV_PRIME           0x100000001b3ULL
+
+/**
+ * Constructor for class
+ *
+ * \param [in] logPtr       Pointer to existing Logger for app logging
+ * \param [in] hash         Hash the object fields
+ */
+MsgBusCounting::MsgBusCounting(Logger *logPtr, bool hash) {
+    logger = logPtr;
+    hashing = hash;
+    messages = 0;
+    ribSeq = 0;
+
+    bzero(types, sizeof(types));
+    for (int i = 0; i < OBJ_TYPE_MAX; i++)
+        types[i].hash = hashing ? FNV_OFFSET_BASIS : 0;
+
+    cur = &types[OBJ_COLLECTOR];
+}
+
+MsgBusCounting::~MsgBusCounting() {
+}
+
+/**
+ * Get the counters of an object type
+ */
+const MsgBusCounting::counters &MsgBusCounting::getCounters(obj_type type) {
+    return types[type];
+}
+
+/**
+ * Number of BMP messages, counted by end_Message()
+ */
+uint64_t MsgBusCounting::getMessages() {
+    return messages;
+}
+
+/**
+ * Log the counters of the object types that were added
+ *
+ * \param [in] name         Name of the stream, such as the router address
+ */
+void MsgBusCounting::logCounters(const char *name) {
+    LOG_INFO("%s: Counting sink %" PRIu64 " BMP messages", name, messages);
+
+    for (int i = 0; i < OBJ_TYPE_MAX; i++) {
+        if (types[i].calls == 0)
+            continue;
+
+        if (hashing)
+            LOG_INFO("%s:   %-16s calls %" PRIu64 " objects %" PRIu64 " bytes %" PRIu64 " hash %016" PRIx64,
+                     name, getTypeName((obj_type)i), types[i].calls, types[i].objects, types[i].bytes, types[i].hash);
+        else
+            LOG_INFO("%s:   %-16s calls %" PRIu64 " objects %" PRIu64 " bytes %" PRIu64,
+                     name, getTypeName((obj_type)i), types[i].calls, types[i].objects, types[i].bytes);
+    }
+}
+
+/**
+ * Name of an object type
+ */
+const char *MsgBusCounting::getTypeName(obj_type type) {
+    switch (type) {
+        case OBJ_COLLECTOR:         return "collector";
+        case OBJ_ROUTER:            return "router";
+        case OBJ_PEER:              return "peer";
+        case OBJ_BASE_ATTR:         return "base_attribute";
+        case OBJ_UNICAST_PREFIX:    return "unicast_prefix";
+        case OBJ_L3VPN:             return "l3vpn";
+        case OBJ_EVPN:              return "evpn";
+        case OBJ_STATS_REPORT:      return "bmp_stat";
+        case OBJ_LS_NODE:           return "ls_node";
+        case OBJ_LS_LINK:           return "ls_link";
+        case OBJ_LS_PREFIX:         return "ls_prefix";
+        case OBJ_BMP_RAW:           return "bmp_raw";
+        default:                    return "unknown";
+    }
+}
+
+/**
+ * Start a call of an object type, fields are added to its counters
+ */
+void MsgBusCounting::begin(obj_type type, uint64_t objects) {
+    cur = &types[type];
+    cur->calls++;
+    cur->objects += objects;
+}
+
+/**
+ * Add bytes of a field to the current counters
+ */
+void MsgBusCounting::add(const void *data, size_t len) {
+    cur->bytes += len;
+
+    if (hashing) {
+        const u_char *p = (const u_char *)data;
+        uint64_t h = cur->hash;
+
+        for (size_t i = 0; i < len; i++) {
+            h ^= p[i];
+            h *= FNV_PRIME;
+        }
+
+        // Terminates the field, so that adjacent fields do not run together
+        h *= FNV_PRIME;
+        cur->hash = h;
+    }
+}
+
+/**
+ * Add a string field of a fixed size buffer, bytes after the string are not added
+ */
+void MsgBusCounting::add(const char *str, size_t max_len) {
+    add((const void *)str, strnlen(str, max_len));
+}
+
+/**
+ * Add a string field
+ */
+void MsgBusCounting::add(const std::string &str) {
+    add((const void *)str.data(), str.size());
+}
+
+/*
+ * Peer identity, added with each object of the peer
+ */
+void MsgBusCounting::addPeer(const obj_bgp_peer &peer) {
+    add((const char *)peer.table_name, sizeof(peer.table_name));
+    add(peer.peer_rd, sizeof(peer.peer_rd));
+    add(peer.peer_addr, sizeof(peer.peer_addr));
+    add(peer.peer_bgp_id, sizeof(peer.peer_bgp_id));
+    add(peer.peer_as);
+    add(peer.isL3VPN);
+    add(peer.isPrePolicy);
+    add(peer.isAdjIn);
+    add(peer.isLocRib);
+    add(peer.isLocRibFiltered);
+    add(peer.isIPv4);
+}
+
+void MsgBusCounting::addAttr(const obj_path_attr &attr) {
+    add(attr.origin, sizeof(attr.origin));
+    add(attr.as_path);
+    add(attr.as_path_count);
+    add(attr.origin_as);
+    add(attr.nexthop_isIPv4);
+    add(attr.next_hop, sizeof(attr.next_hop));
+    add(attr.aggregator, sizeof(attr.aggregator));
+    add(attr.atomic_agg);
+    add(attr.med);
+    add(attr.local_pref);
+    add(attr.community_list);
+    add(attr.ext_community_list);
+    add(attr.large_community_list);
+    add(attr.cluster_list);
+    add(attr.originator_id, sizeof(attr.originator_id));
+}
+
+void MsgBusCounting::addRib(const obj_rib &rib) {
+    add(rib.isIPv4);
+    add(rib.prefix, sizeof(rib.prefix));
+    add(rib.prefix_len);
+    add(rib.path_id);
+    add(rib.labels, sizeof(rib.labels));
+}
+
+void MsgBusCounting::addRd(const obj_route_distinguisher &rd) {
+    add(rd.rd_administrator_subfield);
+    add(rd.rd_assigned_number);
+    add(rd.rd_type);
+}
+
+void MsgBusCounting::update_Collector(struct obj_collector &c_obj, collector_action_code action_code) {
+    begin(OBJ_COLLECTOR, 1);
+
+    add(action_code);
+    add(c_obj.admin_id, sizeof(c_obj.admin_id));
+    add((const char *)c_obj.descr, sizeof(c_obj.descr));
+    add(c_obj.routers, sizeof(c_obj.routers));
+    add(c_obj.router_count);
+}
+
+void MsgBusCounting::update_Router(struct obj_router &r_object, router_action_code code) {
+    begin(OBJ_ROUTER, 1);
+
+    add(code);
+    add((const char *)r_object.name, sizeof(r_object.name));
+    add((const char *)r_object.descr, sizeof(r_object.descr));
+    add((const char *)r_object.ip_addr, sizeof(r_object.ip_addr));
+    add(r_object.bgp_id, sizeof(r_object.bgp_id));
+    add(r_object.asn);
+    add(r_object.term_reason_code);
+    add(r_object.term_reason_text, sizeof(r_object.term_reason_text));
+    add(r_object.term_data, sizeof(r_object.term_data));
+    add(r_object.initiate_data, sizeof(r_object.initiate_data));
+}
+
+void MsgBusCounting::update_Peer(obj_bgp_peer &peer, obj_peer_up_event *up, obj_peer_down_event *down,
+                                 peer_action_code code) {
+    begin(OBJ_PEER, 1);
+
+    add(code);
+    addPeer(peer);
+    add(peer.timestamp_secs);
+    add(peer.timestamp_us);
+
+    if (up != NULL) {
+        add(up->info_data, sizeof(up->info_data));
+        add(up->local_ip, sizeof(up->local_ip));
+        add(up->local_port);
+        add(up->local_asn);
+        add(up->local_hold_time);
+        add(up->local_bgp_id, sizeof(up->local_bgp_id));
+        add(up->remote_asn);
+        add(up->remote_port);
+        add(up->remote_hold_time);
+        add(up->remote_bgp_id, sizeof(up->remote_bgp_id));
+        add(up->sent_cap, sizeof(up->sent_cap));
+        add(up->recv_cap, sizeof(up->recv_cap));
+    }
+
+    if (down != NULL) {
+        add(down->bmp_reason);
+        add(down->bgp_err_code);
+        add(down->bgp_err_subcode);
+        add(down->error_text, sizeof(down->error_text));
+    }
+}
+
+void MsgBusCounting::update_baseAttribute(obj_bgp_peer &peer, obj_path_attr &attr, base_attr_action_code code) {
+    begin(OBJ_BASE_ATTR, 1);
+
+    add(code);
+    addPeer(peer);
+    addAttr(attr);
+}
+
+void MsgBusCounting::update_unicastPrefix(obj_bgp_peer &peer, std::vector<obj_rib> &rib, obj_path_attr *attr,
+                                          unicast_prefix_action_code code) {
+    begin(OBJ_UNICAST_PREFIX, rib.size());
+    ribSeq += rib.size();
+
+    add(code);
+    addPeer(peer);
+    if (attr != NULL)
+        addAttr(*attr);
+
+    for (size_t i = 0; i < rib.size(); i++)
+        addRib(rib[i]);
+}
+
+void MsgBusCounting::update_L3Vpn(obj_bgp_peer &peer, std::vector<obj_vpn> &vpn, obj_path_attr *attr,
+                                  vpn_action_code code) {
+    begin(OBJ_L3VPN, vpn.size());
+
+    add(code);
+    addPeer(peer);
+    if (attr != NULL)
+        addAttr(*attr);
+
+    for (size_t i = 0; i < vpn.size(); i++) {
+        addRib(vpn[i]);
+        addRd(vpn[i]);
+    }
+}
+
+void MsgBusCounting::update_eVPN(obj_bgp_peer &peer, std::vector<obj_evpn> &vpn, obj_path_attr *attr,
+                                 vpn_action_code code) {
+    begin(OBJ_EVPN, vpn.size());
+
+    add(code);
+    addPeer(peer);
+    if (attr != NULL)
+        addAttr(*attr);
+
+    for (size_t i = 0; i < vpn.size(); i++) {
+        const obj_evpn &e = vpn[i];
+
+        addRib(e);
+        addRd(e);
+        add(e.originating_router_ip_len);
+        add(e.originating_router_ip, sizeof(e.originating_router_ip));
+        add(e.ethernet_segment_identifier, sizeof(e.ethernet_segment_identifier));
+        add(e.ethernet_tag_id_hex, sizeof(e.ethernet_tag_id_hex));
+        add(e.mac_len);
+        add(e.mac, sizeof(e.mac));
+        add(e.ip_len);
+        add(e.ip, sizeof(e.ip));
+        add(e.mpls_label_1);
+        add(e.mpls_label_2);
+    }
+}
+
+void MsgBusCounting::add_StatReport(obj_bgp_peer &peer, obj_stats_report &stats) {
+    begin(OBJ_STATS_REPORT, 1);
+
+    addPeer(peer);
+    add(stats.prefixes_rej);
+    add(stats.known_dup_prefixes);
+    add(stats.known_dup_withdraws);
+    add(stats.invalid_cluster_list);
+    add(stats.invalid_as_path_loop);
+    add(stats.invalid_originator_id);
+    add(stats.invalid_as_confed_loop);
+    add(stats.routes_adj_rib_in);
+    add(stats.routes_loc_rib);
+}
+
+void MsgBusCounting::update_LsNode(obj_bgp_peer &peer, obj_path_attr &attr,
+                                   std::list<MsgBusInterface::obj_ls_node> &nodes, ls_action_code code) {
+    begin(OBJ_LS_NODE, nodes.size());
+
+    add(code);
+    addPeer(peer);
+    addAttr(attr);
+
+    for (const auto &node : nodes) {
+        add(node.id);
+        add(node.isIPv4);
+        add(node.asn);
+        add(node.bgp_ls_id);
+        add(node.igp_router_id, sizeof(node.igp_router_id));
+        add(node.ospf_area_Id, sizeof(node.ospf_area_Id));
+        add(node.protocol, sizeof(node.protocol));
+        add(node.router_id, sizeof(node.router_id));
+        add(node.isis_area_id, sizeof(node.isis_area_id));
+        add(node.flags, sizeof(node.flags));
+        add(node.name, sizeof(node.name));
+        add(node.mt_id, sizeof(node.mt_id));
+        add(node.sr_capabilities_tlv, sizeof(node.sr_capabilities_tlv));
+    }
+}
+
+void MsgBusCounting::update_LsLink(obj_bgp_peer &peer, obj_path_attr &attr,
+                                   std::list<MsgBusInterface::obj_ls_link> &links, ls_action_code code) {
+    begin(OBJ_LS_LINK, links.size());
+
+    add(code);
+    addPeer(peer);
+    addAttr(attr);
+
+    for (const auto &link : links) {
+        add(link.id);
+        add(link.mt_id);
+        add(link.bgp_ls_id);
+        add(link.igp_router_id, sizeof(link.igp_router_id));
+        add(link.remote_igp_router_id, sizeof(link.remote_igp_router_id));
+        add(link.ospf_area_Id, sizeof(link.ospf_area_Id));
+        add(link.router_id, sizeof(link.router_id));
+        add(link.remote_router_id, sizeof(link.remote_router_id));
+        add(link.local_node_asn);
+        add(link.remote_node_asn);
+        add(link.local_bgp_router_id);
+        add(link.remote_bgp_router_id);
+        add(link.isis_area_id, sizeof(link.isis_area_id));
+        add(link.protocol, sizeof(link.protocol));
+        add(link.intf_addr, sizeof(link.intf_addr));
+        add(link.nei_addr, sizeof(link.nei_addr));
+        add(link.local_link_id);
+        add(link.remote_link_id);
+        add(link.isIPv4);
+        add(link.admin_group);
+        add(link.max_link_bw);
+        add(link.max_resv_bw);
+        add(link.unreserved_bw, sizeof(link.unreserved_bw));
+        add(link.te_def_metric);
+        add(link.protection_type, sizeof(link.protection_type));
+        add(link.mpls_proto_mask, sizeof(link.mpls_proto_mask));
+        add(link.igp_metric);
+        add(link.srlg, sizeof(link.srlg));
+        add(link.name, sizeof(link.name));
+        add(link.peer_node_sid, sizeof(link.peer_node_sid));
+        add(link.peer_adj_sid, sizeof(link.peer_adj_sid));
+    }
+}
+
+void MsgBusCounting::update_LsPrefix(obj_bgp_peer &peer, obj_path_attr &attr,
+                                     std::list<MsgBusInterface::obj_ls_prefix> &prefixes, ls_action_code code) {
+    begin(OBJ_LS_PREFIX, prefixes.size());
+
+    add(code);
+    addPeer(peer);
+    addAttr(attr);
+
+    for (const auto &prefix : prefixes) {
+        add(prefix.id);
+        add(prefix.protocol, sizeof(prefix.protocol));
+        add(prefix.bgp_ls_id);
+        add(prefix.igp_router_id, sizeof(prefix.igp_router_id));
+        add(prefix.ospf_area_Id, sizeof(prefix.ospf_area_Id));
+        add(prefix.router_id, sizeof(prefix.router_id));
+        add(prefix.isis_area_id, sizeof(prefix.isis_area_id));
+        add(prefix.intf_addr, sizeof(prefix.intf_addr));
+        add(prefix.nei_addr, sizeof(prefix.nei_addr));
+        add(prefix.mt_id);
+        add(prefix.metric);
+        add(prefix.isIPv4);
+        add(prefix.prefix_len);
+        add(prefix.ospf_route_type, sizeof(prefix.ospf_route_type));
+        add(prefix.prefix_bin, sizeof(prefix.prefix_bin));
+        add(prefix.prefix_bcast_bin, sizeof(prefix.prefix_bcast_bin));
+        add(prefix.igp_flags, sizeof(prefix.igp_flags));
+        add(prefix.route_tag);
+        add(prefix.ext_route_tag);
+        add(prefix.ospf_fwd_addr, sizeof(prefix.ospf_fwd_addr));
+        add(prefix.sid_tlv, sizeof(prefix.sid_tlv));
+    }
+}
+
+void MsgBusCounting::send_bmp_raw(u_char *r_hash, obj_bgp_peer &peer, u_char *data, size_t data_len) {
+    begin(OBJ_BMP_RAW, 1);
+
+    add(data, data_len);
+}
+
+void MsgBusCounting::end_Message() {
+    messages++;
+}
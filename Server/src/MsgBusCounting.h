@@ -0,0 +1,148 @@
+/*
+ * Copyright (c) 2024 Microsoft, Inc. and others.  All rights reserved.
+ *
+ * This program and the accompanying materials are made available under the
+ * terms of the Eclipse Public License v1.0 which accompanies this distribution,
+ * and is available at http://www.eclipse.org/legal/epl-v10.html
+ *
+ */
+
+#ifndef MSGBUSCOUNTING_H_
+#define MSGBUSCOUNTING_H_
+
+#include <sys/types.h>
+#include <stdint.h>
+#include <string>
+
+#include "MsgBusInterface.hpp"
+#include "Logger.h"
+
+/**
+ * \class   MsgBusCounting
+ *
+ * \brief   Message bus that counts the objects in memory (sink.type counting)
+ * \details
+ *      Nothing is encoded or sent.  Per object type, the calls, objects and the bytes of
+ *      the object fields (strings without padding, numbers at their size) are counted.
+ *
+ *      With hashing, the fields of each object are also hashed (FNV-1a 64) in the order the
+ *      objects were added, so two builds that parse the same stream to the same objects have
+ *      the same hashes.  Hash ids and collector timestamps are not hashed, they are set by the
+ *      message bus or depend on when the stream was parsed.
+ *
+ *      Methods are called by one thread, the counters are read after the parser stopped.
+ */
+class MsgBusCounting : public MsgBusInterface {
+public:
+    /// Object types counted
+    enum obj_type {
+        OBJ_COLLECTOR = 0,
+        OBJ_ROUTER,
+        OBJ_PEER,
+        OBJ_BASE_ATTR,
+        OBJ_UNICAST_PREFIX,
+        OBJ_L3VPN,
+        OBJ_EVPN,
+        OBJ_STATS_REPORT,
+        OBJ_LS_NODE,
+        OBJ_LS_LINK,
+        OBJ_LS_PREFIX,
+        OBJ_BMP_RAW,
+        OBJ_TYPE_MAX
+    };
+
+    /// Counters of an object type
+    struct counters {
+        uint64_t    calls;                  ///< update_* calls
+        uint64_t    objects;                ///< Objects of the calls, such as prefixes
+        uint64_t    bytes;                  ///< Bytes of the object fields
+        uint64_t    hash;                   ///< Hash of the object fields, zero if not hashing
+    };
+
+    /**
+     * Constructor for class
+     *
+     * \param [in] logPtr       Pointer to existing Logger for app logging
+     * \param [in] hash         Hash the object fields
+     */
+    MsgBusCounting(Logger *logPtr, bool hash);
+
+    virtual ~MsgBusCounting();
+
+    /**
+     * Get the counters of an object type
+     */
+    const counters &getCounters(obj_type type);
+
+    /**
+     * Number of BMP messages, counted by end_Message()
+     */
+    uint64_t getMessages();
+
+    /**
+     * Log the counters of the object types that were added
+     *
+     * \param [in] name         Name of the stream, such as the router address
+     */
+    void logCounters(const char *name);
+
+    /**
+     * Name of an object type
+     */
+    static const char *getTypeName(obj_type type);
+
+    /*
+     * abstract methods implemented
+     * See MsgBusInterface.hpp for method details
+     */
+    void update_Collector(struct obj_collector &c_obj, collector_action_code action_code);
+    void update_Router(struct obj_router &r_object, router_action_code code);
+    void update_Peer(obj_bgp_peer &peer, obj_peer_up_event *up, obj_peer_down_event *down, peer_action_code code);
+    void update_baseAttribute(obj_bgp_peer &peer, obj_path_attr &attr, base_attr_action_code code);
+    void update_unicastPrefix(obj_bgp_peer &peer, std::vector<obj_rib> &rib, obj_path_attr *attr, unicast_prefix_action_code code);
+    void update_L3Vpn(obj_bgp_peer &peer, std::vector<obj_vpn> &vpn, obj_path_attr *attr, vpn_action_code code);
+    void update_eVPN(obj_bgp_peer &peer, std::vector<obj_evpn> &vpn, obj_path_attr *attr, vpn_action_code code);
+    void add_StatReport(obj_bgp_peer &peer, obj_stats_report &stats);
+    void update_LsNode(obj_bgp_peer &peer, obj_path_attr &attr, std::list<MsgBusInterface::obj_ls_node> &nodes,
+                       ls_action_code code);
+    void update_LsLink(obj_bgp_peer &peer, obj_path_attr &attr, std::list<MsgBusInterface::obj_ls_link> &links,
+                       ls_action_code code);
+    void update_LsPrefix(obj_bgp_peer &peer, obj_path_attr &attr, std::list<MsgBusInterface::obj_ls_prefix> &prefixes,
+                         ls_action_code code);
+    void send_bmp_raw(u_char *r_hash, obj_bgp_peer &peer, u_char *data, size_t data_len);
+    void end_Message();
+
+private:
+    Logger          *logger;                ///< Logging class pointer
+    bool            hashing;                ///< Hash the object fields
+    uint64_t        messages;               ///< BMP messages
+    counters        types[OBJ_TYPE_MAX];
+    counters        *cur;                   ///< Counters the fields are added to
+
+    /**
+     * Start a call of an object type, fields are added to its counters
+     */
+    void begin(obj_type type, uint64_t objects);
+
+    /*
+     * Add a field to the current counters
+     */
+    void add(const void *data, size_t len);
+    void add(const char *str, size_t max_len);
+    void add(const std::string &str);
+
+    template <typename T>
+    void add(T value) {
+        add(&value, sizeof(value));
+    }
+
+    /*
+     * Add the fields of an object to the current counters
+     */
+    void addPeer(const obj_bgp_peer &peer);
+    void addAttr(const obj_path_attr &attr);
+    void addRib(const obj_rib &rib);
+    void addRd(const obj_route_distinguisher &rd);
+};
+
+#endif /* MSGBUSCOUNTING_H_ */
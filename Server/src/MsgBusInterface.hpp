@@ -37,6 +37,8 @@ public:
      * ---------------------------------------------------------------------------
      */
     uint64_t        ribSeq;         ///< RIB Message Seq
+    uint64_t        msgReadTime;    ///< Socket read time of the BMP message being added, zero if not measured (see RouterLatency)
+    uint64_t        msgParsedTime;  ///< Time the BMP message was parsed, set before end_Message(), zero if not measured
 
     /**
      * OBJECT: collector
@@ -405,6 +407,8 @@ public:
      * Abstract methods
      * ---------------------------------------------------------------------------
      */
+    MsgBusInterface() : msgReadTime(0), msgParsedTime(0) { };
+
     virtual ~MsgBusInterface() { };
 
     /*****************************************************************//**
@@ -599,6 +603,26 @@ public:
      *****************************************************************/
     virtual void send_bmp_raw(u_char *r_hash, obj_bgp_peer &peer, u_char *data, size_t data_len) = 0;
 
+    /*****************************************************************//**
+     * \brief       End of a BMP message
+     *
+     * \details     Called by the reader after all objects of a BMP message were
+     *              added.  Implementations that queue objects (see MsgBusQueued)
+     *              hand them off here, MsgBusCounting counts the messages, the
+     *              Kafka and Redis message buses time the commit of the message
+     *              when latency is measured, others do nothing.  msgReadTime and
+     *              msgParsedTime are those of the message.
+     *****************************************************************/
+    virtual void end_Message() { };
+
+    /*****************************************************************//**
+     * \brief       Wait until all added objects were sent
+     *
+     * \details     Implementations that queue objects (see MsgBusQueued) block
+     *              until the queue is empty, others do nothing.
+     *****************************************************************/
+    virtual void flush() { };
+
 
     /* ---------------------------------------------------------------------------
      * Commonly used methods
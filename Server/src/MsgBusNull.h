@@ -0,0 +1,58 @@
+/*
+ * Copyright (c) 2024 Microsoft, Inc. and others.  All rights reserved.
+ *
+ * This program and the accompanying materials are made available under the
+ * terms of the Eclipse Public License v1.0 which accompanies this distribution,
+ * and is available at http://www.eclipse.org/legal/epl-v10.html
+ *
+ */
+
+#ifndef MSGBUSNULL_H_
+#define MSGBUSNULL_H_
+
+#include "MsgBusInterface.hpp"
+
+/**
+ * \class   MsgBusNull
+ *
+ * \brief   Message bus that discards the objects (sink.type null)
+ * \details
+ *      Routers are parsed as with Kafka or Redis but nothing is encoded or sent, so the
+ *      throughput is that of the BMP/BGP parser alone.  Hash ids of the objects are not
+ *      set.  ribSeq is counted, BMPReader uses it for the RIB dump rate.
+ */
+class MsgBusNull : public MsgBusInterface {
+public:
+    MsgBusNull() {
+        ribSeq = 0;
+    }
+
+    virtual ~MsgBusNull() { };
+
+    /*
+     * abstract methods implemented
+     * See MsgBusInterface.hpp for method details
+     */
+    void update_Collector(struct obj_collector &c_obj, collector_action_code action_code) { };
+    void update_Router(struct obj_router &r_object, router_action_code code) { };
+    void update_Peer(obj_bgp_peer &peer, obj_peer_up_event *up, obj_peer_down_event *down, peer_action_code code) { };
+    void update_baseAttribute(obj_bgp_peer &peer, obj_path_attr &attr, base_attr_action_code code) { };
+
+    void update_unicastPrefix(obj_bgp_peer &peer, std::vector<obj_rib> &rib, obj_path_attr *attr,
+                              unicast_prefix_action_code code) {
+        ribSeq += rib.size();
+    };
+
+    void update_L3Vpn(obj_bgp_peer &peer, std::vector<obj_vpn> &vpn, obj_path_attr *attr, vpn_action_code code) { };
+    void update_eVPN(obj_bgp_peer &peer, std::vector<obj_evpn> &vpn, obj_path_attr *attr, vpn_action_code code) { };
+    void add_StatReport(obj_bgp_peer &peer, obj_stats_report &stats) { };
+    void update_LsNode(obj_bgp_peer &peer, obj_path_attr &attr, std::list<MsgBusInterface::obj_ls_node> &nodes,
+                       ls_action_code code) { };
+    void update_LsLink(obj_bgp_peer &peer, obj_path_attr &attr, std::list<MsgBusInterface::obj_ls_link> &links,
+                       ls_action_code code) { };
+    void update_LsPrefix(obj_bgp_peer &peer, obj_path_attr &attr, std::list<MsgBusInterface::obj_ls_prefix> &prefixes,
+                         ls_action_code code) { };
+    void send_bmp_raw(u_char *r_hash, obj_bgp_peer &peer, u_char *data, size_t data_len) { };
+};
+
+#endif /* MSGBUSNULL_H_ */
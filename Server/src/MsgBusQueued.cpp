@@ -0,0 +1,197 @@
+/*
+ * Copyright (c) 2024 Microsoft, Inc. and others.  All rights reserved.
+ *
+ * This program and the accompanying materials are made available under the
+ * terms of the Eclipse Public License v1.0 which accompanies this distribution,
+ * and is available at http://www.eclipse.org/legal/epl-v10.html
+ *
+ */
+
+#include <unistd.h>
+#include <sys/syscall.h>
+#include <future>
+
+#include "MsgBusQueued.h"
+#include "Profiler.h"
+
+/**
+ * Constructor for class, starts the message bus thread
+ *
+ * \param [in] logPtr       Pointer to existing Logger for app logging
+ * \param [in] mbus_ptr     Message bus to add the objects to
+ * \param [in] queue_size   Max BMP messages queued
+ */
+MsgBusQueued::MsgBusQueued(Logger *logPtr, MsgBusInterface *mbus_ptr, uint32_t queue_size) : queue(queue_size) {
+    logger = logPtr;
+    mbus = mbus_ptr;
+    ribSeq = mbus->ribSeq;
+    current = new MsgBusBatch(logger);
+    tid = 0;
+    depth = 0;
+
+    thr = new std::thread(&MsgBusQueued::run, this);
+}
+
+MsgBusQueued::~MsgBusQueued() {
+    end_Message();
+
+    queue.push(NULL);
+    thr->join();
+
+    delete thr;
+    delete current;
+}
+
+pid_t MsgBusQueued::getThreadId() {
+    return tid;
+}
+
+size_t MsgBusQueued::getDepth() {
+    return depth.load(std::memory_order_relaxed);
+}
+
+void MsgBusQueued::run() {
+    MsgBusBatch *b;
+
+    tid = syscall(SYS_gettid);
+    Profiler::setThreadName("message bus");
+
+    while (true) {
+        queue.waitPopFront(b);
+
+        if (b == NULL)
+            break;
+
+        mbus->msgReadTime = b->msgReadTime;
+        mbus->msgParsedTime = b->msgParsedTime;
+
+        b->replay(mbus);
+        mbus->end_Message();
+        delete b;
+
+        depth.fetch_sub(1, std::memory_order_relaxed);
+    }
+}
+
+void MsgBusQueued::end_Message() {
+    if (current->empty())
+        return;
+
+    current->msgReadTime = msgReadTime;
+    current->msgParsedTime = msgParsedTime;
+
+    depth.fetch_add(1, std::memory_order_relaxed);
+    queue.push(current);
+    current = new MsgBusBatch(logger);
+}
+
+void MsgBusQueued::add_Batch(MsgBusBatch *batch) {
+    end_Message();
+
+    ribSeq += batch->ribSeq;
+
+    depth.fetch_add(1, std::memory_order_relaxed);
+    queue.push(batch);
+}
+
+void MsgBusQueued::flush() {
+    std::promise<void> done;
+
+    end_Message();
+    current->add([&done] { done.set_value(); });
+    end_Message();
+
+    done.get_future().wait();
+}
+
+/**
+ * Abstract method Implementation - See MsgBusInterface.hpp for details
+ */
+void MsgBusQueued::update_Collector(struct obj_collector &c_obj, collector_action_code action_code) {
+    current->update_Collector(c_obj, action_code);
+}
+
+/**
+ * Abstract method Implementation - See MsgBusInterface.hpp for details
+ */
+void MsgBusQueued::update_Router(struct obj_router &r_object, router_action_code code) {
+    current->update_Router(r_object, code);
+}
+
+/**
+ * Abstract method Implementation - See MsgBusInterface.hpp for details
+ */
+void MsgBusQueued::update_Peer(obj_bgp_peer &peer, obj_peer_up_event *up, obj_peer_down_event *down,
+                               peer_action_code code) {
+    current->update_Peer(peer, up, down, code);
+}
+
+/**
+ * Abstract method Implementation - See MsgBusInterface.hpp for details
+ */
+void MsgBusQueued::update_baseAttribute(obj_bgp_peer &peer, obj_path_attr &attr, base_attr_action_code code) {
+    current->update_baseAttribute(peer, attr, code);
+}
+
+/**
+ * Abstract method Implementation - See MsgBusInterface.hpp for details
+ */
+void MsgBusQueued::update_unicastPrefix(obj_bgp_peer &peer, std::vector<obj_rib> &rib, obj_path_attr *attr,
+                                        unicast_prefix_action_code code) {
+    ribSeq += rib.size();
+    current->update_unicastPrefix(peer, rib, attr, code);
+}
+
+/**
+ * Abstract method Implementation - See MsgBusInterface.hpp for details
+ */
+void MsgBusQueued::update_L3Vpn(obj_bgp_peer &peer, std::vector<obj_vpn> &vpn, obj_path_attr *attr,
+                                vpn_action_code code) {
+    current->update_L3Vpn(peer, vpn, attr, code);
+}
+
+/**
+ * Abstract method Implementation - See MsgBusInterface.hpp for details
+ */
+void MsgBusQueued::update_eVPN(obj_bgp_peer &peer, std::vector<obj_evpn> &vpn, obj_path_attr *attr,
+                               vpn_action_code code) {
+    current->update_eVPN(peer, vpn, attr, code);
+}
+
+/**
+ * Abstract method Implementation - See MsgBusInterface.hpp for details
+ */
+void MsgBusQueued::add_StatReport(obj_bgp_peer &peer, obj_stats_report &stats) {
+    current->add_StatReport(peer, stats);
+}
+
+/**
+ * Abstract method Implementation - See MsgBusInterface.hpp for details
+ */
+void MsgBusQueued::update_LsNode(obj_bgp_peer &peer, obj_path_attr &attr, std::list<MsgBusInterface::obj_ls_node> &nodes,
+                                 ls_action_code code) {
+    current->update_LsNode(peer, attr, nodes, code);
+}
+
+/**
+ * Abstract method Implementation - See MsgBusInterface.hpp for details
+ */
+void MsgBusQueued::update_LsLink(obj_bgp_peer &peer, obj_path_attr &attr, std::list<MsgBusInterface::obj_ls_link> &links,
+                                 ls_action_code code) {
+    current->update_LsLink(peer, attr, links, code);
+}
+
+/**
+ * Abstract method Implementation - See MsgBusInterface.hpp for details
+ */
+void MsgBusQueued::update_LsPrefix(obj_bgp_peer &peer, obj_path_attr &attr,
+                                   std::list<MsgBusInterface::obj_ls_prefix> &prefixes, ls_action_code code) {
+    current->update_LsPrefix(peer, attr, prefixes, code);
+}
+
+/**
+ * Abstract method Implementation - See MsgBusInterface.hpp for details
+ */
+void MsgBusQueued::send_bmp_raw(u_char *r_hash, obj_bgp_peer &peer, u_char *data, size_t data_len) {
+    current->send_bmp_raw(r_hash, peer, data, data_len);
+}
@@ -0,0 +1,111 @@
+/*
+ * Copyright (c) 2024 Microsoft, Inc. and others.  All rights reserved.
+ *
+ * This program and the accompanying materials are made available under the
+ * terms of the Eclipse Public License v1.0 which accompanies this distribution,
+ * and is available at http://www.eclipse.org/legal/epl-v10.html
+ *
+ */
+
+#ifndef MSGBUSQUEUED_H_
+#define MSGBUSQUEUED_H_
+
+#include <sys/types.h>
+#include <thread>
+#include <atomic>
+
+#include "MsgBusInterface.hpp"
+#include "MsgBusBatch.h"
+#include "safeQueue.hpp"
+#include "Logger.h"
+
+/**
+ * \class   MsgBusQueued
+ *
+ * \brief   Message bus stage of a router pipeline
+ * \details
+ *      Decorator that queues the objects added by the parser and adds them to the
+ *      wrapped message bus (encode and produce) on its own thread, so BGP decoding and
+ *      encoding of one router run on different cores.
+ *
+ *      The objects of a BMP message are copied to a MsgBusBatch and handed off at
+ *      end_Message(), the queue holds up to queue_size messages and the parser blocks
+ *      when it is full.  Batches are added in order by a single thread, so the order of
+ *      the messages (and of each peer) is kept.  ribSeq is counted when prefixes are
+ *      queued.  msgReadTime and msgParsedTime are handed off with the batch and set on
+ *      the wrapped message bus before the batch is added.
+ *
+ *      Methods are called by the parser thread only, the wrapped message bus must not be
+ *      used by another thread until flush() returns or the instance is deleted.
+ */
+class MsgBusQueued : public MsgBusInterface {
+public:
+    /**
+     * Constructor for class, starts the message bus thread
+     *
+     * \param [in] logPtr       Pointer to existing Logger for app logging
+     * \param [in] mbus_ptr     Message bus to add the objects to
+     * \param [in] queue_size   Max BMP messages queued
+     */
+    MsgBusQueued(Logger *logPtr, MsgBusInterface *mbus_ptr, uint32_t queue_size);
+
+    /**
+     * Destructor, adds the queued messages and stops the thread
+     */
+    virtual ~MsgBusQueued();
+
+    /**
+     * Thread id (gettid) of the message bus thread
+     */
+    pid_t getThreadId();
+
+    /**
+     * BMP messages queued to the message bus thread, may be read by any thread
+     */
+    size_t getDepth();
+
+    /*
+     * abstract methods implemented
+     * See MsgBusInterface.hpp for method details
+     */
+    void update_Collector(struct obj_collector &c_obj, collector_action_code action_code);
+    void update_Router(struct obj_router &r_object, router_action_code code);
+    void update_Peer(obj_bgp_peer &peer, obj_peer_up_event *up, obj_peer_down_event *down, peer_action_code code);
+    void update_baseAttribute(obj_bgp_peer &peer, obj_path_attr &attr, base_attr_action_code code);
+    void update_unicastPrefix(obj_bgp_peer &peer, std::vector<obj_rib> &rib, obj_path_attr *attr, unicast_prefix_action_code code);
+    void update_L3Vpn(obj_bgp_peer &peer, std::vector<obj_vpn> &vpn, obj_path_attr *attr, vpn_action_code code);
+    void update_eVPN(obj_bgp_peer &peer, std::vector<obj_evpn> &vpn, obj_path_attr *attr, vpn_action_code code);
+    void add_StatReport(obj_bgp_peer &peer, obj_stats_report &stats);
+    void update_LsNode(obj_bgp_peer &peer, obj_path_attr &attr, std::list<MsgBusInterface::obj_ls_node> &nodes,
+                       ls_action_code code);
+    void update_LsLink(obj_bgp_peer &peer, obj_path_attr &attr, std::list<MsgBusInterface::obj_ls_link> &links,
+                       ls_action_code code);
+    void update_LsPrefix(obj_bgp_peer &peer, obj_path_attr &attr, std::list<MsgBusInterface::obj_ls_prefix> &prefixes,
+                         ls_action_code code);
+    void send_bmp_raw(u_char *r_hash, obj_bgp_peer &peer, u_char *data, size_t data_len);
+    void end_Message();
+    void flush();
+
+    /**
+     * Queue a BMP message that was added to a batch by another parser
+     *
+     * \param [in] batch        Objects of the message, deleted once added
+     */
+    void add_Batch(MsgBusBatch *batch);
+
+private:
+    Logger                          *logger;        ///< Logging class pointer
+    MsgBusInterface                 *mbus;          ///< Wrapped message bus
+    std::safeQueue<MsgBusBatch *>   queue;          ///< Batches to add, NULL stops the thread
+    MsgBusBatch                     *current;       ///< Batch of the BMP message being parsed
+    std::thread                     *thr;
+    std::atomic<pid_t>              tid;
+    std::atomic<size_t>             depth;          ///< Batches queued, not yet added
+
+    /**
+     * Message bus thread loop
+     */
+    void run();
+};
+
+#endif /* MSGBUSQUEUED_H_ */
@@ -0,0 +1,407 @@
+/*
+ * Copyright (c) 2024 Microsoft, Inc. and others.  All rights reserved.
+ *
+ * This program and the accompanying materials are made available under the
+ * terms of the Eclipse Public License v1.0 which accompanies this distribution,
+ * and is available at http://www.eclipse.org/legal/epl-v10.html
+ *
+ */
+
+#include <sys/socket.h>
+#include <sys/stat.h>
+#include <sys/time.h>
+#include <arpa/inet.h>
+#include <dirent.h>
+#include <unistd.h>
+#include <zlib.h>
+
+#include <cstring>
+#include <cerrno>
+#include <cstdlib>
+#include <cinttypes>
+#include <algorithm>
+#include <chrono>
+#include <thread>
+
+#include "OfflineParser.h"
+#include "BMPListener.h"
+#include "BMPReader.h"
+#include "MsgBusQueued.h"
+#include "MsgBusNull.h"
+#include "MsgBusCounting.h"
+
+#ifndef REDIS_ENABLED
+#include "MsgBusFile_kafka.h"
+#else
+#include "RedisManager.h"
+#include "MsgBusImpl_redis.h"
+#endif
+
+/**
+ * Constructor for class
+ *
+ * \param [in] logPtr       Pointer to existing Logger for app logging
+ * \param [in] cfg          Pointer to the loaded configuration, c_hash_id is set
+ * \param [in] out_dir      Directory of the output files
+ */
+OfflineParser::OfflineParser(Logger *logPtr, Config *cfg, const std::string &out_dir) {
+    logger = logPtr;
+    this->cfg = cfg;
+    this->out_dir = out_dir;
+    next = 0;
+}
+
+OfflineParser::~OfflineParser() {
+    for (size_t i = 0; i < streams.size(); i++)
+        delete streams[i];
+}
+
+/**
+ * Add a capture file, or the .bmp/.bmp.gz files of a directory
+ *
+ * \param [in] path         File or directory
+ */
+void OfflineParser::addFile(const std::string &path) {
+    struct stat st;
+
+    if (stat(path.c_str(), &st) != 0)
+        throw "Cannot read the capture file";
+
+    if (S_ISDIR(st.st_mode)) {
+        DIR *dir = opendir(path.c_str());
+        if (dir == NULL)
+            throw "Cannot read the capture directory";
+
+        std::vector<std::string> files;
+        struct dirent *ent;
+        while ((ent = readdir(dir)) != NULL) {
+            std::string name = ent->d_name;
+
+            if ((name.size() > 4 and name.compare(name.size() - 4, 4, ".bmp") == 0) or
+                    (name.size() > 7 and name.compare(name.size() - 7, 7, ".bmp.gz") == 0))
+                files.push_back(path + "/" + name);
+        }
+        closedir(dir);
+
+        for (size_t i = 0; i < files.size(); i++)
+            addFile(files[i]);
+
+        return;
+    }
+
+    std::string dir_path = ".";
+    std::string name = path;
+
+    size_t pos = path.rfind('/');
+    if (pos != std::string::npos) {
+        dir_path = path.substr(0, pos);
+        name = path.substr(pos + 1);
+    }
+
+    // Segments of a router are in a directory named by the router address
+    std::string dir_name = dir_path.substr(dir_path.rfind('/') + 1);
+    u_char addr[16];
+
+    if (inet_pton(AF_INET, dir_name.c_str(), addr) == 1 or inet_pton(AF_INET6, dir_name.c_str(), addr) == 1) {
+        stream *&s = router_dirs[dir_path];
+        if (s == NULL)
+            s = addStream(dir_name, dir_name);
+
+        s->files.push_back(path);
+        return;
+    }
+
+    if (name.size() > 3 and name.compare(name.size() - 3, 3, ".gz") == 0)
+        name.erase(name.size() - 3);
+    if (name.size() > 4 and name.compare(name.size() - 4, 4, ".bmp") == 0)
+        name.erase(name.size() - 4);
+
+    addStream("0.0.0.0", name)->files.push_back(path);
+}
+
+/**
+ * Number of streams added
+ */
+size_t OfflineParser::getStreams() {
+    return streams.size();
+}
+
+/**
+ * Add a stream, its name is made unique
+ */
+OfflineParser::stream *OfflineParser::addStream(const std::string &router, const std::string &name) {
+    stream *s = new stream;
+    s->router = router;
+    s->name = name;
+    s->bytes = 0;
+    s->failed = false;
+
+    for (int i = 2; not names.insert(s->name).second; i++)
+        s->name = name + "-" + std::to_string(i);
+
+    streams.push_back(s);
+    return s;
+}
+
+/**
+ * Parse the streams
+ *
+ * \param [in] threads      Number of streams parsed in parallel
+ * \param [in] running      Parsing stops when set to false (signal)
+ *
+ * \return number of streams that failed
+ */
+int OfflineParser::run(int threads, bool &running) {
+    for (size_t i = 0; i < streams.size(); i++)
+        std::sort(streams[i]->files.begin(), streams[i]->files.end(), segmentOrder);
+
+    if (threads > (int)streams.size())
+        threads = streams.size();
+
+    LOG_INFO("Parsing %zu streams with %d threads to %s", streams.size(), threads, out_dir.c_str());
+
+    auto start = std::chrono::steady_clock::now();
+    std::vector<std::thread> workers;
+
+    for (int i = 0; i < threads; i++) {
+        workers.emplace_back([this, &running] {
+            size_t n;
+
+            while (running and (n = next++) < streams.size())
+                streams[n]->failed = not parseStream(streams[n], running);
+        });
+    }
+
+    for (size_t i = 0; i < workers.size(); i++)
+        workers[i].join();
+
+    double secs = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    uint64_t bytes = 0;
+    int failed = 0;
+
+    for (size_t i = 0; i < streams.size(); i++) {
+        bytes += streams[i]->bytes;
+
+        // Streams not started because of a stop are failed as well
+        if (streams[i]->failed or i >= next)
+            failed++;
+    }
+
+    LOG_NOTICE("Parsed %zu streams, %d failed: %" PRIu64 " MB in %.1f seconds (%.1f MB/s)",
+               streams.size(), failed, bytes >> 20, secs, secs > 0 ? bytes / secs / 1048576 : 0);
+
+    return failed;
+}
+
+/**
+ * Parse a stream to its output file
+ *
+ * \return true if parsed, false on error (logged)
+ */
+bool OfflineParser::parseStream(stream *s, bool &running) {
+    std::string out_path = out_dir + "/" + s->name + OFFLINE_OUT_EXT;
+    bool ok = true;
+    auto start = std::chrono::steady_clock::now();
+
+    BMPListener::ClientInfo client;
+    bzero(&client, sizeof(client));
+    snprintf(client.c_ip, sizeof(client.c_ip), "%s", s->router.c_str());
+    snprintf(client.c_port, sizeof(client.c_port), "0");
+    client.c_sock = -1;
+    client.initRec = false;
+    gettimeofday(&client.startTime, NULL);
+    BMPListener::hashRouter(cfg->c_hash_id, client);
+
+    MsgBusInterface *mbus_ptr = NULL;
+    MsgBusCounting *counting = NULL;
+#ifndef REDIS_ENABLED
+    FILE *out = NULL;
+    msgBusFile_kafka *mbus = NULL;
+#else
+    RedisManager redis;
+    MsgBusImpl_redis *mbus = NULL;
+#endif
+
+    // The null and counting sinks do not write an output file
+    if (cfg->sink_type == SINK_NULL) {
+        mbus_ptr = new MsgBusNull();
+
+    } else if (cfg->sink_type == SINK_COUNTING) {
+        counting = new MsgBusCounting(logger, cfg->sink_hash);
+        mbus_ptr = counting;
+
+    } else {
+#ifndef REDIS_ENABLED
+        out = fopen(out_path.c_str(), "w");
+        if (out == NULL) {
+            LOG_ERR("%s: Cannot open %s: %s", s->name.c_str(), out_path.c_str(), strerror(errno));
+            return false;
+        }
+        setvbuf(out, NULL, _IOFBF, 1024 * 1024);
+
+        mbus = new msgBusFile_kafka(logger, cfg, cfg->c_hash_id, out);
+#else
+        try {
+            redis.SetupOpLog(logger, cfg, out_path);
+        } catch (char const *str) {
+            LOG_ERR("%s: %s %s: %s", s->name.c_str(), str, out_path.c_str(), strerror(errno));
+            return false;
+        }
+
+        mbus = new MsgBusImpl_redis(logger, cfg, &redis, &client);
+#endif
+        mbus_ptr = mbus;
+    }
+
+    MsgBusInterface *sink = mbus_ptr;
+    MsgBusQueued *queued = NULL;
+
+    // Encoding runs on its own thread as with router connections
+    if (cfg->pipeline_enabled) {
+        queued = new MsgBusQueued(logger, mbus_ptr, cfg->pipeline_queue_size);
+        mbus_ptr = queued;
+    }
+
+    int sock_fds[2];
+    if (socketpair(PF_LOCAL, SOCK_STREAM, 0, sock_fds) != 0) {
+        LOG_ERR("%s: Cannot create the stream socket: %s", s->name.c_str(), strerror(errno));
+        sock_fds[0] = sock_fds[1] = -1;
+        ok = false;
+
+    } else {
+        client.pipe_sock = sock_fds[0];
+
+        std::thread feeder([this, s, &sock_fds, &ok, &running] {
+            ok = feedStream(s, sock_fds[1], running);
+            close(sock_fds[1]);
+        });
+
+        BMPReader rBMP(logger, cfg);
+        bool bmp_run = true;
+
+        rBMP.readerThreadLoop(bmp_run, &client, mbus_ptr);
+
+        // Unblocks the feeder if the reader stopped before the end of the stream
+        close(sock_fds[0]);
+        feeder.join();
+    }
+
+    // Sends what is still queued before the message bus is closed
+    if (queued != NULL)
+        delete queued;
+
+    double secs = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+#ifndef REDIS_ENABLED
+    if (mbus != NULL) {
+        LOG_INFO("%s: %" PRIu64 " messages written", s->name.c_str(), mbus->getMessages());
+
+        if (mbus->writeFailed()) {
+            LOG_ERR("%s: Failed to write %s", s->name.c_str(), out_path.c_str());
+            ok = false;
+        }
+    }
+#endif
+    if (counting != NULL)
+        counting->logCounters(s->name.c_str());
+
+    delete sink;
+
+#ifndef REDIS_ENABLED
+    if (out != NULL and fclose(out) != 0) {
+        LOG_ERR("%s: Failed to write %s: %s", s->name.c_str(), out_path.c_str(), strerror(errno));
+        ok = false;
+    }
+#else
+    if (mbus != NULL and not redis.ExitRedisManager()) {
+        LOG_ERR("%s: Failed to write %s", s->name.c_str(), out_path.c_str());
+        ok = false;
+    }
+
+    // Parse time includes committing the operations
+    secs = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+#endif
+
+    LOG_INFO("%s: Parsed %zu files, %" PRIu64 " MB in %.1f seconds (%.1f MB/s)",
+             s->name.c_str(), s->files.size(), s->bytes >> 20, secs,
+             secs > 0 ? s->bytes / secs / 1048576 : 0);
+
+    return ok;
+}
+
+/**
+ * Write the capture files of a stream to the BMP reader socket
+ *
+ * \return true if all files were written, false on error (logged) or stop
+ */
+bool OfflineParser::feedStream(stream *s, int sock, bool &running) {
+    std::vector<char> buf(OFFLINE_READ_SIZE);
+
+    for (size_t i = 0; i < s->files.size(); i++) {
+        const char *path = s->files[i].c_str();
+
+        // Reads gzip compressed and uncompressed files
+        gzFile gz = gzopen(path, "rb");
+        if (gz == NULL) {
+            LOG_ERR("%s: Cannot open %s: %s", s->name.c_str(), path, strerror(errno));
+            return false;
+        }
+        gzbuffer(gz, OFFLINE_READ_SIZE);
+
+        int len;
+        while ((len = gzread(gz, buf.data(), buf.size())) > 0) {
+            for (int off = 0; off < len; ) {
+                ssize_t sent = send(sock, buf.data() + off, len - off, MSG_NOSIGNAL);
+
+                if (sent <= 0 or not running) {
+                    if (running)
+                        LOG_ERR("%s: Parsing stopped at %s offset %" PRIu64, s->name.c_str(), path,
+                                (uint64_t)gzoffset(gz));
+                    gzclose(gz);
+                    return false;
+                }
+
+                off += sent;
+                s->bytes += sent;
+            }
+        }
+
+        if (len < 0) {
+            int err;
+            LOG_ERR("%s: Failed to read %s: %s", s->name.c_str(), path, gzerror(gz, &err));
+            gzclose(gz);
+            return false;
+        }
+
+        gzclose(gz);
+    }
+
+    return true;
+}
+
+/**
+ * Stream order of capture files
+ *
+ * \details Segments are named <YYYYmmdd-HHMMSS>-<pid>-<sequence>.bmp[.gz] by the raw recorder,
+ *          segments of the same second are ordered by sequence.  Other names are compared as is.
+ */
+bool OfflineParser::segmentOrder(const std::string &a, const std::string &b) {
+    const char *name_a = strrchr(a.c_str(), '/');
+    const char *name_b = strrchr(b.c_str(), '/');
+    name_a = name_a ? name_a + 1 : a.c_str();
+    name_b = name_b ? name_b + 1 : b.c_str();
+
+    const char *seq_a = strrchr(name_a, '-');
+    const char *seq_b = strrchr(name_b, '-');
+
+    if (strlen(name_a) > 16 and strlen(name_b) > 16 and name_a[8] == '-' and name_b[8] == '-'
+            and seq_a != NULL and seq_b != NULL) {
+        int cmp = strncmp(name_a, name_b, 15);
+        if (cmp != 0)
+            return cmp < 0;
+
+        return strtoul(seq_a + 1, NULL, 10) < strtoul(seq_b + 1, NULL, 10);
+    }
+
+    return strcmp(name_a, name_b) < 0;
+}
@@ -0,0 +1,138 @@
+/*
+ * Copyright (c) 2024 Microsoft, Inc. and others.  All rights reserved.
+ *
+ * This program and the accompanying materials are made available under the
+ * terms of the Eclipse Public License v1.0 which accompanies this distribution,
+ * and is available at http://www.eclipse.org/legal/epl-v10.html
+ *
+ */
+
+#ifndef OFFLINEPARSER_H_
+#define OFFLINEPARSER_H_
+
+#include <sys/types.h>
+#include <string>
+#include <vector>
+#include <map>
+#include <set>
+#include <atomic>
+
+#include "Logger.h"
+#include "Config.h"
+
+#define OFFLINE_READ_SIZE       (256 * 1024)        ///< Bytes read from a capture file at a time
+
+#ifndef REDIS_ENABLED
+#define OFFLINE_OUT_EXT         ".tsv"              ///< Extension of the output files, Kafka messages
+#else
+#define OFFLINE_OUT_EXT         ".redis"            ///< Extension of the output files, redis operations log
+#endif
+
+/**
+ * \class   OfflineParser
+ *
+ * \brief   Parses BMP capture files to local files, the offline parse mode (openbmpd -r)
+ * \details
+ *      Capture files are read through the same BMP/BGP parsing and message bus encoding
+ *      as router connections, but the messages are written to a file per stream instead
+ *      of being produced:
+ *          Kafka build:    <out dir>/<stream>.tsv, the Kafka messages (headers and TSV rows)
+ *          Redis build:    <out dir>/<stream>.redis, the redis operations (redis-cli --pipe)
+ *
+ *      Segments recorded by record.dir are in a directory per router named by the router
+ *      address.  The segments of a router directory are one stream, parsed in order of
+ *      their names and written to <router ip>.<ext>.  Other files are a stream each, for
+ *      router 0.0.0.0, written to the file name without the .bmp/.gz extension.  Files
+ *      can be gzip compressed.
+ *
+ *      Streams are parsed in parallel, each on its own thread, at the speed the files are
+ *      read rather than at the pace of a connection.
+ *
+ *      With sink.type null or counting, no output files are written, the counting sink
+ *      logs its counters (and hashes) per stream.  Used to measure the parser throughput
+ *      and to compare the parsed output of two builds.
+ */
+class OfflineParser {
+public:
+    /**
+     * Constructor for class
+     *
+     * \param [in] logPtr       Pointer to existing Logger for app logging
+     * \param [in] cfg          Pointer to the loaded configuration, c_hash_id is set
+     * \param [in] out_dir      Directory of the output files
+     */
+    OfflineParser(Logger *logPtr, Config *cfg, const std::string &out_dir);
+
+    virtual ~OfflineParser();
+
+    /**
+     * Add a capture file, or the .bmp/.bmp.gz files of a directory
+     *
+     * \param [in] path         File or directory
+     *
+     * \throws const char * if the path cannot be read
+     */
+    void addFile(const std::string &path);
+
+    /**
+     * Number of streams added
+     */
+    size_t getStreams();
+
+    /**
+     * Parse the streams, returns when all are parsed or running is false
+     *
+     * \param [in] threads      Number of streams parsed in parallel
+     * \param [in] running      Parsing stops when set to false (signal)
+     *
+     * \return number of streams that failed
+     */
+    int run(int threads, bool &running);
+
+private:
+    /*
+     * Capture files parsed as one BMP stream
+     */
+    struct stream {
+        std::string                 router;         ///< Router IP address
+        std::string                 name;           ///< Output file name without extension
+        std::vector<std::string>    files;          ///< Capture files, in stream order
+        uint64_t                    bytes;          ///< Bytes read
+        bool                        failed;
+    };
+
+    Logger                          *logger;        ///< Logging class pointer
+    Config                          *cfg;
+    std::string                     out_dir;
+
+    std::vector<stream *>           streams;
+    std::map<std::string, stream *> router_dirs;    ///< Streams of the router directories by path
+    std::set<std::string>           names;          ///< Output names used
+    std::atomic<size_t>             next;           ///< Next stream to parse
+
+    /**
+     * Add a stream, its name is made unique
+     */
+    stream *addStream(const std::string &router, const std::string &name);
+
+    /**
+     * Parse a stream to its output file
+     *
+     * \return true if parsed, false on error (logged)
+     */
+    bool parseStream(stream *s, bool &running);
+
+    /**
+     * Write the capture files of a stream to the BMP reader socket
+     *
+     * \return true if all files were written, false on error (logged) or stop
+     */
+    bool feedStream(stream *s, int sock, bool &running);
+
+    /**
+     * Stream order of capture files, segments of a router by time and sequence
+     */
+    static bool segmentOrder(const std::string &a, const std::string &b);
+};
+
+#endif /* OFFLINEPARSER_H_ */
@@ -0,0 +1,188 @@
+/*
+ * Copyright (c) 2024 Microsoft, Inc. and others.  All rights reserved.
+ *
+ * This program and the accompanying materials are made available under the
+ * terms of the Eclipse Public License v1.0 which accompanies this distribution,
+ * and is available at http://www.eclipse.org/legal/epl-v10.html
+ *
+ */
+
+#include "ParsePool.h"
+#include "Profiler.h"
+
+/**
+ * Constructor for class, starts the workers
+ *
+ *  \param [in] logPtr  Pointer to existing Logger for app logging
+ *  \param [in] workers Number of worker threads
+ */
+ParsePool::ParsePool(Logger *logPtr, int workers) {
+    logger = logPtr;
+    ready_count = 0;
+    stop = false;
+    next_worker = 0;
+    steals = 0;
+
+    for (int i = 0; i < workers; i++)
+        this->workers.push_back(new worker_info());
+
+    for (int i = 0; i < workers; i++)
+        this->workers[i]->thr = new std::thread(&ParsePool::run, this, i);
+
+    LOG_INFO("BGP parse pool started with %d workers", workers);
+}
+
+ParsePool::~ParsePool() {
+    {
+        std::lock_guard<std::mutex> lock(idle_mutex);
+        stop = true;
+    }
+    idle_cond.notify_all();
+
+    // Workers look at the queues of the others, free them once all stopped
+    for (size_t i = 0; i < workers.size(); i++) {
+        workers[i]->thr->join();
+        delete workers[i]->thr;
+    }
+
+    for (size_t i = 0; i < workers.size(); i++)
+        delete workers[i];
+}
+
+ParsePool::strand *ParsePool::addStrand() {
+    strand *s = new strand();
+
+    s->scheduled = false;
+    s->worker = next_worker++ % workers.size();
+
+    return s;
+}
+
+void ParsePool::removeStrand(strand *s) {
+    // The worker releases the strand after its last job returned
+    {
+        std::unique_lock<std::mutex> lock(s->mutex);
+        s->released.wait(lock, [s] { return not s->scheduled; });
+    }
+
+    delete s;
+}
+
+void ParsePool::post(strand *s, std::function<void()> job) {
+    bool idle;
+    int worker;
+
+    {
+        std::lock_guard<std::mutex> lock(s->mutex);
+        s->jobs.push_back(std::move(job));
+
+        idle = not s->scheduled;
+        s->scheduled = true;
+        worker = s->worker;
+    }
+
+    if (idle)
+        schedule(worker, s);
+}
+
+uint64_t ParsePool::getSteals() {
+    return steals;
+}
+
+void ParsePool::schedule(int worker, strand *s) {
+    {
+        std::lock_guard<std::mutex> lock(workers[worker]->mutex);
+        workers[worker]->ready.push_back(s);
+    }
+
+    {
+        std::lock_guard<std::mutex> lock(idle_mutex);
+        ready_count++;
+    }
+    idle_cond.notify_one();
+}
+
+ParsePool::strand *ParsePool::take(int worker) {
+    int n = workers.size();
+
+    for (int i = 0; i < n; i++) {
+        worker_info *w = workers[(worker + i) % n];
+        strand *s;
+
+        {
+            std::lock_guard<std::mutex> lock(w->mutex);
+            if (w->ready.empty())
+                continue;
+
+            s = w->ready.front();
+            w->ready.pop_front();
+        }
+
+        {
+            std::lock_guard<std::mutex> lock(idle_mutex);
+            ready_count--;
+        }
+
+        if (i > 0)
+            steals++;
+
+        return s;
+    }
+
+    return NULL;
+}
+
+void ParsePool::run(int worker) {
+    Profiler::setThreadName("parse pool " + std::to_string(worker));
+
+    while (true) {
+        strand *s = take(worker);
+
+        if (s == NULL) {
+            // Strands are counted after they are queued, wait until one is queued
+            std::unique_lock<std::mutex> lock(idle_mutex);
+            idle_cond.wait(lock, [this] { return ready_count > 0 or stop; });
+
+            if (ready_count == 0)
+                break;
+
+            continue;
+        }
+
+        for (int i = 0; i < PARSE_POOL_STRAND_BATCH; i++) {
+            std::function<void()> job;
+
+            {
+                std::lock_guard<std::mutex> lock(s->mutex);
+                if (s->jobs.empty())
+                    break;
+
+                job = std::move(s->jobs.front());
+                s->jobs.pop_front();
+            }
+
+            try {
+                job();
+
+            } catch (char const *str) {
+                LOG_ERR("BGP parse pool job failed: %s", str);
+            }
+        }
+
+        // Other strands run before the rest of the jobs
+        bool more;
+        {
+            std::lock_guard<std::mutex> lock(s->mutex);
+            more = s->jobs.size() > 0;
+            s->scheduled = more;
+            s->worker = worker;
+
+            // Notified under the lock, removeStrand() deletes the strand once released
+            if (not more)
+                s->released.notify_all();
+        }
+
+        if (more)
+            schedule(worker, s);
+    }
+}
@@ -0,0 +1,131 @@
+/*
+ * Copyright (c) 2024 Microsoft, Inc. and others.  All rights reserved.
+ *
+ * This program and the accompanying materials are made available under the
+ * terms of the Eclipse Public License v1.0 which accompanies this distribution,
+ * and is available at http://www.eclipse.org/legal/epl-v10.html
+ *
+ */
+
+#ifndef PARSEPOOL_H_
+#define PARSEPOOL_H_
+
+#include <deque>
+#include <vector>
+#include <mutex>
+#include <condition_variable>
+#include <functional>
+#include <thread>
+#include <atomic>
+
+#include "Logger.h"
+
+#define PARSE_POOL_STRAND_BATCH     32      ///< Jobs a worker runs from a strand before running other strands
+
+/**
+ * \class   ParsePool
+ *
+ * \brief   Collector wide pool of BGP parse workers with per peer strands
+ * \details
+ *      Jobs are posted to a strand, the jobs of a strand run one at a time in the order
+ *      they were posted, jobs of different strands run in parallel.  Each BMP peer of a
+ *      router has its own strand, so the messages of a peer are parsed in order and the
+ *      peers of a large router are parsed on all workers.
+ *
+ *      A strand with jobs is queued on a worker, a worker without queued strands takes
+ *      (steals) the oldest strand of another worker.  A strand goes back to the worker
+ *      that last ran it.
+ */
+class ParsePool {
+public:
+    struct strand;
+
+    /**
+     * Constructor for class, starts the workers
+     *
+     *  \param [in] logPtr  Pointer to existing Logger for app logging
+     *  \param [in] workers Number of worker threads
+     */
+    ParsePool(Logger *logPtr, int workers);
+
+    /**
+     * Destructor, runs the posted jobs and stops the workers
+     */
+    virtual ~ParsePool();
+
+    /**
+     * Add a strand
+     */
+    strand *addStrand();
+
+    /**
+     * Remove a strand, waits for the strand to be released by the worker
+     *
+     * \param [in] s        Strand to remove, its posted jobs must have run
+     */
+    void removeStrand(strand *s);
+
+    /**
+     * Post a job to a strand
+     *
+     * \param [in] s        Strand of the job
+     * \param [in] job      Job to run, runs after the jobs posted before to the strand
+     */
+    void post(strand *s, std::function<void()> job);
+
+    /**
+     * Number of strands taken from another worker
+     */
+    uint64_t getSteals();
+
+private:
+    /*
+     * Worker thread and the strands queued on it
+     */
+    struct worker_info {
+        std::mutex              mutex;
+        std::deque<strand *>    ready;          ///< Strands with jobs
+        std::thread             *thr;
+    };
+
+    Logger                      *logger;        ///< Logging class pointer
+    std::vector<worker_info *>  workers;
+
+    std::mutex                  idle_mutex;
+    std::condition_variable     idle_cond;      ///< Signaled when a strand is queued
+    size_t                      ready_count;    ///< Strands queued on the workers, not yet taken
+    bool                        stop;
+
+    std::atomic<unsigned>       next_worker;    ///< Worker of the next added strand
+    std::atomic<uint64_t>       steals;
+
+    /**
+     * Queue a strand with jobs on a worker
+     */
+    void schedule(int worker, strand *s);
+
+    /**
+     * Take a queued strand, from the worker or else from another worker
+     *
+     * \return strand, NULL if no strand is queued
+     */
+    strand *take(int worker);
+
+    /**
+     * Worker thread loop
+     */
+    void run(int worker);
+};
+
+/**
+ * Jobs that run in order
+ */
+struct ParsePool::strand {
+    std::mutex                          mutex;
+    std::deque<std::function<void()>>   jobs;           ///< Posted jobs not run yet
+    bool                                scheduled;      ///< Queued on or run by a worker
+    int                                 worker;         ///< Worker that last ran the strand
+    std::condition_variable             released;       ///< Signaled when the worker unschedules the strand
+};
+
+#endif /* PARSEPOOL_H_ */
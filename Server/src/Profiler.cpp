@@ -0,0 +1,272 @@
+/*
+ * Copyright (c) 2024 Microsoft, Inc. and others.  All rights reserved.
+ *
+ * This program and the accompanying materials are made available under the
+ * terms of the Eclipse Public License v1.0 which accompanies this distribution,
+ * and is available at http://www.eclipse.org/legal/epl-v10.html
+ *
+ */
+
+#include "Profiler.h"
+
+#include <unistd.h>
+#include <sys/syscall.h>
+#include <cstdio>
+#include <cinttypes>
+#include <list>
+#include <mutex>
+#include <vector>
+
+std::atomic<bool> profile_enabled(false);
+
+namespace {
+
+/**
+ * Counter written by its thread only, so it is a relaxed load and store
+ */
+struct point_counter {
+    std::atomic<uint64_t>   calls;
+    std::atomic<uint64_t>   ticks;
+    std::atomic<uint64_t>   max;
+};
+
+/**
+ * Counters of a thread, or of the threads that ended
+ */
+struct thread_profile {
+    std::string             name;
+    pid_t                   tid;
+    point_counter           points[Profiler::POINT_MAX];
+
+    thread_profile() : tid(0) {
+        for (int i = 0; i < Profiler::POINT_MAX; i++) {
+            points[i].calls.store(0, std::memory_order_relaxed);
+            points[i].ticks.store(0, std::memory_order_relaxed);
+            points[i].max.store(0, std::memory_order_relaxed);
+        }
+    }
+};
+
+/**
+ * Profile of the calling thread, released to the ended threads when the thread exits
+ */
+struct thread_slot {
+    thread_profile          *profile;
+    std::string             name;
+
+    thread_slot() : profile(NULL) { }
+    ~thread_slot();
+};
+
+std::mutex                      threadsMutex;       ///< Taken when a thread is added, ends or is dumped
+std::list<thread_profile *>     threads;
+thread_profile                  ended;              ///< Threads that ended, under threadsMutex
+
+thread_local thread_slot        slot;
+
+// Time base to convert ticks, the longer the collector runs the more accurate
+const uint64_t                  baseTicks = Profiler::ticks();
+const uint64_t                  baseNs = []() {
+    timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000000ULL + ts.tv_nsec;
+}();
+
+thread_slot::~thread_slot() {
+    if (profile == NULL)
+        return;
+
+    std::unique_lock<std::mutex> lock(threadsMutex);
+
+    for (int i = 0; i < Profiler::POINT_MAX; i++) {
+        point_counter &from = profile->points[i];
+        point_counter &to = ended.points[i];
+
+        to.calls.store(to.calls.load(std::memory_order_relaxed) + from.calls.load(std::memory_order_relaxed),
+                       std::memory_order_relaxed);
+        to.ticks.store(to.ticks.load(std::memory_order_relaxed) + from.ticks.load(std::memory_order_relaxed),
+                       std::memory_order_relaxed);
+
+        if (from.max.load(std::memory_order_relaxed) > to.max.load(std::memory_order_relaxed))
+            to.max.store(from.max.load(std::memory_order_relaxed), std::memory_order_relaxed);
+    }
+
+    threads.remove(profile);
+    delete profile;
+}
+
+/**
+ * Nanoseconds per tick
+ */
+double getTickNs() {
+#ifdef PROFILE_TSC
+    timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+
+    uint64_t ns = (uint64_t)ts.tv_sec * 1000000000ULL + ts.tv_nsec - baseNs;
+    uint64_t ticks = Profiler::ticks() - baseTicks;
+
+    return ticks > 0 ? (double)ns / ticks : 1.0;
+#else
+    return 1.0;
+#endif
+}
+
+/**
+ * Format the counters of a point, empty if it was not called
+ */
+std::string formatPoint(Profiler::point p, uint64_t calls, uint64_t ticks, uint64_t max, double tick_ns) {
+    char line[160];
+
+    if (calls == 0)
+        return std::string();
+
+    snprintf(line, sizeof(line), "    %-24s calls %10" PRIu64 "  total %12.3f ms  avg %10.3f us  max %10.3f us",
+             Profiler::getPointName(p), calls, ticks * tick_ns / 1000000.0, ticks * tick_ns / 1000.0 / calls,
+             max * tick_ns / 1000.0);
+
+    return line;
+}
+
+} // namespace
+
+void Profiler::record(point p, uint64_t elapsed) {
+    thread_profile *profile = slot.profile;
+
+    if (TRACE_UNLIKELY(profile == NULL)) {
+        profile = new thread_profile();
+        profile->tid = syscall(SYS_gettid);
+        profile->name = slot.name;
+
+        std::unique_lock<std::mutex> lock(threadsMutex);
+        threads.push_back(profile);
+        slot.profile = profile;
+    }
+
+    point_counter &c = profile->points[p];
+    c.calls.store(c.calls.load(std::memory_order_relaxed) + 1, std::memory_order_relaxed);
+    c.ticks.store(c.ticks.load(std::memory_order_relaxed) + elapsed, std::memory_order_relaxed);
+
+    if (elapsed > c.max.load(std::memory_order_relaxed))
+        c.max.store(elapsed, std::memory_order_relaxed);
+}
+
+void Profiler::setThreadName(const std::string &name) {
+    slot.name = name;
+
+    if (slot.profile != NULL) {
+        std::unique_lock<std::mutex> lock(threadsMutex);
+        slot.profile->name = name;
+    }
+}
+
+void Profiler::enable(bool on) {
+    profile_enabled.store(on, std::memory_order_relaxed);
+}
+
+void Profiler::dump(Logger *logger, const std::string &file) {
+    std::vector<std::string> lines;
+    uint64_t calls[POINT_MAX] = { 0 }, ticks[POINT_MAX] = { 0 }, max[POINT_MAX] = { 0 };
+    double tick_ns = getTickNs();
+    char line[160];
+
+    snprintf(line, sizeof(line), "Profile since start, profiling is %s, %s clock",
+             profile_enabled.load(std::memory_order_relaxed) ? "on" : "off",
+#ifdef PROFILE_TSC
+             "rdtsc");
+#else
+             "monotonic");
+#endif
+    lines.push_back(line);
+
+    {
+        std::unique_lock<std::mutex> lock(threadsMutex);
+        std::list<thread_profile *> profiles(threads);
+        profiles.push_back(&ended);
+
+        for (thread_profile *profile : profiles) {
+            std::vector<std::string> points;
+
+            for (int i = 0; i < POINT_MAX; i++) {
+                uint64_t c = profile->points[i].calls.load(std::memory_order_relaxed);
+                uint64_t t = profile->points[i].ticks.load(std::memory_order_relaxed);
+                uint64_t m = profile->points[i].max.load(std::memory_order_relaxed);
+
+                std::string text = formatPoint((point)i, c, t, m, tick_ns);
+                if (text.size())
+                    points.push_back(text);
+
+                calls[i] += c;
+                ticks[i] += t;
+                if (m > max[i])
+                    max[i] = m;
+            }
+
+            if (points.empty())
+                continue;
+
+            if (profile == &ended)
+                snprintf(line, sizeof(line), "  Threads ended:");
+            else
+                snprintf(line, sizeof(line), "  Thread %s (tid %d):",
+                         profile->name.size() ? profile->name.c_str() : "unnamed", (int)profile->tid);
+
+            lines.push_back(line);
+            lines.insert(lines.end(), points.begin(), points.end());
+        }
+    }
+
+    lines.push_back("  Total:");
+    for (int i = 0; i < POINT_MAX; i++) {
+        std::string text = formatPoint((point)i, calls[i], ticks[i], max[i], tick_ns);
+        if (text.size())
+            lines.push_back(text);
+    }
+
+    if (file.empty()) {
+        for (const std::string &l : lines)
+            LOG_NOTICE("%s", l.c_str());
+        return;
+    }
+
+    FILE *fp = fopen(file.c_str(), "a");
+    if (fp == NULL) {
+        LOG_WARN("Cannot open the profile file %s", file.c_str());
+        return;
+    }
+
+    time_t now = time(NULL);
+    char ts[32];
+    strftime(ts, sizeof(ts), "%Y-%m-%dT%H:%M:%S", localtime(&now));
+
+    fprintf(fp, "%s pid %d\n", ts, (int)getpid());
+    for (const std::string &l : lines)
+        fprintf(fp, "%s\n", l.c_str());
+
+    fclose(fp);
+
+    LOG_NOTICE("Profile written to %s", file.c_str());
+}
+
+const char *Profiler::getPointName(point p) {
+    switch (p) {
+        case BMP_HANDLE_MESSAGE         : return "bmp.handleMessage";
+        case BGP_HANDLE_UPDATE          : return "bgp.handleUpdate";
+        case BGP_PARSE_ATTRS            : return "bgp.parseAttributes";
+        case BGP_UPDATE_DB              : return "bgp.UpdateDB";
+        case BGP_UPDATE_DB_ATTRS        : return "bgp.UpdateDBAttrs";
+        case BGP_UPDATE_DB_PREFIXES     : return "bgp.UpdateDBAdvPrefixes";
+        case BGP_UPDATE_DB_WITHDRAWN    : return "bgp.UpdateDBWdrawnPrefixes";
+        case BGP_UPDATE_DB_VPN          : return "bgp.UpdateDBL3Vpn";
+        case BGP_UPDATE_DB_EVPN         : return "bgp.UpdateDBeVPN";
+        case BGP_UPDATE_DB_LS           : return "bgp.UpdateDbBgpLs";
+        case SINK_PEER                  : return "sink.update_Peer";
+        case SINK_ATTR                  : return "sink.update_baseAttribute";
+        case SINK_UNICAST               : return "sink.update_unicastPrefix";
+        case SINK_VPN                   : return "sink.update_L3Vpn";
+        case SINK_EVPN                  : return "sink.update_eVPN";
+        case SINK_LS                    : return "sink.update_Ls";
+        case SINK_PRODUCE               : return "sink.produce";
+        default                         : return "unknown";
+    }
+}
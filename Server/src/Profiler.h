@@ -0,0 +1,144 @@
+/*
+ * Copyright (c) 2024 Microsoft, Inc. and others.  All rights reserved.
+ *
+ * This program and the accompanying materials are made available under the
+ * terms of the Eclipse Public License v1.0 which accompanies this distribution,
+ * and is available at http://www.eclipse.org/legal/epl-v10.html
+ *
+ */
+
+#ifndef PROFILER_H_
+#define PROFILER_H_
+
+#include <atomic>
+#include <cstdint>
+#include <ctime>
+#include <string>
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <x86intrin.h>
+#define PROFILE_TSC             1           ///< Time with rdtsc, converted to ns when dumped
+#endif
+
+#include "Logger.h"
+
+/*
+ * Profiler switch, can be toggled at runtime (debug.profile and SIGUSR1)
+ */
+extern std::atomic<bool> profile_enabled;
+
+#define PROFILE_ON()            TRACE_UNLIKELY(profile_enabled.load(std::memory_order_relaxed))
+
+/*
+ * PROFILE_SCOPE times the rest of the scope it is declared in, one per scope
+ */
+#define PROFILE_SCOPE(point)    ProfileTimer profile_timer(Profiler::point)
+
+/**
+ * \class   Profiler
+ *
+ * \brief   Scoped timers of the parsers and sinks, aggregated per thread
+ * \details
+ *      Each thread records the calls, total and max time of the points it runs into its
+ *      own counters, added to the profile when the thread records its first time.  Only
+ *      that thread writes them, so a timer takes no lock and no atomic read-modify-write.
+ *      The counters of threads that ended are added to a single entry.
+ *
+ *      Times are inclusive: a point timed within another (UpdateDB within handleUpdate)
+ *      is counted in both.  handleMessage includes the read of the message from the
+ *      router buffer.
+ *
+ *      When profile_enabled is off a timer is a relaxed load and a branch.
+ */
+class Profiler {
+public:
+    /// Points timed, see getPointName()
+    enum point {
+        BMP_HANDLE_MESSAGE = 0,
+        BGP_HANDLE_UPDATE,
+        BGP_PARSE_ATTRS,
+        BGP_UPDATE_DB,
+        BGP_UPDATE_DB_ATTRS,
+        BGP_UPDATE_DB_PREFIXES,
+        BGP_UPDATE_DB_WITHDRAWN,
+        BGP_UPDATE_DB_VPN,
+        BGP_UPDATE_DB_EVPN,
+        BGP_UPDATE_DB_LS,
+        SINK_PEER,
+        SINK_ATTR,
+        SINK_UNICAST,
+        SINK_VPN,
+        SINK_EVPN,
+        SINK_LS,
+        SINK_PRODUCE,
+        POINT_MAX
+    };
+
+    /**
+     * Current time in ticks, rdtsc if available otherwise CLOCK_MONOTONIC ns
+     */
+    static inline uint64_t ticks() {
+#ifdef PROFILE_TSC
+        return __rdtsc();
+#else
+        timespec ts;
+        clock_gettime(CLOCK_MONOTONIC, &ts);
+        return (uint64_t)ts.tv_sec * 1000000000ULL + ts.tv_nsec;
+#endif
+    }
+
+    /**
+     * Record the time of a point, called by the timers of the thread
+     *
+     * \param [in] p        Point
+     * \param [in] elapsed  Ticks
+     */
+    static void record(point p, uint64_t elapsed);
+
+    /**
+     * Name the calling thread in the profile, such as "reader 10.0.0.1"
+     */
+    static void setThreadName(const std::string &name);
+
+    /**
+     * Enable or disable the timers
+     */
+    static void enable(bool on);
+
+    /**
+     * Dump the profile of the threads and the totals per point
+     *
+     * \param [in] logger   Logger, the profile is logged if file is empty
+     * \param [in] file     File the profile is appended to, empty to log it
+     */
+    static void dump(Logger *logger, const std::string &file);
+
+    /**
+     * Name of a point
+     */
+    static const char *getPointName(point p);
+};
+
+/**
+ * \class   ProfileTimer
+ *
+ * \brief   Times a scope when the profiler is enabled, see PROFILE_SCOPE
+ */
+class ProfileTimer {
+public:
+    explicit inline ProfileTimer(Profiler::point p) : p(p), start(0) {
+        if (PROFILE_ON())
+            start = Profiler::ticks();
+    }
+
+    inline ~ProfileTimer() {
+        if (TRACE_UNLIKELY(start != 0))
+            Profiler::record(p, Profiler::ticks() - start);
+    }
+
+private:
+    Profiler::point     p;
+    uint64_t            start;
+};
+
+#endif /* PROFILER_H_ */
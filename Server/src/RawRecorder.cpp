@@ -0,0 +1,481 @@
+/*
+ * Copyright (c) 2024 Microsoft, Inc. and others.  All rights reserved.
+ *
+ * This program and the accompanying materials are made available under the
+ * terms of the Eclipse Public License v1.0 which accompanies this distribution,
+ * and is available at http://www.eclipse.org/legal/epl-v10.html
+ *
+ */
+
+#include <sys/stat.h>
+#include <arpa/inet.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <cerrno>
+#include <cstring>
+#include <cinttypes>
+#include <algorithm>
+
+#include "RawRecorder.h"
+
+/**
+ * Monotonic time in milliseconds, coarse (cheap) clock
+ */
+static uint64_t nowMs() {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC_COARSE, &ts);
+
+    return (uint64_t)ts.tv_sec * 1000 + ts.tv_nsec / 1000000;
+}
+
+/**
+ * Constructor for class, starts the writer thread
+ *
+ * \param [in] logPtr       Pointer to existing Logger for app logging
+ * \param [in] dir          Directory of the recordings
+ * \param [in] segment_size Bytes of a segment before it is rotated
+ * \param [in] max_disk     Max bytes of all segments
+ * \param [in] queue_size   Max bytes queued to the writer
+ * \param [in] compress     Indicates if segments are gzip compressed
+ *
+ * \throws const char * with the error message
+ */
+RawRecorder::RawRecorder(Logger *logPtr, const std::string &dir, size_t segment_size, size_t max_disk,
+                         size_t queue_size, bool compress) {
+    logger = logPtr;
+    this->dir = dir;
+    this->segment_size = segment_size;
+    this->max_disk = max_disk;
+    this->queue_size = queue_size;
+    this->compress = compress;
+
+    queued = 0;
+    writing = false;
+    stop = false;
+    dropped = 0;
+    disk_used = 0;
+    segment_seq = 0;
+
+    if (mkdir(dir.c_str(), 0755) != 0 and errno != EEXIST)
+        throw "Cannot create the raw recording directory";
+
+    writer = new std::thread(&RawRecorder::run, this);
+
+    LOG_INFO("Raw recording of the routers in %s, max disk %zu MB", dir.c_str(), max_disk / (1024 * 1024));
+}
+
+RawRecorder::~RawRecorder() {
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        stop = true;
+    }
+    cond.notify_one();
+
+    writer->join();
+    delete writer;
+}
+
+RawRecorder::stream *RawRecorder::openStream(const char *router) {
+    stream *s = new stream();
+
+    s->offset = 0;
+    s->framed = true;
+    s->hdr_len = 0;
+    s->msg_left = 0;
+    s->cur = newBlock(s);
+
+    s->router = router;
+    s->fd = -1;
+    s->gz = NULL;
+    s->index = NULL;
+    s->seg_bytes = 0;
+    s->seg_disk = 0;
+    s->indexed = 0;
+    s->written = 0;
+    s->failed = false;
+
+    LOG_INFO("%s: Recording raw BMP to %s/%s", router, dir.c_str(), router);
+
+    return s;
+}
+
+void RawRecorder::closeStream(stream *s) {
+    // A partial message of a closed connection is recorded as received
+    if (s->cur->data.size())
+        submit(s, true);
+
+    delete s->cur;
+    s->cur = NULL;
+
+    // Closing is never dropped, the writer frees the stream
+    block *b = newBlock(s);
+    b->close = true;
+
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        queue.push_back(b);
+    }
+    cond.notify_one();
+}
+
+void RawRecorder::write(stream *s, const u_char *data, size_t len) {
+    block *b = s->cur;
+
+    if (len == 0)
+        return;
+
+    if (b->data.empty()) {
+        b->received = time(NULL);
+        b->opened_ms = nowMs();
+    }
+
+    b->data.insert(b->data.end(), data, data + len);
+    frame(s, data, len);
+
+    if (not s->framed)
+        b->end = b->data.size();
+
+    if (b->data.size() >= RECORD_BLOCK_SIZE)
+        submit(s, false);
+}
+
+void RawRecorder::idle(stream *s) {
+    block *b = s->cur;
+
+    if (b->end > 0 and nowMs() - b->opened_ms >= RECORD_FLUSH_MS)
+        submit(s, false);
+}
+
+void RawRecorder::flush() {
+    std::unique_lock<std::mutex> lock(mutex);
+    written_cond.wait(lock, [this] { return queue.empty() and not writing; });
+}
+
+uint64_t RawRecorder::getDropped() {
+    return dropped;
+}
+
+uint64_t RawRecorder::getDiskUsed() {
+    return disk_used;
+}
+
+void RawRecorder::frame(stream *s, const u_char *data, size_t len) {
+    size_t base = s->cur->data.size() - len;
+    size_t pos = 0;
+
+    while (pos < len and s->framed) {
+        if (s->msg_left > 0) {
+            size_t n = std::min((size_t)s->msg_left, len - pos);
+            pos += n;
+            s->msg_left -= n;
+
+            if (s->msg_left == 0)
+                s->cur->end = base + pos;
+
+            continue;
+        }
+
+        // Common header, version and message length
+        s->hdr[s->hdr_len++] = data[pos++];
+
+        if (s->hdr_len == sizeof(s->hdr)) {
+            uint32_t msg_len;
+            memcpy(&msg_len, s->hdr + 1, sizeof(msg_len));
+            msg_len = ntohl(msg_len);
+            s->hdr_len = 0;
+
+            if (s->hdr[0] != 3 or msg_len <= sizeof(s->hdr)) {
+                LOG_NOTICE("%s: Router stream is not BMP v3, raw recording is not split at message boundaries",
+                           s->router.c_str());
+                s->framed = false;
+                break;
+            }
+
+            s->msg_left = msg_len - sizeof(s->hdr);
+        }
+    }
+}
+
+void RawRecorder::submit(stream *s, bool all) {
+    block *b = s->cur;
+    size_t end = all ? b->data.size() : b->end;
+
+    if (end == 0)
+        return;
+
+    // The partial message starts the next block
+    s->cur = newBlock(s);
+
+    if (end < b->data.size()) {
+        s->cur->data.assign(b->data.begin() + end, b->data.end());
+        s->cur->received = time(NULL);
+        s->cur->opened_ms = nowMs();
+        b->data.resize(end);
+    }
+
+    b->offset = s->offset;
+    s->offset += end;
+
+    bool drop;
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+
+        drop = queued + end > queue_size;
+        if (not drop) {
+            queue.push_back(b);
+            queued += end;
+        }
+    }
+
+    if (drop) {
+        dropped += end;
+        delete b;
+    } else {
+        cond.notify_one();
+    }
+}
+
+RawRecorder::block *RawRecorder::newBlock(stream *s) {
+    block *b = new block();
+
+    b->s = s;
+    b->end = 0;
+    b->offset = 0;
+    b->received = 0;
+    b->opened_ms = 0;
+    b->close = false;
+    b->data.reserve(RECORD_BLOCK_SIZE);
+
+    return b;
+}
+
+void RawRecorder::run() {
+    while (true) {
+        std::deque<block *> blocks;
+
+        {
+            std::unique_lock<std::mutex> lock(mutex);
+
+            writing = false;
+            if (queue.empty())
+                written_cond.notify_all();
+
+            cond.wait(lock, [this] { return queue.size() > 0 or stop; });
+
+            if (queue.empty())
+                break;
+
+            blocks.swap(queue);
+            writing = true;
+        }
+
+        for (size_t i = 0; i < blocks.size(); i++) {
+            size_t len = blocks[i]->data.size();
+
+            writeBlock(blocks[i]);
+            delete blocks[i];
+
+            std::lock_guard<std::mutex> lock(mutex);
+            queued -= len;
+        }
+    }
+}
+
+void RawRecorder::writeBlock(block *b) {
+    stream *s = b->s;
+    size_t len = b->data.size();
+
+    if (b->close) {
+        closeSegment(s);
+        delete s;
+        return;
+    }
+
+    // A segment is contiguous, blocks before were dropped
+    if (s->path.size() and (b->offset != s->written or s->seg_bytes >= segment_size))
+        closeSegment(s);
+
+    s->written = b->offset + len;
+
+    if (s->path.empty() and not openSegment(s, b->received)) {
+        dropped += len;
+        return;
+    }
+
+    uint64_t seg_disk = s->seg_disk;
+    bool ok;
+
+    if (s->seg_bytes == 0 or s->seg_bytes - s->indexed >= RECORD_INDEX_INTERVAL)
+        addIndex(s, b->offset, b->received);
+
+    if (s->gz != NULL) {
+        ok = gzwrite(s->gz, b->data.data(), len) == (int)len;
+        s->seg_disk = gzoffset(s->gz);
+
+    } else {
+        size_t pos = 0;
+        ssize_t n = 0;
+
+        while (pos < len and (n = ::write(s->fd, b->data.data() + pos, len - pos)) > 0)
+            pos += n;
+
+        ok = pos == len;
+        s->seg_disk += pos;
+    }
+
+    disk_used += s->seg_disk - seg_disk;
+
+    if (ok) {
+        s->seg_bytes += len;
+
+    } else {
+        if (not s->failed)
+            LOG_ERR("%s: Cannot write raw recording %s: %s", s->router.c_str(), s->path.c_str(), strerror(errno));
+
+        s->failed = true;
+        closeSegment(s);
+        dropped += len;
+    }
+
+    enforceBudget(s);
+}
+
+bool RawRecorder::openSegment(stream *s, time_t first) {
+    std::string router_dir = dir + "/" + s->router;
+    char name[80];
+    char ts[32];
+    struct tm tm;
+
+    if (mkdir(router_dir.c_str(), 0755) != 0 and errno != EEXIST) {
+        if (not s->failed)
+            LOG_ERR("%s: Cannot create raw recording directory %s: %s", s->router.c_str(), router_dir.c_str(),
+                    strerror(errno));
+        s->failed = true;
+        return false;
+    }
+
+    // Named by the time of the first message, the pid and sequence keep the names of the workers unique
+    gmtime_r(&first, &tm);
+    strftime(ts, sizeof(ts), "%Y%m%d-%H%M%S", &tm);
+    snprintf(name, sizeof(name), "%s-%d-%u", ts, (int)getpid(), ++segment_seq);
+
+    s->path = router_dir + "/" + name + (compress ? ".bmp.gz" : ".bmp");
+    s->index_path = router_dir + "/" + name + ".idx";
+
+    s->fd = open(s->path.c_str(), O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC, 0644);
+    if (s->fd >= 0 and compress) {
+        // Fastest level, the writer serves all routers
+        if ((s->gz = gzdopen(s->fd, "wb1")) == NULL) {
+            close(s->fd);
+            s->fd = -1;
+        }
+    }
+
+    if (s->fd >= 0)
+        s->index = fopen(s->index_path.c_str(), "we");
+
+    if (s->fd < 0 or s->index == NULL) {
+        if (not s->failed)
+            LOG_ERR("%s: Cannot create raw recording %s: %s", s->router.c_str(), s->path.c_str(), strerror(errno));
+
+        if (s->gz != NULL)
+            gzclose(s->gz);
+        else if (s->fd >= 0)
+            close(s->fd);
+
+        unlink(s->path.c_str());
+
+        s->gz = NULL;
+        s->fd = -1;
+        s->path.clear();
+        s->failed = true;
+        return false;
+    }
+
+    fprintf(s->index, "# segment_offset file_offset stream_offset time\n");
+
+    if (s->gz != NULL)
+        s->fd = -1;
+
+    s->seg_bytes = 0;
+    s->seg_disk = 0;
+    s->indexed = 0;
+    s->failed = false;
+
+    return true;
+}
+
+void RawRecorder::closeSegment(stream *s) {
+    segment seg;
+    struct stat st;
+
+    if (s->path.empty())
+        return;
+
+    if (s->gz != NULL)
+        gzclose(s->gz);
+    else
+        close(s->fd);
+
+    fclose(s->index);
+
+    seg.path = s->path;
+    seg.index_path = s->index_path;
+    seg.size = 0;
+
+    if (stat(seg.path.c_str(), &st) == 0)
+        seg.size += st.st_size;
+
+    if (stat(seg.index_path.c_str(), &st) == 0)
+        seg.size += st.st_size;
+
+    // Actual size, the open segment was counted by bytes written
+    disk_used -= s->seg_disk;
+    disk_used += seg.size;
+
+    closed.push_back(seg);
+
+    s->gz = NULL;
+    s->fd = -1;
+    s->index = NULL;
+    s->path.clear();
+    s->index_path.clear();
+    s->seg_disk = 0;
+}
+
+void RawRecorder::addIndex(stream *s, uint64_t offset, time_t received) {
+    uint64_t file_offset = s->seg_bytes;
+
+    // Compression state is reset, so inflate can start at this point
+    if (s->gz != NULL) {
+        if (s->seg_bytes > 0)
+            gzflush(s->gz, Z_FULL_FLUSH);
+
+        file_offset = s->seg_disk = gzoffset(s->gz);
+    }
+
+    fprintf(s->index, "%" PRIu64 " %" PRIu64 " %" PRIu64 " %ld\n", s->seg_bytes, file_offset, offset,
+            (long)received);
+
+    s->indexed = s->seg_bytes;
+}
+
+void RawRecorder::enforceBudget(stream *s) {
+    while (disk_used > max_disk) {
+        if (closed.empty()) {
+            if (s->path.empty())
+                break;
+
+            // Open segments alone are over the budget, the one written is closed and removed
+            closeSegment(s);
+            continue;
+        }
+
+        segment &seg = closed.front();
+        unlink(seg.path.c_str());
+        unlink(seg.index_path.c_str());
+
+        disk_used -= seg.size;
+        closed.pop_front();
+    }
+}
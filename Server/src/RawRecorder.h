@@ -0,0 +1,261 @@
+/*
+ * Copyright (c) 2024 Microsoft, Inc. and others.  All rights reserved.
+ *
+ * This program and the accompanying materials are made available under the
+ * terms of the Eclipse Public License v1.0 which accompanies this distribution,
+ * and is available at http://www.eclipse.org/legal/epl-v10.html
+ *
+ */
+
+#ifndef RAWRECORDER_H_
+#define RAWRECORDER_H_
+
+#include <sys/types.h>
+#include <cstdio>
+#include <ctime>
+#include <string>
+#include <deque>
+#include <vector>
+#include <mutex>
+#include <condition_variable>
+#include <thread>
+#include <atomic>
+#include <zlib.h>
+
+#include "Logger.h"
+
+#define RECORD_BLOCK_SIZE       (256 * 1024)        ///< Bytes of a router batched before they are queued
+#define RECORD_FLUSH_MS         1000                ///< Max time bytes of a router are batched
+#define RECORD_INDEX_INTERVAL   (1024 * 1024)       ///< Segment bytes between index entries
+
+/**
+ * \class   RawRecorder
+ *
+ * \brief   Records the raw BMP streams of the routers to rotated segment files
+ * \details
+ *      The client threads add the bytes received from their router to a stream, the bytes
+ *      are batched in blocks of whole BMP messages and written by a background thread.
+ *      When more than the queue size is waiting to be written, the block is dropped
+ *      (counted), so a slow disk never slows reading the routers.
+ *
+ *      Segments are written per router in <dir>/<router ip>/, named by the time of their
+ *      first message.  A segment is started when the previous one reached the segment size
+ *      or when blocks were dropped, so each segment starts at a BMP message boundary and
+ *      is contiguous.  The oldest segments written by the recorder are removed to stay
+ *      within the disk budget.
+ *
+ *      Each segment has an index file (.idx), a text line per index point:
+ *          <segment offset> <file offset> <stream offset> <unix time>
+ *      Index points are at message boundaries, the stream offset counts all bytes received
+ *      from the router (dropped bytes show as a gap).  In compressed segments, index
+ *      points after the first are zlib full flush points, raw inflate can start at the
+ *      file offset.
+ *
+ *      Streams of BMP versions other than 3 are not framed, blocks are then cut at any byte.
+ */
+class RawRecorder {
+public:
+    struct stream;
+
+    /**
+     * Constructor for class, starts the writer thread
+     *
+     * \param [in] logPtr       Pointer to existing Logger for app logging
+     * \param [in] dir          Directory of the recordings
+     * \param [in] segment_size Bytes of a segment before it is rotated
+     * \param [in] max_disk     Max bytes of all segments
+     * \param [in] queue_size   Max bytes queued to the writer
+     * \param [in] compress     Indicates if segments are gzip compressed
+     */
+    RawRecorder(Logger *logPtr, const std::string &dir, size_t segment_size, size_t max_disk,
+                size_t queue_size, bool compress);
+
+    /**
+     * Destructor, writes the queued blocks and stops the writer
+     */
+    virtual ~RawRecorder();
+
+    /**
+     * Open the stream of a router connection
+     *
+     * \param [in] router   Router IP address, name of the router directory
+     */
+    stream *openStream(const char *router);
+
+    /**
+     * Close a stream, the bytes not written yet are queued, the stream is freed by the writer
+     *
+     * \param [in] s        Stream to close, not used anymore after the call
+     */
+    void closeStream(stream *s);
+
+    /**
+     * Add bytes received from the router, called by the client thread
+     *
+     * \param [in] s        Stream of the router
+     * \param [in] data     Bytes received
+     * \param [in] len      Number of bytes
+     */
+    void write(stream *s, const u_char *data, size_t len);
+
+    /**
+     * Queue the batched bytes of a stream if they were batched longer than RECORD_FLUSH_MS
+     *
+     * \details Called by the client thread in its loop, also when nothing was received.
+     *
+     * \param [in] s        Stream of the router
+     */
+    void idle(stream *s);
+
+    /**
+     * Wait until the queued blocks are written, used at exit after the streams are closed
+     */
+    void flush();
+
+    /**
+     * Bytes received but not recorded, queue full or write errors
+     */
+    uint64_t getDropped();
+
+    /**
+     * Disk space used by the segments
+     */
+    uint64_t getDiskUsed();
+
+private:
+    /*
+     * Bytes of a stream written together
+     */
+    struct block {
+        stream              *s;
+        std::vector<u_char> data;
+        size_t              end;            ///< Bytes of the whole BMP messages in data
+        uint64_t            offset;         ///< Stream offset of the first byte
+        time_t              received;       ///< Time the first byte was received
+        uint64_t            opened_ms;      ///< Monotonic time the first byte was added
+        bool                close;          ///< Close the stream, no data
+    };
+
+    /*
+     * Segment closed by the writer, removed when over the disk budget
+     */
+    struct segment {
+        std::string         path;
+        std::string         index_path;
+        uint64_t            size;           ///< Bytes on disk of the segment and the index
+    };
+
+    Logger                      *logger;        ///< Logging class pointer
+    std::string                 dir;
+    size_t                      segment_size;
+    size_t                      max_disk;
+    size_t                      queue_size;
+    bool                        compress;
+
+    std::mutex                  mutex;
+    std::condition_variable     cond;           ///< Signaled when a block is queued
+    std::condition_variable     written_cond;   ///< Signaled when the queue is written
+    std::deque<block *>         queue;          ///< Blocks to write, in the order they were queued
+    size_t                      queued;         ///< Bytes in the queue and being written
+    bool                        writing;        ///< Writer is writing blocks taken from the queue
+    bool                        stop;
+
+    std::atomic<uint64_t>       dropped;
+    std::atomic<uint64_t>       disk_used;
+
+    std::thread                 *writer;
+
+    /*
+     * Writer only
+     */
+    std::deque<segment>         closed;         ///< Closed segments, oldest first
+    unsigned                    segment_seq;    ///< Sequence number of the last segment name
+
+    /**
+     * Advance the BMP framing of a stream over bytes added to its block
+     *
+     * \param [in] s        Stream, the bytes are at the end of its block
+     * \param [in] data     Bytes added
+     * \param [in] len      Number of bytes
+     */
+    void frame(stream *s, const u_char *data, size_t len);
+
+    /**
+     * Queue the whole messages of the block of a stream, the rest is kept in a new block
+     *
+     * \param [in] s        Stream
+     * \param [in] all      Queue all bytes, also a partial message
+     */
+    void submit(stream *s, bool all);
+
+    /**
+     * Start a block for a stream
+     */
+    block *newBlock(stream *s);
+
+    /**
+     * Writer thread loop
+     */
+    void run();
+
+    /**
+     * Write a block to the segment of its stream, rotates the segment as needed
+     */
+    void writeBlock(block *b);
+
+    /**
+     * Open a new segment for a stream
+     *
+     * \return true if opened, false on error (logged)
+     */
+    bool openSegment(stream *s, time_t first);
+
+    /**
+     * Close the segment of a stream, if open
+     */
+    void closeSegment(stream *s);
+
+    /**
+     * Add an index point at the current segment offset
+     */
+    void addIndex(stream *s, uint64_t offset, time_t received);
+
+    /**
+     * Remove the oldest segments while over the disk budget
+     *
+     * \param [in] s        Stream written, its segment is closed if the open segments are over the budget
+     */
+    void enforceBudget(stream *s);
+};
+
+/**
+ * Raw BMP stream of a router connection
+ */
+struct RawRecorder::stream {
+    /*
+     * Client thread
+     */
+    block           *cur;               ///< Block bytes are added to
+    uint64_t        offset;             ///< Stream offset of the block
+    bool            framed;             ///< Stream is BMP v3, blocks end at message boundaries
+    u_char          hdr[5];             ///< Version and length of the message header being read
+    int             hdr_len;
+    uint32_t        msg_left;           ///< Bytes of the message not added yet
+
+    /*
+     * Writer
+     */
+    std::string     router;
+    std::string     path;               ///< Segment being written, empty if none
+    std::string     index_path;
+    int             fd;                 ///< Segment file, -1 if compressed
+    gzFile          gz;                 ///< Compressed segment file, NULL if not compressed
+    FILE            *index;
+    uint64_t        seg_bytes;          ///< Bytes written to the segment
+    uint64_t        seg_disk;           ///< Bytes on disk of the segment
+    uint64_t        indexed;            ///< Segment offset of the last index point
+    uint64_t        written;            ///< Stream offset after the last byte written
+    bool            failed;             ///< Write error logged, not logged again until a segment is opened
+};
+
+#endif /* RAWRECORDER_H_ */
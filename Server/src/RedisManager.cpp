@@ -8,6 +8,12 @@
  */
 
 #include "RedisManager.h"
+#include "md5.h"
+#include "Profiler.h"
+
+#include <cinttypes>
+#include <cstring>
+#include <cerrno>
 
 
 /*********************************************************************//**
@@ -15,12 +21,27 @@
  ***********************************************************************/
 RedisManager::RedisManager() {
     exit_ = false;
+    oplogFailed_ = false;
+    compactSchema_ = false;
+    attrSweepSecs_ = 0;
+    sweeping_ = false;
+    notifications_ = false;
+    opsCommitted_ = 0;
+    queueFull_ = 0;
+    latencyMax_ = 0;
+    attrGen_ = 0;
+
+    for (int i = 0; i < BMP_TABLE_ID_MAX; i++) {
+        tableEnabled_[i] = false;
+        resyncGen_[i] = 0;
+    }
 }
 
 /*********************************************************************//**
- * Constructor for class
+ * Destructor for class
  ***********************************************************************/
 RedisManager::~RedisManager() {
+    ExitRedisManager();
 }
 
 
@@ -28,15 +49,101 @@ RedisManager::~RedisManager() {
  * Setup for this class
  *
  * \param [in] logPtr     logger pointer
+ * \param [in] cfg        Pointer to the config instance
  ***********************************************************************/
-void RedisManager::Setup(Logger *logPtr) {
+void RedisManager::Setup(Logger *logPtr, Config *cfg) {
     logger = logPtr;
+    compactSchema_ = cfg->redis_compact_schema;
+    attrSweepSecs_ = cfg->redis_attr_sweep_secs;
+    notifications_ = cfg->redis_notifications;
     if (!swss::SonicDBConfig::isInit()) {
         swss::SonicDBConfig::initialize();
     }
 
-    stateDb_ =  std::make_shared<swss::DBConnector>(BMP_DB_NAME, 0, false);
+    swss::DBConnector stateDb(BMP_DB_NAME, 0, false);
     separator_ = swss::SonicDBConfig::getSeparator(BMP_DB_NAME);
+
+    // The queue size is split across the writers
+    int queue_size = cfg->redis_queue_size / cfg->redis_connections;
+
+    for (int i = 0; i < cfg->redis_connections; i++) {
+        std::unique_ptr<Writer> w = std::make_unique<Writer>();
+        w->pipeline = std::make_unique<swss::RedisPipeline>(&stateDb, REDIS_WRITER_BATCH_SIZE);
+        w->oplog = NULL;
+        w->queue = std::make_unique<BoundedOpQueue<RedisOp>>(queue_size);
+        w->attrGen = 0;
+        w->writerParked = false;
+        w->producersParked = 0;
+        writers_.push_back(std::move(w));
+    }
+
+    for (auto& w : writers_) {
+        w->thread = std::thread(&RedisManager::WriterThreadLoop, this, w.get());
+    }
+
+    LOG_INFO("RedisManager started with %d connections to %s", cfg->redis_connections, BMP_DB_NAME);
+}
+
+
+/*********************************************************************
+ * Setup to write the operations to a log file instead of BMP_STATE_DB
+ *
+ * \param [in] logPtr     logger pointer
+ * \param [in] cfg        Pointer to the config instance
+ * \param [in] path       Operations log file, truncated
+ ***********************************************************************/
+void RedisManager::SetupOpLog(Logger *logPtr, Config *cfg, const std::string &path) {
+    logger = logPtr;
+    compactSchema_ = cfg->redis_compact_schema;
+    notifications_ = cfg->redis_notifications;
+
+    // The separator is read from the database config when there is one, logs can be set up concurrently
+    separator_ = "|";
+    {
+        static std::mutex dbConfigMutex;
+        std::lock_guard<std::mutex> lock(dbConfigMutex);
+
+        try {
+            if (!swss::SonicDBConfig::isInit()) {
+                swss::SonicDBConfig::initialize();
+            }
+            separator_ = swss::SonicDBConfig::getSeparator(BMP_DB_NAME);
+        } catch (const std::exception &e) {
+            LOG_INFO("RedisManager no database config (%s), using key separator %s", e.what(), separator_.c_str());
+        }
+    }
+
+    for (int i = 0; i < BMP_TABLE_ID_MAX; i++)
+        tableEnabled_[i] = true;
+
+    std::unique_ptr<Writer> w = std::make_unique<Writer>();
+    w->oplog = fopen(path.c_str(), "w");
+    if (w->oplog == NULL)
+        throw "Cannot open the redis operations log";
+
+    setvbuf(w->oplog, NULL, _IOFBF, 1024 * 1024);
+    w->queue = std::make_unique<BoundedOpQueue<RedisOp>>(cfg->redis_queue_size);
+    w->attrGen = 0;
+    w->writerParked = false;
+    w->producersParked = 0;
+    writers_.push_back(std::move(w));
+
+    writers_[0]->thread = std::thread(&RedisManager::WriterThreadLoop, this, writers_[0].get());
+
+    LOG_INFO("RedisManager writing operations to %s", path.c_str());
+}
+
+
+/**
+ * Get the writer shard for a router session
+ *
+ * \param [in] hash_id  Router hash id (16 bytes)
+ */
+size_t RedisManager::GetShard(const u_char *hash_id) {
+    uint32_t value;
+    memcpy(&value, hash_id, sizeof(value));
+
+    return value % writers_.size();
 }
 
 
@@ -54,27 +161,129 @@ std::string RedisManager::GetKeySeparator() {
 /**
  * WriteBMPTable
  *
+ * \param [in] shard            Session writer shard
  * \param [in] table            Reference to table name
  * \param [in] key              Reference to various keys list
- * \param [in] fieldValues      Reference to field-value pairs
+ * \param [in] fieldValues      Field-value pairs
+ */
+bool RedisManager::WriteBMPTable(size_t shard, const std::string& table, const std::vector<std::string>& keys, std::vector<swss::FieldValueTuple> fieldValues) {
+
+    RedisOp op;
+    op.type = OP_SET;
+    BuildKey(table, keys, separator_, op.key);
+    op.fieldValues = std::move(fieldValues);
+
+    TRACE(TRACE_REDIS, "RedisManager WriteBMPTable key = %s", op.key.c_str());
+
+    Enqueue(shard, op);
+    return true;
+}
+
+
+/**
+ * Build the full key of a table entry
+ *
+ * \param [in] table            Reference to table name
+ * \param [in] keys             Reference to various keys list
+ * \param [in] separator        Key separator
+ * \param [out] key             Full key, as <table><separator><key 1><separator><key 2>...
  */
-bool RedisManager::WriteBMPTable(const std::string& table, const std::vector<std::string>& keys, const std::vector<swss::FieldValueTuple> fieldValues) {
+void RedisManager::BuildKey(const std::string& table, const std::vector<std::string>& keys,
+                            const std::string& separator, std::string& key) {
+    size_t len = table.length();
+    for (const auto& k : keys)
+        len += separator.length() + k.length();
 
-    if (enabledTables_.find(table) == enabledTables_.end()) {
-        LOG_INFO("RedisManager %s is disabled", table.c_str());
-        return false;
+    key.reserve(len);
+    key = table;
+    for (const auto& k : keys) {
+        key += separator;
+        key += k;
     }
-    std::unique_ptr<swss::Table> stateBMPTable = std::make_unique<swss::Table>(stateDb_.get(), table);
-    std::ostringstream oss;
-    for (const auto& key : keys) {
-        oss << key << separator_;
+}
+
+
+/**
+ * Indicates if the compact schema is in use
+ *
+ * \param [in] N/A
+ */
+bool RedisManager::IsCompactSchema() {
+    return compactSchema_;
+}
+
+
+/**
+ * Generate the compact schema attribute id
+ *
+ * \param [in] attrFieldValues  Reference to attribute field-value pairs
+ * \param [out] attrId          Attribute id (hex string of the truncated MD5 of the values)
+ */
+void RedisManager::GetAttrId(const std::vector<swss::FieldValueTuple>& attrFieldValues, std::string& attrId) {
+    MD5 hash;
+
+    for (const auto& fieldValue : attrFieldValues) {
+        const std::string& value = std::get<1>(fieldValue);
+        hash.update((unsigned char *)value.c_str(), value.length());
+        hash.update((unsigned char *)"\t", 1);
     }
-    std::string fullKey = oss.str();
-    fullKey.pop_back();
+    hash.finalize();
+
+    char *hex = hash.hex_digest();
+    attrId.assign(hex, BMP_ATTR_ID_LEN);
+    delete[] hex;
+}
+
+
+/**
+ * WriteRibCompact, compact schema write of prefixes sharing one attribute set
+ *
+ * \param [in] shard            Session writer shard
+ * \param [in] table            Reference to table name BGP_RIB_OUT_TABLE/BGP_RIB_IN_TABLE
+ * \param [in] peer             Reference to peer address
+ * \param [in] prefixes         Reference to prefix list (prefix/len)
+ * \param [in] attrFieldValues  Reference to attribute field-value pairs
+ */
+bool RedisManager::WriteRibCompact(size_t shard, const std::string& table, const std::string& peer,
+                                   const std::vector<std::string>& prefixes, const std::vector<swss::FieldValueTuple>& attrFieldValues) {
+
+    RedisOp op;
+    op.type = OP_COMPACT_SET;
+    GetAttrId(attrFieldValues, op.attrId);
+
+    op.key = table;
+    op.key += separator_;
+    op.key += peer;
+    op.fields = prefixes;
+    op.fieldValues = attrFieldValues;
+
+    TRACE(TRACE_REDIS, "RedisManager WriteRibCompact key = %s, prefixes = %zu, attr = %s", op.key.c_str(), prefixes.size(), op.attrId.c_str());
+
+    Enqueue(shard, op);
+    return true;
+}
+
+
+/**
+ * RemoveRibCompact, compact schema removal of prefixes from the per-peer hash
+ *
+ * \param [in] shard            Session writer shard
+ * \param [in] table            Reference to table name BGP_RIB_OUT_TABLE/BGP_RIB_IN_TABLE
+ * \param [in] peer             Reference to peer address
+ * \param [in] prefixes         Reference to prefix list (prefix/len)
+ */
+bool RedisManager::RemoveRibCompact(size_t shard, const std::string& table, const std::string& peer, const std::vector<std::string>& prefixes) {
 
-    DEBUG("RedisManager WriteBMPTable key = %s", fullKey.c_str());
+    RedisOp op;
+    op.type = OP_COMPACT_DEL;
+    op.key = table;
+    op.key += separator_;
+    op.key += peer;
+    op.fields = prefixes;
 
-    stateBMPTable->set(fullKey, fieldValues);
+    TRACE(TRACE_REDIS, "RedisManager RemoveRibCompact key = %s, prefixes = %zu", op.key.c_str(), prefixes.size());
+
+    Enqueue(shard, op);
     return true;
 }
 
@@ -82,14 +291,20 @@ bool RedisManager::WriteBMPTable(const std::string& table, const std::vector<std
 /**
  * RemoveEntityFromBMPTable
  *
+ * \param [in] shard            Session writer shard
  * \param [in] keys             Reference to various keys
  */
-bool RedisManager::RemoveEntityFromBMPTable(const std::vector<std::string>& keys) {
+bool RedisManager::RemoveEntityFromBMPTable(size_t shard, const std::vector<std::string>& keys) {
+
+    RedisOp op;
+    op.type = OP_DEL;
 
     for (const auto& key : keys) {
-        DEBUG("RedisManager RemoveEntityFromBMPTable key = %s", key.c_str());
+        TRACE(TRACE_REDIS, "RedisManager RemoveEntityFromBMPTable key = %s", key.c_str());
+
+        op.key = key;
+        Enqueue(shard, op);
     }
-    stateDb_->del(keys);
     return true;
 }
 
@@ -98,14 +313,37 @@ bool RedisManager::RemoveEntityFromBMPTable(const std::vector<std::string>& keys
  * ExitRedisManager
  *
  * \param [in] N/A
+ *
+ * \return false if writing the operations log failed
  */
-void RedisManager::ExitRedisManager() {
+bool RedisManager::ExitRedisManager() {
     exit_ = true;
+
+    if (cfgThread_.joinable())
+        cfgThread_.join();
+
+    for (auto& w : writers_) {
+        {
+            std::lock_guard<std::mutex> lock(w->parkMutex);
+            w->notEmpty.notify_one();
+        }
+
+        if (w->thread.joinable())
+            w->thread.join();
+
+        if (w->oplog != NULL) {
+            if (ferror(w->oplog) or fclose(w->oplog) != 0)
+                oplogFailed_ = true;
+            w->oplog = NULL;
+        }
+    }
+
+    return not oplogFailed_;
 }
 
 
 /**
- * InitBMPConfig, read config_db for table enablement setting.
+ * InitBMPConfig, read config_db for table enablement setting and subscribe to changes.
  *
  * \param [in] N/A
  */
@@ -115,40 +353,804 @@ bool RedisManager::InitBMPConfig() {
     std::unique_ptr<swss::Table> cfgTable = std::make_unique<swss::Table>(cfgDb.get(), BMP_CFG_TABLE_NAME);
     std::vector<swss::FieldValueTuple> fvt;
     cfgTable->get(BMP_CFG_TABLE_KEY, fvt);
-    for (const auto& item : fvt) {
-        if (item.second == "true") {
-            enabledTables_.insert(item.first);
+    ApplyTableConfig(fvt, true);
+
+    cfgThread_ = std::thread(&RedisManager::ConfigThreadLoop, this);
+    return true;
+}
+
+
+/**
+ * Get the resync generation of a table
+ *
+ * \param [in] id       Table id
+ */
+uint64_t RedisManager::GetResyncGeneration(BMP_TABLE_ID id) {
+    return resyncGen_[id].load(std::memory_order_relaxed);
+}
+
+
+/**
+ * Record that the session of a router was closed to resync
+ *
+ * \param [in] hash_id  Router hash id (16 bytes)
+ */
+void RedisManager::SetResyncReconnect(const u_char *hash_id) {
+    std::lock_guard<std::mutex> lock(resyncMutex_);
+    resyncRouters_.insert(std::string(reinterpret_cast<const char *>(hash_id), 16));
+}
+
+
+/**
+ * Indicates if the router reconnects after its session was closed to resync, clears it
+ *
+ * \param [in] hash_id  Router hash id (16 bytes)
+ */
+bool RedisManager::TakeResyncReconnect(const u_char *hash_id) {
+    std::lock_guard<std::mutex> lock(resyncMutex_);
+    return resyncRouters_.erase(std::string(reinterpret_cast<const char *>(hash_id), 16)) > 0;
+}
+
+
+/**
+ * Config thread loop, applies CONFIG_DB BMP|table changes
+ */
+void RedisManager::ConfigThreadLoop() {
+    try {
+        swss::DBConnector cfgDb("CONFIG_DB", 0, false);
+        swss::SubscriberStateTable cfgSub(&cfgDb, BMP_CFG_TABLE_NAME);
+        swss::Select sel;
+        sel.addSelectable(&cfgSub);
+
+        time_t last_sweep = time(NULL);
+
+        while (!exit_) {
+            // Attribute sets are not reference counted, the ones no longer used are swept
+            if (compactSchema_ and attrSweepSecs_ > 0 and time(NULL) - last_sweep >= attrSweepSecs_) {
+                SweepAttrTable();
+                last_sweep = time(NULL);
+            }
+
+            swss::Selectable *sel_obj;
+            int ret = sel.select(&sel_obj, BMP_CFG_SELECT_TIMEOUT_MS);
+
+            if (ret == swss::Select::ERROR) {
+                LOG_ERR("RedisManager config subscription select error");
+                continue;
+            }
+            if (ret != swss::Select::OBJECT)
+                continue;
+
+            std::deque<swss::KeyOpFieldsValuesTuple> entries;
+            cfgSub.pops(entries);
+
+            for (const auto& entry : entries) {
+                if (swss::kfvKey(entry) != BMP_CFG_TABLE_KEY)
+                    continue;
+
+                if (swss::kfvOp(entry) == SET_COMMAND)
+                    ApplyTableConfig(swss::kfvFieldsValues(entry), false);
+                else
+                    ApplyTableConfig(std::vector<swss::FieldValueTuple>(), false);
+            }
         }
+    } catch (const std::exception &e) {
+        LOG_ERR("RedisManager config subscription ended: %s", e.what());
+    }
+}
+
+
+/**
+ * Apply table enablement
+ *
+ * \param [in] fieldValues      BMP|table field-value pairs, missing tables are disabled
+ * \param [in] initial          True on the initial read, no resync is requested
+ */
+void RedisManager::ApplyTableConfig(const std::vector<swss::FieldValueTuple>& fieldValues, bool initial) {
+    bool enabled[BMP_TABLE_ID_MAX] = { false };
+
+    for (const auto& item : fieldValues) {
+        BMP_TABLE_ID id = GetTableId(item.first);
+        if (id != BMP_TABLE_ID_MAX)
+            enabled[id] = (item.second == "true");
+    }
+
+    // The flag is cleared before the reset is queued, writers drop what is still queued for the table
+    for (int i = 0; i < BMP_TABLE_ID_MAX; i++) {
+        bool was_enabled = tableEnabled_[i].exchange(enabled[i]);
+
+        if (initial or was_enabled == enabled[i])
+            continue;
+
+        if (enabled[i]) {
+            LOG_INFO("RedisManager %s enabled, requesting resync", GetTableName((BMP_TABLE_ID)i));
+
+            // Entries left from before the table was disabled, the reconnects do not reset it
+            QueueBarrier(OP_RESET, GetTableName((BMP_TABLE_ID)i));
+            resyncGen_[i]++;
+
+        } else {
+            LOG_INFO("RedisManager %s disabled, removing entries", GetTableName((BMP_TABLE_ID)i));
+
+            QueueBarrier(OP_RESET, GetTableName((BMP_TABLE_ID)i));
+        }
+    }
+}
+
+
+/**
+ * Get the table id for the CONFIG_DB field name
+ *
+ * \details Field names are matched case insensitive and with '-' treated as '_'.
+ *
+ * \param [in] field    BMP|table field name
+ */
+RedisManager::BMP_TABLE_ID RedisManager::GetTableId(const std::string& field) {
+    std::string name(field);
+
+    for (auto& c : name) {
+        c = (c == '-') ? '_' : tolower(c);
+    }
+
+    if (name.compare(BMP_CFG_TABLE_NEI) == 0)
+        return BMP_TABLE_ID_NEI;
+    else if (name.compare(BMP_CFG_TABLE_RIB_IN) == 0)
+        return BMP_TABLE_ID_RIB_IN;
+    else if (name.compare(BMP_CFG_TABLE_RIB_OUT) == 0)
+        return BMP_TABLE_ID_RIB_OUT;
+
+    return BMP_TABLE_ID_MAX;
+}
+
+
+/**
+ * Get the table id of a full key
+ *
+ * \param [in] key      Full key including the table name
+ */
+RedisManager::BMP_TABLE_ID RedisManager::GetKeyTableId(const std::string& key) {
+    for (int i = 0; i < BMP_TABLE_ID_MAX; i++) {
+        const char *name = GetTableName((BMP_TABLE_ID)i);
+        size_t len = strlen(name);
+
+        if (key.compare(0, len, name) == 0 and key.compare(len, separator_.length(), separator_) == 0)
+            return (BMP_TABLE_ID)i;
+    }
+
+    return BMP_TABLE_ID_MAX;
+}
+
+
+/**
+ * Get the BMP_STATE_DB table name for the table id
+ *
+ * \param [in] id       Table id
+ */
+const char *RedisManager::GetTableName(BMP_TABLE_ID id) {
+    switch (id) {
+        case BMP_TABLE_ID_NEI:      return BMP_TABLE_NEI;
+        case BMP_TABLE_ID_RIB_IN:   return BMP_TABLE_RIB_IN;
+        case BMP_TABLE_ID_RIB_OUT:  return BMP_TABLE_RIB_OUT;
+        default:                    return "";
     }
-    return true;
 }
 
 
 /**
  * Reset ResetBMPTable, this will flush redis
  *
+ * \param [in] w        Writer
  * \param [in] table    Reference to table name BGP_NEIGHBOR_TABLE/BGP_RIB_OUT_TABLE/BGP_RIB_IN_TABLE
  */
-void RedisManager::ResetBMPTable(const std::string & table) {
+void RedisManager::ResetBMPTable(Writer &w, const std::string & table) {
+
+    // The operations log has no keys to read, it is loaded into an empty database
+    if (w.oplog != NULL)
+        return;
 
     LOG_INFO("RedisManager ResetBMPTable %s", table.c_str());
-    std::unique_ptr<swss::Table> stateBMPTable = std::make_unique<swss::Table>(stateDb_.get(), table);
+    std::unique_ptr<swss::Table> stateBMPTable = std::make_unique<swss::Table>(w.pipeline->getDBConnector(), table);
     std::vector<std::string> keys;
     stateBMPTable->getKeys(keys);
-    stateDb_->del(keys);
+
+    // getKeys() returns the keys without the table name
+    for (const auto& key : keys) {
+        swss::RedisCommand cmd;
+        cmd.formatDEL(table + separator_ + key);
+        Push(w, cmd);
+    }
+
+    if (notifications_) {
+        w.changes[table].emplace_back(BMP_NOTIFY_OP_CLEAR, "");
+        PublishChanges(w);
+    }
+
+    w.pipeline->flush();
 }
 
 
+/**
+ * Add change record to be published with the batch
+ *
+ * \param [in] w        Writer
+ * \param [in] op       Change op BMP_NOTIFY_OP_*
+ * \param [in] fullKey  Full key including the table name
+ */
+void RedisManager::AddChange(Writer &w, const char *op, const std::string &fullKey) {
+    size_t pos = fullKey.find(separator_);
+    if (pos == std::string::npos)
+        return;
+
+    w.changes[fullKey.substr(0, pos)].emplace_back(op, fullKey.substr(pos + separator_.length()));
+}
+
 
 /**
- * Reset all Tables once FRR reconnects to BMP, this will not disable table population
+ * Push the pending change records of the writer to the pipeline
  *
- * \param [in] N/A
+ * \param [in] w        Writer
+ */
+void RedisManager::PublishChanges(Writer &w) {
+    for (auto& table : w.changes) {
+        if (table.second.empty())
+            continue;
+
+        std::string channel = table.first + BMP_NOTIFY_CHANNEL_SUFFIX;
+        std::string msg = swss::JSon::buildJson(table.second);
+
+        swss::RedisCommand cmd;
+        cmd.format("PUBLISH %s %s", channel.c_str(), msg.c_str());
+        Push(w, cmd);
+
+        table.second.clear();
+    }
+}
+
+
+
+/**
+ * Reset all Tables once FRR reconnects to BMP, this will not disable table population
  */
 void RedisManager::ResetAllTables() {
     LOG_INFO("RedisManager ResetAllTables");
 
-    for (const auto& enabledTable : enabledTables_) {
-        ResetBMPTable(enabledTable);
+    QueueBarrier(OP_RESET, "");
+}
+
+
+/**
+ * Queue a table reset or attribute sweep on every writer
+ *
+ * \param [in] type     OP_RESET, OP_SWEEP_START or OP_SWEEP
+ * \param [in] table    Table to reset, empty resets all enabled tables
+ *
+ * \return barrier, done once the operation ran
+ */
+std::shared_ptr<RedisManager::WriterBarrier> RedisManager::QueueBarrier(OpType type, const std::string &table) {
+    std::shared_ptr<WriterBarrier> barrier = std::make_shared<WriterBarrier>();
+    std::unique_lock<std::mutex> lock(barrierMutex_);
+
+    for (size_t shard = 0; shard < writers_.size(); shard++) {
+        RedisOp op;
+        op.type = type;
+        op.key = table;
+        op.barrier = barrier;
+        Enqueue(shard, op);
+    }
+
+    return barrier;
+}
+
+
+/**
+ * Wait at the barrier, the last writer to arrive runs the operation
+ *
+ * \param [in] w        Writer
+ * \param [in] op       Reset or sweep operation
+ */
+void RedisManager::WaitBarrier(Writer &w, RedisOp &op) {
+    WriterBarrier &barrier = *op.barrier;
+    std::unique_lock<std::mutex> lock(barrier.mutex);
+
+    if (++barrier.arrived < writers_.size()) {
+        barrier.cond.wait(lock, [&barrier] { return barrier.done; });
+        return;
+    }
+
+    // All writers flushed the writes queued before the barrier and are waiting
+    if (op.type == OP_SWEEP_START) {
+        for (auto& writer : writers_)
+            writer->sweepUsed.clear();
+        sweeping_ = true;
+
+    } else if (op.type == OP_SWEEP) {
+        RemoveSweptAttrs(w);
+
+    } else if (not op.key.empty()) {
+        ResetBMPTable(w, op.key);
+
+    } else {
+        for (int i = 0; i < BMP_TABLE_ID_MAX; i++) {
+            if (tableEnabled_[i])
+                ResetBMPTable(w, GetTableName((BMP_TABLE_ID)i));
+        }
+
+        if (compactSchema_) {
+            // Writers drop their attribute id cache on the generation change
+            attrGen_++;
+            ResetBMPTable(w, BMP_TABLE_RIB_ATTR);
+        }
+    }
+
+    barrier.done = true;
+    barrier.cond.notify_all();
+}
+
+
+/**
+ * Remove the attribute sets no prefix refers to
+ *
+ * \details The per-peer hashes are read with SCAN/HSCAN while the writers run, only
+ *          removing the sets is done at a barrier.
+ */
+void RedisManager::SweepAttrTable() {
+    std::shared_ptr<WriterBarrier> start = QueueBarrier(OP_SWEEP_START, "");
+    {
+        std::unique_lock<std::mutex> lock(start->mutex);
+        start->cond.wait(lock, [&start] { return start->done; });
+    }
+
+    // Writers record the ids they write from now on, the scan only needs the ones written before
+    std::vector<std::string> candidates;
+    try {
+        swss::DBConnector db(BMP_DB_NAME, 0, false);
+        std::unordered_set<std::string> referenced;
+
+        for (BMP_TABLE_ID id : { BMP_TABLE_ID_RIB_IN, BMP_TABLE_ID_RIB_OUT }) {
+            std::string match = GetTableName(id) + separator_ + "*";
+            int cursor = 0;
+
+            do {
+                auto keys = db.scan(cursor, match.c_str(), REDIS_SWEEP_SCAN_COUNT);
+                cursor = keys.first;
+
+                for (const auto& key : keys.second)
+                    ScanAttrIds(db, key, referenced);
+            } while (cursor != 0);
+        }
+
+        std::string prefix = std::string(BMP_TABLE_RIB_ATTR) + separator_;
+        std::string match = prefix + "*";
+        int cursor = 0;
+
+        do {
+            auto keys = db.scan(cursor, match.c_str(), REDIS_SWEEP_SCAN_COUNT);
+            cursor = keys.first;
+
+            for (const auto& key : keys.second) {
+                std::string attrId = key.substr(prefix.length());
+                if (not referenced.count(attrId))
+                    candidates.push_back(attrId);
+            }
+        } while (cursor != 0);
+
+    } catch (const std::exception &e) {
+        LOG_ERR("RedisManager attribute sweep failed: %s", e.what());
+        candidates.clear();
+    }
+
+    // Read by the writer running the barrier, the previous sweep finished before the start barrier
+    sweepCandidates_ = std::move(candidates);
+    QueueBarrier(OP_SWEEP, "");
+}
+
+
+/**
+ * Add the attribute ids of a per-peer hash, read with HSCAN
+ *
+ * \param [in] db       State DB connection
+ * \param [in] key      Per-peer hash key
+ * \param [out] attrIds Attribute ids found
+ */
+void RedisManager::ScanAttrIds(swss::DBConnector &db, const std::string &key, std::unordered_set<std::string> &attrIds) {
+    std::string cursor = "0";
+
+    do {
+        swss::RedisCommand cmd;
+        cmd.format("HSCAN %s %s COUNT %d", key.c_str(), cursor.c_str(), REDIS_SWEEP_SCAN_COUNT);
+
+        swss::RedisReply r(&db, cmd, REDIS_REPLY_ARRAY);
+        redisReply *reply = r.getContext();
+        cursor = reply->element[0]->str;
+
+        // Prefix and attribute id pairs
+        redisReply *fields = reply->element[1];
+        for (size_t i = 1; i < fields->elements; i += 2)
+            attrIds.insert(fields->element[i]->str);
+    } while (cursor != "0");
+}
+
+
+/**
+ * Remove the sweep candidates not written since the sweep started
+ *
+ * \param [in] w        Writer
+ */
+void RedisManager::RemoveSweptAttrs(Writer &w) {
+    size_t removed = 0;
+
+    for (const auto& attrId : sweepCandidates_) {
+        bool used = false;
+        for (auto& writer : writers_)
+            used = used or writer->sweepUsed.count(attrId);
+
+        if (used)
+            continue;
+
+        swss::RedisCommand cmd;
+        cmd.formatDEL(BMP_TABLE_RIB_ATTR + separator_ + attrId);
+        Push(w, cmd);
+
+        // The writers are waiting, their caches can be updated
+        for (auto& writer : writers_)
+            writer->writtenAttrIds.erase(attrId);
+
+        removed++;
+    }
+
+    for (auto& writer : writers_)
+        writer->sweepUsed.clear();
+    sweeping_ = false;
+
+    if (w.oplog == NULL)
+        w.pipeline->flush();
+
+    LOG_INFO("RedisManager removed %zu attribute sets, not referenced", removed);
+    sweepCandidates_.clear();
+}
+
+
+/**
+ * Mark the end of a BMP message to record its commit latency
+ *
+ * \param [in] shard        Session writer shard
+ * \param [in] latency      Latency of the router
+ * \param [in] readTime     Socket read time of the message, zero if not measured
+ */
+void RedisManager::MarkCommit(size_t shard, const std::shared_ptr<RouterLatency> &latency, uint64_t readTime) {
+    RedisOp op;
+    op.type = OP_MARK;
+    op.latency = latency;
+    op.readTime = readTime;
+    op.markTime = RouterLatency::now();
+    Enqueue(shard, op);
+}
+
+
+/**
+ * Queue operation to the writer thread, waits while the queue is full
+ *
+ * \details Waiting on a full queue stalls the BMP reader, which in turn lets the
+ *          socket buffer and TCP apply backpressure to the router.
+ *
+ * \param [in] shard    Writer shard
+ * \param [in] op       Operation to queue (moved)
+ */
+void RedisManager::Enqueue(size_t shard, RedisOp &op) {
+    PROFILE_SCOPE(SINK_PRODUCE);
+
+    Writer *w = writers_[shard].get();
+    op.enqueued = std::chrono::steady_clock::now();
+
+    if (not w->queue->tryPush(op)) {
+        queueFull_++;
+
+        std::unique_lock<std::mutex> lock(w->parkMutex);
+        w->producersParked++;
+
+        // Pairs with the fence in the writer after it pops, one of the two sees the other
+        std::atomic_thread_fence(std::memory_order_seq_cst);
+        w->notFull.wait(lock, [w, &op] { return w->queue->tryPush(op); });
+
+        w->producersParked--;
     }
-}
\ No newline at end of file
+
+    // Pairs with the fence in the writer after it parks
+    std::atomic_thread_fence(std::memory_order_seq_cst);
+    if (w->writerParked.load(std::memory_order_relaxed)) {
+        std::lock_guard<std::mutex> lock(w->parkMutex);
+        w->notEmpty.notify_one();
+    }
+}
+
+
+/**
+ * Writer thread loop, drains the queue and commits in batches
+ *
+ * \param [in] w        Writer
+ */
+void RedisManager::WriterThreadLoop(Writer *w) {
+    std::vector<std::chrono::steady_clock::time_point> batch;
+    batch.reserve(REDIS_WRITER_BATCH_SIZE);
+
+    time_t last_stats = time(NULL);
+    RedisOp op;
+
+    while (true) {
+        if (w->queue->tryPop(op)) {
+            std::atomic_thread_fence(std::memory_order_seq_cst);
+            if (w->producersParked.load(std::memory_order_relaxed) > 0) {
+                std::lock_guard<std::mutex> lock(w->parkMutex);
+                w->notFull.notify_one();
+            }
+
+            if (batch.empty())
+                depthHist_.record(w->queue->depth() + 1);
+
+            // Operations of the message are in the batch or were flushed
+            if (op.type == OP_MARK) {
+                w->marks.push_back(std::move(op));
+                continue;
+            }
+
+            if (op.type == OP_RESET or op.type == OP_SWEEP_START or op.type == OP_SWEEP) {
+                // Reset and sweep read keys, commit queued writes first
+                FlushBatch(*w, batch);
+                WaitBarrier(*w, op);
+                op.barrier.reset();
+                continue;
+            }
+
+            CommitOp(*w, op);
+            batch.push_back(op.enqueued);
+
+            if (batch.size() >= REDIS_WRITER_BATCH_SIZE)
+                FlushBatch(*w, batch);
+
+            continue;
+        }
+
+        // Queue is empty
+        FlushBatch(*w, batch);
+
+        // Statistics are for all writers, logged by the first one
+        if (w == writers_[0].get() and time(NULL) - last_stats >= REDIS_WRITER_STATS_SECS) {
+            LogWriterStats();
+            last_stats = time(NULL);
+        }
+
+        if (exit_)
+            break;
+
+        // Producers signal after they queue when they see the writer parked
+        std::unique_lock<std::mutex> lock(w->parkMutex);
+        w->writerParked = true;
+        std::atomic_thread_fence(std::memory_order_seq_cst);
+
+        w->notEmpty.wait_for(lock, std::chrono::seconds(REDIS_WRITER_PARK_SECS),
+                             [this, w] { return w->queue->depth() > 0 or exit_; });
+        w->writerParked = false;
+    }
+}
+
+
+/**
+ * Add operation to the writer pipeline
+ *
+ * \param [in] w        Writer
+ * \param [in] op       Operation to commit
+ */
+void RedisManager::CommitOp(Writer &w, RedisOp &op) {
+    swss::RedisCommand cmd;
+
+    // Writes queued before the table was disabled, the reset queued after them removes the rest
+    BMP_TABLE_ID id = GetKeyTableId(op.key);
+    if (id != BMP_TABLE_ID_MAX and not tableEnabled_[id].load(std::memory_order_relaxed))
+        return;
+
+    switch (op.type) {
+        case OP_SET:
+            if (op.fieldValues.empty())
+                return;
+            cmd.formatHSET(op.key, op.fieldValues.begin(), op.fieldValues.end());
+            Push(w, cmd);
+
+            if (notifications_)
+                AddChange(w, BMP_NOTIFY_OP_SET, op.key);
+            break;
+
+        case OP_DEL:
+            cmd.formatDEL(op.key);
+            Push(w, cmd);
+
+            if (notifications_)
+                AddChange(w, BMP_NOTIFY_OP_DEL, op.key);
+            break;
+
+        case OP_COMPACT_SET:
+        {
+            if (w.attrGen != attrGen_) {
+                w.writtenAttrIds.clear();
+                w.attrGen = attrGen_;
+            }
+
+            if (sweeping_)
+                w.sweepUsed.insert(op.attrId);
+
+            // Attribute sets are content addressed, so they only need to be written once
+            if (w.writtenAttrIds.insert(op.attrId).second) {
+                std::string attrKey = BMP_TABLE_RIB_ATTR;
+                attrKey += separator_;
+                attrKey += op.attrId;
+
+                swss::RedisCommand attrCmd;
+                attrCmd.formatHSET(attrKey, op.fieldValues.begin(), op.fieldValues.end());
+                Push(w, attrCmd);
+            }
+
+            std::vector<swss::FieldValueTuple> prefixValues;
+            prefixValues.reserve(op.fields.size());
+            for (const auto& prefix : op.fields) {
+                prefixValues.emplace_back(prefix, op.attrId);
+            }
+
+            cmd.formatHSET(op.key, prefixValues.begin(), prefixValues.end());
+            Push(w, cmd);
+
+            // Compact changes are reported per prefix as <table>|<peer>|<prefix>
+            if (notifications_) {
+                for (const auto& prefix : op.fields)
+                    AddChange(w, BMP_NOTIFY_OP_SET, op.key + separator_ + prefix);
+            }
+        }
+            break;
+
+        case OP_COMPACT_DEL:
+            for (const auto& prefix : op.fields) {
+                swss::RedisCommand delCmd;
+                delCmd.formatHDEL(op.key, prefix);
+                Push(w, delCmd);
+
+                if (notifications_)
+                    AddChange(w, BMP_NOTIFY_OP_DEL, op.key + separator_ + prefix);
+            }
+            break;
+
+        default:
+            break;
+    }
+}
+
+
+/**
+ * Add command to the writer pipeline or operations log
+ *
+ * \param [in] w        Writer
+ * \param [in] cmd      Formatted command
+ */
+void RedisManager::Push(Writer &w, const swss::RedisCommand &cmd) {
+    if (w.oplog == NULL) {
+        w.pipeline->push(cmd, REDIS_REPLY_INTEGER);
+        return;
+    }
+
+    if (fwrite(cmd.c_str(), 1, cmd.length(), w.oplog) != cmd.length() and not oplogFailed_) {
+        LOG_ERR("RedisManager failed to write the operations log: %s", strerror(errno));
+        oplogFailed_ = true;
+    }
+}
+
+
+/**
+ * Flush the pipeline and record the commit latency of the batch
+ *
+ * \param [in] w        Writer
+ * \param [in] batch    Enqueue times of the operations in the batch
+ */
+void RedisManager::FlushBatch(Writer &w, std::vector<std::chrono::steady_clock::time_point> &batch) {
+    if (batch.empty()) {
+        RecordMarks(w);
+        return;
+    }
+
+    if (notifications_)
+        PublishChanges(w);
+
+    if (w.oplog == NULL)
+        w.pipeline->flush();
+
+    auto now = std::chrono::steady_clock::now();
+    for (const auto& enqueued : batch) {
+        uint64_t usec = std::chrono::duration_cast<std::chrono::microseconds>(now - enqueued).count();
+        latencyHist_.record(usec);
+
+        uint64_t max = latencyMax_.load(std::memory_order_relaxed);
+        while (usec > max and not latencyMax_.compare_exchange_weak(max, usec, std::memory_order_relaxed))
+            ;
+    }
+
+    opsCommitted_ += batch.size();
+    batchHist_.record(batch.size());
+    batch.clear();
+
+    RecordMarks(w);
+}
+
+
+/**
+ * Record the commit latency of the messages marked since the last flush
+ *
+ * \param [in] w        Writer
+ */
+void RedisManager::RecordMarks(Writer &w) {
+    if (w.marks.empty())
+        return;
+
+    uint64_t now = RouterLatency::now();
+    for (auto &mark : w.marks) {
+        mark.latency->record(RouterLatency::STAGE_COMMIT, mark.markTime, now);
+        mark.latency->record(RouterLatency::STAGE_TOTAL, mark.readTime, now);
+    }
+
+    w.marks.clear();
+}
+
+
+/**
+ * Get writer statistics
+ *
+ * \param [out] stats      Reference to the stats to update
+ */
+void RedisManager::GetWriterStats(WriterStats &stats) {
+    stats.ops_committed = opsCommitted_;
+    stats.queue_full = queueFull_;
+    stats.connections = writers_.size();
+    stats.queue_depth = 0;
+    stats.queue_capacity = 0;
+    for (const auto& w : writers_) {
+        stats.queue_depth += w->queue->depth();
+        stats.queue_capacity += w->queue->capacity();
+    }
+    stats.depth_p50 = depthHist_.percentile(50);
+    stats.depth_p99 = depthHist_.percentile(99);
+    stats.latency_p50_us = latencyHist_.percentile(50);
+    stats.latency_p99_us = latencyHist_.percentile(99);
+    stats.latency_max_us = latencyMax_;
+    stats.latency_count = latencyHist_.count();
+    stats.batch_p50 = batchHist_.percentile(50);
+    stats.batch_p99 = batchHist_.percentile(99);
+    stats.batch_count = batchHist_.count();
+}
+
+
+/**
+ * Get the queue depth histogram (sampled per commit batch)
+ */
+const LatencyHistogram &RedisManager::GetQueueDepthHistogram() {
+    return depthHist_;
+}
+
+
+/**
+ * Get the commit latency histogram in microseconds (enqueue to pipeline flush)
+ */
+const LatencyHistogram &RedisManager::GetCommitLatencyHistogram() {
+    return latencyHist_;
+}
+
+
+/**
+ * Log the writer statistics
+ */
+void RedisManager::LogWriterStats() {
+    WriterStats stats;
+    GetWriterStats(stats);
+
+    if (stats.ops_committed == 0)
+        return;
+
+    LOG_INFO("RedisManager writers = %zu: ops = %" PRIu64 ", queue full = %" PRIu64 ", depth = %zu/%zu (p50 %" PRIu64 ", p99 %" PRIu64
+             "), commit latency us p50 = %" PRIu64 ", p99 = %" PRIu64 ", max = %" PRIu64,
+             stats.connections, stats.ops_committed, stats.queue_full, stats.queue_depth, stats.queue_capacity,
+             stats.depth_p50, stats.depth_p99, stats.latency_p50_us, stats.latency_p99_us, stats.latency_max_us);
+}
@@ -13,17 +13,30 @@
 #include <swss/dbconnector.h>
 #include <swss/table.h>
 #include <swss/configdb.h>
+#include <swss/redispipeline.h>
+#include <swss/subscriberstatetable.h>
+#include <swss/select.h>
+#include <swss/json.h>
+#include <swss/redisreply.h>
 
+#include <cstdio>
 #include <string>
 #include <list>
 #include <map>
+#include <set>
 #include <mutex>
+#include <condition_variable>
 #include <unordered_set>
 #include <functional>
 #include <vector>
 #include <sstream>
+#include <thread>
+#include <atomic>
+#include <chrono>
 #include "Logger.h"
 #include "Config.h"
+#include "RouterLatency.h"
+#include "RedisOpQueue.hpp"
 
 
 /**
@@ -34,6 +47,28 @@
 #define BMP_TABLE_RIB_IN           "BGP_RIB_IN_TABLE"
 #define BMP_TABLE_RIB_OUT          "BGP_RIB_OUT_TABLE"
 #define BMP_TABLE_NEI_PREFIX       "BGP_NEIGHBOR"
+#define BMP_TABLE_RIB_ATTR         "BGP_RIB_ATTR_TABLE"
+
+/**
+ * BMP_ATTR_ID_LEN defines the length in hex chars of the compact schema attribute id
+ */
+#define BMP_ATTR_ID_LEN            16
+
+/**
+ * REDIS_WRITER_* defines the writer thread tuning
+ */
+#define REDIS_WRITER_BATCH_SIZE    512      ///< Max operations committed per pipeline flush
+#define REDIS_WRITER_PARK_SECS     1        ///< Max wait on an empty queue, the writer then checks stats and exit
+#define REDIS_WRITER_STATS_SECS    60       ///< Interval in seconds to log writer statistics
+#define REDIS_SWEEP_SCAN_COUNT     1000     ///< Keys or fields per SCAN/HSCAN of the attribute sweep
+
+/**
+ * BMP_NOTIFY_* defines the change notifications
+ */
+#define BMP_NOTIFY_CHANNEL_SUFFIX  "_CHANNEL"   ///< Channel is <table>_CHANNEL
+#define BMP_NOTIFY_OP_SET          "SET"
+#define BMP_NOTIFY_OP_DEL          "DEL"
+#define BMP_NOTIFY_OP_CLEAR        "CLEAR"      ///< Table was reset, consumers should resync
 
 
 /**
@@ -42,19 +77,48 @@
 #define BMP_CFG_TABLE_NAME         "BMP"
 #define BMP_CFG_TABLE_KEY          "table"
 #define BMP_CFG_TABLE_NEI          "bgp_neighbor_table"
-#define BMP_CFG_TABLE_RIB_IN       "bgp-rib-in-table"
-#define BMP_CFG_TABLE_RIB_OUT      "bgp-rib-out-table"
+#define BMP_CFG_TABLE_RIB_IN       "bgp_rib_in_table"
+#define BMP_CFG_TABLE_RIB_OUT      "bgp_rib_out_table"
+#define BMP_CFG_SELECT_TIMEOUT_MS  1000     ///< Config subscription select timeout, bounds the exit time
 
 /**
  * \class   RedisManager
  *
  * \brief   RedisManager class for openbmpd
  * \details
- *      Encapsulate redis operation in this class instance.
+ *      Encapsulate redis operation in this class instance.  A single instance is shared by
+ *      all router sessions.  Sessions are sharded onto a small pool of writers (redis.connections),
+ *      each owning one pipelined connection to BMP_STATE_DB, so the number of connections does
+ *      not grow with the number of BMP sessions.
  */
 class RedisManager {
 
 public:
+    /**
+     * BMP state tables that can be enabled via CONFIG_DB
+     */
+    enum BMP_TABLE_ID { BMP_TABLE_ID_NEI = 0, BMP_TABLE_ID_RIB_IN, BMP_TABLE_ID_RIB_OUT, BMP_TABLE_ID_MAX };
+
+    /**
+     * Writer statistics
+     */
+    struct WriterStats {
+        uint64_t    ops_committed;          ///< Operations committed to redis
+        uint64_t    queue_full;             ///< Number of times a producer waited on a full queue
+        size_t      connections;            ///< Number of writers/connections
+        size_t      queue_depth;            ///< Current (approximate) queue depth, all writers
+        size_t      queue_capacity;         ///< Queue capacity, all writers
+        uint64_t    depth_p50;              ///< Queue depth percentiles, sampled per commit batch
+        uint64_t    depth_p99;
+        uint64_t    latency_p50_us;         ///< Commit latency (enqueue to pipeline flush) percentiles
+        uint64_t    latency_p99_us;
+        uint64_t    latency_max_us;
+        uint64_t    latency_count;          ///< Operations the commit latency was measured for
+        uint64_t    batch_p50;              ///< Operations per pipeline flush percentiles
+        uint64_t    batch_p99;
+        uint64_t    batch_count;            ///< Pipeline flushes
+    };
+
     /***********************************************************************
      * Constructor for class
      ***********************************************************************/
@@ -69,54 +133,188 @@ public:
      * Setup logger for this class
      *
      * \param [in] logPtr     logger pointer
+     * \param [in] cfg        Pointer to the config instance
+     */
+    void Setup(Logger *logPtr, Config *cfg);
+
+    /***********************************************************************
+     * Setup to write the operations to a log file instead of BMP_STATE_DB
+     *
+     * \details Used by the offline parse mode (openbmpd -r).  A single writer appends each
+     *          operation to the file as a redis command in the redis protocol (RESP), so the
+     *          log can be loaded with redis-cli --pipe.  All tables are enabled.  Table resets
+     *          are not logged, the log is expected to be loaded into an empty database.
+     *
+     * \param [in] logPtr     logger pointer
+     * \param [in] cfg        Pointer to the config instance
+     * \param [in] path       Operations log file, truncated
+     *
+     * \throws const char * if the file cannot be opened
      */
-    void Setup(Logger *logPtr);
+    void SetupOpLog(Logger *logPtr, Config *cfg, const std::string &path);
 
 
     /**
-    * ExitRedisManager
+    * ExitRedisManager, commits pending operations and stops the writer threads
     *
     * \param [in] N/A
+    *
+    * \return false if writing the operations log failed
     */
-    void ExitRedisManager();
+    bool ExitRedisManager();
+
+    /**
+     * Get writer statistics
+     *
+     * \param [out] stats      Reference to the stats to update
+     */
+    void GetWriterStats(WriterStats &stats);
+
+    /**
+     * Get the queue depth histogram (sampled per commit batch)
+     */
+    const LatencyHistogram &GetQueueDepthHistogram();
+
+    /**
+     * Get the commit latency histogram in microseconds (enqueue to pipeline flush)
+     */
+    const LatencyHistogram &GetCommitLatencyHistogram();
+
+    /**
+     * Get the writer shard for a router session
+     *
+     * \param [in] hash_id  Router hash id (16 bytes)
+     *
+     * \return shard index to use for all operations of the session
+     */
+    size_t GetShard(const u_char *hash_id);
 
     /**
      * Reset all Tables once FRR reconnects to BMP, this will not disable table population
      *
-     * \param [in] N/A
+     * \details The reset is a barrier across all writers, see QueueBarrier().  It is ordered
+     *          after the pending writes of every session and before the writes that follow.
      */
     void ResetAllTables();
 
     /**
-     * Reset ResetBMPTable, this will flush redis
+     * Mark the end of a BMP message to record its commit latency
      *
-     * \param [in] table    Reference to table name BGP_NEIGHBOR_TABLE/BGP_RIB_OUT_TABLE/BGP_RIB_IN_TABLE
+     * \details The mark is queued after the operations of the message, the commit and total
+     *          stages are recorded once the writer flushed them.
+     *
+     * \param [in] shard        Session writer shard
+     * \param [in] latency      Latency of the router
+     * \param [in] readTime     Socket read time of the message, zero if not measured
      */
-    void ResetBMPTable(const std::string & table);
+    void MarkCommit(size_t shard, const std::shared_ptr<RouterLatency> &latency, uint64_t readTime);
 
     /**
      * WriteBMPTable
      *
+     * \details The write is queued and committed by the writer thread.  The caller is
+     *          expected to have checked IsTableEnabled().
+     *
+     * \param [in] shard            Session writer shard
      * \param [in] table            Reference to table name
      * \param [in] key              Reference to various keys list
-     * \param [in] fieldValues      Reference to field-value pairs
+     * \param [in] fieldValues      Field-value pairs
+     */
+    bool WriteBMPTable(size_t shard, const std::string& table, const std::vector<std::string>& keys, std::vector<swss::FieldValueTuple> fieldValues);
+
+    /**
+     * WriteRibCompact, compact schema write of prefixes sharing one attribute set
+     *
+     * \details The attribute set is stored once in BGP_RIB_ATTR_TABLE keyed by its attribute id,
+     *          and each prefix is added as a field of the per-peer hash <table>|<peer> whose
+     *          value is the attribute id.
+     *
+     * \param [in] shard            Session writer shard
+     * \param [in] table            Reference to table name BGP_RIB_OUT_TABLE/BGP_RIB_IN_TABLE
+     * \param [in] peer             Reference to peer address
+     * \param [in] prefixes         Reference to prefix list (prefix/len)
+     * \param [in] attrFieldValues  Reference to attribute field-value pairs
      */
-    bool WriteBMPTable(const std::string& table, const std::vector<std::string>& keys, const std::vector<swss::FieldValueTuple> fieldValues);
+    bool WriteRibCompact(size_t shard, const std::string& table, const std::string& peer, const std::vector<std::string>& prefixes,
+                         const std::vector<swss::FieldValueTuple>& attrFieldValues);
 
     /**
-     * InitBMPConfig, read config_db for table enablement setting.
+     * RemoveRibCompact, compact schema removal of prefixes from the per-peer hash
+     *
+     * \param [in] shard            Session writer shard
+     * \param [in] table            Reference to table name BGP_RIB_OUT_TABLE/BGP_RIB_IN_TABLE
+     * \param [in] peer             Reference to peer address
+     * \param [in] prefixes         Reference to prefix list (prefix/len)
+     */
+    bool RemoveRibCompact(size_t shard, const std::string& table, const std::string& peer, const std::vector<std::string>& prefixes);
+
+    /**
+     * Indicates if the compact schema is in use
+     *
+     * \param [in] N/A
+     */
+    bool IsCompactSchema();
+
+    /**
+     * InitBMPConfig, read config_db for table enablement setting and subscribe to changes.
+     *
+     * \details Enabling a table at runtime resets it and requests a resync of the sessions that
+     *          feed it (see GetResyncGeneration), disabling a table removes its entries from
+     *          BMP_STATE_DB.
      *
      * \param [in] N/A
      */
     bool InitBMPConfig();
 
+    /**
+     * Indicates if population of the table is enabled
+     *
+     * \details Callers check this before building keys and field values, so that a disabled
+     *          table costs nothing.
+     *
+     * \param [in] id       Table id
+     */
+    inline bool IsTableEnabled(BMP_TABLE_ID id) {
+        return tableEnabled_[id].load(std::memory_order_relaxed);
+    }
+
+    /**
+     * Get the resync generation of a table
+     *
+     * \details The generation is bumped each time the table is enabled at runtime.  Sessions
+     *          that feed the table and started with an older generation need to be restarted
+     *          so that the router dumps the full RIB again.
+     *
+     * \param [in] id       Table id
+     */
+    uint64_t GetResyncGeneration(BMP_TABLE_ID id);
+
+    /**
+     * Record that the session of a router was closed to resync
+     *
+     * \details The enabled table was reset when it was enabled and the other tables are
+     *          current, so the reconnect of the router does not reset the tables.
+     *
+     * \param [in] hash_id  Router hash id (16 bytes)
+     */
+    void SetResyncReconnect(const u_char *hash_id);
+
+    /**
+     * Indicates if the router reconnects after its session was closed to resync, clears it
+     *
+     * \param [in] hash_id  Router hash id (16 bytes)
+     */
+    bool TakeResyncReconnect(const u_char *hash_id);
+
     /**
      * RemoveEntityFromBMPTable
      *
-     * \param [in] table            Reference to table name
+     * \details The removal is queued and committed by the writer thread.
+     *
+     * \param [in] shard            Session writer shard
      * \param [in] args             Reference to various keys
      */
-    bool RemoveEntityFromBMPTable(const std::vector<std::string>& keys);
+    bool RemoveEntityFromBMPTable(size_t shard, const std::vector<std::string>& keys);
 
     /**
      * Get Key separator for deletion
@@ -125,12 +323,276 @@ public:
      */
     std::string GetKeySeparator();
 
+    /**
+     * Build the full key of a table entry, table and keys joined by the separator
+     *
+     * \param [in] table            Reference to table name
+     * \param [in] keys             Reference to various keys list
+     * \param [in] separator        Key separator
+     * \param [out] key             Full key
+     */
+    static void BuildKey(const std::string& table, const std::vector<std::string>& keys,
+                         const std::string& separator, std::string& key);
+
+    /**
+     * Generate the compact schema attribute id
+     *
+     * \param [in] attrFieldValues  Reference to attribute field-value pairs
+     * \param [out] attrId          Attribute id (hex string of the truncated MD5 of the values)
+     */
+    static void GetAttrId(const std::vector<swss::FieldValueTuple>& attrFieldValues, std::string& attrId);
+
 private:
-    std::shared_ptr<swss::DBConnector> stateDb_;
+    /**
+     * Operation queued to the writer thread
+     */
+    enum OpType { OP_SET, OP_DEL, OP_COMPACT_SET, OP_COMPACT_DEL, OP_RESET, OP_SWEEP_START, OP_SWEEP, OP_MARK };
+
+    /**
+     * Reset or sweep step queued on every writer.  Each writer flushes its queued writes and waits
+     * at the barrier, the last one to arrive runs the operation and releases the others.
+     */
+    struct WriterBarrier {
+        std::mutex                          mutex;
+        std::condition_variable             cond;
+        size_t                              arrived;        ///< Writers waiting at the barrier
+        bool                                done;           ///< Operation ran, the writers continue
+
+        WriterBarrier() : arrived(0), done(false) { }
+    };
+
+    struct RedisOp {
+        OpType                              type;
+        std::string                         key;            ///< Full key (OP_SET/OP_DEL), per-peer hash key (compact) or
+                                                            ///<   table to reset (OP_RESET, empty resets all enabled tables)
+        std::string                         attrId;         ///< Attribute id (OP_COMPACT_SET)
+        std::vector<std::string>            fields;         ///< Prefixes (compact)
+        std::vector<swss::FieldValueTuple>  fieldValues;    ///< Field-value pairs (OP_SET) or attributes (OP_COMPACT_SET)
+        std::chrono::steady_clock::time_point enqueued;     ///< Time the operation was queued
+        std::shared_ptr<RouterLatency>      latency;        ///< Latency of the router (OP_MARK)
+        uint64_t                            readTime;       ///< Socket read time of the message (OP_MARK)
+        uint64_t                            markTime;       ///< Time the message was marked (OP_MARK)
+        std::shared_ptr<WriterBarrier>      barrier;        ///< Barrier shared by the writers (OP_RESET/OP_SWEEP_START/OP_SWEEP)
+    };
+
+    /**
+     * Writer, one per connection.  Everything but the queue and the park state is only used by
+     * the writer thread, or by the writer running a barrier while the others wait at it.
+     *
+     * The queue is lock-free.  The writer parks on notEmpty when the queue is empty and
+     * producers park on notFull when it is full; the other side only takes parkMutex to
+     * signal when it sees a parked thread.
+     */
+    struct Writer {
+        std::unique_ptr<swss::RedisPipeline>    pipeline;       ///< Pipelined connection to BMP_STATE_DB, NULL if oplog
+        FILE                                    *oplog;         ///< Operations log, NULL if writing to BMP_STATE_DB
+        std::unique_ptr<BoundedOpQueue<RedisOp>> queue;         ///< Operations pending commit
+        std::thread                             thread;         ///< Writer thread draining the queue
+        std::unordered_set<std::string>         writtenAttrIds; ///< Attribute ids already stored (compact schema)
+        uint64_t                                attrGen;        ///< Attribute generation writtenAttrIds is valid for
+        std::unordered_set<std::string>         sweepUsed;      ///< Attribute ids written since the sweep started
+        std::vector<RedisOp>                    marks;          ///< Messages committed by the next flush (OP_MARK)
+        std::mutex                              parkMutex;
+        std::condition_variable                 notEmpty;       ///< Signaled on queue while the writer is parked
+        std::condition_variable                 notFull;        ///< Signaled on pop while producers are parked
+        std::atomic<bool>                       writerParked;   ///< Writer waits on notEmpty
+        std::atomic<int>                        producersParked; ///< Producers waiting on notFull
+
+        /// Pending change records (op, key) per table, published with the batch
+        std::map<std::string, std::vector<swss::FieldValueTuple>> changes;
+    };
+
+    std::vector<std::unique_ptr<Writer>> writers_;
     std::string separator_;
     Logger *logger;
-    std::unordered_set<std::string> enabledTables_;
-    bool exit_;
+    std::atomic<bool> tableEnabled_[BMP_TABLE_ID_MAX];     ///< Table enablement, updated by the config thread
+    std::atomic<uint64_t> resyncGen_[BMP_TABLE_ID_MAX];     ///< Bumped when the table is enabled at runtime
+    std::mutex resyncMutex_;
+    std::set<std::string> resyncRouters_;                   ///< Routers closed to resync, by hash id
+    std::atomic<uint64_t> attrGen_;                         ///< Bumped when BGP_RIB_ATTR_TABLE is reset
+    std::thread cfgThread_;                                 ///< CONFIG_DB subscription thread
+    bool compactSchema_;
+    int attrSweepSecs_;                                     ///< Interval of the attribute sweep, 0 to not sweep
+    bool sweeping_;                                         ///< Writers record the attribute ids they write, only
+                                                            ///<   changed at a barrier
+    std::vector<std::string> sweepCandidates_;              ///< Attribute ids the sweep found no prefix for
+    bool notifications_;                                    ///< Publish change records per commit batch
+    std::atomic<bool> exit_;
+    bool oplogFailed_;                                      ///< Writing an operations log failed
+    std::mutex barrierMutex_;                               ///< Queues a barrier on all writers in the same order
+
+    std::atomic<uint64_t> opsCommitted_;
+    std::atomic<uint64_t> queueFull_;
+    std::atomic<uint64_t> latencyMax_;
+    LatencyHistogram depthHist_;
+    LatencyHistogram latencyHist_;
+    LatencyHistogram batchHist_;
+
+    /**
+     * Queue operation to the writer thread, waits while the queue is full
+     *
+     * \param [in] shard    Writer shard
+     * \param [in] op       Operation to queue (moved)
+     */
+    void Enqueue(size_t shard, RedisOp &op);
+
+    /**
+     * Queue a table reset or attribute sweep on every writer
+     *
+     * \details Barriers are queued under barrierMutex_, so that all writers see them in the
+     *          same order and two barriers cannot wait on each other.
+     *
+     * \param [in] type     OP_RESET, OP_SWEEP_START or OP_SWEEP
+     * \param [in] table    Table to reset, empty resets all enabled tables
+     *
+     * \return barrier, done once the operation ran
+     */
+    std::shared_ptr<WriterBarrier> QueueBarrier(OpType type, const std::string &table);
+
+    /**
+     * Wait at the barrier, the last writer to arrive runs the operation (writer thread only)
+     *
+     * \param [in] w        Writer
+     * \param [in] op       Reset or sweep operation
+     */
+    void WaitBarrier(Writer &w, RedisOp &op);
+
+    /**
+     * Remove the attribute sets no prefix refers to (config thread only)
+     *
+     * \details The tables are scanned while the writers run.  The writers record the attribute
+     *          ids they write between the OP_SWEEP_START and OP_SWEEP barriers, so that the
+     *          ids written after a hash was scanned are not removed.
+     */
+    void SweepAttrTable();
+
+    /**
+     * Add the attribute ids of a per-peer hash, read with HSCAN
+     *
+     * \param [in] db       State DB connection
+     * \param [in] key      Per-peer hash key
+     * \param [out] attrIds Attribute ids found
+     */
+    void ScanAttrIds(swss::DBConnector &db, const std::string &key, std::unordered_set<std::string> &attrIds);
+
+    /**
+     * Remove the sweep candidates not written since the sweep started, all writers wait at
+     * the barrier (writer thread only)
+     *
+     * \param [in] w        Writer
+     */
+    void RemoveSweptAttrs(Writer &w);
+
+    /**
+     * Writer thread loop, drains the queue and commits in batches
+     *
+     * \param [in] w        Writer
+     */
+    void WriterThreadLoop(Writer *w);
+
+    /**
+     * Add operation to the writer pipeline
+     *
+     * \details Operations of a table that was disabled after they were queued are dropped.
+     *
+     * \param [in] w        Writer
+     * \param [in] op       Operation to commit
+     */
+    void CommitOp(Writer &w, RedisOp &op);
+
+    /**
+     * Add command to the writer pipeline or operations log
+     *
+     * \param [in] w        Writer
+     * \param [in] cmd      Formatted command
+     */
+    void Push(Writer &w, const swss::RedisCommand &cmd);
+
+    /**
+     * Flush the pipeline and record the commit latency of the batch and of the marked messages
+     *
+     * \param [in] w        Writer
+     * \param [in] batch    Enqueue times of the operations in the batch
+     */
+    void FlushBatch(Writer &w, std::vector<std::chrono::steady_clock::time_point> &batch);
+
+    /**
+     * Record the commit latency of the messages marked since the last flush
+     *
+     * \param [in] w        Writer
+     */
+    void RecordMarks(Writer &w);
+
+    /**
+     * Log the writer statistics
+     */
+    void LogWriterStats();
+
+    /**
+     * Add change record to be published with the batch
+     *
+     * \param [in] w        Writer
+     * \param [in] op       Change op BMP_NOTIFY_OP_*
+     * \param [in] fullKey  Full key including the table name
+     */
+    void AddChange(Writer &w, const char *op, const std::string &fullKey);
+
+    /**
+     * Push the pending change records of the writer to the pipeline
+     *
+     * \details One message per table is published on <table>_CHANNEL.  The message is a
+     *          JSON array of op and key pairs (swss JSon format), for example
+     *          ["SET","192.168.0.0/24|10.0.0.1","DEL","10.1.0.0/16|10.0.0.1"]
+     *
+     * \param [in] w        Writer
+     */
+    void PublishChanges(Writer &w);
+
+    /**
+     * Config thread loop, applies CONFIG_DB BMP|table changes
+     */
+    void ConfigThreadLoop();
+
+    /**
+     * Apply table enablement
+     *
+     * \param [in] fieldValues      BMP|table field-value pairs, missing tables are disabled
+     * \param [in] initial          True on the initial read, no resync is requested
+     */
+    void ApplyTableConfig(const std::vector<swss::FieldValueTuple>& fieldValues, bool initial);
+
+    /**
+     * Get the table id for the CONFIG_DB field name
+     *
+     * \param [in] field    BMP|table field name
+     *
+     * \return table id or BMP_TABLE_ID_MAX if not known
+     */
+    static BMP_TABLE_ID GetTableId(const std::string& field);
+
+    /**
+     * Get the table id of a full key
+     *
+     * \param [in] key      Full key including the table name
+     *
+     * \return table id or BMP_TABLE_ID_MAX if the table has no enablement
+     */
+    BMP_TABLE_ID GetKeyTableId(const std::string& key);
+
+    /**
+     * Get the BMP_STATE_DB table name for the table id
+     *
+     * \param [in] id       Table id
+     */
+    static const char *GetTableName(BMP_TABLE_ID id);
+
+    /**
+     * Reset ResetBMPTable, this will flush redis (writer thread only)
+     *
+     * \param [in] w        Writer
+     * \param [in] table    Reference to table name BGP_NEIGHBOR_TABLE/BGP_RIB_OUT_TABLE/BGP_RIB_IN_TABLE
+     */
+    void ResetBMPTable(Writer &w, const std::string & table);
 };
 
 
@@ -0,0 +1,95 @@
+/*
+ * Copyright (c) 2024 Microsoft, Inc. and others.  All rights reserved.
+ *
+ * This program and the accompanying materials are made available under the
+ * terms of the Eclipse Public License v1.0 which accompanies this distribution,
+ * and is available at http://www.eclipse.org/legal/epl-v10.html
+ *
+ */
+
+#include <unistd.h>
+#include <sys/resource.h>
+
+#include "RouterAdmission.h"
+
+RouterAdmission::RouterAdmission(Logger *logPtr, Config *config) {
+    logger = logPtr;
+    cfg = config;
+    debug = cfg->debug_general;
+
+    limit = cfg->max_concurrent_routers;
+    lastCheck = time(NULL);
+    lastCpuSecs = getCpuSecs();
+
+    numCpus = sysconf(_SC_NPROCESSORS_ONLN);
+    if (numCpus < 1)
+        numCpus = 1;
+}
+
+int RouterAdmission::getDumpTime(const u_char *hash_id) {
+    RouterBaseline::entry baseline;
+
+    // if calculate_baseline is true and the baseline time for the router is known, use the baseline time
+    if (cfg->calculate_baseline and cfg->router_baseline.get(hash_id, baseline))
+        return baseline.dump_secs;
+
+    return cfg->initial_router_time;
+}
+
+double RouterAdmission::getWeight(const u_char *hash_id) {
+    double weight = (double)getDumpTime(hash_id) / cfg->initial_router_time;
+
+    if (weight < ADMISSION_MIN_WEIGHT)
+        return ADMISSION_MIN_WEIGHT;
+    else if (weight > 1)
+        return 1;
+
+    return weight;
+}
+
+void RouterAdmission::updateLoad(double dump_load, int buffer_fill, int queue_fill) {
+    time_t now = time(NULL);
+
+    if (now - lastCheck < ADMISSION_INTERVAL)
+        return;
+
+    double cpuSecs = getCpuSecs();
+    int cpu = 100 * (cpuSecs - lastCpuSecs) / ((now - lastCheck) * numCpus);
+
+    lastCheck = now;
+    lastCpuSecs = cpuSecs;
+
+    if (not cfg->startup_adaptive)
+        return;
+
+    if (dump_load == 0) {
+        limit = cfg->max_concurrent_routers;
+
+    } else if (cpu >= cfg->startup_max_cpu or buffer_fill >= ADMISSION_FILL_HIGH or queue_fill >= ADMISSION_FILL_HIGH) {
+        if (limit > cfg->max_concurrent_routers) {
+            --limit;
+            LOG_INFO("Lowered concurrent router limit to %d (cpu %d%%, buffer %d%%, queue %d%%)",
+                     limit, cpu, buffer_fill, queue_fill);
+        }
+
+    } else if (cpu < cfg->startup_max_cpu / 2 and buffer_fill < ADMISSION_FILL_LOW
+               and queue_fill < ADMISSION_FILL_LOW and dump_load + 1 > limit and limit < MAX_THREADS) {
+        ++limit;
+        SELF_DEBUG("Raised concurrent router limit to %d (cpu %d%%, buffer %d%%, queue %d%%)",
+                   limit, cpu, buffer_fill, queue_fill);
+    }
+}
+
+bool RouterAdmission::admit(double dump_load) {
+    return dump_load < limit;
+}
+
+double RouterAdmission::getCpuSecs() {
+    struct rusage usage;
+
+    if (getrusage(RUSAGE_SELF, &usage))
+        return 0;
+
+    return usage.ru_utime.tv_sec + usage.ru_utime.tv_usec / 1e6 +
+           usage.ru_stime.tv_sec + usage.ru_stime.tv_usec / 1e6;
+}
@@ -0,0 +1,100 @@
+/*
+ * Copyright (c) 2024 Microsoft, Inc. and others.  All rights reserved.
+ *
+ * This program and the accompanying materials are made available under the
+ * terms of the Eclipse Public License v1.0 which accompanies this distribution,
+ * and is available at http://www.eclipse.org/legal/epl-v10.html
+ *
+ */
+
+#ifndef ROUTERADMISSION_H_
+#define ROUTERADMISSION_H_
+
+#include <ctime>
+#include <sys/types.h>
+
+#include "Config.h"
+#include "Logger.h"
+
+#define ADMISSION_INTERVAL          5           ///< Seconds between load checks/limit changes
+#define ADMISSION_MIN_WEIGHT        0.25        ///< Min concurrent router slots used by a dumping router
+#define ADMISSION_FILL_LOW          50          ///< Buffer/queue fill percent below which the limit may grow
+#define ADMISSION_FILL_HIGH         80          ///< Buffer/queue fill percent above which the limit shrinks
+
+/**
+ * \class   RouterAdmission
+ *
+ * \brief   Decides when a new router connection is accepted during RIB dumps
+ * \details
+ *      Each router that is still dumping its RIB uses part of the concurrent router
+ *      limit.  Routers with a known baseline (see RouterBaseline) use a share based on
+ *      their dump time compared to initial_router_time, so routers with small dumps do
+ *      not hold a full slot.  Unknown routers use a full slot.
+ *
+ *      With adaptive admission, the limit starts at max_concurrent_routers and is
+ *      raised by one every ADMISSION_INTERVAL while collector CPU, router buffer fill
+ *      and message bus queue fill are low.  It is lowered again (never below
+ *      max_concurrent_routers) when any of them is high.
+ */
+class RouterAdmission {
+public:
+    /**
+     * Constructor for class
+     *
+     *  \param [in] logPtr  Pointer to existing Logger for app logging
+     *  \param [in] config  Pointer to the loaded configuration
+     */
+    RouterAdmission(Logger *logPtr, Config *config);
+
+    /**
+     * Get the time in seconds a router is expected to take to dump its RIB
+     *
+     * \param [in] hash_id      Router hash id
+     */
+    int getDumpTime(const u_char *hash_id);
+
+    /**
+     * Get the concurrent router slots used by a dumping router
+     *
+     * \param [in] hash_id      Router hash id
+     */
+    double getWeight(const u_char *hash_id);
+
+    /**
+     * Update the measured load, the limit is only changed every ADMISSION_INTERVAL
+     *
+     * \details The limit is only raised when it is what holds back routers (dump load at
+     *          the limit) and is reset when no router is dumping.
+     *
+     * \param [in] dump_load    Sum of getWeight() of all routers still dumping
+     * \param [in] buffer_fill  Max percent of router buffer in use by dumping routers, or of the buffer pool
+     * \param [in] queue_fill   Percent of the message bus queue in use
+     */
+    void updateLoad(double dump_load, int buffer_fill, int queue_fill);
+
+    /**
+     * Check if another router can be accepted
+     *
+     * \param [in] dump_load    Sum of getWeight() of all routers still dumping
+     *
+     * \return true if a router can be accepted
+     */
+    bool admit(double dump_load);
+
+private:
+    Logger      *logger;                    ///< Logging class pointer
+    Config      *cfg;                       ///< Config pointer
+    bool        debug;                      ///< debug flag to indicate debugging
+
+    int         limit;                      ///< Current concurrent router limit
+    time_t      lastCheck;                  ///< Time of the last limit change check
+    double      lastCpuSecs;                ///< Collector CPU seconds at the last check
+    int         numCpus;                    ///< Number of online CPUs
+
+    /**
+     * Get the CPU (user + system) seconds used by the collector
+     */
+    double getCpuSecs();
+};
+
+#endif /* ROUTERADMISSION_H_ */
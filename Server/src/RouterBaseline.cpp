@@ -0,0 +1,151 @@
+/*
+ * Copyright (c) 2024 Microsoft, Inc. and others.  All rights reserved.
+ *
+ * This program and the accompanying materials are made available under the
+ * terms of the Eclipse Public License v1.0 which accompanies this distribution,
+ * and is available at http://www.eclipse.org/legal/epl-v10.html
+ *
+ */
+
+#include <cstdio>
+#include <cstring>
+#include <cinttypes>
+#include <unistd.h>
+#include <fcntl.h>
+#include <sys/file.h>
+
+#include "RouterBaseline.h"
+
+RouterBaseline::RouterBaseline() {
+}
+
+void RouterBaseline::setStateFile(const std::string &filename) {
+    std::lock_guard<std::mutex> lock(mutex);
+    stateFile = filename;
+}
+
+size_t RouterBaseline::load() {
+    std::lock_guard<std::mutex> lock(mutex);
+
+    if (stateFile.empty())
+        return 0;
+
+    read(baselines);
+
+    return baselines.size();
+}
+
+void RouterBaseline::read(std::map<std::string, entry> &entries) {
+    FILE *fp = fopen(stateFile.c_str(), "r");
+    if (fp == NULL)
+        return;
+
+    char line[256];
+    while (fgets(line, sizeof(line), fp) != NULL) {
+        char hash_hex[33];
+        entry baseline;
+
+        if (line[0] == '#')
+            continue;
+
+        if (sscanf(line, "%32s %f %" SCNu64, hash_hex, &baseline.dump_secs, &baseline.dump_prefixes) != 3
+                or strlen(hash_hex) != 32 or baseline.dump_secs <= 0)
+            continue;
+
+        u_char hash_id[16];
+        bool valid = true;
+        for (int i = 0; i < 16 and valid; i++) {
+            unsigned int byte;
+            if (sscanf(hash_hex + i * 2, "%2x", &byte) != 1)
+                valid = false;
+            hash_id[i] = byte;
+        }
+
+        if (valid)
+            entries[std::string(reinterpret_cast<char *>(hash_id), 16)] = baseline;
+    }
+
+    fclose(fp);
+}
+
+bool RouterBaseline::get(const u_char *hash_id, entry &baseline) {
+    std::lock_guard<std::mutex> lock(mutex);
+
+    auto it = baselines.find(std::string(reinterpret_cast<const char *>(hash_id), 16));
+    if (it == baselines.end())
+        return false;
+
+    baseline = it->second;
+    return true;
+}
+
+bool RouterBaseline::set(const u_char *hash_id, float dump_secs, uint64_t prefixes) {
+    std::lock_guard<std::mutex> lock(mutex);
+
+    std::string key(reinterpret_cast<const char *>(hash_id), 16);
+
+    entry &baseline = baselines[key];
+    baseline.dump_secs = dump_secs;
+    baseline.dump_prefixes = prefixes;
+    updated.insert(key);
+
+    return save();
+}
+
+size_t RouterBaseline::size() {
+    std::lock_guard<std::mutex> lock(mutex);
+    return baselines.size();
+}
+
+bool RouterBaseline::save() {
+    if (stateFile.empty())
+        return true;
+
+    // Serialize with other workers and keep the baselines they wrote
+    std::string lockFile = stateFile + ".lock";
+    int lockFd = open(lockFile.c_str(), O_RDWR | O_CREAT | O_CLOEXEC, 0644);
+    if (lockFd < 0)
+        return false;
+
+    flock(lockFd, LOCK_EX);
+
+    std::map<std::string, entry> current;
+    read(current);
+
+    for (const auto &key : updated)
+        current[key] = baselines[key];
+
+    baselines.swap(current);
+
+    // Write to a tmp file and rename so that a crash never leaves a partial state file
+    std::string tmpFile = stateFile + ".tmp";
+
+    FILE *fp = fopen(tmpFile.c_str(), "w");
+    if (fp == NULL) {
+        close(lockFd);
+        return false;
+    }
+
+    fprintf(fp, "# openbmpd router baselines: <router hash> <dump seconds> <dump prefixes>\n");
+
+    for (const auto &it : baselines) {
+        const u_char *hash_id = reinterpret_cast<const u_char *>(it.first.data());
+
+        for (int i = 0; i < 16; i++)
+            fprintf(fp, "%02x", hash_id[i]);
+
+        fprintf(fp, " %.1f %" PRIu64 "\n", it.second.dump_secs, it.second.dump_prefixes);
+    }
+
+    bool ok = (fflush(fp) == 0 and fsync(fileno(fp)) == 0);
+    ok = (fclose(fp) == 0) and ok;
+
+    if (ok and rename(tmpFile.c_str(), stateFile.c_str()) == 0) {
+        close(lockFd);
+        return true;
+    }
+
+    unlink(tmpFile.c_str());
+    close(lockFd);
+    return false;
+}
@@ -0,0 +1,114 @@
+/*
+ * Copyright (c) 2024 Microsoft, Inc. and others.  All rights reserved.
+ *
+ * This program and the accompanying materials are made available under the
+ * terms of the Eclipse Public License v1.0 which accompanies this distribution,
+ * and is available at http://www.eclipse.org/legal/epl-v10.html
+ *
+ */
+
+#ifndef ROUTERBASELINE_H_
+#define ROUTERBASELINE_H_
+
+#include <string>
+#include <map>
+#include <set>
+#include <mutex>
+#include <cstdint>
+#include <sys/types.h>
+
+/**
+ * \class   RouterBaseline
+ *
+ * \brief   Router RIB dump baselines, shared by all router threads
+ * \details
+ *      Stores the time (and number of prefixes) it took each router to complete its
+ *      initial RIB dump.  The baseline is used at startup to decide how long a router
+ *      counts against the concurrent router limit.
+ *
+ *      When a state file is set, the baselines are loaded from it at startup and the
+ *      file is rewritten (tmp file + rename) whenever a baseline changes, so baselines
+ *      survive a collector restart.  Collector workers share the state file, so it is
+ *      rewritten under a lock with the baselines of other workers merged in.
+ *
+ *      State file format is one router per line:
+ *          <router hash id in hex> <seconds> <prefixes>
+ */
+class RouterBaseline {
+public:
+    /**
+     * Baseline entry
+     */
+    struct entry {
+        float       dump_secs;              ///< RIB dump time in seconds, includes the safety margin
+        uint64_t    dump_prefixes;          ///< Number of unicast prefixes in the RIB dump
+    };
+
+    RouterBaseline();
+
+    /**
+     * Set the state file used to persist the baselines
+     *
+     * \param [in] filename     State filename, empty to disable persistence
+     */
+    void setStateFile(const std::string &filename);
+
+    /**
+     * Load the baselines from the state file
+     *
+     * \details A missing state file is not an error, invalid lines are skipped.
+     *
+     * \return number of baselines loaded
+     */
+    size_t load();
+
+    /**
+     * Get the baseline of a router
+     *
+     * \param [in]  hash_id     Router hash id (16 bytes)
+     * \param [out] baseline    Baseline of the router
+     *
+     * \return true if the router has a baseline, false if not
+     */
+    bool get(const u_char *hash_id, entry &baseline);
+
+    /**
+     * Set the baseline of a router and update the state file
+     *
+     * \param [in] hash_id      Router hash id (16 bytes)
+     * \param [in] dump_secs    RIB dump time in seconds
+     * \param [in] prefixes     Number of unicast prefixes in the RIB dump
+     *
+     * \return false if the state file could not be written, true otherwise
+     */
+    bool set(const u_char *hash_id, float dump_secs, uint64_t prefixes);
+
+    /**
+     * Number of routers with a baseline
+     */
+    size_t size();
+
+private:
+    std::mutex                      mutex;
+    std::string                     stateFile;          ///< Empty if baselines are not persisted
+    std::map<std::string, entry>    baselines;          ///< Key is the raw router hash id
+    std::set<std::string>           updated;            ///< Routers set by this process since load
+
+    /**
+     * Read the baselines in the state file, caller holds the mutex
+     *
+     * \param [out] entries    Baselines read, existing entries are replaced
+     */
+    void read(std::map<std::string, entry> &entries);
+
+    /**
+     * Write the baselines to the state file, caller holds the mutex
+     *
+     * \details Baselines in the file that were not set by this process are kept.
+     *
+     * \return false if the state file could not be written
+     */
+    bool save();
+};
+
+#endif /* ROUTERBASELINE_H_ */
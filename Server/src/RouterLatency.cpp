@@ -0,0 +1,104 @@
+/*
+ * Copyright (c) 2024 Microsoft, Inc. and others.  All rights reserved.
+ *
+ * This program and the accompanying materials are made available under the
+ * terms of the Eclipse Public License v1.0 which accompanies this distribution,
+ * and is available at http://www.eclipse.org/legal/epl-v10.html
+ *
+ */
+
+#include "RouterLatency.h"
+
+#include <sys/time.h>
+#include <cinttypes>
+
+RouterLatency::RouterLatency() {
+    markHead = 0;
+    markTail = 0;
+    lastLag = 0;
+}
+
+void RouterLatency::markRead(uint64_t stream_end) {
+    uint64_t head = markHead.load(std::memory_order_relaxed);
+
+    if (head - markTail.load(std::memory_order_acquire) >= READ_MARKS)
+        return;
+
+    marks[head & (READ_MARKS - 1)].end = stream_end;
+    marks[head & (READ_MARKS - 1)].time = now();
+
+    markHead.store(head + 1, std::memory_order_release);
+}
+
+uint64_t RouterLatency::getReadTime(uint64_t stream_offset) {
+    uint64_t tail = markTail.load(std::memory_order_relaxed);
+    uint64_t head = markHead.load(std::memory_order_acquire);
+
+    while (tail != head and marks[tail & (READ_MARKS - 1)].end < stream_offset)
+        tail++;
+
+    uint64_t time = tail != head ? marks[tail & (READ_MARKS - 1)].time : 0;
+
+    markTail.store(tail, std::memory_order_release);
+    return time;
+}
+
+void RouterLatency::recordLag(uint32_t ts_secs, uint32_t ts_usecs) {
+    timeval tv;
+    gettimeofday(&tv, NULL);
+
+    int64_t usec = ((int64_t)tv.tv_sec - ts_secs) * 1000000 + ((int64_t)tv.tv_usec - ts_usecs);
+
+    lastLag.store(usec, std::memory_order_relaxed);
+    lag.record(usec > 0 ? usec : 0);
+}
+
+const HdrHistogram &RouterLatency::getHistogram(stage s) {
+    return hist[s];
+}
+
+const HdrHistogram &RouterLatency::getLagHistogram() {
+    return lag;
+}
+
+int64_t RouterLatency::getLastLag() {
+    return lastLag.load(std::memory_order_relaxed);
+}
+
+void RouterLatency::logLatency(Logger *logger, const char *name) {
+    char buf[512];
+    size_t len = 0;
+
+    for (int i = 0; i < STAGE_MAX; i++) {
+        const HdrHistogram &h = hist[i];
+
+        if (h.count() == 0)
+            continue;
+
+        len += snprintf(buf + len, sizeof(buf) - len, "%s%s %" PRIu64 "/%" PRIu64 "/%" PRIu64,
+                        len ? ", " : "", getStageName((stage)i), h.percentile(50), h.percentile(99), h.max());
+
+        if (len >= sizeof(buf))
+            break;
+    }
+
+    if (len == 0)
+        return;
+
+    LOG_INFO("%s: latency us p50/p99/max %s", name, buf);
+
+    if (lag.count())
+        LOG_INFO("%s: lag %" PRId64 " ms, p50/p99/max %" PRIu64 "/%" PRIu64 "/%" PRIu64 " ms", name,
+                 getLastLag() / 1000, lag.percentile(50) / 1000, lag.percentile(99) / 1000, lag.max() / 1000);
+}
+
+const char *RouterLatency::getStageName(stage s) {
+    switch (s) {
+        case STAGE_QUEUE  : return "queue";
+        case STAGE_PARSE  : return "parse";
+        case STAGE_ENCODE : return "encode";
+        case STAGE_COMMIT : return "commit";
+        case STAGE_TOTAL  : return "total";
+        default           : return "unknown";
+    }
+}
@@ -0,0 +1,260 @@
+/*
+ * Copyright (c) 2024 Microsoft, Inc. and others.  All rights reserved.
+ *
+ * This program and the accompanying materials are made available under the
+ * terms of the Eclipse Public License v1.0 which accompanies this distribution,
+ * and is available at http://www.eclipse.org/legal/epl-v10.html
+ *
+ */
+
+#ifndef ROUTERLATENCY_H_
+#define ROUTERLATENCY_H_
+
+#include <atomic>
+#include <cstdint>
+#include <ctime>
+
+#include "Logger.h"
+
+/**
+ * \class   HdrHistogram
+ *
+ * \brief   Lock-free log-linear histogram
+ * \details
+ *      Values below SUB_BUCKETS are counted exactly, larger values in SUB_BUCKETS / 2 linear
+ *      buckets per power of two (as HdrHistogram does), so a percentile is within 1/16 of the
+ *      value over the whole range, unlike the power of two LatencyHistogram.  Values are
+ *      recorded by any thread and may be read by any other thread.
+ */
+class HdrHistogram {
+public:
+    enum {
+        SUB_BITS    = 5,
+        SUB_BUCKETS = 1 << SUB_BITS,
+        MAX_BITS    = 40,                                   ///< Larger values are counted as 2^MAX_BITS - 1
+        BUCKETS     = SUB_BUCKETS + (MAX_BITS - SUB_BITS) * (SUB_BUCKETS / 2)
+    };
+
+    HdrHistogram() {
+        reset();
+    }
+
+    void record(uint64_t value) {
+        if (value >= (1ULL << MAX_BITS))
+            value = (1ULL << MAX_BITS) - 1;
+
+        counts[getBucket(value)].fetch_add(1, std::memory_order_relaxed);
+
+        uint64_t cur = maxValue.load(std::memory_order_relaxed);
+        while (value > cur and not maxValue.compare_exchange_weak(cur, value, std::memory_order_relaxed))
+            ;
+    }
+
+    /**
+     * Get the value (upper bound of the bucket) at the given percentile
+     *
+     * \param [in] pct      Percentile 0 - 100
+     */
+    uint64_t percentile(double pct) const {
+        uint64_t total = count();
+        if (total == 0)
+            return 0;
+
+        uint64_t target = (uint64_t)(total * pct / 100.0);
+        if (target == 0)
+            target = 1;
+
+        uint64_t seen = 0;
+        for (int i = 0; i < BUCKETS; i++) {
+            seen += counts[i].load(std::memory_order_relaxed);
+            if (seen >= target)
+                return getBucketMax(i) < max() ? getBucketMax(i) : max();
+        }
+        return max();
+    }
+
+    uint64_t count() const {
+        uint64_t total = 0;
+        for (int i = 0; i < BUCKETS; i++)
+            total += counts[i].load(std::memory_order_relaxed);
+        return total;
+    }
+
+    uint64_t max() const {
+        return maxValue.load(std::memory_order_relaxed);
+    }
+
+    void reset() {
+        for (int i = 0; i < BUCKETS; i++)
+            counts[i].store(0, std::memory_order_relaxed);
+        maxValue.store(0, std::memory_order_relaxed);
+    }
+
+private:
+    std::atomic<uint64_t> counts[BUCKETS];
+    std::atomic<uint64_t> maxValue;
+
+    static int getBucket(uint64_t value) {
+        if (value < SUB_BUCKETS)
+            return value;
+
+        // value >> shift is in [SUB_BUCKETS / 2, SUB_BUCKETS)
+        int shift = 63 - __builtin_clzll(value) - (SUB_BITS - 1);
+        return SUB_BUCKETS + (shift - 1) * (SUB_BUCKETS / 2) + (int)(value >> shift) - SUB_BUCKETS / 2;
+    }
+
+    static uint64_t getBucketMax(int bucket) {
+        if (bucket < SUB_BUCKETS)
+            return bucket;
+
+        int shift = (bucket - SUB_BUCKETS) / (SUB_BUCKETS / 2) + 1;
+        uint64_t sub = (bucket - SUB_BUCKETS) % (SUB_BUCKETS / 2) + SUB_BUCKETS / 2;
+        return ((sub + 1) << shift) - 1;
+    }
+};
+
+/**
+ * \class   RouterLatency
+ *
+ * \brief   End-to-end latency of a router, from the socket read to the sink commit
+ * \details
+ *      Each BMP message is timed by stage, in microseconds:
+ *
+ *          queue   socket read to the BMP header parsed (router buffer and socket pair)
+ *          parse   BMP header parsed to the message parsed (and encoded if not pipelined)
+ *          encode  message parsed to added to the sink (pipeline queue and encoding)
+ *          commit  added to the sink to committed (Kafka delivery report, Redis flush)
+ *          total   socket read to committed
+ *
+ *      The I/O thread marks the stream offset and time of each socket read, the reader
+ *      looks up the read time of a message by the offset of its header.  Marks are kept in
+ *      a single producer/consumer ring, a read is not marked when the ring is full and its
+ *      messages are then timed from a later read.
+ *
+ *      The lag of the router is the wall clock minus the peer header timestamp of route
+ *      monitoring messages, it grows when the router or the collector falls behind.
+ *
+ *      Shared by the router threads and the sinks (shared_ptr), it outlives the sinks
+ *      so delivery reports of a router that disconnected can still be recorded.
+ */
+class RouterLatency {
+public:
+    /// Stages of a BMP message, see class details
+    enum stage {
+        STAGE_QUEUE = 0,
+        STAGE_PARSE,
+        STAGE_ENCODE,
+        STAGE_COMMIT,
+        STAGE_TOTAL,
+        STAGE_MAX
+    };
+
+    enum { READ_MARKS = 1024 };                 ///< Socket reads marked, power of two
+
+    RouterLatency();
+
+    /**
+     * Current time in nanoseconds (CLOCK_MONOTONIC), the time of the stages
+     */
+    static inline uint64_t now() {
+        timespec ts;
+        clock_gettime(CLOCK_MONOTONIC, &ts);
+        return (uint64_t)ts.tv_sec * 1000000000ULL + ts.tv_nsec;
+    }
+
+    /**
+     * Mark a socket read, called by the I/O thread after the bytes are buffered
+     *
+     * \param [in] stream_end   Bytes read from the router so far, including this read
+     */
+    void markRead(uint64_t stream_end);
+
+    /**
+     * Get the time of the socket read of a byte, called by the reader thread
+     *
+     * \details Offsets are expected in increasing order, reads before the offset are dropped.
+     *
+     * \param [in] stream_offset    Bytes parsed so far, the byte at stream_offset - 1 is looked up
+     *
+     * \return read time (see now()), zero if the read was not marked
+     */
+    uint64_t getReadTime(uint64_t stream_offset);
+
+    /**
+     * Record the time of a stage
+     *
+     * \param [in] s        Stage
+     * \param [in] start    Start time (see now()), not recorded if zero
+     * \param [in] end      End time
+     */
+    inline void record(stage s, uint64_t start, uint64_t end) {
+        if (start == 0)
+            return;
+
+        hist[s].record(end > start ? (end - start) / 1000 : 0);
+    }
+
+    /**
+     * Record the time of a stage measured by the caller
+     *
+     * \param [in] s        Stage
+     * \param [in] usec     Time in microseconds, not recorded if negative
+     */
+    inline void recordValue(stage s, int64_t usec) {
+        if (usec >= 0)
+            hist[s].record(usec);
+    }
+
+    /**
+     * Record the lag of a route monitoring message
+     *
+     * \param [in] ts_secs      Peer header timestamp seconds
+     * \param [in] ts_usecs     Peer header timestamp microseconds
+     */
+    void recordLag(uint32_t ts_secs, uint32_t ts_usecs);
+
+    /**
+     * Get the histogram of a stage in microseconds
+     */
+    const HdrHistogram &getHistogram(stage s);
+
+    /**
+     * Get the lag histogram in microseconds
+     */
+    const HdrHistogram &getLagHistogram();
+
+    /**
+     * Lag in microseconds of the last route monitoring message, negative if the router clock is ahead
+     */
+    int64_t getLastLag();
+
+    /**
+     * Log the percentiles of the stages and the lag
+     *
+     * \param [in] logger       Logger
+     * \param [in] name         Name of the router, such as its address
+     */
+    void logLatency(Logger *logger, const char *name);
+
+    /**
+     * Name of a stage
+     */
+    static const char *getStageName(stage s);
+
+private:
+    struct read_mark {
+        uint64_t    end;                        ///< Stream offset after the read
+        uint64_t    time;                       ///< Time of the read
+    };
+
+    read_mark               marks[READ_MARKS];
+    std::atomic<uint64_t>   markHead;           ///< Next mark written, by the I/O thread
+    char                    markPad[64 - sizeof(std::atomic<uint64_t>)];    ///< Keeps markTail off the cache line of markHead
+    std::atomic<uint64_t>   markTail;           ///< Oldest mark not dropped, by the reader thread
+
+    HdrHistogram            hist[STAGE_MAX];
+    HdrHistogram            lag;                ///< Lag of route monitoring messages, negative lag is recorded as zero
+    std::atomic<int64_t>    lastLag;
+};
+
+#endif /* ROUTERLATENCY_H_ */
@@ -0,0 +1,45 @@
+/*
+ * Copyright (c) 2024 Microsoft, Inc. and others.  All rights reserved.
+ *
+ * This program and the accompanying materials are made available under the
+ * terms of the Eclipse Public License v1.0 which accompanies this distribution,
+ * and is available at http://www.eclipse.org/legal/epl-v10.html
+ *
+ */
+
+#include "RouterMetrics.h"
+
+RouterMetrics::RouterMetrics(const char *router, const std::shared_ptr<RouterLatency> &latency)
+        : router(router), latency(latency) {
+}
+
+PeerMetrics *RouterMetrics::addPeer(const char *peer_addr, const char *peer_rd) {
+    PeerMetrics *peer = new PeerMetrics();
+    peer->peer_addr = peer_addr;
+    peer->peer_rd = peer_rd;
+
+    std::unique_lock<std::mutex> lock(peersMutex);
+    peers.emplace_back(peer);
+
+    return peer;
+}
+
+void RouterMetrics::getPeers(std::vector<PeerMetrics *> &peers) {
+    std::unique_lock<std::mutex> lock(peersMutex);
+
+    for (auto &peer : this->peers)
+        peers.push_back(peer.get());
+}
+
+const char *RouterMetrics::getTypeName(int bmp_type) {
+    switch (bmp_type) {
+        case 0  : return "route_monitoring";
+        case 1  : return "stats_report";
+        case 2  : return "peer_down";
+        case 3  : return "peer_up";
+        case 4  : return "initiation";
+        case 5  : return "termination";
+        case 6  : return "route_mirroring";
+        default : return "other";
+    }
+}
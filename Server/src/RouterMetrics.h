@@ -0,0 +1,129 @@
+/*
+ * Copyright (c) 2024 Microsoft, Inc. and others.  All rights reserved.
+ *
+ * This program and the accompanying materials are made available under the
+ * terms of the Eclipse Public License v1.0 which accompanies this distribution,
+ * and is available at http://www.eclipse.org/legal/epl-v10.html
+ *
+ */
+
+#ifndef ROUTERMETRICS_H_
+#define ROUTERMETRICS_H_
+
+#include <atomic>
+#include <cstdint>
+#include <string>
+#include <list>
+#include <vector>
+#include <memory>
+#include <mutex>
+
+#include "RouterLatency.h"
+
+/**
+ * \class   MetricCounter
+ *
+ * \brief   Counter or gauge updated without locks
+ * \details
+ *      add() is a relaxed atomic add, counters such as produce_errors are updated by the
+ *      producer and the delivery callback threads.  Any thread may read it.
+ */
+class MetricCounter {
+public:
+    MetricCounter() : value(0) { }
+
+    inline void add(uint64_t n = 1) {
+        value.fetch_add(n, std::memory_order_relaxed);
+    }
+
+    inline void set(uint64_t n) {
+        value.store(n, std::memory_order_relaxed);
+    }
+
+    inline uint64_t get() const {
+        return value.load(std::memory_order_relaxed);
+    }
+
+private:
+    std::atomic<uint64_t> value;
+};
+
+/**
+ * Counters of a peer, updated by the thread that parses the peer (reader or parse pool strand)
+ */
+struct PeerMetrics {
+    std::string     peer_addr;
+    std::string     peer_rd;
+    MetricCounter   prefixes_added;         ///< Unicast, VPN and EVPN prefixes advertised
+    MetricCounter   prefixes_withdrawn;     ///< Unicast, VPN and EVPN prefixes withdrawn
+    MetricCounter   parse_errors;           ///< Route monitoring messages that failed to parse (parse pool)
+};
+
+/**
+ * \class   RouterMetrics
+ *
+ * \brief   Counters of a router served by the metrics endpoint
+ * \details
+ *      Each counter is updated by one of the router threads, noted per member, and the
+ *      metrics endpoint reads and aggregates them when it is scraped.  Created by the server
+ *      when the router is started and shared with the endpoint, so a scrape can read the
+ *      counters of a router that is disconnecting.
+ */
+class RouterMetrics {
+public:
+    enum { BMP_TYPES = 8 };                 ///< BMP message types counted, larger types are counted as the last
+
+    /**
+     * Constructor for class
+     *
+     * \param [in] router       Router address, label of the counters
+     * \param [in] latency      Latency of the router, NULL if not measured
+     */
+    RouterMetrics(const char *router, const std::shared_ptr<RouterLatency> &latency);
+
+    /**
+     * Add the counters of a peer, called once per peer by the reader thread
+     *
+     * \return counters of the peer, valid as long as the router metrics
+     */
+    PeerMetrics *addPeer(const char *peer_addr, const char *peer_rd);
+
+    /**
+     * Get the peers added so far, called by the endpoint
+     */
+    void getPeers(std::vector<PeerMetrics *> &peers);
+
+    /**
+     * Count a BMP message, called by the reader thread
+     */
+    inline void addMessage(int bmp_type) {
+        messages.add();
+        msg_types[bmp_type >= 0 and bmp_type < BMP_TYPES ? bmp_type : BMP_TYPES - 1].add();
+    }
+
+    /**
+     * Name of a BMP message type
+     */
+    static const char *getTypeName(int bmp_type);
+
+    const std::string               router;
+    const std::shared_ptr<RouterLatency> latency;
+
+    MetricCounter   bytes;                  ///< Bytes received from the router, by the I/O thread
+    MetricCounter   buffer_fill;            ///< Router buffer fill in percent, by the I/O thread
+    MetricCounter   spill_bytes;            ///< Bytes in the buffer spill file, by the I/O thread
+    MetricCounter   pipeline_depth;         ///< Messages queued to the message bus thread, by the I/O thread
+
+    MetricCounter   messages;               ///< BMP messages, by the reader thread
+    MetricCounter   msg_types[BMP_TYPES];   ///< BMP messages per type, by the reader thread
+    MetricCounter   parse_errors;           ///< Messages the connection was closed on, by the reader thread
+
+    MetricCounter   produce_errors;         ///< Messages Kafka did not accept, by the thread producing
+    MetricCounter   producer_depth;         ///< Messages in the Kafka producer queue, by the thread producing
+
+private:
+    std::mutex                                  peersMutex;     ///< Only taken when a peer is added or read
+    std::list<std::unique_ptr<PeerMetrics>>     peers;
+};
+
+#endif /* ROUTERMETRICS_H_ */
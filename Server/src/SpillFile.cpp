@@ -0,0 +1,112 @@
+/*
+ * Copyright (c) 2024 Microsoft, Inc. and others.  All rights reserved.
+ *
+ * This program and the accompanying materials are made available under the
+ * terms of the Eclipse Public License v1.0 which accompanies this distribution,
+ * and is available at http://www.eclipse.org/legal/epl-v10.html
+ *
+ */
+
+#include <sys/mman.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <cstdlib>
+#include <algorithm>
+
+#include "SpillFile.h"
+
+/**
+ * Constructor for class
+ *
+ * \param [in] dir      Directory to create the file in
+ * \param [in] quota    Max bytes in the file, rounded down to whole segments
+ *
+ * \throws const char * with the error message
+ */
+SpillFile::SpillFile(const std::string &dir, size_t quota) {
+    // Segments do not cross the end of the ring
+    this->quota = quota = quota / SPILL_SEGMENT_SIZE * SPILL_SEGMENT_SIZE;
+    readPos = 0;
+    writePos = 0;
+    allocated = 0;
+    released = 0;
+
+    if (quota == 0)
+        throw "Spill quota is less than a segment";
+
+    std::string path = dir + "/openbmpd-spill-XXXXXX";
+
+    if ((fd = mkostemp(&path[0], O_CLOEXEC)) < 0)
+        throw "Cannot create spill file";
+
+    // Nothing else opens the file, it is removed on close
+    unlink(path.c_str());
+
+    // Sparse file, disk space is only allocated by writable()
+    if (ftruncate(fd, quota) < 0) {
+        close(fd);
+        throw "Cannot size spill file";
+    }
+
+    map = (unsigned char *)mmap(NULL, quota, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+    if (map == MAP_FAILED) {
+        close(fd);
+        throw "Cannot map spill file";
+    }
+}
+
+SpillFile::~SpillFile() {
+    munmap(map, quota);
+    close(fd);
+}
+
+size_t SpillFile::writable(unsigned char *&ptr) {
+    if (writePos == allocated) {
+        // The next segment is reused once it was read and released
+        if (allocated + SPILL_SEGMENT_SIZE - released > quota or
+                fallocate(fd, 0, allocated % quota, SPILL_SEGMENT_SIZE) != 0)
+            return 0;
+
+        allocated += SPILL_SEGMENT_SIZE;
+    }
+
+    ptr = map + writePos % quota;
+    return allocated - writePos;
+}
+
+void SpillFile::commit(size_t len) {
+    writePos += len;
+}
+
+size_t SpillFile::readable(unsigned char *&ptr) {
+    size_t offset = readPos % quota;
+
+    ptr = map + offset;
+    return std::min(writePos - readPos, quota - offset);
+}
+
+void SpillFile::consume(size_t len) {
+    readPos += len;
+
+    if (readPos == writePos) {
+        // Drained, start over at the beginning of the file
+        release(released, allocated);
+
+        readPos = writePos = allocated = released = 0;
+
+    } else if (readPos - released >= SPILL_SEGMENT_SIZE) {
+        size_t to = readPos / SPILL_SEGMENT_SIZE * SPILL_SEGMENT_SIZE;
+
+        release(released, to);
+        released = to;
+    }
+}
+
+size_t SpillFile::size() {
+    return writePos - readPos;
+}
+
+void SpillFile::release(size_t from, size_t to) {
+    for (; from < to; from += SPILL_SEGMENT_SIZE)
+        fallocate(fd, FALLOC_FL_PUNCH_HOLE | FALLOC_FL_KEEP_SIZE, from % quota, SPILL_SEGMENT_SIZE);
+}
@@ -0,0 +1,103 @@
+/*
+ * Copyright (c) 2024 Microsoft, Inc. and others.  All rights reserved.
+ *
+ * This program and the accompanying materials are made available under the
+ * terms of the Eclipse Public License v1.0 which accompanies this distribution,
+ * and is available at http://www.eclipse.org/legal/epl-v10.html
+ *
+ */
+
+#ifndef SPILLFILE_H_
+#define SPILLFILE_H_
+
+#include <string>
+#include <cstddef>
+
+#define SPILL_SEGMENT_SIZE      (16 * 1024 * 1024)  ///< Disk space is allocated/released in segments
+
+/**
+ * \class   SpillFile
+ *
+ * \brief   Append only, memory mapped overflow file of a router buffer
+ * \details
+ *      Bytes that do not fit in the router buffer are appended to the file and read back
+ *      in order.  The file is unlinked when created, so it is removed when the router
+ *      disconnects or the collector exits.
+ *
+ *      The file is a ring of segments, the quota caps the bytes not read yet.  The whole
+ *      quota is mapped, disk space is allocated (fallocate) a segment at a time before it
+ *      is written, so a full disk stops the writes instead of faulting.  Read segments are
+ *      released (hole punched) and reused once the writes wrap to them.
+ *
+ *      Not thread safe, used by the client thread only.
+ */
+class SpillFile {
+public:
+    /**
+     * Constructor for class
+     *
+     * \param [in] dir      Directory to create the file in
+     * \param [in] quota    Max bytes in the file, rounded down to whole segments
+     *
+     * \throws const char * with the error message
+     */
+    SpillFile(const std::string &dir, size_t quota);
+
+    virtual ~SpillFile();
+
+    /**
+     * Get the contiguous space to write to
+     *
+     * \param [out] ptr     Where to write
+     *
+     * \return bytes that can be written at ptr, zero if the quota is used or the disk is full
+     */
+    size_t writable(unsigned char *&ptr);
+
+    /**
+     * Add bytes written at the pointer returned by writable()
+     *
+     * \param [in] len      Bytes written
+     */
+    void commit(size_t len);
+
+    /**
+     * Get the contiguous bytes to read
+     *
+     * \param [out] ptr     Where to read
+     *
+     * \return bytes that can be read at ptr, zero if empty
+     */
+    size_t readable(unsigned char *&ptr);
+
+    /**
+     * Remove bytes read at the pointer returned by readable()
+     *
+     * \param [in] len      Bytes read
+     */
+    void consume(size_t len);
+
+    /**
+     * Bytes in the file not read yet
+     */
+    size_t size();
+
+private:
+    int             fd;
+    unsigned char   *map;                   ///< Mapping of the whole quota
+    size_t          quota;
+    size_t          readPos;                ///< Stream offset of the next byte to read, the file offset is modulo quota
+    size_t          writePos;               ///< Stream offset of the next byte to write
+    size_t          allocated;              ///< Disk space allocated up to this stream offset
+    size_t          released;               ///< Disk space released up to this stream offset
+
+    /**
+     * Release the disk space of whole segments
+     *
+     * \param [in] from     Stream offset of the first segment
+     * \param [in] to       Stream offset after the last segment
+     */
+    void release(size_t from, size_t to);
+};
+
+#endif /* SPILLFILE_H_ */
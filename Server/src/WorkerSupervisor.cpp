@@ -0,0 +1,340 @@
+/*
+ * Copyright (c) 2024 Microsoft, Inc. and others.  All rights reserved.
+ *
+ * This program and the accompanying materials are made available under the
+ * terms of the Eclipse Public License v1.0 which accompanies this distribution,
+ * and is available at http://www.eclipse.org/legal/epl-v10.html
+ *
+ */
+
+#include <sys/mman.h>
+#include <sys/prctl.h>
+#include <sys/wait.h>
+#include <unistd.h>
+#include <sched.h>
+#include <cstdio>
+#include <cstring>
+#include <cerrno>
+#include <new>
+
+#include "WorkerSupervisor.h"
+
+static_assert(ATOMIC_INT_LOCK_FREE == 2, "worker status atomics must be lock free to be shared between processes");
+
+volatile sig_atomic_t WorkerSupervisor::stop = 0;
+volatile sig_atomic_t WorkerSupervisor::reload = 0;
+volatile sig_atomic_t WorkerSupervisor::dump = 0;
+
+/**
+ * Constructor for class
+ *
+ *  \param [in] logPtr  Pointer to existing Logger for app logging
+ *  \param [in] config  Pointer to the loaded configuration
+ */
+WorkerSupervisor::WorkerSupervisor(Logger *logPtr, Config *config) {
+    logger = logPtr;
+    cfg = config;
+    debug = cfg->debug_general;
+
+    worker = -1;
+    lastChanges = 0;
+
+    void *mem = mmap(NULL, sizeof(shared_status), PROT_READ | PROT_WRITE, MAP_SHARED | MAP_ANONYMOUS, -1, 0);
+    if (mem == MAP_FAILED)
+        throw "ERROR: Cannot allocate shared worker status";
+
+    status = new (mem) shared_status();
+    status->changes = 0;
+    for (int i = 0; i < MAX_WORKERS; i++) {
+        status->workers[i].seq = 0;
+        status->workers[i].router_count = 0;
+        status->workers[i].routers[0] = 0;
+    }
+}
+
+WorkerSupervisor::~WorkerSupervisor() {
+    for (size_t i = 0; i < listeners.size(); i++)
+        delete listeners[i];
+
+    munmap(status, sizeof(shared_status));
+}
+
+/**
+ * Open the listeners and run the workers until the supervisor is stopped
+ *
+ * \return worker index in a worker process, -1 in the supervisor
+ */
+int WorkerSupervisor::run() {
+    // Listeners join the SO_REUSEPORT group in worker order, the steering program returns that index
+    for (int i = 0; i < cfg->workers; i++)
+        listeners.push_back(new BMPListener(logger, cfg));
+
+    if (not listeners[0]->attach_worker_steering(cfg->workers))
+        LOG_WARN("Routers are assigned to workers by the kernel hash, a reconnecting router may move to another worker");
+
+    pids.assign(cfg->workers, 0);
+    restartAt.assign(cfg->workers, 0);
+
+    struct sigaction sigact;
+    sigact.sa_handler = signal_handler;
+    sigact.sa_flags = 0;
+    sigemptyset(&sigact.sa_mask);
+
+    sigaction(SIGTERM, &sigact, NULL);
+    sigaction(SIGQUIT, &sigact, NULL);
+    sigaction(SIGINT, &sigact, NULL);
+    sigaction(SIGHUP, &sigact, NULL);
+    sigaction(SIGUSR1, &sigact, NULL);
+    sigaction(SIGUSR2, &sigact, NULL);
+
+    LOG_INFO("Starting %d collector workers", cfg->workers);
+
+    while (not stop) {
+        time_t now = time(NULL);
+
+        for (int i = 0; i < cfg->workers; i++) {
+            if (pids[i] == 0 and now >= restartAt[i] and startWorker(i))
+                return i;
+        }
+
+        if (reload) {
+            reload = 0;
+            for (int i = 0; i < cfg->workers; i++) {
+                if (pids[i] > 0)
+                    kill(pids[i], SIGUSR1);
+            }
+        }
+
+        if (dump) {
+            dump = 0;
+            for (int i = 0; i < cfg->workers; i++) {
+                if (pids[i] > 0)
+                    kill(pids[i], SIGUSR2);
+            }
+        }
+
+        int wstatus;
+        pid_t pid;
+        while ((pid = waitpid(-1, &wstatus, WNOHANG)) > 0) {
+            for (int i = 0; i < cfg->workers; i++) {
+                if (pids[i] != pid)
+                    continue;
+
+                if (WIFSIGNALED(wstatus))
+                    LOG_WARN("Worker %d (pid %d) killed by signal %d, restarting", i, pid, WTERMSIG(wstatus));
+                else
+                    LOG_WARN("Worker %d (pid %d) exited with status %d, restarting", i, pid, WEXITSTATUS(wstatus));
+
+                pids[i] = 0;
+                restartAt[i] = now + WORKER_RESTART_DELAY;
+                clearRouters(i);
+            }
+        }
+
+        usleep(100000);
+    }
+
+    LOG_INFO("Stopping collector workers");
+
+    for (int i = 0; i < cfg->workers; i++) {
+        if (pids[i] > 0)
+            kill(pids[i], SIGTERM);
+    }
+
+    for (int i = 0; i < cfg->workers; i++) {
+        if (pids[i] > 0)
+            waitpid(pids[i], NULL, 0);
+    }
+
+    return -1;
+}
+
+/**
+ * Fork a worker
+ *
+ * \param [in] index    Worker index
+ *
+ * \return true in the worker process
+ */
+bool WorkerSupervisor::startWorker(int index) {
+    pid_t supervisor = getpid();
+
+    // Buffered log lines would be written by both processes
+    logger->flush();
+
+    pid_t pid = fork();
+
+    if (pid < 0) {
+        LOG_ERR("Failed to fork worker %d: %s", index, strerror(errno));
+        restartAt[index] = time(NULL) + WORKER_RESTART_DELAY;
+        return false;
+
+    } else if (pid > 0) {
+        pids[index] = pid;
+        LOG_INFO("Started worker %d, pid %d", index, pid);
+        return false;
+    }
+
+    worker = index;
+
+    // The worker exits with the supervisor
+    prctl(PR_SET_PDEATHSIG, SIGTERM);
+    if (getppid() != supervisor)
+        _exit(0);
+
+    struct sigaction sigact;
+    sigact.sa_handler = SIG_DFL;
+    sigact.sa_flags = 0;
+    sigemptyset(&sigact.sa_mask);
+
+    sigaction(SIGTERM, &sigact, NULL);
+    sigaction(SIGQUIT, &sigact, NULL);
+    sigaction(SIGINT, &sigact, NULL);
+    sigaction(SIGHUP, &sigact, NULL);
+    sigaction(SIGUSR1, &sigact, NULL);
+    sigaction(SIGUSR2, &sigact, NULL);
+
+    // Only this worker's listener stays open in the worker
+    for (int i = 0; i < (int)listeners.size(); i++) {
+        if (i != index) {
+            delete listeners[i];
+            listeners[i] = NULL;
+        }
+    }
+
+    return true;
+}
+
+/**
+ * Get the listener of this worker
+ */
+BMPListener *WorkerSupervisor::getListener() {
+    return worker >= 0 ? listeners[worker] : NULL;
+}
+
+/**
+ * Get the index of this worker, -1 in the supervisor
+ */
+int WorkerSupervisor::getWorker() {
+    return worker;
+}
+
+/**
+ * Publish the routers connected to this worker
+ *
+ * \param [in] count    Number of connected routers
+ * \param [in] routers  Router addresses, comma delimited
+ */
+void WorkerSupervisor::setRouters(uint32_t count, const std::string &routers) {
+    if (worker < 0)
+        return;
+
+    worker_status &ws = status->workers[worker];
+
+    // Only this worker writes the slot, heartbeats with the same routers are not a change
+    if (ws.router_count == count and routers.compare(0, sizeof(ws.routers) - 1, ws.routers) == 0)
+        return;
+
+    ws.seq.fetch_add(1, std::memory_order_relaxed);
+    std::atomic_thread_fence(std::memory_order_release);
+
+    ws.router_count = count;
+    snprintf(ws.routers, sizeof(ws.routers), "%s", routers.c_str());
+
+    ws.seq.fetch_add(1, std::memory_order_release);
+
+    // Worker 0 sends its own changes, only changes of other workers need a new message
+    uint32_t prev = status->changes.fetch_add(1, std::memory_order_acq_rel);
+    if (worker == 0 and prev == lastChanges)
+        lastChanges = prev + 1;
+}
+
+/**
+ * Get the routers connected to all workers
+ *
+ * \param [out] count   Number of connected routers
+ * \param [out] routers Router addresses, comma delimited
+ */
+void WorkerSupervisor::getRouters(uint32_t &count, std::string &routers) {
+    count = 0;
+    routers.clear();
+
+    for (int i = 0; i < cfg->workers; i++) {
+        worker_status &ws = status->workers[i];
+        uint32_t ws_count;
+        char ws_routers[sizeof(ws.routers)];
+        uint32_t seq;
+
+        do {
+            while ((seq = ws.seq.load(std::memory_order_acquire)) & 1)
+                sched_yield();
+
+            ws_count = ws.router_count;
+            memcpy(ws_routers, ws.routers, sizeof(ws_routers));
+
+            std::atomic_thread_fence(std::memory_order_acquire);
+        } while (ws.seq.load(std::memory_order_relaxed) != seq);
+
+        ws_routers[sizeof(ws_routers) - 1] = 0;
+
+        count += ws_count;
+
+        if (ws_routers[0]) {
+            if (routers.size() > 0)
+                routers.append(", ");
+            routers.append(ws_routers);
+        }
+    }
+}
+
+/**
+ * Check if another worker changed its routers since the last call
+ */
+bool WorkerSupervisor::routersChanged() {
+    uint32_t changes = status->changes.load(std::memory_order_acquire);
+
+    if (changes == lastChanges)
+        return false;
+
+    lastChanges = changes;
+    return true;
+}
+
+/**
+ * Clear the routers of a worker that exited
+ *
+ * \param [in] index    Worker index
+ */
+void WorkerSupervisor::clearRouters(int index) {
+    worker_status &ws = status->workers[index];
+
+    // The worker may have died while writing, leave the sequence even
+    ws.seq.store(ws.seq.load(std::memory_order_relaxed) | 1, std::memory_order_relaxed);
+    std::atomic_thread_fence(std::memory_order_release);
+
+    ws.router_count = 0;
+    ws.routers[0] = 0;
+
+    ws.seq.fetch_add(1, std::memory_order_release);
+    status->changes.fetch_add(1, std::memory_order_acq_rel);
+}
+
+void WorkerSupervisor::signal_handler(int signum) {
+    if (signum == SIGUSR1)
+        reload = 1;
+    else if (signum == SIGUSR2)
+        dump = 1;
+    else
+        stop = 1;
+}
+
+/*
+ * Enable/Disable debug
+ */
+void WorkerSupervisor::enableDebug() {
+    debug = true;
+}
+
+void WorkerSupervisor::disableDebug() {
+    debug = false;
+}
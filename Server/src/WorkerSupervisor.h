@@ -0,0 +1,155 @@
+/*
+ * Copyright (c) 2024 Microsoft, Inc. and others.  All rights reserved.
+ *
+ * This program and the accompanying materials are made available under the
+ * terms of the Eclipse Public License v1.0 which accompanies this distribution,
+ * and is available at http://www.eclipse.org/legal/epl-v10.html
+ *
+ */
+
+#ifndef WORKERSUPERVISOR_H_
+#define WORKERSUPERVISOR_H_
+
+#include <atomic>
+#include <string>
+#include <vector>
+#include <csignal>
+#include <cstdint>
+#include <ctime>
+#include <sys/types.h>
+
+#include "BMPListener.h"
+#include "Config.h"
+#include "Logger.h"
+
+#define WORKER_RESTART_DELAY    1               ///< Seconds before a worker that exited is restarted
+
+/**
+ * \class   WorkerSupervisor
+ *
+ * \brief   Runs the collector as multiple worker processes sharing the BMP port
+ * \details
+ *      The supervisor opens one SO_REUSEPORT listener per worker, in worker order, and
+ *      attaches a steering program so that a router is always accepted by the same
+ *      worker (see BMPListener::attach_worker_steering).  Each worker is a forked
+ *      collector with its own router threads and message bus connections.
+ *
+ *      The supervisor keeps all listeners open.  A worker that exits is restarted with
+ *      the same listener, so routers connecting meanwhile wait in its accept queue and
+ *      the steering does not change.
+ *
+ *      Workers publish their connected routers in shared memory.  Worker 0 sends the
+ *      collector messages with the routers of all workers.
+ */
+class WorkerSupervisor {
+public:
+    /**
+     * Constructor for class
+     *
+     *  \param [in] logPtr  Pointer to existing Logger for app logging
+     *  \param [in] config  Pointer to the loaded configuration
+     */
+    WorkerSupervisor(Logger *logPtr, Config *config);
+
+    virtual ~WorkerSupervisor();
+
+    /**
+     * Open the listeners and run the workers until the supervisor is stopped
+     *
+     * \details Returns in each worker process right after it is forked.  The supervisor
+     *          returns after SIGTERM/SIGINT, once all workers exited.
+     *
+     * \return worker index in a worker process, -1 in the supervisor
+     *
+     * \throws const char * with the error message
+     */
+    int run();
+
+    /**
+     * Get the listener of this worker
+     */
+    BMPListener *getListener();
+
+    /**
+     * Get the index of this worker, -1 in the supervisor
+     */
+    int getWorker();
+
+    /**
+     * Publish the routers connected to this worker
+     *
+     * \param [in] count    Number of connected routers
+     * \param [in] routers  Router addresses, comma delimited
+     */
+    void setRouters(uint32_t count, const std::string &routers);
+
+    /**
+     * Get the routers connected to all workers
+     *
+     * \param [out] count   Number of connected routers
+     * \param [out] routers Router addresses, comma delimited
+     */
+    void getRouters(uint32_t &count, std::string &routers);
+
+    /**
+     * Check if another worker changed its routers since the last call
+     */
+    bool routersChanged();
+
+    // Debug methods
+    void enableDebug();
+    void disableDebug();
+
+private:
+    /**
+     * Routers of a worker, written by the worker only
+     */
+    struct worker_status {
+        std::atomic<uint32_t>   seq;            ///< Odd while the routers are written
+        uint32_t                router_count;
+        char                    routers[4096];
+    };
+
+    /**
+     * Status shared by the supervisor and the workers
+     */
+    struct shared_status {
+        std::atomic<uint32_t>   changes;        ///< Bumped on every router change
+        worker_status           workers[MAX_WORKERS];
+    };
+
+    Logger      *logger;                    ///< Logging class pointer
+    Config      *cfg;                       ///< Config pointer
+    bool        debug;                      ///< debug flag to indicate debugging
+
+    shared_status               *status;    ///< Shared (mmap) worker status
+    std::vector<BMPListener *>  listeners;  ///< Listener per worker
+    std::vector<pid_t>          pids;       ///< Worker pids, 0 if not running
+    std::vector<time_t>         restartAt;  ///< Time to restart a worker that exited
+    int                         worker;     ///< Index of this worker, -1 in the supervisor
+    uint32_t                    lastChanges;///< Changes seen by routersChanged()
+
+    static volatile sig_atomic_t    stop;       ///< Set by SIGTERM/SIGINT in the supervisor
+    static volatile sig_atomic_t    reload;     ///< Set by SIGUSR1 in the supervisor, forwarded to the workers
+    static volatile sig_atomic_t    dump;       ///< Set by SIGUSR2 in the supervisor, forwarded to the workers
+
+    static void signal_handler(int signum);
+
+    /**
+     * Fork a worker
+     *
+     * \param [in] index    Worker index
+     *
+     * \return true in the worker process
+     */
+    bool startWorker(int index);
+
+    /**
+     * Clear the routers of a worker that exited
+     *
+     * \param [in] index    Worker index
+     */
+    void clearRouters(int index);
+};
+
+#endif /* WORKERSUPERVISOR_H_ */
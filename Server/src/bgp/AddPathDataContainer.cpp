@@ -11,6 +11,7 @@
 #include "OpenMsg.h"
 
 #include <memory>
+#include <cstdio>
 
 AddPathDataContainer::AddPathDataContainer() {
 }
@@ -90,3 +91,42 @@ bool AddPathDataContainer::isAddPathEnabled(int afi, int safi) {
             );
     }
 }
+
+/**
+ * Export the Add Path data, used to hand off the peer to another collector
+ *
+ * \param [out] out             Exported data, appended as "<afi_safi> <sent> <recv>;" entries
+ */
+void AddPathDataContainer::exportState(std::string &out) {
+    for (AddPathMap::iterator it = this->addPathMap.begin(); it != this->addPathMap.end(); ++it) {
+        out.append(it->first);
+        out.append(" ");
+        out.append(std::to_string(static_cast<long long>(it->second.sendReceiveCodeForSentOpenMessage)));
+        out.append(" ");
+        out.append(std::to_string(static_cast<long long>(it->second.sendReceiveCodeForReceivedOpenMessage)));
+        out.append(";");
+    }
+}
+
+/**
+ * Import Add Path data exported by exportState()
+ *
+ * \param [in] in               Exported data
+ */
+void AddPathDataContainer::importState(const std::string &in) {
+    size_t pos = 0;
+
+    while (pos < in.size()) {
+        size_t end = in.find(';', pos);
+        if (end == std::string::npos)
+            break;
+
+        char key[32];
+        sendReceiveCodesForSentAndReceivedOpenMessageStructure codes;
+        if (sscanf(in.substr(pos, end - pos).c_str(), "%31s %d %d", key,
+                   &codes.sendReceiveCodeForSentOpenMessage, &codes.sendReceiveCodeForReceivedOpenMessage) == 3)
+            this->addPathMap[key] = codes;
+
+        pos = end + 1;
+    }
+}
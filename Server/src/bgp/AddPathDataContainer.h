@@ -65,6 +65,20 @@ public:
      */
     bool isAddPathEnabled(int afi, int safi);
 
+    /**
+     * Export the Add Path data, used to hand off the peer to another collector
+     *
+     * \param [out] out             Exported data, appended as "<afi_safi> <sent> <recv>;" entries
+     */
+    void exportState(std::string &out);
+
+    /**
+     * Import Add Path data exported by exportState()
+     *
+     * \param [in] in               Exported data
+     */
+    void importState(const std::string &in);
+
 };
 
 
@@ -395,7 +395,7 @@ namespace bgp_msg {
 
                         // Parse second label if present
                         if (len == 3) {
-                            SELF_DEBUG("%s: parsing second evpn label\n", peer_addr.c_str());
+                            TRACE(TRACE_BGP, "%s: parsing second evpn label\n", peer_addr.c_str());
 
                             memcpy(&tuple.mpls_label_2, data_pointer, 3);
                             bgp::SWAP_BYTES(&tuple.mpls_label_2);
@@ -501,8 +501,8 @@ namespace bgp_msg {
             else
                 parsed_data->evpn.push_back(tuple);
 
-            SELF_DEBUG("%s: Processed evpn NLRI read %d of %d, nlri len %d", peer_addr.c_str(),
-                       data_read, data_len, len);
+            TRACE(TRACE_BGP, "%s: Processed evpn NLRI read %d of %d, nlri len %d", peer_addr.c_str(),
+                             data_read, data_len, len);
         }
     }
 } /* namespace bgp_msg */
\ No newline at end of file
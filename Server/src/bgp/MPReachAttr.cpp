@@ -72,7 +72,7 @@ void MPReachAttr::parseReachNlriAttr(int attr_len, u_char *data, UpdateMsg::pars
         return;
     }
 
-    SELF_DEBUG("%s: afi=%d safi=%d nh_len=%d reserved=%d", peer_addr.c_str(),
+    TRACE(TRACE_BGP, "%s: afi=%d safi=%d nh_len=%d reserved=%d", peer_addr.c_str(),
                 nlri.afi, nlri.safi, nlri.nh_len, nlri.reserved);
 
     /*
@@ -69,7 +69,7 @@ void MPUnReachAttr::parseUnReachNlriAttr(int attr_len, u_char *data, bgp_msg::Up
         return;
     }
 
-    SELF_DEBUG("%s: afi=%d safi=%d", peer_addr.c_str(), nlri.afi, nlri.safi);
+    TRACE(TRACE_BGP, "%s: afi=%d safi=%d", peer_addr.c_str(), nlri.afi, nlri.safi);
 
     if (nlri.nlri_len == 0) {
 	peer_info->endOfRIB = true;		// Indicates End-Of-RIB Marker is received
@@ -86,7 +86,7 @@ size_t OpenMsg::parseOpenMsg(u_char *data, size_t size, bool openMessageIsSent,
     inet_ntop(AF_INET, &open_hdr.bgp_id, bgp_id_char, sizeof(bgp_id_char));
     bgp_id.assign(bgp_id_char);
 
-    SELF_DEBUG("%s: Open message:ver=%d hold=%u asn=%hu bgp_id=%s params_len=%d", peer_addr.c_str(),
+    TRACE(TRACE_BGP, "%s: Open message:ver=%d hold=%u asn=%hu bgp_id=%s params_len=%d", peer_addr.c_str(),
                 open_hdr.ver, open_hdr.hold, open_hdr.asn, bgp_id.c_str(), open_hdr.param_len);
 
     /*
@@ -152,7 +152,7 @@ size_t OpenMsg::parseCapabilities(u_char *data, size_t size, bool openMessageIsS
 
     for (int i=0; i < size; ) {
         param = (open_param *)bufPtr;
-        SELF_DEBUG("%s: Open param type=%d len=%d", peer_addr.c_str(), param->type, param->len);
+        TRACE(TRACE_BGP, "%s: Open param type=%d len=%d", peer_addr.c_str(), param->type, param->len);
 
         if (param->type != BGP_CAP_PARAM_TYPE) {
             LOG_NOTICE("%s: Open param type %d is not supported, expected type %d", peer_addr.c_str(),
@@ -167,7 +167,7 @@ size_t OpenMsg::parseCapabilities(u_char *data, size_t size, bool openMessageIsS
 
             for (int c=0; c < param->len; ) {
                 cap = (cap_param *)cap_ptr;
-                SELF_DEBUG("%s: Capability code=%d len=%d", peer_addr.c_str(), cap->code, cap->len);
+                TRACE(TRACE_BGP, "%s: Capability code=%d len=%d", peer_addr.c_str(), cap->code, cap->len);
 
                 /*
                  * Handle the capability
@@ -185,19 +185,19 @@ size_t OpenMsg::parseCapabilities(u_char *data, size_t size, bool openMessageIsS
                         break;
 
                     case BGP_CAP_ROUTE_REFRESH:
-                        SELF_DEBUG("%s: supports route-refresh", peer_addr.c_str());
+                        TRACE(TRACE_BGP, "%s: supports route-refresh", peer_addr.c_str());
                         snprintf(capStr, sizeof(capStr), "Route Refresh (%d)", BGP_CAP_ROUTE_REFRESH);
                         capabilities.push_back(capStr);
                         break;
 
                     case BGP_CAP_ROUTE_REFRESH_ENHANCED:
-                        SELF_DEBUG("%s: supports route-refresh enhanced", peer_addr.c_str());
+                        TRACE(TRACE_BGP, "%s: supports route-refresh enhanced", peer_addr.c_str());
                         snprintf(capStr, sizeof(capStr), "Route Refresh Enhanced (%d)", BGP_CAP_ROUTE_REFRESH_ENHANCED);
                         capabilities.push_back(capStr);
                         break;
 
                     case BGP_CAP_ROUTE_REFRESH_OLD:
-                        SELF_DEBUG("%s: supports OLD route-refresh", peer_addr.c_str());
+                        TRACE(TRACE_BGP, "%s: supports OLD route-refresh", peer_addr.c_str());
                         snprintf(capStr, sizeof(capStr), "Route Refresh Old (%d)", BGP_CAP_ROUTE_REFRESH_OLD);
                         capabilities.push_back(capStr);
                         break;
@@ -220,8 +220,8 @@ size_t OpenMsg::parseCapabilities(u_char *data, size_t size, bool openMessageIsS
                                 snprintf(capStr, sizeof(capStr), "ADD Path (%d) : afi=%d safi=%d send/receive=%d",
                                          BGP_CAP_ADD_PATH, data.afi, data.safi, data.send_recieve);
 
-                                SELF_DEBUG("%s: supports Add Path afi = %d safi = %d send/receive = %d",
-                                           peer_addr.c_str(), data.afi, data.safi, data.send_recieve);
+                                TRACE(TRACE_BGP, "%s: supports Add Path afi = %d safi = %d send/receive = %d",
+                                                 peer_addr.c_str(), data.afi, data.safi, data.send_recieve);
 
                                 std::string decodeStr(capStr);
                                 decodeStr.append(" : ");
@@ -261,19 +261,19 @@ size_t OpenMsg::parseCapabilities(u_char *data, size_t size, bool openMessageIsS
                     }
 
                     case BGP_CAP_GRACEFUL_RESTART:
-                        SELF_DEBUG("%s: supports graceful restart", peer_addr.c_str());
+                        TRACE(TRACE_BGP, "%s: supports graceful restart", peer_addr.c_str());
                         snprintf(capStr, sizeof(capStr), "Graceful Restart (%d)", BGP_CAP_GRACEFUL_RESTART);
                         capabilities.push_back(capStr);
                         break;
 
                     case BGP_CAP_OUTBOUND_FILTER:
-                        SELF_DEBUG("%s: supports outbound filter", peer_addr.c_str());
+                        TRACE(TRACE_BGP, "%s: supports outbound filter", peer_addr.c_str());
                         snprintf(capStr, sizeof(capStr), "Outbound Filter (%d)", BGP_CAP_OUTBOUND_FILTER);
                         capabilities.push_back(capStr);
                         break;
 
                     case BGP_CAP_MULTI_SESSION:
-                        SELF_DEBUG("%s: supports multi-session", peer_addr.c_str());
+                        TRACE(TRACE_BGP, "%s: supports multi-session", peer_addr.c_str());
                         snprintf(capStr, sizeof(capStr), "Multi-session (%d)", BGP_CAP_MULTI_SESSION);
                         capabilities.push_back(capStr);
                         break;
@@ -285,7 +285,7 @@ size_t OpenMsg::parseCapabilities(u_char *data, size_t size, bool openMessageIsS
                             memcpy(&data, (cap_ptr + 2), sizeof(data));
                             bgp::SWAP_BYTES(&data.afi);
 
-                            SELF_DEBUG("%s: supports MPBGP afi = %d safi=%d",
+                            TRACE(TRACE_BGP, "%s: supports MPBGP afi = %d safi=%d",
                                     peer_addr.c_str(), data.afi, data.safi);
 
                             snprintf(capStr, sizeof(capStr), "MPBGP (%d) : afi=%d safi=%d",
@@ -315,7 +315,7 @@ size_t OpenMsg::parseCapabilities(u_char *data, size_t size, bool openMessageIsS
                         snprintf(capStr, sizeof(capStr), "%d", cap->code);
                         capabilities.push_back(capStr);
 
-                        SELF_DEBUG("%s: Ignoring capability %d, not implemented", peer_addr.c_str(), cap->code);
+                        TRACE(TRACE_BGP, "%s: Ignoring capability %d, not implemented", peer_addr.c_str(), cap->code);
                         break;
                 }
 
@@ -18,6 +18,7 @@
 #include "MPReachAttr.h"
 #include "MPUnReachAttr.h"
 #include "MPLinkStateAttr.h"
+#include "Profiler.h"
 
 namespace bgp_msg {
 
@@ -80,7 +81,7 @@ size_t UpdateMsg::parseUpdateMsg(u_char *data, size_t size, parsed_update_data &
      */
     update_bgp_hdr uHdr;
 
-    SELF_DEBUG("%s: rtr=%s: Parsing update message of size %d", peer_addr.c_str(), router_addr.c_str(), size);
+    TRACE(TRACE_BGP, "%s: rtr=%s: Parsing update message of size %d", peer_addr.c_str(), router_addr.c_str(), size);
 
     if (size < 2) {
         LOG_WARN("%s: rtr=%s: Update message is too short to parse header", peer_addr.c_str(), router_addr.c_str());
@@ -101,13 +102,13 @@ size_t UpdateMsg::parseUpdateMsg(u_char *data, size_t size, parsed_update_data &
     uHdr.withdrawnPtr = bufPtr;
     bufPtr += uHdr.withdrawn_len; read_size += uHdr.withdrawn_len;
 
-    SELF_DEBUG("%s: rtr=%s: Withdrawn len = %hu", peer_addr.c_str(), router_addr.c_str(), uHdr.withdrawn_len );
+    TRACE(TRACE_BGP, "%s: rtr=%s: Withdrawn len = %hu", peer_addr.c_str(), router_addr.c_str(), uHdr.withdrawn_len );
 
     // Get the attributes length
     memcpy(&uHdr.attr_len, bufPtr, sizeof(uHdr.attr_len));
     bufPtr += sizeof(uHdr.attr_len); read_size += sizeof(uHdr.attr_len);
     bgp::SWAP_BYTES(&uHdr.attr_len);
-    SELF_DEBUG("%s: rtr=%s: Attribute len = %hu", peer_addr.c_str(), router_addr.c_str(), uHdr.attr_len);
+    TRACE(TRACE_BGP, "%s: rtr=%s: Attribute len = %hu", peer_addr.c_str(), router_addr.c_str(), uHdr.attr_len);
 
     // Set the attributes data pointer
     if ((size - read_size) < uHdr.attr_len) {
@@ -133,7 +134,7 @@ size_t UpdateMsg::parseUpdateMsg(u_char *data, size_t size, parsed_update_data &
         /* ---------------------------------------------------------
          * Parse the withdrawn prefixes
          */
-        SELF_DEBUG("%s: rtr=%s: Getting the IPv4 withdrawn data", peer_addr.c_str(), router_addr.c_str());
+        TRACE(TRACE_BGP, "%s: rtr=%s: Getting the IPv4 withdrawn data", peer_addr.c_str(), router_addr.c_str());
         if (uHdr.withdrawn_len > 0)
             parseNlriData_v4(uHdr.withdrawnPtr, uHdr.withdrawn_len, parsed_data.withdrawn);
 
@@ -149,7 +150,7 @@ size_t UpdateMsg::parseUpdateMsg(u_char *data, size_t size, parsed_update_data &
         /* ---------------------------------------------------------
          * Parse the NLRI data
          */
-        SELF_DEBUG("%s: rtr=%s: Getting the IPv4 NLRI data, size = %d", peer_addr.c_str(), router_addr.c_str(), (size - read_size));
+        TRACE(TRACE_BGP, "%s: rtr=%s: Getting the IPv4 NLRI data, size = %d", peer_addr.c_str(), router_addr.c_str(), (size - read_size));
         if ((size - read_size) > 0) {
             parseNlriData_v4(uHdr.nlriPtr, (size - read_size), parsed_data.advertised);
             read_size = size;
@@ -208,7 +209,7 @@ void UpdateMsg::parseNlriData_v4(u_char *data, uint16_t len, std::list<bgp::pref
         if (tuple.len % 8)
             ++addr_bytes;
 
-        SELF_DEBUG("%s: rtr=%s: Reading NLRI data prefix bits=%d bytes=%d", peer_addr.c_str(),
+        TRACE(TRACE_BGP, "%s: rtr=%s: Reading NLRI data prefix bits=%d bytes=%d", peer_addr.c_str(),
                     router_addr.c_str(), tuple.len, addr_bytes);
 
         if (addr_bytes <= 4) {
@@ -219,7 +220,7 @@ void UpdateMsg::parseNlriData_v4(u_char *data, uint16_t len, std::list<bgp::pref
             // Convert the IP to string printed format
             inet_ntop(AF_INET, ipv4_raw, ipv4_char, sizeof(ipv4_char));
             tuple.prefix.assign(ipv4_char);
-            SELF_DEBUG("%s: rtr=%s: Adding prefix %s len %d", peer_addr.c_str(),
+            TRACE(TRACE_BGP, "%s: rtr=%s: Adding prefix %s len %d", peer_addr.c_str(),
                         router_addr.c_str(), ipv4_char, tuple.len);
 
             // set the raw/binary address
@@ -246,6 +247,8 @@ void UpdateMsg::parseNlriData_v4(u_char *data, uint16_t len, std::list<bgp::pref
  * \param [out]  parsed_data    Reference to parsed_update_data; will be updated with all parsed data
  */
 void UpdateMsg::parseAttributes(u_char *data, uint16_t len, parsed_update_data &parsed_data) {
+    PROFILE_SCOPE(BGP_PARSE_ATTRS);
+
     /*
      * Per RFC4271 Section 4.3, flat indicates if the length is 1 or 2 octets
      */
@@ -271,7 +274,7 @@ void UpdateMsg::parseAttributes(u_char *data, uint16_t len, parsed_update_data &
 
         // Check if the length field is 1 or two bytes
         if (ATTR_FLAG_EXTENDED(attr_flags)) {
-            SELF_DEBUG("%s: rtr=%s: extended length path attribute bit set for an entry", peer_addr.c_str(), router_addr.c_str());
+            TRACE(TRACE_BGP, "%s: rtr=%s: extended length path attribute bit set for an entry", peer_addr.c_str(), router_addr.c_str());
 
             memcpy(&attr_len, data, 2); data += 2; read_size += 2;
             bgp::SWAP_BYTES(&attr_len);
@@ -281,7 +284,7 @@ void UpdateMsg::parseAttributes(u_char *data, uint16_t len, parsed_update_data &
             read_size++;
         }
 
-        SELF_DEBUG("%s: rtr=%s: attribute type = %d len_sz = %d",
+        TRACE(TRACE_BGP, "%s: rtr=%s: attribute type = %d len_sz = %d",
                 peer_addr.c_str(), router_addr.c_str(), attr_type, attr_len);
 
         // Get the attribute data, if we have any; making sure to not overrun buffer
@@ -295,7 +298,7 @@ void UpdateMsg::parseAttributes(u_char *data, uint16_t len, parsed_update_data &
             data        += attr_len;
             read_size   += attr_len;
 
-            SELF_DEBUG("%s: rtr=%s: parsed attr type=%d, size=%hu", peer_addr.c_str(), router_addr.c_str(),
+            TRACE(TRACE_BGP, "%s: rtr=%s: parsed attr type=%d, size=%hu", peer_addr.c_str(), router_addr.c_str(),
                         attr_type, attr_len);
 
         } else if (attr_len) {
@@ -465,15 +468,15 @@ void UpdateMsg::parseAttrData(u_char attr_type, uint16_t attr_len, u_char *data,
 
         case ATTR_TYPE_AS4_PATH:
         {
-            SELF_DEBUG("%s: rtr=%s: attribute type AS4_PATH is not yet implemented, skipping for now.",
+            TRACE(TRACE_BGP, "%s: rtr=%s: attribute type AS4_PATH is not yet implemented, skipping for now.",
                      peer_addr.c_str(), router_addr.c_str());
             break;
         }
 
         case ATTR_TYPE_AS4_AGGREGATOR:
         {
-            SELF_DEBUG("%s: rtr=%s: attribute type AS4_AGGREGATOR is not yet implemented, skipping for now.",
-                       peer_addr.c_str(), router_addr.c_str());
+            TRACE(TRACE_BGP, "%s: rtr=%s: attribute type AS4_AGGREGATOR is not yet implemented, skipping for now.",
+                             peer_addr.c_str(), router_addr.c_str());
             break;
         }
 
@@ -607,9 +610,9 @@ void UpdateMsg::parseAttr_AsPath(uint16_t attr_len, u_char *data, parsed_attrs_m
             decoded_path.append(" {");
         }
 
-        SELF_DEBUG("%s: rtr=%s: as_path seg_len = %d seg_type = %d, path_len = %d total_len = %d as_octet_size = %d",
-                   peer_addr.c_str(), router_addr.c_str(),
-                   seg_len, seg_type, path_len, attr_len, asn_octet_size);
+        TRACE(TRACE_BGP, "%s: rtr=%s: as_path seg_len = %d seg_type = %d, path_len = %d total_len = %d as_octet_size = %d",
+                         peer_addr.c_str(), router_addr.c_str(),
+                         seg_len, seg_type, path_len, attr_len, asn_octet_size);
 
         if ((seg_len * asn_octet_size) > path_len){
 
@@ -648,7 +651,7 @@ void UpdateMsg::parseAttr_AsPath(uint16_t attr_len, u_char *data, parsed_attrs_m
         }
     }
 
-    SELF_DEBUG("%s: rtr=%s: Parsed AS_PATH count %hu : %s", peer_addr.c_str(), router_addr.c_str(), as_path_cnt, decoded_path.c_str());
+    TRACE(TRACE_BGP, "%s: rtr=%s: Parsed AS_PATH count %hu : %s", peer_addr.c_str(), router_addr.c_str(), as_path_cnt, decoded_path.c_str());
 
     /*
      * Update the attributes map
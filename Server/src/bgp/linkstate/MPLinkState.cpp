@@ -63,7 +63,7 @@ namespace bgp_msg {
          */
         switch (nlri.safi) {
             case bgp::BGP_SAFI_BGPLS: // Unicast BGP-LS
-                SELF_DEBUG("REACH: bgp-ls: len=%d", nlri.nlri_len);
+                TRACE(TRACE_BGP, "REACH: bgp-ls: len=%d", nlri.nlri_len);
                 parseLinkStateNlriData(nlri.nlri_data, nlri.nlri_len);
                 break;
 
@@ -90,7 +90,7 @@ namespace bgp_msg {
          */
         switch (nlri.safi) {
             case bgp::BGP_SAFI_BGPLS: // Unicast BGP-LS
-                SELF_DEBUG("UNREACH: bgp-ls: len=%d", nlri.nlri_len);
+                TRACE(TRACE_BGP, "UNREACH: bgp-ls: len=%d", nlri.nlri_len);
                 parseLinkStateNlriData(nlri.nlri_data, nlri.nlri_len);
                 break;
 
@@ -117,7 +117,7 @@ namespace bgp_msg {
         // Process the NLRI data
         while (nlri_len_read < len) {
 
-            SELF_DEBUG("NLRI read=%d total = %d", nlri_len_read, len);
+            TRACE(TRACE_BGP, "NLRI read=%d total = %d", nlri_len_read, len);
 
             /*
              * Parse the NLRI TLV
@@ -156,22 +156,22 @@ namespace bgp_msg {
              */
             switch (nlri_type) {
                 case NLRI_TYPE_NODE:
-                    SELF_DEBUG("%s: bgp-ls: parsing NODE NLRI len=%d", peer_addr.c_str(), nlri_len);
+                    TRACE(TRACE_BGP, "%s: bgp-ls: parsing NODE NLRI len=%d", peer_addr.c_str(), nlri_len);
                     parseNlriNode(data, nlri_len, id, proto_id);
                     break;
 
                 case NLRI_TYPE_LINK:
-                    SELF_DEBUG("%s: bgp-ls: parsing LINK NLRI", peer_addr.c_str());
+                    TRACE(TRACE_BGP, "%s: bgp-ls: parsing LINK NLRI", peer_addr.c_str());
                     parseNlriLink(data, nlri_len, id, proto_id);
                     break;
 
                 case NLRI_TYPE_IPV4_PREFIX:
-                    SELF_DEBUG("%s: bgp-ls: parsing IPv4 PREFIX NLRI", peer_addr.c_str());
+                    TRACE(TRACE_BGP, "%s: bgp-ls: parsing IPv4 PREFIX NLRI", peer_addr.c_str());
                     parseNlriPrefix(data, nlri_len, id, proto_id, true);
                     break;
 
                 case NLRI_TYPE_IPV6_PREFIX:
-                    SELF_DEBUG("%s: bgp-ls: parsing IPv6 PREFIX NLRI", peer_addr.c_str());
+                    TRACE(TRACE_BGP, "%s: bgp-ls: parsing IPv6 PREFIX NLRI", peer_addr.c_str());
                     parseNlriPrefix(data, nlri_len, id, proto_id, false);
                     break;
 
@@ -258,7 +258,7 @@ namespace bgp_msg {
         node_tbl.id       = id;
         snprintf(node_tbl.protocol, sizeof(node_tbl.protocol), "%s", decodeNlriProtocolId(proto_id).c_str());
 
-        SELF_DEBUG("%s: bgp-ls: ID = %x Protocol = %s", peer_addr.c_str(), id, node_tbl.protocol);
+        TRACE(TRACE_BGP, "%s: bgp-ls: ID = %x Protocol = %s", peer_addr.c_str(), id, node_tbl.protocol);
 
         /*
          * Parse the local node descriptor sub-tlv
@@ -336,7 +336,7 @@ namespace bgp_msg {
         link_tbl.id       = id;
         snprintf(link_tbl.protocol, sizeof(link_tbl.protocol), "%s", decodeNlriProtocolId(proto_id).c_str());
 
-        SELF_DEBUG("%s: bgp-ls: ID = %x Protocol = %s", peer_addr.c_str(), id, link_tbl.protocol);
+        TRACE(TRACE_BGP, "%s: bgp-ls: ID = %x Protocol = %s", peer_addr.c_str(), id, link_tbl.protocol);
 
         /*
          * Parse local and remote node descriptors (expect both)
@@ -413,7 +413,7 @@ namespace bgp_msg {
         }
 
         // Save link to parsed data
-        SELF_DEBUG("MT-ID = %u/%u", link_tbl.mt_id, info.mt_id);
+        TRACE(TRACE_BGP, "MT-ID = %u/%u", link_tbl.mt_id, info.mt_id);
         link_tbl.isIPv4             = info.isIPv4;
         link_tbl.mt_id              = info.mt_id;
         link_tbl.local_link_id      = info.local_id;
@@ -447,7 +447,7 @@ namespace bgp_msg {
         prefix_tbl.id       = id;
         snprintf(prefix_tbl.protocol, sizeof(prefix_tbl.protocol), "%s", decodeNlriProtocolId(proto_id).c_str());
 
-        SELF_DEBUG("%s: bgp-ls: ID = %x Protocol = %s", peer_addr.c_str(), id, prefix_tbl.protocol);
+        TRACE(TRACE_BGP, "%s: bgp-ls: ID = %x Protocol = %s", peer_addr.c_str(), id, prefix_tbl.protocol);
 
         /*
          * Parse the local node descriptor sub-tlv
@@ -548,7 +548,7 @@ namespace bgp_msg {
         memcpy(&len, data+2, 2);
         bgp::SWAP_BYTES(&len);
 
-        //SELF_DEBUG("%s: bgp-ls: Parsing node descriptor type %d len %d", peer_addr.c_str(), type, len);
+        //TRACE(TRACE_BGP, "%s: bgp-ls: Parsing node descriptor type %d len %d", peer_addr.c_str(), type, len);
 
         if (len > data_len - 4) {
             LOG_NOTICE("%s: bgp-ls: failed to parse node descriptor; type length is larger than available data %d>=%d",
@@ -572,7 +572,7 @@ namespace bgp_msg {
                 bgp::SWAP_BYTES(&info.asn);
                 data_read += 4;
 
-                SELF_DEBUG("%s: bgp-ls: Node descriptor AS = %u", peer_addr.c_str(), info.asn);
+                TRACE(TRACE_BGP, "%s: bgp-ls: Node descriptor AS = %u", peer_addr.c_str(), info.asn);
 
                 break;
             }
@@ -591,7 +591,7 @@ namespace bgp_msg {
                 bgp::SWAP_BYTES(&info.bgp_ls_id);
                 data_read += 4;
 
-                SELF_DEBUG("%s: bgp-ls: Node descriptor BGP-LS ID = %08X", peer_addr.c_str(), info.bgp_ls_id);
+                TRACE(TRACE_BGP, "%s: bgp-ls: Node descriptor BGP-LS ID = %08X", peer_addr.c_str(), info.bgp_ls_id);
                 break;
             }
 
@@ -610,7 +610,7 @@ namespace bgp_msg {
                 inet_ntop(AF_INET, info.ospf_area_Id, ipv4_char, sizeof(ipv4_char));
                 data_read += 4;
 
-                SELF_DEBUG("%s: bgp-ls: Node descriptor OSPF Area ID = %s", peer_addr.c_str(), ipv4_char);
+                TRACE(TRACE_BGP, "%s: bgp-ls: Node descriptor OSPF Area ID = %s", peer_addr.c_str(), ipv4_char);
                 break;
             }
 
@@ -627,7 +627,7 @@ namespace bgp_msg {
                 memcpy(info.igp_router_id, data, len);
                 data_read += len;
 
-                SELF_DEBUG("%s: bgp-ls: Node descriptor IGP Router ID %d = %d.%d.%d.%d (%02x%02x.%02x%02x.%02x%02x.%02x %02x)", peer_addr.c_str(), data_read,
+                TRACE(TRACE_BGP, "%s: bgp-ls: Node descriptor IGP Router ID %d = %d.%d.%d.%d (%02x%02x.%02x%02x.%02x%02x.%02x %02x)", peer_addr.c_str(), data_read,
                             info.igp_router_id[0], info.igp_router_id[1], info.igp_router_id[2], info.igp_router_id[3],
                         info.igp_router_id[0], info.igp_router_id[1], info.igp_router_id[2], info.igp_router_id[3],
                         info.igp_router_id[4], info.igp_router_id[5], info.igp_router_id[6], info.igp_router_id[7]);
@@ -649,7 +649,7 @@ namespace bgp_msg {
                 inet_ntop(AF_INET, &info.bgp_router_id, ipv4_char, sizeof(ipv4_char));
                 data_read += 4;
 
-                SELF_DEBUG("%s: bgp-ls: Node descriptor BGP Router-ID = %s", peer_addr.c_str(), ipv4_char);
+                TRACE(TRACE_BGP, "%s: bgp-ls: Node descriptor BGP Router-ID = %s", peer_addr.c_str(), ipv4_char);
                 break;
             }
 
@@ -713,7 +713,7 @@ namespace bgp_msg {
                 memcpy(&info.remote_id, data+4, 4); bgp::SWAP_BYTES(&info.remote_id);
                 data_read += 8;
 
-                SELF_DEBUG("%s: bgp-ls: Link descriptor ID local = %08x remote = %08x", peer_addr.c_str(), info.local_id, info.remote_id);
+                TRACE(TRACE_BGP, "%s: bgp-ls: Link descriptor ID local = %08x remote = %08x", peer_addr.c_str(), info.local_id, info.remote_id);
 
                 break;
             }
@@ -728,8 +728,8 @@ namespace bgp_msg {
                 }
 
                 if (len > 4) {
-                    SELF_DEBUG("%s: bgp-ls: failed to parse link MT-ID descriptor sub-tlv; too long %d",
-                               peer_addr.c_str(), len);
+                    TRACE(TRACE_BGP, "%s: bgp-ls: failed to parse link MT-ID descriptor sub-tlv; too long %d",
+                                     peer_addr.c_str(), len);
                     info.mt_id = 0;
                     data_read += len;
                     break;
@@ -739,7 +739,7 @@ namespace bgp_msg {
                 info.mt_id >>= 16;          // MT ID is 16 bits
                 data_read += len;
 
-                SELF_DEBUG("%s: bgp-ls: Link descriptor MT-ID = %08x ", peer_addr.c_str(), info.mt_id);
+                TRACE(TRACE_BGP, "%s: bgp-ls: Link descriptor MT-ID = %08x ", peer_addr.c_str(), info.mt_id);
 
                 break;
             }
@@ -760,7 +760,7 @@ namespace bgp_msg {
                 inet_ntop(AF_INET, info.intf_addr, ip_char, sizeof(ip_char));
                 data_read += 4;
 
-                SELF_DEBUG("%s: bgp-ls: Link descriptor Interface Address = %s", peer_addr.c_str(), ip_char);
+                TRACE(TRACE_BGP, "%s: bgp-ls: Link descriptor Interface Address = %s", peer_addr.c_str(), ip_char);
                 break;
             }
 
@@ -779,7 +779,7 @@ namespace bgp_msg {
                 inet_ntop(AF_INET6, info.intf_addr, ip_char, sizeof(ip_char));
                 data_read += 16;
 
-                SELF_DEBUG("%s: bgp-ls: Link descriptor interface address = %s", peer_addr.c_str(), ip_char);
+                TRACE(TRACE_BGP, "%s: bgp-ls: Link descriptor interface address = %s", peer_addr.c_str(), ip_char);
                 break;
             }
 
@@ -799,7 +799,7 @@ namespace bgp_msg {
                 inet_ntop(AF_INET, info.nei_addr, ip_char, sizeof(ip_char));
                 data_read += 4;
 
-                SELF_DEBUG("%s: bgp-ls: Link descriptor neighbor address = %s", peer_addr.c_str(), ip_char);
+                TRACE(TRACE_BGP, "%s: bgp-ls: Link descriptor neighbor address = %s", peer_addr.c_str(), ip_char);
                 break;
             }
 
@@ -818,7 +818,7 @@ namespace bgp_msg {
                 inet_ntop(AF_INET6, info.nei_addr, ip_char, sizeof(ip_char));
                 data_read += 16;
 
-                SELF_DEBUG("%s: bgp-ls: Link descriptor neighbor address = %s", peer_addr.c_str(), ip_char);
+                TRACE(TRACE_BGP, "%s: bgp-ls: Link descriptor neighbor address = %s", peer_addr.c_str(), ip_char);
                 break;
             }
 
@@ -943,7 +943,7 @@ namespace bgp_msg {
                         memcpy(info.prefix_bcast, info.prefix, sizeof(info.prefix_bcast));
                 }
 
-                SELF_DEBUG("%s: bgp-ls: prefix ip_reach_info: prefix = %s/%d", peer_addr.c_str(),
+                TRACE(TRACE_BGP, "%s: bgp-ls: prefix ip_reach_info: prefix = %s/%d", peer_addr.c_str(),
                             ip_char, info.prefix_len);
                 break;
             }
@@ -956,8 +956,8 @@ namespace bgp_msg {
                 }
 
                 if (len > 4) {
-                    SELF_DEBUG("%s: bgp-ls: failed to parse link MT-ID descriptor sub-tlv; too long %d",
-                               peer_addr.c_str(), len);
+                    TRACE(TRACE_BGP, "%s: bgp-ls: failed to parse link MT-ID descriptor sub-tlv; too long %d",
+                                     peer_addr.c_str(), len);
                     info.mt_id = 0;
                     data_read += len;
                     break;
@@ -968,7 +968,7 @@ namespace bgp_msg {
 
                 data_read += len;
 
-                SELF_DEBUG("%s: bgp-ls: Link descriptor MT-ID = %08x ", peer_addr.c_str(), info.mt_id);
+                TRACE(TRACE_BGP, "%s: bgp-ls: Link descriptor MT-ID = %08x ", peer_addr.c_str(), info.mt_id);
 
                 break;
 
@@ -1002,7 +1002,7 @@ namespace bgp_msg {
                     default:
                         snprintf(info.ospf_route_type, sizeof(info.ospf_route_type),"Intra");
                 }
-                SELF_DEBUG("%s: bgp-ls: prefix ospf route type is %s", peer_addr.c_str(), info.ospf_route_type);
+                TRACE(TRACE_BGP, "%s: bgp-ls: prefix ospf route type is %s", peer_addr.c_str(), info.ospf_route_type);
                 break;
             }
 
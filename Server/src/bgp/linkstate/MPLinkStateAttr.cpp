@@ -294,7 +294,7 @@ namespace bgp_msg {
 
                 std::string flags = this->parse_flags_to_string(*data, LS_FLAGS_NODE_NLRI, sizeof(LS_FLAGS_NODE_NLRI));
 
-                SELF_DEBUG("%s: bgp-ls: parsed node flags %s %x (len=%d)", peer_addr.c_str(), flags.c_str(), *data, len);
+                TRACE(TRACE_BGP, "%s: bgp-ls: parsed node flags %s %x (len=%d)", peer_addr.c_str(), flags.c_str(), *data, len);
 
                 parsed_data->ls_attrs[ATTR_NODE_FLAG].fill(0);
                 strncpy((char *)parsed_data->ls_attrs[ATTR_NODE_FLAG].data(), flags.c_str(), flags.size());
@@ -311,7 +311,7 @@ namespace bgp_msg {
                 memcpy(parsed_data->ls_attrs[ATTR_NODE_IPV4_ROUTER_ID_LOCAL].data(), data, 4);
                 inet_ntop(AF_INET, parsed_data->ls_attrs[ATTR_NODE_IPV4_ROUTER_ID_LOCAL].data(), ip_char, sizeof(ip_char));
 
-                SELF_DEBUG("%s: bgp-ls: parsed local IPv4 router id attribute: addr = %s", peer_addr.c_str(), ip_char);
+                TRACE(TRACE_BGP, "%s: bgp-ls: parsed local IPv4 router id attribute: addr = %s", peer_addr.c_str(), ip_char);
                 break;
 
             case ATTR_NODE_IPV6_ROUTER_ID_LOCAL:  // Includes ATTR_LINK_IPV6_ROUTER_ID_LOCAL
@@ -324,7 +324,7 @@ namespace bgp_msg {
                 memcpy(parsed_data->ls_attrs[ATTR_NODE_IPV6_ROUTER_ID_LOCAL].data(), data, 16);
                 inet_ntop(AF_INET6, parsed_data->ls_attrs[ATTR_NODE_IPV6_ROUTER_ID_LOCAL].data(), ip_char, sizeof(ip_char));
 
-                SELF_DEBUG("%s: bgp-ls: parsed local IPv6 router id attribute: addr = %s", peer_addr.c_str(), ip_char);
+                TRACE(TRACE_BGP, "%s: bgp-ls: parsed local IPv6 router id attribute: addr = %s", peer_addr.c_str(), ip_char);
                 break;
 
             case ATTR_NODE_ISIS_AREA_ID:
@@ -332,11 +332,11 @@ namespace bgp_msg {
                     memcpy(parsed_data->ls_attrs[ATTR_NODE_ISIS_AREA_ID].data(), data, len);
                 parsed_data->ls_attrs[ATTR_NODE_ISIS_AREA_ID].data()[8] = len;
 
-                SELF_DEBUG("%s: bgp-ls: parsed node ISIS area id %x (len=%d)", peer_addr.c_str(), value_32bit, len);
+                TRACE(TRACE_BGP, "%s: bgp-ls: parsed node ISIS area id %x (len=%d)", peer_addr.c_str(), value_32bit, len);
                 break;
 
             case ATTR_NODE_MT_ID:
-                SELF_DEBUG("%s: bgp-ls: parsing node MT ID attribute (len=%d)", peer_addr.c_str(), len);
+                TRACE(TRACE_BGP, "%s: bgp-ls: parsing node MT ID attribute (len=%d)", peer_addr.c_str(), len);
 
                 val_ss.str(std::string());  // Clear
 
@@ -360,8 +360,8 @@ namespace bgp_msg {
                 parsed_data->ls_attrs[ATTR_NODE_NAME].fill(0);
                 strncpy((char *)parsed_data->ls_attrs[ATTR_NODE_NAME].data(), (char *)data, len);
 
-                SELF_DEBUG("%s: bgp-ls: parsed node name attribute: name = %s", peer_addr.c_str(),
-                           parsed_data->ls_attrs[ATTR_NODE_NAME].data());
+                TRACE(TRACE_BGP, "%s: bgp-ls: parsed node name attribute: name = %s", peer_addr.c_str(),
+                                 parsed_data->ls_attrs[ATTR_NODE_NAME].data());
                 break;
 
             case ATTR_NODE_OPAQUE:
@@ -444,7 +444,7 @@ namespace bgp_msg {
                         break;
                     }
                 }
-                SELF_DEBUG("%s: bgp-ls: parsed node sr capabilities (len=%d) %s", peer_addr.c_str(), len, val_ss.str().c_str());
+                TRACE(TRACE_BGP, "%s: bgp-ls: parsed node sr capabilities (len=%d) %s", peer_addr.c_str(), len, val_ss.str().c_str());
 
                 memcpy(parsed_data->ls_attrs[ATTR_NODE_SR_CAPABILITIES].data(), val_ss.str().data(), val_ss.str().length());
                 break;
@@ -460,9 +460,9 @@ namespace bgp_msg {
                     memcpy(&value_32bit, data, len);
                     bgp::SWAP_BYTES(&value_32bit, len);
                     memcpy(parsed_data->ls_attrs[ATTR_LINK_ADMIN_GROUP].data(), &value_32bit, 4);
-                    SELF_DEBUG("%s: bgp-ls: parsed linked admin group attribute: "
-                               " 0x%x, len = %d",
-                               peer_addr.c_str(), value_32bit, len);
+                    TRACE(TRACE_BGP, "%s: bgp-ls: parsed linked admin group attribute: "
+                                     " 0x%x, len = %d",
+                                     peer_addr.c_str(), value_32bit, len);
                 }
                 break;
 
@@ -472,7 +472,7 @@ namespace bgp_msg {
                     memcpy(&value_32bit, data, len);
                     bgp::SWAP_BYTES(&value_32bit, len);
                     memcpy(parsed_data->ls_attrs[ATTR_LINK_IGP_METRIC].data(), &value_32bit, 4);
-                    SELF_DEBUG("%s: bgp-ls: parsed link IGP metric attribute: metric = %u", peer_addr.c_str(), value_32bit);
+                    TRACE(TRACE_BGP, "%s: bgp-ls: parsed link IGP metric attribute: metric = %u", peer_addr.c_str(), value_32bit);
                 }
                 break;
 
@@ -486,7 +486,7 @@ namespace bgp_msg {
                 memcpy(parsed_data->ls_attrs[ATTR_LINK_IPV4_ROUTER_ID_REMOTE].data(), data, 4);
                 inet_ntop(AF_INET, parsed_data->ls_attrs[ATTR_LINK_IPV4_ROUTER_ID_REMOTE].data(), ip_char, sizeof(ip_char));
 
-                SELF_DEBUG("%s: bgp-ls: parsed remote IPv4 router id attribute: addr = %s", peer_addr.c_str(), ip_char);
+                TRACE(TRACE_BGP, "%s: bgp-ls: parsed remote IPv4 router id attribute: addr = %s", peer_addr.c_str(), ip_char);
                 break;
 
             case ATTR_LINK_IPV6_ROUTER_ID_REMOTE:
@@ -499,7 +499,7 @@ namespace bgp_msg {
                 memcpy(parsed_data->ls_attrs[ATTR_LINK_IPV6_ROUTER_ID_REMOTE].data(), data, 16);
                 inet_ntop(AF_INET6, parsed_data->ls_attrs[ATTR_LINK_IPV6_ROUTER_ID_REMOTE].data(), ip_char, sizeof(ip_char));
 
-                SELF_DEBUG("%s: bgp-ls: parsed remote IPv6 router id attribute: addr = %s", peer_addr.c_str(), ip_char);
+                TRACE(TRACE_BGP, "%s: bgp-ls: parsed remote IPv6 router id attribute: addr = %s", peer_addr.c_str(), ip_char);
                 break;
 
             case ATTR_LINK_MAX_LINK_BW:
@@ -517,8 +517,8 @@ namespace bgp_msg {
 
                 memcpy(&value_32bit, data, 4);
                 bgp::SWAP_BYTES(&value_32bit);
-                SELF_DEBUG("%s: bgp-ls: parsed attribute maximum link bandwidth (raw=%x) %u Kbits (len=%d)",
-                           peer_addr.c_str(), value_32bit, *(int32_t *)&float_val, len);
+                TRACE(TRACE_BGP, "%s: bgp-ls: parsed attribute maximum link bandwidth (raw=%x) %u Kbits (len=%d)",
+                                 peer_addr.c_str(), value_32bit, *(int32_t *)&float_val, len);
                 break;
 
             case ATTR_LINK_MAX_RESV_BW:
@@ -532,17 +532,17 @@ namespace bgp_msg {
                 bgp::SWAP_BYTES(&float_val, len);
                 float_val = ieee_float_to_kbps(float_val);
                 memcpy(parsed_data->ls_attrs[ATTR_LINK_MAX_RESV_BW].data(), &float_val, 4);
-                SELF_DEBUG("%s: bgp-ls: parsed attribute maximum reserved bandwidth %u Kbits (len=%d)",
+                TRACE(TRACE_BGP, "%s: bgp-ls: parsed attribute maximum reserved bandwidth %u Kbits (len=%d)",
                     peer_addr.c_str(), *(uint32_t *)&float_val, len);
                 break;
 
             case ATTR_LINK_MPLS_PROTO_MASK:
-                // SELF_DEBUG("%s: bgp-ls: parsing link MPLS Protocol mask attribute", peer_ad dr.c_str());
+                // TRACE(TRACE_BGP, "%s: bgp-ls: parsing link MPLS Protocol mask attribute", peer_ad dr.c_str());
                 LOG_INFO("%s: bgp-ls: link MPLS Protocol mask attribute, not yet implemented", peer_addr.c_str());
                 break;
 
             case ATTR_LINK_PROTECTION_TYPE:
-                // SELF_DEBUG("%s: bgp-ls: parsing link protection type attribute", peer_addr.c_str());
+                // TRACE(TRACE_BGP, "%s: bgp-ls: parsing link protection type attribute", peer_addr.c_str());
                 LOG_INFO("%s: bgp-ls: link protection type attribute, not yet implemented", peer_addr.c_str());
                 break;
 
@@ -550,7 +550,7 @@ namespace bgp_msg {
                 parsed_data->ls_attrs[ATTR_LINK_NAME].fill(0);
                 strncpy((char *)parsed_data->ls_attrs[ATTR_LINK_NAME].data(), (char *)data, len);
 
-                SELF_DEBUG("%s: bgp-ls: parsing link name attribute: name = %s",
+                TRACE(TRACE_BGP, "%s: bgp-ls: parsing link name attribute: name = %s",
                     peer_addr.c_str(), parsed_data->ls_attrs[ATTR_LINK_NAME].data());
                 break;
             }
@@ -585,7 +585,7 @@ namespace bgp_msg {
                 // Parse the sid/value
                 val_ss << " " << parse_sid_value(data, len - 4);
 
-                SELF_DEBUG("%s: bgp-ls: parsed sr link adjacency segment identifier %s", peer_addr.c_str(), val_ss.str().c_str());
+                TRACE(TRACE_BGP, "%s: bgp-ls: parsed sr link adjacency segment identifier %s", peer_addr.c_str(), val_ss.str().c_str());
 
                 strncat((char *)parsed_data->ls_attrs[ATTR_LINK_ADJACENCY_SID].data(),
                         val_ss.str().c_str(),
@@ -595,7 +595,7 @@ namespace bgp_msg {
             }
 
             case ATTR_LINK_SRLG:
-                // SELF_DEBUG("%s: bgp-ls: parsing link SRLG attribute", peer_addr.c_str());
+                // TRACE(TRACE_BGP, "%s: bgp-ls: parsing link SRLG attribute", peer_addr.c_str());
                 LOG_INFO("%s: bgp-ls: link SRLG attribute, not yet implemented", peer_addr.c_str());
                 break;
 
@@ -615,8 +615,8 @@ namespace bgp_msg {
                     memcpy(&value_32bit, data, len);
                     bgp::SWAP_BYTES(&value_32bit, len);
                     memcpy(parsed_data->ls_attrs[ATTR_LINK_TE_DEF_METRIC].data(), &value_32bit, len);
-                    SELF_DEBUG("%s: bgp-ls: parsed attribute te default metric 0x%X (len=%d)", peer_addr.c_str(),
-                               value_32bit, len);
+                    TRACE(TRACE_BGP, "%s: bgp-ls: parsed attribute te default metric 0x%X (len=%d)", peer_addr.c_str(),
+                                     value_32bit, len);
                 }
 
                 break;
@@ -624,7 +624,7 @@ namespace bgp_msg {
             case ATTR_LINK_UNRESV_BW: {
                 std::stringstream   val_ss;
 
-                SELF_DEBUG("%s: bgp-ls: parsing link unreserve bw attribute (len=%d)", peer_addr.c_str(), len);
+                TRACE(TRACE_BGP, "%s: bgp-ls: parsing link unreserve bw attribute (len=%d)", peer_addr.c_str(), len);
 
                 if (len != 32) {
                     LOG_INFO("%s: bgp-ls: link unreserve bw attribute is invalid, length is %d but should be 32",
@@ -648,7 +648,7 @@ namespace bgp_msg {
                         val_ss << ", " << float_val;
                 }
 
-                SELF_DEBUG("%s: bgp-ls: parsed unresvered bandwidth: %s", peer_addr.c_str(), val_ss.str().c_str());
+                TRACE(TRACE_BGP, "%s: bgp-ls: parsed unresvered bandwidth: %s", peer_addr.c_str(), val_ss.str().c_str());
 
                 memcpy(parsed_data->ls_attrs[ATTR_LINK_UNRESV_BW].data(), val_ss.str().data(), val_ss.str().length());
 
@@ -678,8 +678,8 @@ namespace bgp_msg {
                 val_ss << " " << (int) *(data + 1) << " " << parse_sid_value( (data+4), len - 4);
 
 
-                SELF_DEBUG("%s: bgp-ls: parsed link peer node SID: %s (len=%d) %x", peer_addr.c_str(),
-                           val_ss.str().c_str(), len, (data+4));
+                TRACE(TRACE_BGP, "%s: bgp-ls: parsed link peer node SID: %s (len=%d) %x", peer_addr.c_str(),
+                                 val_ss.str().c_str(), len, (data+4));
 
                 memcpy(parsed_data->ls_attrs[ATTR_LINK_PEER_EPE_NODE_SID].data(), val_ss.str().data(), val_ss.str().length());
                 break;
@@ -693,13 +693,13 @@ namespace bgp_msg {
                 break;
 
             case ATTR_PREFIX_EXTEND_TAG:
-                // SELF_DEBUG("%s: bgp-ls: parsing prefix extended tag attribute", peer_addr.c_str());
+                // TRACE(TRACE_BGP, "%s: bgp-ls: parsing prefix extended tag attribute", peer_addr.c_str());
                 LOG_INFO("%s: bgp-ls: prefix extended tag attribute (len=%d), not yet implemented",
                          peer_addr.c_str(), len);
                 break;
 
             case ATTR_PREFIX_IGP_FLAGS:
-                // SELF_DEBUG("%s: bgp-ls: parsing prefix IGP flags attribute", peer_addr.c_str());
+                // TRACE(TRACE_BGP, "%s: bgp-ls: parsing prefix IGP flags attribute", peer_addr.c_str());
                 LOG_INFO("%s: bgp-ls: prefix IGP flags attribute, not yet implemented", peer_addr.c_str());
                 break;
 
@@ -711,12 +711,12 @@ namespace bgp_msg {
                 }
 
                 memcpy(parsed_data->ls_attrs[ATTR_PREFIX_PREFIX_METRIC].data(), &value_32bit, 4);
-                SELF_DEBUG("%s: bgp-ls: parsing prefix metric attribute: metric = %u", peer_addr.c_str(), value_32bit);
+                TRACE(TRACE_BGP, "%s: bgp-ls: parsing prefix metric attribute: metric = %u", peer_addr.c_str(), value_32bit);
                 break;
 
             case ATTR_PREFIX_ROUTE_TAG:
             {
-                SELF_DEBUG("%s: bgp-ls: parsing prefix route tag attribute (len=%d)", peer_addr.c_str(), len);
+                TRACE(TRACE_BGP, "%s: bgp-ls: parsing prefix route tag attribute (len=%d)", peer_addr.c_str(), len);
 
                 // TODO(undefined): Per RFC7752 section 3.3.3, prefix tag can be multiples, but for now we only decode the first one.
                 value_32bit = 0;
@@ -726,14 +726,14 @@ namespace bgp_msg {
                     bgp::SWAP_BYTES(&value_32bit);
 
                     memcpy(parsed_data->ls_attrs[ATTR_PREFIX_ROUTE_TAG].data(), &value_32bit, 4);
-//                    SELF_DEBUG("%s: bgp-ls: parsing prefix route tag attribute %d (len=%d)", peer_addr.c_str(),
+//                    TRACE(TRACE_BGP, "%s: bgp-ls: parsing prefix route tag attribute %d (len=%d)", peer_addr.c_str(),
 //                             value_32bit, len);
                 }
 
                 break;
             }
             case ATTR_PREFIX_OSPF_FWD_ADDR:
-                // SELF_DEBUG("%s: bgp-ls: parsing prefix OSPF forwarding address attribute", peer_addr.c_str());
+                // TRACE(TRACE_BGP, "%s: bgp-ls: parsing prefix OSPF forwarding address attribute", peer_addr.c_str());
                 LOG_INFO("%s: bgp-ls: prefix OSPF forwarding address attribute, not yet implemented", peer_addr.c_str());
                 break;
 
@@ -789,8 +789,8 @@ namespace bgp_msg {
                         parsed_data->ls_attrs[ATTR_PREFIX_SID].size() -
                                 strlen((char *)parsed_data->ls_attrs[ATTR_PREFIX_SID].data()));
 
-                SELF_DEBUG("%s: bgp-ls: parsed sr prefix segment identifier  flags = %x len=%d : %s",
-                           peer_addr.c_str(), *(data - 4), len, val_ss.str().c_str());
+                TRACE(TRACE_BGP, "%s: bgp-ls: parsed sr prefix segment identifier  flags = %x len=%d : %s",
+                                 peer_addr.c_str(), *(data - 4), len, val_ss.str().c_str());
 
                 break;
             }
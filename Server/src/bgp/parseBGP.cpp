@@ -29,6 +29,7 @@
 #include "OpenMsg.h"
 #include "UpdateMsg.h"
 #include "bgp_common.h"
+#include "Profiler.h"
 
 using namespace std;
 
@@ -85,6 +86,8 @@ parseBGP::~parseBGP() {
  * \returns True if error, false if no error.
  */
 bool parseBGP::handleUpdate(u_char *data, size_t size) {
+    PROFILE_SCOPE(BGP_HANDLE_UPDATE);
+
     bgp_msg::UpdateMsg::parsed_update_data parsed_data;
     int read_size = 0;
 
@@ -314,7 +317,7 @@ u_char parseBGP::parseBgpHeader(u_char *data, size_t size) {
                 p_entry->peer_addr, router_addr.c_str(), common_hdr.len, size);
     }
 
-    SELF_DEBUG("%s: rtr=%s: BGP hdr len = %u, type = %d", p_entry->peer_addr, router_addr.c_str(), common_hdr.len, common_hdr.type);
+    TRACE(TRACE_BGP, "%s: rtr=%s: BGP hdr len = %u, type = %d", p_entry->peer_addr, router_addr.c_str(), common_hdr.len, common_hdr.type);
 
     /*
      * Validate the message type as being allowed/accepted
@@ -332,7 +335,7 @@ u_char parseBGP::parseBgpHeader(u_char *data, size_t size) {
             break;
 
         default :
-            SELF_DEBUG("%s: rtr=%s: Unsupported BGP message type = %d", p_entry->peer_addr, router_addr.c_str(), common_hdr.type);
+            TRACE(TRACE_BGP, "%s: rtr=%s: Unsupported BGP message type = %d", p_entry->peer_addr, router_addr.c_str(), common_hdr.type);
             break;
     }
 
@@ -347,6 +350,18 @@ u_char parseBGP::parseBgpHeader(u_char *data, size_t size) {
  * \param  parsed_data          Reference to the parsed update data
  */
 void parseBGP::UpdateDB(bgp_msg::UpdateMsg::parsed_update_data &parsed_data) {
+    PROFILE_SCOPE(BGP_UPDATE_DB);
+
+    /*
+     * Count the prefixes of the peer
+     */
+    if (p_info != NULL and p_info->metrics != NULL) {
+        p_info->metrics->prefixes_added.add(parsed_data.advertised.size() + parsed_data.vpn.size() +
+                                            parsed_data.evpn.size());
+        p_info->metrics->prefixes_withdrawn.add(parsed_data.withdrawn.size() + parsed_data.vpn_withdrawn.size() +
+                                                parsed_data.evpn_withdrawn.size());
+    }
+
     /*
      * Update the path attributes
      */
@@ -390,6 +405,7 @@ void parseBGP::UpdateDB(bgp_msg::UpdateMsg::parsed_update_data &parsed_data) {
  * \param  attrs            Reference to the parsed attributes map
  */
 void parseBGP::UpdateDBAttrs(bgp_msg::UpdateMsg::parsed_attrs_map &attrs) {
+    PROFILE_SCOPE(BGP_UPDATE_DB_ATTRS);
 
     /*
      * Setup the record
@@ -447,13 +463,13 @@ void parseBGP::UpdateDBAttrs(bgp_msg::UpdateMsg::parsed_attrs_map &attrs) {
 
     else {
         // Skip adding path attributes if next hop is missing
-        SELF_DEBUG("%s: no next-hop, must be unreach; not sending attributes to message bus", p_entry->peer_addr);
+        TRACE(TRACE_BGP, "%s: no next-hop, must be unreach; not sending attributes to message bus", p_entry->peer_addr);
         bzero(base_attr.next_hop, sizeof(base_attr.next_hop));
         bzero(path_hash_id, sizeof(path_hash_id));
         return;
     }
 
-    SELF_DEBUG("%s: adding attributes to message bus", p_entry->peer_addr);
+    TRACE(TRACE_BGP, "%s: adding attributes to message bus", p_entry->peer_addr);
 
     // Update the DB entry
     mbus_ptr->update_baseAttribute(*p_entry, base_attr, mbus_ptr->BASE_ATTR_ACTION_ADD);
@@ -473,6 +489,8 @@ void parseBGP::UpdateDBAttrs(bgp_msg::UpdateMsg::parsed_attrs_map &attrs) {
  */
 void parseBGP::UpdateDBL3Vpn(bool remove, std::list<bgp::vpn_tuple> &prefixes,
                              bgp_msg::UpdateMsg::parsed_attrs_map &attrs) {
+    PROFILE_SCOPE(BGP_UPDATE_DB_VPN);
+
     vector<MsgBusInterface::obj_vpn> rib_list;
     MsgBusInterface::obj_vpn         rib_entry;
     uint32_t                         value_32bit;
@@ -550,8 +568,8 @@ void parseBGP::UpdateDBL3Vpn(bool remove, std::list<bgp::vpn_tuple> &prefixes,
         rib_entry.path_id = tuple.path_id;
         snprintf(rib_entry.labels, sizeof(rib_entry.labels), "%s", tuple.labels.c_str());
 
-        SELF_DEBUG("%s: %s vpn=%s len=%d", p_entry->peer_addr, remove ? "removing" : "adding",
-                   rib_entry.prefix, rib_entry.prefix_len);
+        TRACE(TRACE_BGP, "%s: %s vpn=%s len=%d", p_entry->peer_addr, remove ? "removing" : "adding",
+                         rib_entry.prefix, rib_entry.prefix_len);
 
         // Add entry to the list
         rib_list.insert(rib_list.end(), rib_entry);
@@ -575,6 +593,7 @@ void parseBGP::UpdateDBL3Vpn(bool remove, std::list<bgp::vpn_tuple> &prefixes,
  */
 void parseBGP::UpdateDBeVPN(bool remove, std::list<bgp::evpn_tuple> &nlris,
                            bgp_msg::UpdateMsg::parsed_attrs_map &attrs) {
+    PROFILE_SCOPE(BGP_UPDATE_DB_EVPN);
 
     vector<MsgBusInterface::obj_evpn> rib_list;
     MsgBusInterface::obj_evpn         rib_entry;
@@ -608,8 +627,8 @@ void parseBGP::UpdateDBeVPN(bool remove, std::list<bgp::evpn_tuple> &nlris,
 
         rib_entry.path_id = tuple.path_id;
 
-        SELF_DEBUG("%s: %s evpn mac=%s ip=%s", p_entry->peer_addr,
-                   remove ? "removing" : "adding", rib_entry.mac, rib_entry.ip);
+        TRACE(TRACE_BGP, "%s: %s evpn mac=%s ip=%s", p_entry->peer_addr,
+                         remove ? "removing" : "adding", rib_entry.mac, rib_entry.ip);
 
         // Add entry to the list
         rib_list.insert(rib_list.end(), rib_entry);
@@ -635,6 +654,8 @@ void parseBGP::UpdateDBeVPN(bool remove, std::list<bgp::evpn_tuple> &nlris,
  */
 void parseBGP::UpdateDBAdvPrefixes(std::list<bgp::prefix_tuple> &adv_prefixes,
                                    bgp_msg::UpdateMsg::parsed_attrs_map &attrs) {
+    PROFILE_SCOPE(BGP_UPDATE_DB_PREFIXES);
+
     vector<MsgBusInterface::obj_rib> rib_list;
     MsgBusInterface::obj_rib         rib_entry;
     uint32_t                         value_32bit;
@@ -706,7 +727,7 @@ void parseBGP::UpdateDBAdvPrefixes(std::list<bgp::prefix_tuple> &adv_prefixes,
         rib_entry.path_id = tuple.path_id;
         snprintf(rib_entry.labels, sizeof(rib_entry.labels), "%s", tuple.labels.c_str());
 
-        SELF_DEBUG("%s: Adding prefix=%s len=%d", p_entry->peer_addr, rib_entry.prefix, rib_entry.prefix_len);
+        TRACE(TRACE_BGP, "%s: Adding prefix=%s len=%d", p_entry->peer_addr, rib_entry.prefix, rib_entry.prefix_len);
 
         // Add entry to the list
         rib_list.insert(rib_list.end(), rib_entry);
@@ -728,6 +749,8 @@ void parseBGP::UpdateDBAdvPrefixes(std::list<bgp::prefix_tuple> &adv_prefixes,
  * \param  wdrawn_prefixes         Reference to the list<prefix_tuple> of withdrawn prefixes
  */
 void parseBGP::UpdateDBWdrawnPrefixes(std::list<bgp::prefix_tuple> &wdrawn_prefixes) {
+    PROFILE_SCOPE(BGP_UPDATE_DB_WITHDRAWN);
+
     vector<MsgBusInterface::obj_rib> rib_list;
     MsgBusInterface::obj_rib         rib_entry;
 
@@ -752,7 +775,7 @@ void parseBGP::UpdateDBWdrawnPrefixes(std::list<bgp::prefix_tuple> &wdrawn_prefi
         rib_entry.path_id = tuple.path_id;
         snprintf(rib_entry.labels, sizeof(rib_entry.labels), "%s", tuple.labels.c_str());
 
-        SELF_DEBUG("%s: Removing prefix=%s len=%d", p_entry->peer_addr, rib_entry.prefix, rib_entry.prefix_len);
+        TRACE(TRACE_BGP, "%s: Removing prefix=%s len=%d", p_entry->peer_addr, rib_entry.prefix, rib_entry.prefix_len);
 
         // Add entry to the list
         rib_list.insert(rib_list.end(), rib_entry);
@@ -779,11 +802,13 @@ void parseBGP::UpdateDBWdrawnPrefixes(std::list<bgp::prefix_tuple> &wdrawn_prefi
  */
 void parseBGP::UpdateDbBgpLs(bool remove, bgp_msg::UpdateMsg::parsed_data_ls ls_data,
                              bgp_msg::UpdateMsg::parsed_ls_attrs_map &ls_attrs) {
+    PROFILE_SCOPE(BGP_UPDATE_DB_LS);
+
     /*
      * Update table entry with attributes based on NLRI
      */
     if (ls_data.nodes.size() > 0) {
-        SELF_DEBUG("%s: Updating BGP-LS: Nodes %d", p_entry->peer_addr, ls_data.nodes.size());
+        TRACE(TRACE_BGP, "%s: Updating BGP-LS: Nodes %d", p_entry->peer_addr, ls_data.nodes.size());
 
         // Merge attributes to each table entry
         for (list<MsgBusInterface::obj_ls_node>::iterator it = ls_data.nodes.begin();
@@ -823,7 +848,7 @@ void parseBGP::UpdateDbBgpLs(bool remove, bgp_msg::UpdateMsg::parsed_data_ls ls_
     }
 
     if (ls_data.links.size() > 0) {
-        SELF_DEBUG("%s: Updating BGP-LS: Links %d ", p_entry->peer_addr, ls_data.links.size());
+        TRACE(TRACE_BGP, "%s: Updating BGP-LS: Links %d ", p_entry->peer_addr, ls_data.links.size());
 
         // Merge attributes to each table entry
         for (list<MsgBusInterface::obj_ls_link>::iterator it = ls_data.links.begin();
@@ -894,7 +919,7 @@ void parseBGP::UpdateDbBgpLs(bool remove, bgp_msg::UpdateMsg::parsed_data_ls ls_
     }
 
     if (ls_data.prefixes.size() > 0) {
-        SELF_DEBUG("%s: Updating BGP-LS: Prefixes %d ", p_entry->peer_addr, ls_data.prefixes.size());
+        TRACE(TRACE_BGP, "%s: Updating BGP-LS: Prefixes %d ", p_entry->peer_addr, ls_data.prefixes.size());
 
         // Merge attributes to each table entry
         for (list<MsgBusInterface::obj_ls_prefix>::iterator it = ls_data.prefixes.begin();
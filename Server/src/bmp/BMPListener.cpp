@@ -20,6 +20,7 @@
 #include <string>
 
 #include <poll.h>
+#include <linux/filter.h>
 #include <MsgBusInterface.hpp>
 
 #include "BMPListener.h"
@@ -78,8 +79,6 @@ BMPListener::~BMPListener() {
         close(sock);
     if (sockv6 > 0)
         close(sockv6);
-
-    delete cfg;
 }
 
 /**
@@ -92,7 +91,7 @@ void BMPListener::open_socket(bool ipv4, bool ipv6) {
     int on = 1;
 
     if (ipv4) {
-        if ((sock = socket(PF_INET, SOCK_STREAM, 0)) < 0) {
+        if ((sock = socket(PF_INET, SOCK_STREAM | SOCK_NONBLOCK, 0)) < 0) {
             throw "ERROR: Cannot open IPv4 socket.";
         }
 
@@ -102,6 +101,12 @@ void BMPListener::open_socket(bool ipv4, bool ipv6) {
             throw "ERROR: Failed to set IPv4 socket option SO_REUSEADDR";
         }
 
+        // Worker processes each bind their own listening socket to the same address/port
+        if (cfg->workers > 1 and setsockopt(sock, SOL_SOCKET, SO_REUSEPORT, &on, sizeof(on)) < 0) {
+            close(sock);
+            throw "ERROR: Failed to set IPv4 socket option SO_REUSEPORT";
+        }
+
         // Bind to the address/port
         if (::bind(sock, (struct sockaddr *) &svr_addr, sizeof(svr_addr)) < 0) {
             close(sock);
@@ -109,11 +114,11 @@ void BMPListener::open_socket(bool ipv4, bool ipv6) {
         }
 
         // listen for incoming connections
-        listen(sock, 10);
+        listen(sock, cfg->listen_backlog);
     }
 
     if (ipv6) {
-        if ((sockv6 = socket(AF_INET6, SOCK_STREAM, 0)) < 0) {
+        if ((sockv6 = socket(AF_INET6, SOCK_STREAM | SOCK_NONBLOCK, 0)) < 0) {
             throw "ERROR: Cannot open IPv6 socket.";
         }
 
@@ -123,6 +128,12 @@ void BMPListener::open_socket(bool ipv4, bool ipv6) {
             throw "ERROR: Failed to set IPv6 socket option SO_REUSEADDR";
         }
 
+        // Worker processes each bind their own listening socket to the same address/port
+        if (cfg->workers > 1 and setsockopt(sockv6, SOL_SOCKET, SO_REUSEPORT, &on, sizeof(on)) < 0) {
+            close(sockv6);
+            throw "ERROR: Failed to set IPv6 socket option SO_REUSEPORT";
+        }
+
         if (setsockopt(sockv6, IPPROTO_IPV6, IPV6_V6ONLY, &on, sizeof(on)) < 0) {
             close(sockv6);
             throw "ERROR: Failed to set IPv6 socket option IPV6_V6ONLY";
@@ -135,27 +146,81 @@ void BMPListener::open_socket(bool ipv4, bool ipv6) {
         }
 
         // listen for incoming connections
-        listen(sockv6, 10);
+        listen(sockv6, cfg->listen_backlog);
     }
 }
 
 /**
- * Wait and Accept new/pending connections
+ * Steer new connections to the worker listening sockets by router source address
  *
- * Will accept both IPv4 and IPv6 (if configured), but only one will be accepted
- * per poll/wait period.  Must run this method in a loop fashion to accept all
- * pending connections.
+ * \details The classic BPF program returns the index of the socket in the SO_REUSEPORT
+ *          group, which is the order the workers' listeners were opened in.  The source
+ *          address is folded into 32 bits and taken modulo the number of workers, so a
+ *          router always connects to the same worker (the kernel default hash includes
+ *          the source port).
  *
- * \param [out] c           Ref to client info - this will be updated based on accepted connection
- * \param [in]  timeout     Timeout in ms to wait for
+ * \param [in] workers  Number of worker listening sockets in the group
+ *
+ * \return false if the kernel does not support SO_ATTACH_REUSEPORT_CBPF
+ */
+bool BMPListener::attach_worker_steering(int workers) {
+    // A = (saddr ^ saddr >> 16) % workers
+    sock_filter v4_code[] = {
+        BPF_STMT(BPF_LD  | BPF_W | BPF_ABS, (uint32_t)SKF_NET_OFF + 12),
+        BPF_STMT(BPF_MISC | BPF_TAX, 0),
+        BPF_STMT(BPF_ALU | BPF_RSH | BPF_K, 16),
+        BPF_STMT(BPF_ALU | BPF_XOR | BPF_X, 0),
+        BPF_STMT(BPF_ALU | BPF_MOD | BPF_K, (uint32_t)workers),
+        BPF_STMT(BPF_RET | BPF_A, 0),
+    };
+
+    // A = saddr[0] ^ saddr[1] ^ saddr[2] ^ saddr[3], folded as above
+    sock_filter v6_code[] = {
+        BPF_STMT(BPF_LD  | BPF_W | BPF_ABS, (uint32_t)SKF_NET_OFF + 8),
+        BPF_STMT(BPF_MISC | BPF_TAX, 0),
+        BPF_STMT(BPF_LD  | BPF_W | BPF_ABS, (uint32_t)SKF_NET_OFF + 12),
+        BPF_STMT(BPF_ALU | BPF_XOR | BPF_X, 0),
+        BPF_STMT(BPF_MISC | BPF_TAX, 0),
+        BPF_STMT(BPF_LD  | BPF_W | BPF_ABS, (uint32_t)SKF_NET_OFF + 16),
+        BPF_STMT(BPF_ALU | BPF_XOR | BPF_X, 0),
+        BPF_STMT(BPF_MISC | BPF_TAX, 0),
+        BPF_STMT(BPF_LD  | BPF_W | BPF_ABS, (uint32_t)SKF_NET_OFF + 20),
+        BPF_STMT(BPF_ALU | BPF_XOR | BPF_X, 0),
+        BPF_STMT(BPF_MISC | BPF_TAX, 0),
+        BPF_STMT(BPF_ALU | BPF_RSH | BPF_K, 16),
+        BPF_STMT(BPF_ALU | BPF_XOR | BPF_X, 0),
+        BPF_STMT(BPF_ALU | BPF_MOD | BPF_K, (uint32_t)workers),
+        BPF_STMT(BPF_RET | BPF_A, 0),
+    };
+
+    sock_fprog v4_prog = { sizeof(v4_code) / sizeof(v4_code[0]), v4_code };
+    sock_fprog v6_prog = { sizeof(v6_code) / sizeof(v6_code[0]), v6_code };
+
+    if (sock > 0 and setsockopt(sock, SOL_SOCKET, SO_ATTACH_REUSEPORT_CBPF, &v4_prog, sizeof(v4_prog)) < 0) {
+        LOG_WARN("Failed to attach IPv4 worker steering program: %s", strerror(errno));
+        return false;
+    }
+
+    if (sockv6 > 0 and setsockopt(sockv6, SOL_SOCKET, SO_ATTACH_REUSEPORT_CBPF, &v6_prog, sizeof(v6_prog)) < 0) {
+        LOG_WARN("Failed to attach IPv6 worker steering program: %s", strerror(errno));
+        return false;
+    }
+
+    return true;
+}
+
+/**
+ * Wait for pending connections
  *
- * \return  True if accepted a connection, false if not (timed out waiting)
+ * \param [in] timeout     Timeout in ms to wait for
+ * \param [in] event_fd    Additional fd to wait for (e.g. thread completions), -1 for none
+ *
+ * \return  True if a connection is pending, false if not (timed out or event_fd is readable)
  */
-bool BMPListener::wait_and_accept_connection(ClientInfo &c, int timeout) {
-    pollfd pfd[4];
+bool BMPListener::wait(int timeout, int event_fd) {
+    pollfd pfd[3];
     int fds_cnt = 0;
-    int cur_sock = 0;
-    bool close_sock = false;
+    bool pending = false;
 
     if (sock > 0) {
         pfd[fds_cnt].fd = sock;
@@ -171,59 +236,71 @@ bool BMPListener::wait_and_accept_connection(ClientInfo &c, int timeout) {
         fds_cnt++;
     }
 
-    // Check if the listening socket has a new connection
-    if (poll(pfd, fds_cnt + 1, timeout)) {
-
-        for (int i = 0; i < fds_cnt; i++) {
-            if (pfd[i].revents & POLLHUP or pfd[i].revents & POLLERR) {
-                LOG_WARN("sock=%d: received POLLHUP/POLLHERR while accepting", pfd[i].fd);
-                cur_sock = pfd[i].fd;
-                close_sock = true;
-                break;
-
-            } else if (pfd[i].revents & POLLIN) {
-                cur_sock = pfd[i].fd;
-                break;
-            }
-        }
+    if (event_fd >= 0) {
+        pfd[fds_cnt].fd = event_fd;
+        pfd[fds_cnt].events = POLLIN;
+        pfd[fds_cnt].revents = 0;
+        fds_cnt++;
     }
 
-    if (cur_sock > 0) {
-        if (close_sock) {
-            if (cur_sock == sock)
-                close(sock);
-            else if (cur_sock == sockv6)
-                close(sockv6);
-        }
+    if (poll(pfd, fds_cnt, timeout) <= 0)
+        return false;
+
+    for (int i = 0; i < fds_cnt; i++) {
+        if (pfd[i].fd == event_fd)
+            continue;
 
-        else {
-            if (cur_sock == sock)  // IPv4
-                accept_connection(c, true);
+        if (pfd[i].revents & POLLHUP or pfd[i].revents & POLLERR) {
+            LOG_WARN("sock=%d: received POLLHUP/POLLHERR while accepting", pfd[i].fd);
+            close(pfd[i].fd);
 
-            else // IPv6
-                accept_connection(c, false);
-		
-	    gettimeofday(&c.startTime, NULL);	// Stores the start time for client	
+            if (pfd[i].fd == sock)
+                sock = 0;
+            else
+                sockv6 = 0;
 
-            return true;
+        } else if (pfd[i].revents & POLLIN) {
+            pending = true;
         }
     }
 
-    return false;
+    return pending;
 }
 
+/**
+ * Accept a pending connection, does not block
+ *
+ * \param [out] c           Ref to client info - this will be updated based on accepted connection
+ *
+ * \return  True if accepted a connection, false if none is pending
+ */
+bool BMPListener::accept_pending(ClientInfo &c) {
+    bool accepted = false;
+
+    if (sock > 0)
+        accepted = accept_connection(c, true);
+
+    if (not accepted and sockv6 > 0)
+        accepted = accept_connection(c, false);
 
+    if (accepted)
+        gettimeofday(&c.startTime, NULL);   // Stores the start time for client
+
+    return accepted;
+}
 
 /**
  * Accept new/pending connections
  *
- * Will accept new connections and wait if one is not currently ready.
+ * Will accept a new connection, the listening sockets are non-blocking.
  * Supports IPv4 and IPv6 sockets
  *
  * \param [out]  c       Client information reference to where the client info will be stored
  * \param [in]   isIPv4  True to indicate if IPv4, false if IPv6
+ *
+ * \return  True if accepted a connection, false if none is pending
  */
-void BMPListener::accept_connection(ClientInfo &c, bool isIPv4) {
+bool BMPListener::accept_connection(ClientInfo &c, bool isIPv4) {
     socklen_t c_addr_len = sizeof(c.c_addr);         // the client info length
     socklen_t s_addr_len = sizeof(c.s_addr);         // the client info length
     c.initRec=false;				     // To indicate INIT message not received
@@ -237,6 +314,10 @@ void BMPListener::accept_connection(ClientInfo &c, bool isIPv4) {
 
     // Accept the pending client request, or block till one exists
     if ((c.c_sock = accept(sock, (struct sockaddr *) &c.c_addr, &c_addr_len)) < 0) {
+        // Listening sockets are non-blocking, the connection may also have been reset while pending
+        if (errno == EAGAIN or errno == EWOULDBLOCK or errno == ECONNABORTED)
+            return false;
+
         string error = "Server accept connection: ";
         if (errno != EINTR)
             error += strerror(errno);
@@ -281,6 +362,8 @@ void BMPListener::accept_connection(ClientInfo &c, bool isIPv4) {
     }
     
     hashRouter(c);
+
+    return true;
 }
 
 /**
@@ -291,8 +374,18 @@ void BMPListener::accept_connection(ClientInfo &c, bool isIPv4) {
  * \return client.hash_id will be updated with the generated hash
  */
 void BMPListener::hashRouter(ClientInfo &client) {
+    hashRouter(cfg->c_hash_id, client);
+}
+
+/**
+ * Generate BMP router HASH without a listener
+ *
+ * \param [in]     c_hash_id   Collector hash ID
+ * \param [in,out] client      Reference to client info used to generate the hash.
+ */
+void BMPListener::hashRouter(const u_char *c_hash_id, ClientInfo &client) {
     string c_hash_str;
-    MsgBusInterface::hash_toStr(cfg->c_hash_id, c_hash_str);
+    MsgBusInterface::hash_toStr(c_hash_id, c_hash_str);
 
     MD5 hash;
     hash.update((unsigned char *)client.c_ip, strlen(client.c_ip));
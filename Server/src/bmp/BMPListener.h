@@ -63,18 +63,37 @@ public:
     virtual ~BMPListener();
 
     /**
-     * Wait and Accept new/pending connections
+     * Wait for pending connections
      *
-     * Will accept both IPv4 and IPv6 (if configured), but only one will be accepted
-     * per poll/wait period.  Must run this method in a loop fashion to accept all
+     * \param [in] timeout     Timeout in ms to wait for
+     * \param [in] event_fd    Additional fd to wait for (e.g. thread completions), -1 for none
+     *
+     * \return  True if a connection is pending, false if not (timed out or event_fd is readable)
+     */
+    bool wait(int timeout, int event_fd);
+
+    /**
+     * Accept a pending connection, does not block
+     *
+     * Will accept both IPv4 and IPv6 (if configured).  Call in a loop to drain all
      * pending connections.
      *
      * \param [out] c           Ref to client info - this will be updated based on accepted connection
-     * \param [in]  timeout     Timeout in ms to wait for
      *
-     * \return  True if accepted a connection, false if not (timed out waiting)
+     * \return  True if accepted a connection, false if none is pending
+     */
+    bool accept_pending(ClientInfo &c);
+
+    /**
+     * Steer new connections to the worker listening sockets by router source address
+     *
+     * \details Call on one listener after all workers' listeners are open (config workers > 1)
+     *
+     * \param [in] workers  Number of worker listening sockets in the group
+     *
+     * \return false if the kernel does not support SO_ATTACH_REUSEPORT_CBPF
      */
-    bool wait_and_accept_connection(ClientInfo &c, int timeout);
+    bool attach_worker_steering(int workers);
 
 /**
      * Generate BMP router HASH
@@ -85,6 +104,14 @@ public:
      */
     void hashRouter(ClientInfo &client);
 
+    /**
+     * Generate BMP router HASH without a listener, used for streams not read from a connection
+     *
+     * \param [in]     c_hash_id   Collector hash ID
+     * \param [in,out] client      Reference to client info used to generate the hash.
+     */
+    static void hashRouter(const u_char *c_hash_id, ClientInfo &client);
+
     // Debug methods
     void enableDebug();
     void disableDebug();
@@ -108,13 +135,15 @@ private:
     /**
      * Accept new/pending connections
      *
-     * Will accept new connections and wait if one is not currently ready.
+     * Will accept a new connection, the listening sockets are non-blocking.
      * Supports IPv4 and IPv6 sockets
      *
      * \param [out]  c  Client information reference to where the client info will be stored
      * \param [in]   isIPv4  True to indicate if IPv4, false if IPv6
+     *
+     * \return  True if accepted a connection, false if none is pending
      */
-    void accept_connection(ClientInfo &c, bool isIPv4);
+    bool accept_connection(ClientInfo &c, bool isIPv4);
 
 };
 
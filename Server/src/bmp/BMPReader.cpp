@@ -18,6 +18,9 @@
 #include <cstdlib>
 #include <string>
 #include <cerrno>
+#include <cinttypes>
+#include <poll.h>
+#include <sys/ioctl.h>
 
 #include "BMPListener.h"
 #include "BMPReader.h"
@@ -48,6 +51,27 @@ BMPReader::BMPReader(Logger *logPtr, Config *config) {
     
     hasPrevRIBdumpTime = false;
     maxRIBdumpRate = 0;
+    baselineDone = false;
+
+    handoffRequested = false;
+    handoffParked = false;
+    handoffInputDone = false;
+    handoffReady = false;
+
+    parsePool = NULL;
+    parseQueued = NULL;
+    parseMbus = NULL;
+    parseClient = NULL;
+    dispatchSeq = 0;
+    commitSeq = 0;
+    committing = false;
+    parseError = NULL;
+
+    latency = NULL;
+    metrics = NULL;
+    streamOffset = 0;
+    peerCount = 0;
+    endOfRIBPeers = 0;
 }
 
 /**
@@ -70,8 +94,46 @@ BMPReader::~BMPReader() {
  * \throw (char const *str) message indicate error
  */
 void BMPReader::readerThreadLoop(bool &run, BMPListener::ClientInfo *client, MsgBusInterface *mbus_ptr) {
+    int read_fd = client->pipe_sock > 0 ? client->pipe_sock : client->c_sock;
+    pollfd pfd;
+
+    parseMbus = mbus_ptr;
+    parseClient = client;
+
     while (run) {
 
+        if (handoffRequested) {
+            // At a message boundary, only read messages that are complete in the pipe
+            handoffParked = true;
+
+            if (not handoffMsgReady(read_fd)) {
+                if (handoffInputDone) {
+                    if (parsePool != NULL)
+                        waitParsed();
+
+                    exportHandoff(read_fd);
+
+                    // The new collector continues from here, everything parsed must be sent first
+                    mbus_ptr->flush();
+                    handoffReady = true;
+                    break;
+                }
+
+                usleep(1000);
+                continue;
+            }
+
+        } else {
+            // Wait for data so that a handoff request is seen while the router is quiet
+            pfd.fd = read_fd;
+            pfd.events = POLLIN | POLLHUP | POLLERR;
+            pfd.revents = 0;
+
+            // A parse error of the pool closes the connection even if the router is quiet
+            if (poll(&pfd, 1, 100) <= 0 and parseError.load() == NULL)
+                continue;
+        }
+
         try {
             if (not ReadIncomingMsg(client, mbus_ptr))
                 break;
@@ -81,6 +143,17 @@ void BMPReader::readerThreadLoop(bool &run, BMPListener::ClientInfo *client, Msg
             break;
         }
     }
+
+    // Everything parsed by the pool is sent before the message bus is closed
+    if (parsePool != NULL) {
+        waitParsed();
+
+        for (std::map<std::string, ParsePool::strand *>::iterator it = parseStrands.begin();
+                it != parseStrands.end(); ++it)
+            parsePool->removeStrand(it->second);
+
+        parseStrands.clear();
+    }
 }
 
 /**
@@ -124,9 +197,47 @@ bool BMPReader::ReadIncomingMsg(BMPListener::ClientInfo *client, MsgBusInterface
     // Setup the router record table object
     memcpy(r_object.ip_addr, client->c_ip, sizeof(client->c_ip));
 
+    uint64_t read_time = 0;
+    uint64_t frame_time = 0;
+
     try {
+        if (parsePool != NULL)
+            checkParsed();
+
         bmp_type = pBMP->handleMessage(read_fd);
 
+        if (metrics != NULL)
+            metrics->addMessage(bmp_type);
+
+        if (latency != NULL) {
+            frame_time = RouterLatency::now();
+            read_time = latency->getReadTime(streamOffset + pBMP->bmp_read_len);
+            latency->record(RouterLatency::STAGE_QUEUE, read_time, frame_time);
+
+            if (bmp_type == parseBMP::TYPE_ROUTE_MON)
+                latency->recordLag(p_entry.timestamp_secs, p_entry.timestamp_us);
+        }
+
+        if (parsePool != NULL) {
+            if (bmp_type == parseBMP::TYPE_ROUTE_MON) {
+                pBMP->bufferBMPMessage(read_fd);
+                postRouteMon(pBMP, p_entry, r_object, read_time, frame_time);
+
+                streamOffset += pBMP->bmp_read_len;
+                delete pBMP;
+                return true;
+            }
+
+            // Other messages change the router or the peer info, the messages before are sent first
+            waitParsed();
+            checkParsed();
+        }
+
+        if (latency != NULL) {
+            mbus_ptr->msgReadTime = read_time;
+            mbus_ptr->msgParsedTime = 0;
+        }
+
         /*
          * Now that we have parsed the BMP message...
          *  add record to the database
@@ -145,9 +256,12 @@ bool BMPReader::ReadIncomingMsg(BMPListener::ClientInfo *client, MsgBusInterface
             if (bmp_type != parseBMP::TYPE_PEER_UP)
                 mbus_ptr->update_Peer(p_entry, NULL, NULL, mbus_ptr->PEER_ACTION_FIRST);     // add the peer entry
 
-            if (not peer_info_map[peer_info_key].using_2_octet_asn and p_entry.isTwoOctet) {
-                peer_info_map[peer_info_key].using_2_octet_asn = true;
+            peer_info &info = getPeerInfo(peer_info_key, p_entry);
+            if (not info.using_2_octet_asn and p_entry.isTwoOctet) {
+                info.using_2_octet_asn = true;
             }
+
+            peerCount = peer_info_map.size();
         }
 
         /*
@@ -239,7 +353,7 @@ bool BMPReader::ReadIncomingMsg(BMPListener::ClientInfo *client, MsgBusInterface
 
                     // Read info TLV data
                     if (((int)pBMP->bmp_data_len - read) > 0) {
-                        SELF_DEBUG("%s: PEER UP has info data, parsing %d bytes", p_entry.peer_addr, pBMP->bmp_data_len - read);
+                        TRACE(TRACE_BMP, "%s: PEER UP has info data, parsing %d bytes", p_entry.peer_addr, pBMP->bmp_data_len - read);
                         pBMP->parsePeerUpInfo(pBMP->bmp_data + read, (int)pBMP->bmp_data_len - read);
                     }
 
@@ -266,21 +380,15 @@ bool BMPReader::ReadIncomingMsg(BMPListener::ClientInfo *client, MsgBusInterface
                     pBGP->enableDebug();
 
                 pBGP->handleUpdate(pBMP->bmp_data, pBMP->bmp_data_len);
-   		
-		string str(reinterpret_cast<char*>(client->hash_id), 16);  //storing the client hash in a string 
-		if(client->initRec && cfg->router_baseline_time.find(str) == cfg->router_baseline_time.end())	
-                //check if client has received init message and Baseline time is not already calculated
-		{
-		    peer_info_map_iter it = peer_info_map.begin();
-		    while (it != peer_info_map.end() && it->second.endOfRIB)
-		        ++it;
-
-		    if (it == peer_info_map.end() || checkRIBdumpRate(p_entry.timestamp_secs,mbus_ptr->ribSeq)) {  //End-Of-RIBs are received for all peers.
-		        timeval now;
-		        gettimeofday(&now, NULL);
-		        cfg->router_baseline_time[str] = 1.2 * (now.tv_sec - client->startTime.tv_sec);  //20% buffer for baseline time 
-		    }		
-		}
+
+                //check if client has received init message and Baseline time is not already calculated for this session
+                if (client->initRec && !baselineDone) {
+                    peer_info_map_iter it = peer_info_map.begin();
+                    while (it != peer_info_map.end() && it->second.endOfRIB)
+                        ++it;
+
+                    checkBaseline(client, mbus_ptr, p_entry.timestamp_secs, it == peer_info_map.end());
+                }
                 delete pBGP;
 
                 break;
@@ -327,7 +435,15 @@ bool BMPReader::ReadIncomingMsg(BMPListener::ClientInfo *client, MsgBusInterface
     } catch (char const *str) {
         // Mark the router as disconnected and update the error to be a local disconnect (no term message received)
         LOG_INFO("%s: Caught: %s", client->c_ip, str);
+
+        if (metrics != NULL)
+            metrics->parse_errors.add();
+
+        if (parsePool != NULL)
+            waitParsed();
+
         disconnect(client, mbus_ptr, parseBMP::TERM_REASON_OPENBMP_CONN_ERR, str);
+        mbus_ptr->end_Message();
 
         delete pBMP;                    // Make sure to free the resource
         throw str;
@@ -336,12 +452,51 @@ bool BMPReader::ReadIncomingMsg(BMPListener::ClientInfo *client, MsgBusInterface
     // Send BMP RAW packet data
     mbus_ptr->send_bmp_raw(router_hash_id, p_entry, pBMP->bmp_packet, pBMP->bmp_packet_len);
 
+    if (latency != NULL) {
+        mbus_ptr->msgParsedTime = RouterLatency::now();
+        latency->record(RouterLatency::STAGE_PARSE, frame_time, mbus_ptr->msgParsedTime);
+    }
+
+    mbus_ptr->end_Message();
+
+    streamOffset += pBMP->bmp_read_len;
+
     // Free the bmp parser
     delete pBMP;
 
     return rval;
 }
 
+/**
+ * Record the RIB dump baseline of the router once all peers sent End-Of-RIB or the
+ *      RIB dump rate dropped
+ *
+ * \param [in] client       Client information pointer
+ * \param [in] mbus_ptr     Message bus the prefixes were sent to
+ * \param [in] timeStamp    Time of the route monitoring message
+ * \param [in] allEndOfRIB  All peers sent End-Of-RIB
+ */
+void BMPReader::checkBaseline(BMPListener::ClientInfo *client, MsgBusInterface *mbus_ptr, uint32_t timeStamp,
+                              bool allEndOfRIB) {
+    if (not allEndOfRIB and not checkRIBdumpRate(timeStamp, mbus_ptr->ribSeq))
+        return;
+
+    timeval now;
+    gettimeofday(&now, NULL);
+    baselineDone = true;
+
+    // 20% buffer for baseline time, updated every session so that it follows the dump size
+    float dump_secs = 1.2 * (now.tv_sec - client->startTime.tv_sec);
+    if (dump_secs < 1)
+        dump_secs = 1;
+
+    LOG_INFO("%s: RIB dump baseline is %.0f seconds, %" PRIu64 " prefixes", client->c_ip,
+             dump_secs, mbus_ptr->ribSeq);
+
+    if (!cfg->router_baseline.set(client->hash_id, dump_secs, mbus_ptr->ribSeq))
+        LOG_WARN("%s: Failed to save router baseline to %s", client->c_ip, cfg->baseline_file.c_str());
+}
+
 bool BMPReader::checkRIBdumpRate(uint32_t timeStamp, int ribSeq) {
     int time, currRate;                                  
 
@@ -435,6 +590,361 @@ void BMPReader::hashRouter(BMPListener::ClientInfo *client,MsgBusInterface::obj_
 
 
 
+/**
+ * Append a length prefixed string to the handoff peer info
+ */
+static void appendString(std::string &out, const std::string &str) {
+    uint32_t len = str.size();
+    out.append((char *)&len, sizeof(len));
+    out.append(str);
+}
+
+/**
+ * Read a length prefixed string from the handoff peer info
+ *
+ * \return false if the data is truncated
+ */
+static bool readString(const std::string &in, size_t &pos, std::string &str) {
+    uint32_t len;
+
+    if (pos + sizeof(len) > in.size())
+        return false;
+
+    memcpy(&len, in.data() + pos, sizeof(len));
+    pos += sizeof(len);
+
+    if (pos + len > in.size())
+        return false;
+
+    str.assign(in, pos, len);
+    pos += len;
+    return true;
+}
+
+void BMPReader::requestHandoff() {
+    handoffRequested = true;
+}
+
+bool BMPReader::isHandoffParked() {
+    return handoffParked;
+}
+
+void BMPReader::setHandoffInputDone() {
+    handoffInputDone = true;
+}
+
+bool BMPReader::isHandoffReady() {
+    return handoffReady;
+}
+
+void BMPReader::getHandoffState(std::string &peers, std::string &data) {
+    peers.swap(handoffPeers);
+    data.swap(handoffData);
+}
+
+/**
+ * Check if a complete BMP message is in the pipe, used while handing off
+ *
+ * \param [in] read_fd      Pipe socket
+ *
+ * \return true if a complete BMP v3 message can be read without blocking
+ */
+bool BMPReader::handoffMsgReady(int read_fd) {
+    int avail = 0;
+    u_char hdr[1 + BMP_HDRv3_LEN];              // version + v3 header
+
+    if (ioctl(read_fd, FIONREAD, &avail) < 0 or avail < (int)sizeof(hdr))
+        return false;
+
+    if (recv(read_fd, hdr, sizeof(hdr), MSG_PEEK | MSG_DONTWAIT) != sizeof(hdr))
+        return false;
+
+    // Older versions are left in the pipe and parsed by the new collector
+    if (hdr[0] != 3)
+        return false;
+
+    uint32_t len;
+    memcpy(&len, hdr + 1, sizeof(len));
+
+    return (uint32_t)avail >= ntohl(len);
+}
+
+/**
+ * Export the peer info and the bytes left in the pipe
+ *
+ * \param [in] read_fd      Pipe socket
+ */
+void BMPReader::exportHandoff(int read_fd) {
+    char buf[8192];
+    ssize_t len;
+
+    while ((len = recv(read_fd, buf, sizeof(buf), MSG_DONTWAIT)) > 0)
+        handoffData.append(buf, len);
+
+    for (peer_info_map_iter it = peer_info_map.begin(); it != peer_info_map.end(); ++it) {
+        std::string add_path;
+        it->second.add_path_capability.exportState(add_path);
+
+        u_char flags = (it->second.sent_four_octet_asn ? 0x01 : 0) |
+                       (it->second.recv_four_octet_asn ? 0x02 : 0) |
+                       (it->second.using_2_octet_asn   ? 0x04 : 0) |
+                       (it->second.endOfRIB            ? 0x08 : 0);
+
+        appendString(handoffPeers, it->first);
+        handoffPeers.append((char *)&flags, 1);
+        appendString(handoffPeers, it->second.peer_group);
+        appendString(handoffPeers, add_path);
+    }
+
+    TRACE(TRACE_BMP, "Exported %zu peers and %zu unparsed bytes for handoff", peer_info_map.size(), handoffData.size());
+}
+
+/**
+ * Import peer info exported by a collector handoff, call before readerThreadLoop
+ *
+ * \param [in] peers        Exported peer info
+ */
+void BMPReader::importPeerInfo(const std::string &peers) {
+    size_t pos = 0;
+
+    while (pos < peers.size()) {
+        std::string key, group, add_path;
+
+        if (not readString(peers, pos, key) or pos >= peers.size())
+            break;
+
+        u_char flags = peers[pos++];
+
+        if (not readString(peers, pos, group) or not readString(peers, pos, add_path))
+            break;
+
+        peer_info &info = peer_info_map[key];
+        info.sent_four_octet_asn = flags & 0x01;
+        info.recv_four_octet_asn = flags & 0x02;
+        info.using_2_octet_asn   = flags & 0x04;
+        info.endOfRIB            = flags & 0x08;
+        info.peer_group = group;
+        info.add_path_capability.importState(add_path);
+    }
+
+    // The RIB dump was done before the handoff
+    baselineDone = true;
+}
+
+/**
+ * Parse route monitoring messages with a parse pool, call before readerThreadLoop
+ *
+ * \param [in] pool         Collector wide parse pool
+ * \param [in] queued       Message bus stage of the pipeline, NULL if not enabled
+ */
+void BMPReader::enableParsePool(ParsePool *pool, MsgBusQueued *queued) {
+    parsePool = pool;
+    parseQueued = queued;
+}
+
+/**
+ * Time the messages of the router, call before readerThreadLoop
+ *
+ * \param [in] routerLatency    Latency of the router, socket reads are marked by the I/O thread
+ */
+void BMPReader::enableLatency(RouterLatency *routerLatency) {
+    latency = routerLatency;
+}
+
+/**
+ * Count the messages of the router and of its peers, call before readerThreadLoop
+ *
+ * \param [in] routerMetrics    Counters of the router, must outlive the reader
+ */
+void BMPReader::enableMetrics(RouterMetrics *routerMetrics) {
+    metrics = routerMetrics;
+}
+
+/**
+ * Get the persistent info of a peer, its counters are added on first use
+ *
+ * \param [in] key          Peer info key
+ * \param [in] p_entry      Peer
+ */
+BMPReader::peer_info &BMPReader::getPeerInfo(const std::string &key, const MsgBusInterface::obj_bgp_peer &p_entry) {
+    peer_info &info = peer_info_map[key];
+
+    if (metrics != NULL and info.metrics == NULL)
+        info.metrics = metrics->addPeer(p_entry.peer_addr, p_entry.peer_rd);
+
+    return info;
+}
+
+/**
+ * Post a route monitoring message to the strand of its peer
+ *
+ * \param [in] pBMP         BMP parser with the message buffered
+ * \param [in] p_entry      Peer of the message
+ * \param [in] r_object     Router of the message
+ * \param [in] readTime     Socket read time of the message, zero if not measured
+ * \param [in] frameTime    Time the BMP header was parsed, zero if not measured
+ */
+void BMPReader::postRouteMon(parseBMP *pBMP, MsgBusInterface::obj_bgp_peer &p_entry,
+                             MsgBusInterface::obj_router &r_object, uint64_t readTime, uint64_t frameTime) {
+    string peer_info_key = p_entry.peer_addr;
+    peer_info_key += p_entry.peer_rd;
+
+    route_mon_job *job = new route_mon_job();
+    job->p_entry = p_entry;
+    job->r_object = r_object;
+    job->info = &getPeerInfo(peer_info_key, p_entry);
+    job->data.assign(pBMP->bmp_data, pBMP->bmp_data + pBMP->bmp_data_len);
+    job->packet.assign(pBMP->bmp_packet, pBMP->bmp_packet + pBMP->bmp_packet_len);
+    job->batch = new MsgBusBatch(logger);
+    job->batch->msgReadTime = readTime;
+    job->endOfRIB = false;
+    job->frameTime = frameTime;
+    job->error = NULL;
+
+    peerCount = peer_info_map.size();
+
+    ParsePool::strand *&strand = parseStrands[peer_info_key];
+    if (strand == NULL)
+        strand = parsePool->addStrand();
+
+    {
+        std::unique_lock<std::mutex> lock(commitMutex);
+
+        // Limits the memory used by a router that is read faster than it is parsed
+        commitCond.wait(lock, [this] { return dispatchSeq - commitSeq < (uint64_t)cfg->parse_pool_max_pending; });
+        job->seq = dispatchSeq++;
+    }
+
+    parsePool->post(strand, [this, job] { parseRouteMon(job); });
+}
+
+/**
+ * Parse a route monitoring message, runs on the strand of the peer
+ */
+void BMPReader::parseRouteMon(route_mon_job *job) {
+    MsgBusBatch *batch = job->batch;
+
+    batch->update_Router(job->r_object, batch->ROUTER_ACTION_FIRST);
+
+    memcpy(job->p_entry.router_hash_id, job->r_object.hash_id, sizeof(job->r_object.hash_id));
+    batch->update_Peer(job->p_entry, NULL, NULL, batch->PEER_ACTION_FIRST);
+
+    if (not job->info->using_2_octet_asn and job->p_entry.isTwoOctet)
+        job->info->using_2_octet_asn = true;
+
+    bool endOfRIB = job->info->endOfRIB;
+
+    parseBGP *pBGP = new parseBGP(logger, batch, &job->p_entry, (char *)job->r_object.ip_addr, job->info);
+
+    if (cfg->debug_bgp)
+        pBGP->enableDebug();
+
+    try {
+        pBGP->handleUpdate(job->data.data(), job->data.size());
+
+    } catch (char const *str) {
+        LOG_NOTICE("%s: rtr=%s: Failed to parse the route monitoring message: %s", job->p_entry.peer_addr,
+                   (char *)job->r_object.ip_addr, str);
+
+        if (job->info->metrics != NULL)
+            job->info->metrics->parse_errors.add();
+
+        job->error = str;
+    }
+
+    delete pBGP;
+
+    job->endOfRIB = not endOfRIB and job->info->endOfRIB;
+
+    batch->send_bmp_raw(job->r_object.hash_id, job->p_entry, job->packet.data(), job->packet.size());
+
+    if (latency != NULL) {
+        batch->msgParsedTime = RouterLatency::now();
+        latency->record(RouterLatency::STAGE_PARSE, job->frameTime, batch->msgParsedTime);
+    }
+
+    std::vector<u_char>().swap(job->data);
+    std::vector<u_char>().swap(job->packet);
+
+    commitRouteMon(job);
+}
+
+/**
+ * Send parsed messages in order, the worker that parsed the next message sends it
+ */
+void BMPReader::commitRouteMon(route_mon_job *job) {
+    std::unique_lock<std::mutex> lock(commitMutex);
+
+    parsedJobs[job->seq] = job;
+
+    // Another worker is sending, it sends this message once the messages before are sent
+    if (committing)
+        return;
+
+    committing = true;
+
+    while (parsedJobs.size() and parsedJobs.begin()->first == commitSeq) {
+        route_mon_job *next = parsedJobs.begin()->second;
+        parsedJobs.erase(parsedJobs.begin());
+
+        lock.unlock();
+
+        // The reader closes the connection on the first error, the messages from it on are dropped
+        if (next->error != NULL and parseError.load() == NULL)
+            parseError = next->error;
+
+        if (parseError.load() != NULL) {
+            delete next->batch;
+
+        } else if (parseQueued != NULL) {
+            parseQueued->add_Batch(next->batch);
+
+        } else {
+            parseMbus->msgReadTime = next->batch->msgReadTime;
+            parseMbus->msgParsedTime = next->batch->msgParsedTime;
+
+            next->batch->replay(parseMbus);
+            parseMbus->end_Message();
+            delete next->batch;
+        }
+
+        if (next->endOfRIB)
+            endOfRIBPeers++;
+
+        //check if client has received init message and Baseline time is not already calculated for this session
+        if (parseClient->initRec && !baselineDone && parseError.load() == NULL)
+            checkBaseline(parseClient, parseMbus, next->p_entry.timestamp_secs, endOfRIBPeers >= peerCount);
+
+        delete next;
+
+        lock.lock();
+        commitSeq++;
+        commitCond.notify_all();
+    }
+
+    committing = false;
+    commitCond.notify_all();
+}
+
+/**
+ * Wait until all messages posted to the pool are sent
+ */
+void BMPReader::waitParsed() {
+    std::unique_lock<std::mutex> lock(commitMutex);
+
+    commitCond.wait(lock, [this] { return commitSeq == dispatchSeq and not committing; });
+}
+
+/**
+ * Throw the parse error of a message parsed by the pool
+ */
+void BMPReader::checkParsed() {
+    char const *str = parseError.load();
+
+    if (str != NULL)
+        throw str;
+}
+
 /*
  * Enable/Disable debug
  */
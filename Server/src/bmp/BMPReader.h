@@ -14,11 +14,22 @@
 #include "BMPReader.h"
 #include "AddPathDataContainer.h"
 #include "MsgBusInterface.hpp"
+#include "MsgBusBatch.h"
+#include "MsgBusQueued.h"
+#include "ParsePool.h"
+#include "RouterLatency.h"
+#include "RouterMetrics.h"
 #include "Logger.h"
 #include "Config.h"
 
 #include <map>
 #include <memory>
+#include <atomic>
+#include <mutex>
+#include <condition_variable>
+#include <vector>
+
+class parseBMP;
 
 /**
  * \class   BMPReader
@@ -41,6 +52,7 @@ public:
         AddPathDataContainer add_path_capability;               ///< Stores data about Add Path capability
         string peer_group;                                      ///< Peer group name of defined
 	bool endOfRIB;						///< Indicates if End-Of-RIB marker is received
+        PeerMetrics *metrics;                                   ///< Counters of the peer, NULL if not counted
     };
 
 
@@ -111,6 +123,64 @@ public:
 
     void hashRouter(BMPListener::ClientInfo *client, MsgBusInterface::obj_router &r_entry);
 
+    /**
+     * Request the reader to stop at a BMP message boundary for a collector handoff
+     *
+     * \details The reader parks at the next message boundary (isHandoffParked).  The
+     *          caller then stops reading the router socket and flushes its buffer to
+     *          the pipe (setHandoffInputDone).  The reader parses all complete messages
+     *          left in the pipe, exports the rest and the peer info and stops
+     *          (isHandoffReady).
+     */
+    void requestHandoff();
+    bool isHandoffParked();
+    void setHandoffInputDone();
+    bool isHandoffReady();
+
+    /**
+     * Get the handoff state, valid once isHandoffReady() is true
+     *
+     * \param [out] peers       Exported peer info
+     * \param [out] data        Bytes read from the pipe that have not been parsed
+     */
+    void getHandoffState(std::string &peers, std::string &data);
+
+    /**
+     * Import peer info exported by a collector handoff, call before readerThreadLoop
+     *
+     * \param [in] peers        Exported peer info
+     */
+    void importPeerInfo(const std::string &peers);
+
+    /**
+     * Parse route monitoring messages with a parse pool, call before readerThreadLoop
+     *
+     * \details Each peer has a strand in the pool.  Parsed messages are sent to the
+     *          message bus in the order they were read.  Other messages are parsed by
+     *          the reader thread once the pool parsed the messages before them.
+     *
+     * \param [in] pool         Collector wide parse pool
+     * \param [in] queued       Message bus stage of the pipeline, NULL if not enabled
+     */
+    void enableParsePool(ParsePool *pool, MsgBusQueued *queued);
+
+    /**
+     * Time the messages of the router, call before readerThreadLoop
+     *
+     * \details The queue and parse stages and the lag are recorded, msgReadTime and
+     *          msgParsedTime of the message bus are set so the sink can record the rest.
+     *
+     * \param [in] routerLatency    Latency of the router, socket reads are marked by the I/O thread
+     */
+    void enableLatency(RouterLatency *routerLatency);
+
+    /**
+     * Count the messages of the router and of its peers, call before readerThreadLoop
+     *
+     * \param [in] routerMetrics    Counters of the router, must outlive the reader
+     */
+    void enableMetrics(RouterMetrics *routerMetrics);
+
     // Debug methods
     void enableDebug();
     void disableDebug();
@@ -129,12 +199,130 @@ private:
     int32_t 	prevRIBdumpTime;            ///< Stores the time the previous message was received
     int32_t 	maxRIBdumpRate;             ///< Stores the maximum RIB dump rate
     int32_t     belowThresholdInitTime;     ///< Stores the time when the RIB dump rate has dropped below threshold
+    bool        baselineDone;               ///< True if the RIB dump baseline was recorded for this session
+
+    std::atomic<bool> handoffRequested;     ///< Stop at the next message boundary
+    std::atomic<bool> handoffParked;        ///< Reader is at a message boundary
+    std::atomic<bool> handoffInputDone;     ///< No more data will be written to the pipe
+    std::atomic<bool> handoffReady;         ///< Handoff state exported, reader stopped
+    std::string handoffPeers;               ///< Exported peer info
+    std::string handoffData;                ///< Unparsed bytes left in the pipe
+
+    /*
+     * Route monitoring message parsed by the parse pool
+     */
+    struct route_mon_job {
+        uint64_t seq;                           ///< Order the message was read in
+        MsgBusInterface::obj_bgp_peer p_entry;  ///< Peer of the message
+        MsgBusInterface::obj_router r_object;   ///< Router hash id and address
+        peer_info *info;                        ///< Persistent peer info, only used by the peer strand
+        std::vector<u_char> data;               ///< BGP message
+        std::vector<u_char> packet;             ///< Raw BMP message
+        MsgBusBatch *batch;                     ///< Objects added by parsing the message
+        bool endOfRIB;                          ///< End-Of-RIB of the peer was received by this message
+        uint64_t frameTime;                     ///< Time the BMP header was parsed, zero if not measured
+        char const *error;                      ///< Parse error, NULL if the message was parsed
+    };
+
+    ParsePool   *parsePool;                 ///< Parse pool, NULL to parse in the reader thread
+    MsgBusQueued *parseQueued;              ///< Message bus stage parsed messages are added to, NULL for none
+    MsgBusInterface *parseMbus;             ///< Message bus parsed messages are added to
+    BMPListener::ClientInfo *parseClient;   ///< Client of the parsed messages
+    std::map<std::string, ParsePool::strand *> parseStrands;   ///< Strand of each peer, key is the peer info key
+
+    std::mutex  commitMutex;
+    std::condition_variable commitCond;     ///< Signaled when parsed messages are sent
+    uint64_t    dispatchSeq;                ///< Sequence of the next message posted to the pool
+    uint64_t    commitSeq;                  ///< Sequence of the next message to send
+    bool        committing;                 ///< A worker is sending parsed messages
+    std::map<uint64_t, route_mon_job *> parsedJobs;     ///< Parsed messages waiting for the messages before them
+    std::atomic<size_t> peerCount;          ///< Peers in the peer info map
+    size_t      endOfRIBPeers;              ///< Peers with End-Of-RIB sent, only used by the sending worker
+    std::atomic<char const *> parseError;   ///< First message that failed to parse, the messages after it are not sent
+
+    RouterLatency *latency;                 ///< Latency of the router, NULL if not measured
+    RouterMetrics *metrics;                 ///< Counters of the router, NULL if not counted
+    uint64_t    streamOffset;               ///< Bytes of the messages read so far
+
     /**
      * Persistent peer info map, Key is the peer_hash_id.
      */
     std::map<std::string, peer_info> peer_info_map;
     typedef std::map<std::string, peer_info>::iterator peer_info_map_iter;
 
+    /**
+     * Check if a complete BMP message is in the pipe, used while handing off
+     *
+     * \param [in] read_fd      Pipe socket
+     *
+     * \return true if a complete BMP v3 message can be read without blocking
+     */
+    bool handoffMsgReady(int read_fd);
+
+    /**
+     * Export the peer info and the bytes left in the pipe
+     *
+     * \param [in] read_fd      Pipe socket
+     */
+    void exportHandoff(int read_fd);
+
+    /**
+     * Record the RIB dump baseline of the router once all peers sent End-Of-RIB or the
+     *      RIB dump rate dropped
+     *
+     * \param [in] client       Client information pointer
+     * \param [in] mbus_ptr     Message bus the prefixes were sent to
+     * \param [in] timeStamp    Time of the route monitoring message
+     * \param [in] allEndOfRIB  All peers sent End-Of-RIB
+     */
+    void checkBaseline(BMPListener::ClientInfo *client, MsgBusInterface *mbus_ptr, uint32_t timeStamp,
+                       bool allEndOfRIB);
+
+    /**
+     * Post a route monitoring message to the strand of its peer
+     *
+     * \details Waits while the router has max_pending messages in the pool.
+     *
+     * \param [in] pBMP         BMP parser with the message buffered
+     * \param [in] p_entry      Peer of the message
+     * \param [in] r_object     Router of the message
+     * \param [in] readTime     Socket read time of the message, zero if not measured
+     * \param [in] frameTime    Time the BMP header was parsed, zero if not measured
+     */
+    void postRouteMon(parseBMP *pBMP, MsgBusInterface::obj_bgp_peer &p_entry, MsgBusInterface::obj_router &r_object,
+                      uint64_t readTime, uint64_t frameTime);
+
+    /**
+     * Parse a route monitoring message, runs on the strand of the peer
+     */
+    void parseRouteMon(route_mon_job *job);
+
+    /**
+     * Get the persistent info of a peer, its counters are added on first use
+     *
+     * \param [in] key          Peer info key
+     * \param [in] p_entry      Peer
+     */
+    peer_info &getPeerInfo(const std::string &key, const MsgBusInterface::obj_bgp_peer &p_entry);
+
+    /**
+     * Send parsed messages in order, the worker that parsed the next message sends it
+     */
+    void commitRouteMon(route_mon_job *job);
+
+    /**
+     * Wait until all messages posted to the pool are sent
+     */
+    void waitParsed();
+
+    /**
+     * Throw the parse error of a message parsed by the pool, the reader closes the
+     *      connection as it does on a message it failed to parse itself
+     *
+     * \throw (char const *str) parse error
+     */
+    void checkParsed();
+
 };
 
 #endif /* BMPReader_H_ */
@@ -9,6 +9,7 @@
 
 #include "parseBMP.h"
 #include "MsgBusInterface.hpp"
+#include "Profiler.h"
 
 #include <cstdio>
 #include <cstdlib>
@@ -42,6 +43,7 @@ parseBMP::parseBMP(Logger *logPtr, MsgBusInterface::obj_bgp_peer *peer_entry) {
     bzero(bmp_data, sizeof(bmp_data));
 
     bmp_packet_len = 0;
+    bmp_read_len = 0;
     bzero(bmp_packet, sizeof(bmp_packet));
 
     // Set the passed storage for the router entry items.
@@ -59,6 +61,9 @@ parseBMP::~parseBMP() {
 ssize_t parseBMP::Recv(int sockfd, void *buf, size_t len, int flags) {
     ssize_t read = recv(sockfd, buf, len, flags);
 
+    if (read > 0 and not (flags & MSG_PEEK))
+        bmp_read_len += read;
+
     if (read > 0)
         if ((bmp_packet_len + read) < BMP_PACKET_BUF_SIZE) {
             memcpy(&bmp_packet[bmp_packet_len], buf, read);
@@ -80,6 +85,8 @@ ssize_t parseBMP::Recv(int sockfd, void *buf, size_t len, int flags) {
  * \throws (const char *) on error.   String will detail error message.
  */
 char parseBMP::handleMessage(int sock) {
+    PROFILE_SCOPE(BMP_HANDLE_MESSAGE);
+
     unsigned char ver;
     ssize_t bytes_read;
 
@@ -101,13 +108,13 @@ char parseBMP::handleMessage(int sock) {
 
     // Handle the older versions
     else if (ver == 1 || ver == 2) {
-        SELF_DEBUG("Older BMP version of %d, consider upgrading the router to support BMPv3", ver);
+        TRACE(TRACE_BMP, "Older BMP version of %d, consider upgrading the router to support BMPv3", ver);
         parseBMPv2(sock);
 
     } else
         throw "ERROR: Unsupported BMP message version";
 
-    SELF_DEBUG("BMP version = %d\n", ver);
+    TRACE(TRACE_BMP, "BMP version = %d\n", ver);
 
     return bmp_type;
 }
@@ -125,13 +132,13 @@ void parseBMP::parseBMPv2(int sock) {
     ssize_t i = 0;
     char buf[256] = {0};
 
-    SELF_DEBUG("parseBMP: sock=%d: Reading %d bytes", sock, BMP_HDRv1v2_LEN);
+    TRACE(TRACE_BMP, "parseBMP: sock=%d: Reading %d bytes", sock, BMP_HDRv1v2_LEN);
 
     bmp_len = 0;
 
     if ((i = Recv(sock, &c_hdr, BMP_HDRv1v2_LEN, MSG_WAITALL))
             != BMP_HDRv1v2_LEN) {
-        SELF_DEBUG("sock=%d: Couldn't read all bytes, read %zd bytes",
+        TRACE(TRACE_BMP, "sock=%d: Couldn't read all bytes, read %zd bytes",
                 sock, i);
         throw "ERROR: Cannot read v1/v2 BMP common header.";
     }
@@ -139,7 +146,7 @@ void parseBMP::parseBMPv2(int sock) {
     bmp_type = c_hdr.type;
     switch (c_hdr.type) {
         case 0: // Route monitoring
-            SELF_DEBUG("sock=%d : BMP MSG : route monitor", sock);
+            TRACE(TRACE_BMP, "sock=%d : BMP MSG : route monitor", sock);
 
             // Get the length of the remaining message by reading the BGP length
             if ((i=Recv(sock, buf, 18, MSG_PEEK | MSG_WAITALL)) == 18) {
@@ -155,7 +162,7 @@ void parseBMP::parseBMPv2(int sock) {
             break;
 
         case 1: // Statistics Report
-            SELF_DEBUG("sock=%d : BMP MSG : stats report", sock);
+            TRACE(TRACE_BMP, "sock=%d : BMP MSG : stats report", sock);
             LOG_INFO("sock=%d : BMP MSG : stats report", sock);
             break;
 
@@ -181,24 +188,24 @@ void parseBMP::parseBMPv2(int sock) {
                 throw "Failed to read BMP peer down reason";
             }
 
-            SELF_DEBUG("sock=%d : BMP MSG : peer down", sock);
+            TRACE(TRACE_BMP, "sock=%d : BMP MSG : peer down", sock);
             break;
 
         case 3: // Peer Up notification
             LOG_ERR("sock=%d: Peer UP not supported with older BMP version since no one has implemented it", sock);
 
-            SELF_DEBUG("sock=%d : BMP MSG : peer up", sock);
+            TRACE(TRACE_BMP, "sock=%d : BMP MSG : peer up", sock);
             throw "ERROR: Will need to add support for peer up if it's really used.";
             break;
     }
 
-    SELF_DEBUG("sock=%d : Peer Type is %d", sock, c_hdr.peer_type);
+    TRACE(TRACE_BMP, "sock=%d : Peer Type is %d", sock, c_hdr.peer_type);
 
     if (c_hdr.peer_flags & 0x80) { // V flag of 1 means this is IPv6
         p_entry->isIPv4 = false;
         inet_ntop(AF_INET6, c_hdr.peer_addr, peer_addr, sizeof(peer_addr));
 
-        SELF_DEBUG("sock=%d : Peer address is IPv6", sock);
+        TRACE(TRACE_BMP, "sock=%d : Peer address is IPv6", sock);
 
     } else {
         p_entry->isIPv4 = true;
@@ -206,13 +213,13 @@ void parseBMP::parseBMPv2(int sock) {
                 c_hdr.peer_addr[12], c_hdr.peer_addr[13], c_hdr.peer_addr[14],
                 c_hdr.peer_addr[15]);
 
-        SELF_DEBUG("sock=%d : Peer address is IPv4", sock);
+        TRACE(TRACE_BMP, "sock=%d : Peer address is IPv4", sock);
     }
 
     if (c_hdr.peer_flags & 0x40) { // L flag of 1 means this is Loc-RIP and not Adj-RIB-In
-        SELF_DEBUG("sock=%d : Msg is for Loc-RIB", sock);
+        TRACE(TRACE_BMP, "sock=%d : Msg is for Loc-RIB", sock);
     } else {
-        SELF_DEBUG("sock=%d : Msg is for Adj-RIB-In", sock);
+        TRACE(TRACE_BMP, "sock=%d : Msg is for Adj-RIB-In", sock);
     }
 
     // convert the BMP byte messages to human readable strings
@@ -269,11 +276,11 @@ void parseBMP::parseBMPv2(int sock) {
         // Global Instance
         p_entry->isL3VPN = 0;
 
-    SELF_DEBUG("sock=%d : Peer Address = %s", sock, peer_addr);
-    SELF_DEBUG("sock=%d : Peer AS = (%x-%x)%x:%x", sock,
+    TRACE(TRACE_BMP, "sock=%d : Peer Address = %s", sock, peer_addr);
+    TRACE(TRACE_BMP, "sock=%d : Peer AS = (%x-%x)%x:%x", sock,
             c_hdr.peer_as[0], c_hdr.peer_as[1], c_hdr.peer_as[2],
             c_hdr.peer_as[3]);
-    SELF_DEBUG("sock=%d : Peer RD = %s", sock, peer_rd);
+    TRACE(TRACE_BMP, "sock=%d : Peer RD = %s", sock, peer_rd);
 }
 
 /**
@@ -288,7 +295,7 @@ void parseBMP::parseBMPv2(int sock) {
 void parseBMP::parseBMPv3(int sock) {
     struct common_hdr_v3 c_hdr = { 0 };
 
-    SELF_DEBUG("Parsing BMP version 3 (rfc7854)");
+    TRACE(TRACE_BMP, "Parsing BMP version 3 (rfc7854)");
     if ((Recv(sock, &c_hdr, BMP_HDRv3_LEN, MSG_WAITALL)) != BMP_HDRv3_LEN) {
         throw "ERROR: Cannot read v3 BMP common header.";
     }
@@ -296,7 +303,7 @@ void parseBMP::parseBMPv3(int sock) {
     // Change to host order
     bgp::SWAP_BYTES(&c_hdr.len);
 
-    SELF_DEBUG("BMP v3: type = %x len=%d", c_hdr.type, c_hdr.len);
+    TRACE(TRACE_BMP, "BMP v3: type = %x len=%d", c_hdr.type, c_hdr.len);
 
     // Adjust length to remove common header size
     c_hdr.len -= 1 + BMP_HDRv3_LEN;
@@ -310,24 +317,24 @@ void parseBMP::parseBMPv3(int sock) {
 
     switch (c_hdr.type) {
         case TYPE_ROUTE_MON: // Route monitoring
-            SELF_DEBUG("BMP MSG : route monitor");
+            TRACE(TRACE_BMP, "BMP MSG : route monitor");
             parsePeerHdr(sock);
             break;
 
         case TYPE_STATS_REPORT: // Statistics Report
-            SELF_DEBUG("BMP MSG : stats report");
+            TRACE(TRACE_BMP, "BMP MSG : stats report");
             parsePeerHdr(sock);
             break;
 
         case TYPE_PEER_UP: // Peer Up notification
         {
-            SELF_DEBUG("BMP MSG : peer up");
+            TRACE(TRACE_BMP, "BMP MSG : peer up");
             parsePeerHdr(sock);
 
             break;
         }
         case TYPE_PEER_DOWN: // Peer down notification
-            SELF_DEBUG("BMP MSG : peer down");
+            TRACE(TRACE_BMP, "BMP MSG : peer down");
             parsePeerHdr(sock);
             break;
 
@@ -375,20 +382,20 @@ void parseBMP::parsePeerFlags(u_char peer_type, u_char peer_flags) {
             }
 
             if (peer_flags & 0x10) { // O flag of 1 means this is Adj-Rib-Out
-                SELF_DEBUG("Msg is for Adj-RIB-Out");
+                TRACE(TRACE_BMP, "Msg is for Adj-RIB-Out");
                 p_entry->isAdjIn = false;
             }
 
             if (peer_flags & 0x20) { // A flag of 1 means 2-octet encoding
-                SELF_DEBUG("Msg is 2-octet encoded");
+                TRACE(TRACE_BMP, "Msg is 2-octet encoded");
                 p_entry->isTwoOctet = true;
             }
 
             if (peer_flags & 0x40) { // L flag of 1 means this is post-policy of Adj-RIB-In
-                SELF_DEBUG("Msg is for POST-POLICY Adj-RIB-In");
+                TRACE(TRACE_BMP, "Msg is for POST-POLICY Adj-RIB-In");
                 p_entry->isPrePolicy = false;
             } else {
-                SELF_DEBUG("Msg is for PRE-POLICY Adj-RIB-In");
+                TRACE(TRACE_BMP, "Msg is for PRE-POLICY Adj-RIB-In");
                 p_entry->isPrePolicy = true;
                 p_entry->isAdjIn = true;
             }
@@ -426,8 +433,8 @@ void parseBMP::parsePeerHdr(int sock) {
     // Adjust the common header length to remove the peer header (as it's been read)
     bmp_len -= BMP_PEER_HDR_LEN;
 
-    SELF_DEBUG("parsePeerHdr: sock=%d : Peer Type is %d", sock,
-               p_hdr.peer_type);
+    TRACE(TRACE_BMP, "parsePeerHdr: sock=%d : Peer Type is %d", sock,
+                     p_hdr.peer_type);
 
     parsePeerFlags(p_hdr.peer_type, p_hdr.peer_flags);
 
@@ -435,15 +442,15 @@ void parseBMP::parsePeerHdr(int sock) {
         snprintf(peer_addr, sizeof(peer_addr), "%d.%d.%d.%d",
                  p_hdr.peer_addr[12], p_hdr.peer_addr[13], p_hdr.peer_addr[14],
                  p_hdr.peer_addr[15]);
-        SELF_DEBUG("sock=%d : Peer address is IPv4 %s", sock,
-                   peer_addr);
+        TRACE(TRACE_BMP, "sock=%d : Peer address is IPv4 %s", sock,
+                         peer_addr);
 
     }
     else {
         inet_ntop(AF_INET6, p_hdr.peer_addr, peer_addr, sizeof(peer_addr));
 
-        SELF_DEBUG("sock=%d : Peer address is IPv6 %s", sock,
-                   peer_addr);
+        TRACE(TRACE_BMP, "sock=%d : Peer address is IPv6 %s", sock,
+                         peer_addr);
     }
 
 
@@ -453,11 +460,11 @@ void parseBMP::parsePeerHdr(int sock) {
              p_hdr.peer_as[2] << 8 | p_hdr.peer_as[3]);
 
     inet_ntop(AF_INET, p_hdr.peer_bgp_id, peer_bgp_id, sizeof(peer_bgp_id));
-    SELF_DEBUG("sock=%d : Peer BGP-ID %x.%x.%x.%x (%s)", sock, p_hdr.peer_bgp_id[0],
-               p_hdr.peer_bgp_id[1],p_hdr.peer_bgp_id[2],p_hdr.peer_bgp_id[3], peer_bgp_id);
+    TRACE(TRACE_BMP, "sock=%d : Peer BGP-ID %x.%x.%x.%x (%s)", sock, p_hdr.peer_bgp_id[0],
+                     p_hdr.peer_bgp_id[1],p_hdr.peer_bgp_id[2],p_hdr.peer_bgp_id[3], peer_bgp_id);
 
     // Format based on the type of RD
-    SELF_DEBUG("sock=%d : Peer RD type = %d %d", sock, p_hdr.peer_dist_id[0], p_hdr.peer_dist_id[1]);
+    TRACE(TRACE_BMP, "sock=%d : Peer RD type = %d %d", sock, p_hdr.peer_dist_id[0], p_hdr.peer_dist_id[1]);
     switch (p_hdr.peer_dist_id[1]) {
         case 1: // admin = 4bytes (IP address), assign number = 2bytes
             snprintf(peer_rd, sizeof(peer_rd), "%d.%d.%d.%d:%d",
@@ -509,11 +516,11 @@ void parseBMP::parsePeerHdr(int sock) {
     }
 
 
-    SELF_DEBUG("sock=%d : Peer Address = %s", sock, peer_addr);
-    SELF_DEBUG("sock=%d : Peer AS = (%x-%x)%x:%x", sock,
+    TRACE(TRACE_BMP, "sock=%d : Peer Address = %s", sock, peer_addr);
+    TRACE(TRACE_BMP, "sock=%d : Peer AS = (%x-%x)%x:%x", sock,
                 p_hdr.peer_as[0], p_hdr.peer_as[1], p_hdr.peer_as[2],
                 p_hdr.peer_as[3]);
-    SELF_DEBUG("sock=%d : Peer RD = %s", sock, peer_rd);
+    TRACE(TRACE_BMP, "sock=%d : Peer RD = %s", sock, peer_rd);
 }
 
 /**
@@ -568,7 +575,7 @@ void parseBMP::bufferBMPMessage(int sock) {
         throw "BMP message length is too large for buffer, invalid BMP sender";
     }
 
-    SELF_DEBUG("sock=%d: Buffering %d from socket", sock, bmp_len);
+    TRACE(TRACE_BMP, "sock=%d: Buffering %d from socket", sock, bmp_len);
     if ((bmp_data_len=Recv(sock, bmp_data, bmp_len, MSG_WAITALL)) != bmp_len) {
          LOG_ERR("sock=%d: Couldn't read all %d bytes into buffer",
                  sock, bmp_len);
@@ -606,7 +613,7 @@ void parseBMP::parsePeerUpInfo(u_char *data, int len) {
 
         bufPtr += BMP_INFO_TLV_HDR_LEN;                // Move pointer past the info header
 
-        SELF_DEBUG("Peer info message type %hu and length %hu parsed", info.type, info.len);
+        TRACE(TRACE_BMP, "Peer info message type %hu and length %hu parsed", info.type, info.len);
 
         if (info.len > 0) {
             infoLen = sizeof(infoBuf) < info.len ? sizeof(infoBuf) : info.len;
@@ -664,11 +671,11 @@ bool parseBMP::parsePeerUpEventHdr(int sock, MsgBusInterface::obj_peer_up_event
         snprintf(up_event.local_ip, sizeof(up_event.local_ip), "%d.%d.%d.%d",
                     local_addr[12], local_addr[13], local_addr[14],
                     local_addr[15]);
-        SELF_DEBUG("%s : Peer UP local address is IPv4 %s", peer_addr, up_event.local_ip);
+        TRACE(TRACE_BMP, "%s : Peer UP local address is IPv4 %s", peer_addr, up_event.local_ip);
 
     } else if (isParseGood) {
         inet_ntop(AF_INET6, local_addr, up_event.local_ip, sizeof(up_event.local_ip));
-        SELF_DEBUG("%s : Peer UP local address is IPv6 %s", peer_addr, up_event.local_ip);
+        TRACE(TRACE_BMP, "%s : Peer UP local address is IPv6 %s", peer_addr, up_event.local_ip);
     }
 
     // Get the local port
@@ -730,7 +737,7 @@ bool parseBMP::handleStatsReport(int sock, MsgBusInterface::obj_stats_report &st
     bgp::SWAP_BYTES(b, 4);
     memcpy((void*) &stats_cnt, (void*) b, 4);
 
-    SELF_DEBUG("sock = %d : STATS REPORT Count: %u (%d %d %d %d)",
+    TRACE(TRACE_BMP, "sock = %d : STATS REPORT Count: %u (%d %d %d %d)",
                 sock, stats_cnt, b[0], b[1], b[2], b[3]);
 
     // Vars used per counter object
@@ -751,7 +758,7 @@ bool parseBMP::handleStatsReport(int sock, MsgBusInterface::obj_stats_report &st
         bgp::SWAP_BYTES(&stat_type);
         bgp::SWAP_BYTES(&stat_len);
 
-        SELF_DEBUG("sock=%d STATS: %lu : TYPE = %u LEN = %u", sock,
+        TRACE(TRACE_BMP, "sock=%d STATS: %lu : TYPE = %u LEN = %u", sock,
                     i, stat_type, stat_len);
 
         // check if this is a 32 bit number  (default)
@@ -802,23 +809,23 @@ bool parseBMP::handleStatsReport(int sock, MsgBusInterface::obj_stats_report &st
                         if (stat_len == 8) {
                             memcpy((void*)&value64bit, (void *)b, 8);
 
-                            SELF_DEBUG("%s: sock=%d: stat type %d length of %d value of %lu is not yet implemented",
+                            TRACE(TRACE_BMP, "%s: sock=%d: stat type %d length of %d value of %lu is not yet implemented",
                                     p_entry->peer_addr, sock, stat_type, stat_len, value64bit);
                         } else {
                             memcpy((void*)&value32bit, (void *)b, 4);
 
-                            SELF_DEBUG("%s: sock=%d: stat type %d length of %d value of %lu is not yet implemented",
+                            TRACE(TRACE_BMP, "%s: sock=%d: stat type %d length of %d value of %lu is not yet implemented",
                                      p_entry->peer_addr, sock, stat_type, stat_len, value32bit);
                         }
                     }
                 }
 
-                SELF_DEBUG("VALUE is %u",
+                TRACE(TRACE_BMP, "VALUE is %u",
                             b[3] << 24 | b[2] << 16 | b[1] << 8 | b[0]);
             }
 
         } else { // stats len not expected, we need to skip it.
-            SELF_DEBUG("sock=%d : skipping stats report '%u' because length of '%u' is not expected.",
+            TRACE(TRACE_BMP, "sock=%d : skipping stats report '%u' because length of '%u' is not expected.",
                         sock, stat_type, stat_len);
 
             while (stat_len-- > 0)
@@ -165,6 +165,8 @@ public:
     u_char      bmp_packet[BMP_PACKET_BUF_SIZE + 1];
     size_t      bmp_packet_len;
 
+    size_t      bmp_read_len;              ///< Bytes of the message read from the socket, peeked bytes are not counted
+
     /**
      * Constructor for class
      *
@@ -8,14 +8,20 @@
  */
 
 #include <sys/socket.h>
+#include <sys/eventfd.h>
+#include <sys/syscall.h>
 
 #include <cstdlib>
 #include <cstring>
+#include <algorithm>
 #include <thread>
 #include <unistd.h>
 
 #include "client_thread.h"
 #include "BMPReader.h"
+#include "MsgBusNull.h"
+#include "MsgBusCounting.h"
+#include "Profiler.h"
 #include "Logger.h"
 
 
@@ -23,6 +29,56 @@
 #include <poll.h>
 
 
+ThreadCompletionQueue::ThreadCompletionQueue() {
+    if ((efd = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC)) < 0)
+        throw "ERROR: Cannot create thread completion eventfd";
+}
+
+ThreadCompletionQueue::~ThreadCompletionQueue() {
+    close(efd);
+}
+
+void ThreadCompletionQueue::push(ThreadMgmt *thr) {
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        ended.push_back(thr);
+    }
+
+    uint64_t one = 1;
+    write(efd, &one, sizeof(one));
+}
+
+void ThreadCompletionQueue::take(std::vector<ThreadMgmt *> &threads) {
+    // Clear the event first, a push after this sets it again
+    uint64_t count;
+    read(efd, &count, sizeof(count));
+
+    std::lock_guard<std::mutex> lock(mutex);
+    threads.insert(threads.end(), ended.begin(), ended.end());
+    ended.clear();
+}
+
+int ThreadCompletionQueue::getFd() {
+    return efd;
+}
+
+/**
+ * Delete the null or counting sink of the router, the counting sink logs its counters
+ *
+ * @param cInfo     Client thread info, sink is set to NULL
+ */
+static void deleteSink(ClientThreadInfo *cInfo) {
+    if (cInfo->sink == NULL)
+        return;
+
+    MsgBusCounting *counting = dynamic_cast<MsgBusCounting *>(cInfo->sink);
+    if (counting != NULL)
+        counting->logCounters(cInfo->client->c_ip);
+
+    delete cInfo->sink;
+    cInfo->sink = NULL;
+}
+
 /**
  * Client thread cancel
  * @param arg       Pointer to ClientThreadInfo struct
@@ -48,13 +104,20 @@ void ClientThread_cancel(void *arg) {
         close(cInfo->client->pipe_sock);
         close(cInfo->bmp_write_end_sock);
 
-        if (cInfo->bmp_reader_thread->joinable())
+        if (cInfo->bmp_reader_thread != NULL and cInfo->bmp_reader_thread->joinable())
             cInfo->bmp_reader_thread->join();
 
         if (cInfo->bmp_reader_thread != NULL) {
             delete cInfo->bmp_reader_thread;
             cInfo->bmp_reader_thread = NULL;
         }
+
+        if (cInfo->queued != NULL) {
+            delete cInfo->queued;
+            cInfo->queued = NULL;
+        }
+
+        deleteSink(cInfo);
 #ifndef REDIS_ENABLED
         if (cInfo->mbus != NULL) {
             delete cInfo->mbus;
@@ -62,6 +125,11 @@ void ClientThread_cancel(void *arg) {
         }
 #endif
     }
+
+    if (cInfo->record != NULL) {
+        cInfo->recorder->closeStream(cInfo->record);
+        cInfo->record = NULL;
+    }
 }
 
 /**
@@ -82,13 +150,28 @@ void *ClientThread(void *arg) {
 #ifndef REDIS_ENABLED
     cInfo.mbus = NULL;
 #endif
+    cInfo.queued = NULL;
+    cInfo.sink = NULL;
+    cInfo.recorder = thr->recorder;
+    cInfo.record = NULL;
     cInfo.client = &thr->client;
     cInfo.log = thr->log;
+    cInfo.bmp_reader_thread = NULL;
     cInfo.closing = false;
 
-    int sock_fds[2];
+    int sock_fds[2] = { -1, -1 };
     pollfd pfd;
-    unsigned char *sock_buf = NULL;
+    RouterBuffer *sock_buf = NULL;
+#ifndef REDIS_ENABLED
+    bool handoff_done = false;                  // Connection was handed off to another collector
+#endif
+
+    /*
+     * The reader thread uses these until it is joined, after the try block below or by the
+     *    cancel cleanup.  Declared before the cleanup is pushed so they outlive the join.
+     */
+    BMPReader rBMP(logger, thr->cfg);
+    bool bmp_run = true;
 
     /*
      * Setup the cleanup routine for when the thread is canceled.
@@ -96,19 +179,67 @@ void *ClientThread(void *arg) {
      */
     pthread_cleanup_push(ClientThread_cancel, &cInfo);
 
+    thr->io_tid = syscall(SYS_gettid);
+
+    // Message bus threads started by this thread stay on the router node
+    if (thr->affinity != NULL and not thr->affinity->bindNode(thr->placement))
+        LOG_WARN("%s: Cannot place router threads on NUMA node %d", cInfo.client->c_ip,
+                 thr->affinity->getNodeId(thr->placement));
+
     try {
+        // The null and counting sinks replace the message bus of the router
+        if (thr->cfg->sink_type == SINK_NULL) {
+            cInfo.sink = new MsgBusNull();
+
+        } else if (thr->cfg->sink_type == SINK_COUNTING) {
+            cInfo.sink = new MsgBusCounting(logger, thr->cfg->sink_hash);
+
+        } else {
 #ifndef REDIS_ENABLED
-        // connect to message bus
-        cInfo.mbus = new msgBus_kafka(logger, thr->cfg, thr->cfg->c_hash_id);
+            // connect to message bus
+            cInfo.mbus = new msgBus_kafka(logger, thr->cfg, thr->cfg->c_hash_id);
+
+            if (thr->cfg->debug_msgbus)
+                cInfo.mbus->enableDebug();
+#else
+            // connect to redis
+            cInfo.redis = std::make_shared<MsgBusImpl_redis>(logger, thr->cfg, thr->redis, cInfo.client);
+
+            /*
+             * Tables of a handed off router are current, the router does not send the RIB again.
+             *    A router closed to resync sends the RIB of tables that were not reset, the
+             *    enabled table was reset when it was enabled.
+             */
+            if (not thr->handed_off and not cInfo.redis->IsResyncReconnect())
+                cInfo.redis->ResetAllTables();
+#endif
+        }
+
+        if (thr->latency) {
+            rBMP.enableLatency(thr->latency.get());
 
-        if (thr->cfg->debug_msgbus)
-            cInfo.mbus->enableDebug();
+#ifndef REDIS_ENABLED
+            if (cInfo.mbus != NULL)
+                cInfo.mbus->enableLatency(thr->latency);
 #else
-        // connect to redis
-        cInfo.redis = std::make_shared<MsgBusImpl_redis>(logger, thr->cfg, cInfo.client);
-        cInfo.redis->ResetAllTables();
+            if (cInfo.redis)
+                cInfo.redis->EnableLatency(thr->latency);
+#endif
+        }
+
+        if (thr->metrics) {
+            rBMP.enableMetrics(thr->metrics.get());
+
+#ifndef REDIS_ENABLED
+            if (cInfo.mbus != NULL)
+                cInfo.mbus->enableMetrics(thr->metrics.get());
 #endif
-        BMPReader rBMP(logger, thr->cfg);
+        }
+
+        if (thr->handed_off) {
+            rBMP.importPeerInfo(thr->handoff_peers);
+            thr->handoff_peers.clear();
+        }
         LOG_INFO("Thread started to monitor BMP from router %s using socket %d buffer in bytes = %u",
                 cInfo.client->c_ip, cInfo.client->c_sock, thr->cfg->bmp_buffer_size);
 
@@ -120,90 +251,181 @@ void *ClientThread(void *arg) {
         /*
          * Create and start the reader thread to monitor the pipe fd (read end)
          */
-        bool bmp_run = true;
+        MsgBusInterface *mbus_ptr = cInfo.sink;
 #ifndef REDIS_ENABLED
-        //cInfo.bmp_reader_thread = new std::thread([&] {rBMP.readerThreadLoop(bmp_run,cInfo.client,
-        cInfo.bmp_reader_thread = new std::thread(&BMPReader::readerThreadLoop, &rBMP, std::ref(bmp_run), cInfo.client,
-                                                                             (MsgBusInterface *)cInfo.mbus );
+        if (mbus_ptr == NULL)
+            mbus_ptr = (MsgBusInterface *)cInfo.mbus;
 #else
-        cInfo.bmp_reader_thread = new std::thread(&BMPReader::readerThreadLoop, &rBMP, std::ref(bmp_run), cInfo.client,
-                                                                             (MsgBusInterface *)cInfo.redis.get());
+        if (mbus_ptr == NULL)
+            mbus_ptr = (MsgBusInterface *)cInfo.redis.get();
 #endif
-        // Variables to handle circular buffer
-        sock_buf = new unsigned char[thr->cfg->bmp_buffer_size];
+        // The message bus stage inherits the node affinity, the I/O thread is pinned after
+        if (thr->cfg->pipeline_enabled) {
+            cInfo.queued = new MsgBusQueued(logger, mbus_ptr, thr->cfg->pipeline_queue_size);
+            mbus_ptr = cInfo.queued;
+        }
+
+        if (thr->parse_pool != NULL)
+            rBMP.enableParsePool(thr->parse_pool, cInfo.queued);
+
+        cInfo.bmp_reader_thread = new std::thread([&rBMP, &bmp_run, &cInfo, thr, mbus_ptr] {
+            thr->parse_tid = syscall(SYS_gettid);
+            Profiler::setThreadName(std::string("reader ") + cInfo.client->c_ip);
+
+            if (thr->affinity != NULL)
+                thr->affinity->pinCpu(thr->placement.parse_cpu);
+
+            rBMP.readerThreadLoop(bmp_run, cInfo.client, mbus_ptr);
+            thr->parse_tid = 0;
+        });
+
+        if (thr->affinity != NULL and not thr->affinity->pinCpu(thr->placement.io_cpu))
+            LOG_WARN("%s: Cannot pin router I/O thread to CPU %d", cInfo.client->c_ip, thr->placement.io_cpu);
+
+        // Buffer grows in chunks from the collector wide pool
+        sock_buf = new RouterBuffer(thr->buffer_pool, thr->cfg->bmp_buffer_size,
+                                    thr->affinity != NULL ? thr->affinity->getNodeId(thr->placement) : -1);
+        size_t spill_peak = 0;
+
+        if (thr->cfg->bmp_spill_dir.size()) {
+            try {
+                sock_buf->enableSpill(thr->cfg->bmp_spill_dir, thr->cfg->bmp_spill_quota);
+            } catch (char const *str) {
+                LOG_WARN("%s: %s in %s, buffer spill disabled", cInfo.client->c_ip, str, thr->cfg->bmp_spill_dir.c_str());
+            }
+        }
+        // Bytes received from the router are recorded as read, before they are parsed
+        if (cInfo.recorder != NULL)
+            cInfo.record = cInfo.recorder->openStream(cInfo.client->c_ip);
+
         int bytes_read = 0;
-        int write_buf_pos = 0;
-        int read_buf_pos = 0;
-        bool wrap_state = false;
-        unsigned char *sock_buf_read_ptr = sock_buf;
-        unsigned char *sock_buf_write_ptr = sock_buf;
+        unsigned char *buf_ptr;
+        size_t buf_len;
+        bool read_socket = true;
+        uint64_t stream_bytes = 0;                  // Bytes read from the router, for the latency read marks
+
+        // Bytes the previous collector read from the router but did not parse go first
+        if (thr->handed_off and thr->handoff_data.size()) {
+            if (not sock_buf->append((const unsigned char *)thr->handoff_data.data(), thr->handoff_data.size()))
+                throw "handoff data is larger than the buffer";
+
+            stream_bytes = thr->handoff_data.size();
+            if (thr->latency)
+                thr->latency->markRead(stream_bytes);
+
+            std::string().swap(thr->handoff_data);
+        }
 
         /*
          * monitor and buffer the client socket
          */
         while (bmp_run) {
 
-            if ((wrap_state and (write_buf_pos + 1) < read_buf_pos) or
-                    (not wrap_state and write_buf_pos < thr->cfg->bmp_buffer_size)) {
+#ifdef REDIS_ENABLED
+            /*
+             * A table the router feeds was enabled at runtime, close the session so that the
+             *    router reconnects and sends the full RIB again.
+             */
+            if (cInfo.redis and cInfo.redis->ResyncRequested()) {
+                LOG_INFO("%s: Closing connection to resync redis tables", cInfo.client->c_ip);
+                cInfo.redis->MarkResyncReconnect();
+
+                close(sock_fds[0]);
+                close(sock_fds[1]);
+                close(cInfo.client->c_sock);
+
+                bmp_run = false;
+                break;
+            }
+#endif
+
+            /*
+             * Collector handoff, stop the router at a BMP message boundary.  The socket is read
+             *    until the reader is at a boundary, then the buffer is flushed to the reader.
+             */
+            int handoff = thr->handoff_state.load();
+            if (handoff != HANDOFF_NONE) {
+                if (handoff == HANDOFF_DONE or handoff == HANDOFF_FAILED) {
+                    if (handoff == HANDOFF_DONE) {
+                        LOG_INFO("%s: Connection handed off to the new collector", cInfo.client->c_ip);
+#ifndef REDIS_ENABLED
+                        handoff_done = true;
+#endif
+                    }
+
+                    close(sock_fds[0]);
+                    close(sock_fds[1]);
+                    close(cInfo.client->c_sock);
+
+                    bmp_run = false;
+                    break;
+                }
+
+                if (handoff == HANDOFF_READY) {
+                    usleep(1000);
+                    continue;
+                }
+
+                rBMP.requestHandoff();
+
+                if (rBMP.isHandoffReady()) {
+                    rBMP.getHandoffState(thr->handoff_peers, thr->handoff_data);
+                    thr->handoff_state.compare_exchange_strong(handoff, HANDOFF_READY);
+                    continue;
+                }
+
+                read_socket = not rBMP.isHandoffParked();
+
+                if (not read_socket and sock_buf->size() == 0) {
+                    rBMP.setHandoffInputDone();
+                    usleep(1000);
+                }
+            }
+
+            if (read_socket) {
 
                 pfd.fd = cInfo.client->c_sock;
                 pfd.events = POLLIN | POLLHUP | POLLERR;
                 pfd.revents = 0;
 
-                // Attempt to read from socket
+                // Attempt to read from socket, a chunk is only taken from the pool once data is ready
                 if (poll(&pfd, 1, 5)) {
-                    if (pfd.revents & POLLHUP or pfd.revents & POLLERR) {
+                    bool paused = false;
+
+                    if (pfd.revents & POLLHUP or pfd.revents & POLLERR)
                         bytes_read = 0;                     // Indicate to close the connection
 
-                    } else {
-                            if (not wrap_state)     // write is ahead of read in terms of buffer pointer
-                                bytes_read = read(cInfo.client->c_sock, sock_buf_write_ptr,
-                                                  thr->cfg->bmp_buffer_size - write_buf_pos);
+                    else if ((buf_len = sock_buf->writable(buf_ptr)) > 0)
+                        bytes_read = read(cInfo.client->c_sock, buf_ptr, buf_len);
 
-                            else if (read_buf_pos > write_buf_pos) // read is ahead of write in terms of buffer pointer
-                                bytes_read = read(cInfo.client->c_sock, sock_buf_write_ptr,
-                                                  read_buf_pos - write_buf_pos - 1);
-                    }
+                    else
+                        paused = true;                      // Buffer is full or the pool budget is used, wait for the reader
 
-                    if (bytes_read <= 0) {
+                    if (not paused and bytes_read <= 0) {
                         close(sock_fds[0]);
                         close(sock_fds[1]);
                         close(cInfo.client->c_sock);
 
                         bmp_run = false;
-                        //cInfo.bmp_reader_thread->join();
-                        //delete cInfo.bmp_reader_thread;
-                        //cInfo.bmp_reader_thread = NULL;
                         break;
                     }
-                    else {
-                        sock_buf_write_ptr += bytes_read;
-                        write_buf_pos += bytes_read;
-                    }
+                    else if (not paused) {
+                        sock_buf->commit(bytes_read);
 
-                }
+                        stream_bytes += bytes_read;
+                        if (thr->latency)
+                            thr->latency->markRead(stream_bytes);
 
-            } else if (write_buf_pos >= thr->cfg->bmp_buffer_size) { // if reached end of buffer space
-                // Reached end of buffer, wrap to start
-                write_buf_pos = 0;
-                sock_buf_write_ptr = sock_buf;
-                wrap_state = true;
-                //LOG_INFO("write buffer wrapped");
-            }
+                        if (thr->metrics)
+                            thr->metrics->bytes.add(bytes_read);
 
-            /** DEBUG ONLY
-
-            else {
-                LOG_INFO("%s: buffer stall, waiting for read to catch up  w=%u r=%u",  cInfo.client->c_ipv4,
-                         write_buf_pos, read_buf_pos);
+                        if (cInfo.record != NULL)
+                            cInfo.recorder->write(cInfo.record, buf_ptr, bytes_read);
+                    }
+                }
             }
 
-            if (write_buf_pos != read_buf_pos)
-                LOG_INFO("%s: CHECK: state=%d w=%u r=%u",  cInfo.client->c_ipv4, wrap_state, write_buf_pos, read_buf_pos);
-            **/
-
-            if ((not wrap_state and read_buf_pos < write_buf_pos) or
-                    (wrap_state and read_buf_pos < thr->cfg->bmp_buffer_size)) {
+            if ((buf_len = sock_buf->readable(buf_ptr)) > 0) {
 
                 pfd.fd = cInfo.bmp_write_end_sock;
                 pfd.events = POLLOUT | POLLHUP | POLLERR;
@@ -218,40 +440,51 @@ void *ClientThread(void *arg) {
                         close(cInfo.client->c_sock);
 
                         bmp_run = false;
-                        //cInfo.bmp_reader_thread->join();
-                        //delete cInfo.bmp_reader_thread;
-                        //cInfo.bmp_reader_thread = NULL;
                         break;
                     }
 
-                    if (not wrap_state) // Write buffer is a head of read in terms of buffer pointer
-                        bytes_read = write(cInfo.bmp_write_end_sock, sock_buf_read_ptr,
-                                           (write_buf_pos - read_buf_pos) > CLIENT_WRITE_BUFFER_BLOCK_SIZE ?
-                                           CLIENT_WRITE_BUFFER_BLOCK_SIZE : (write_buf_pos - read_buf_pos));
-
-                    else // Read buffer is ahead of write in terms of buffer pointer
-                        bytes_read = write(cInfo.bmp_write_end_sock, sock_buf_read_ptr,
-                                           (thr->cfg->bmp_buffer_size - read_buf_pos) > CLIENT_WRITE_BUFFER_BLOCK_SIZE ?
-                                           CLIENT_WRITE_BUFFER_BLOCK_SIZE : (thr->cfg->bmp_buffer_size - read_buf_pos));
+                    bytes_read = write(cInfo.bmp_write_end_sock, buf_ptr,
+                                       buf_len > CLIENT_WRITE_BUFFER_BLOCK_SIZE ? CLIENT_WRITE_BUFFER_BLOCK_SIZE : buf_len);
 
-                    if (bytes_read > 0) {
-                        sock_buf_read_ptr += bytes_read;
-                        read_buf_pos += bytes_read;
-                    }
+                    if (bytes_read > 0)
+                        sock_buf->consume(bytes_read);
                 }
             }
-            else if (read_buf_pos >= thr->cfg->bmp_buffer_size) {
-                read_buf_pos = 0;
-                sock_buf_read_ptr = sock_buf;
-                wrap_state = false;
-                //LOG_INFO("read buffer wrapped");
+
+            // Buffer fill is used by the server for startup admission
+            thr->buffer_fill.store(sock_buf->getFill(), std::memory_order_relaxed);
+
+            if (cInfo.queued != NULL)
+                thr->sink_tid.store(cInfo.queued->getThreadId(), std::memory_order_relaxed);
+
+            size_t spill_depth = sock_buf->getSpillDepth();
+            if (spill_depth > 0 and spill_peak == 0) {
+                LOG_NOTICE("%s: Router buffer is full, spilling to disk", cInfo.client->c_ip);
+            } else if (spill_depth == 0 and spill_peak > 0) {
+                LOG_NOTICE("%s: Router buffer spill drained, peak spill depth was %zu KB", cInfo.client->c_ip, spill_peak / 1024);
+                spill_peak = 0;
+            }
+
+            spill_peak = std::max(spill_peak, spill_depth);
+            thr->spill_depth.store(spill_depth, std::memory_order_relaxed);
+
+            if (thr->metrics) {
+                thr->metrics->buffer_fill.set(sock_buf->getFill());
+                thr->metrics->spill_bytes.set(spill_depth);
+
+                if (cInfo.queued != NULL)
+                    thr->metrics->pipeline_depth.set(cInfo.queued->getDepth());
             }
+
+            if (cInfo.record != NULL)
+                cInfo.recorder->idle(cInfo.record);
         }
 
         LOG_INFO("%s: Thread for sock [%d] ended normally", cInfo.client->c_ip, cInfo.client->c_sock);
 
     } catch (char const *str) {
         LOG_INFO("%s: %s - Thread for sock [%d] ended", cInfo.client->c_ip, str, cInfo.client->c_sock);
+        bmp_run = false;
         close(sock_fds[0]);
         close(sock_fds[1]);
 #ifndef __APPLE__
@@ -263,15 +496,27 @@ void *ClientThread(void *arg) {
 
     } catch (...) {
         LOG_INFO("%s: Thread for sock [%d] ended abnormally: ", cInfo.client->c_ip, cInfo.client->c_sock);
+        bmp_run = false;
         close(sock_fds[0]);
         close(sock_fds[1]);
     }
 
     if (sock_buf != NULL)
-        delete[] sock_buf;
+        delete sock_buf;
+
+    if (cInfo.record != NULL) {
+        cInfo.recorder->closeStream(cInfo.record);
+        cInfo.record = NULL;
+    }
 
     pthread_cleanup_pop(0);
 
+#ifndef REDIS_ENABLED
+    // The new collector owns the router now, do not send a term message
+    if (handoff_done and cInfo.mbus != NULL)
+        cInfo.mbus->releaseRouter();
+#endif
+
     // Indicate that we are no longer running
     thr->running = false;
 
@@ -287,6 +532,15 @@ void *ClientThread(void *arg) {
             cInfo.bmp_reader_thread = NULL;
         }
 
+        // Sends what is still queued before the message bus is closed
+        thr->sink_tid = 0;
+        if (cInfo.queued != NULL) {
+            delete cInfo.queued;
+            cInfo.queued = NULL;
+        }
+
+        deleteSink(&cInfo);
+
 #ifndef REDIS_ENABLED
         if (cInfo.mbus != NULL) {
             delete cInfo.mbus;
@@ -295,6 +549,12 @@ void *ClientThread(void *arg) {
 #endif
     }
 
+    thr->io_tid = 0;
+
+    // Let the server join the thread
+    if (thr->completions != NULL)
+        thr->completions->push(thr);
+
     // Exit the thread
     pthread_exit(NULL);
 
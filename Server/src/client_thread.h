@@ -18,19 +18,102 @@
 #endif
 
 #include "BMPListener.h"
+#include "BufferPool.h"
+#include "CpuAffinity.h"
+#include "MsgBusQueued.h"
+#include "ParsePool.h"
+#include "RawRecorder.h"
+#include "RouterLatency.h"
+#include "RouterMetrics.h"
 #include "Logger.h"
 #include "Config.h"
 #include <thread>
+#include <atomic>
+#include <mutex>
+#include <memory>
+#include <vector>
 
 #define CLIENT_WRITE_BUFFER_BLOCK_SIZE    8192        // Number of bytes to write to BMP reader from buffer
 
+/*
+ * Collector handoff state of a client thread, see Handoff.h
+ */
+enum handoff_state {
+    HANDOFF_NONE = 0,                   // Normal operation
+    HANDOFF_REQUESTED,                  // Set by server, thread quiesces the router
+    HANDOFF_READY,                      // Set by thread, handoff_peers/handoff_data are valid
+    HANDOFF_DONE,                       // Set by server, socket was sent, thread exits without a term
+    HANDOFF_FAILED                      // Set by server, thread closes the router connection
+};
+
+class ThreadCompletionQueue;
+
 struct ThreadMgmt {
     pthread_t thr;
     BMPListener::ClientInfo client;
     Config *cfg;
     Logger *log;
+#ifdef REDIS_ENABLED
+    RedisManager *redis;                // Collector wide redis manager
+#endif
     bool running;                       // true if running, zero if not running
     bool baselineTimeout;		        // true if past the baseline time of the router
+    std::atomic<int> buffer_fill;       // Percent of the socket buffer in use, updated by the client thread
+    std::atomic<size_t> spill_depth;    // Bytes in the buffer spill file, updated by the client thread
+
+    std::atomic<int> handoff_state;     // One of handoff_state
+    bool handed_off;                    // true if the connection was received from a collector handoff
+    std::string handoff_peers;          // Peer info exported/imported by the handoff
+    std::string handoff_data;           // Buffered bytes not yet parsed, exported/imported by the handoff
+
+    ThreadCompletionQueue *completions; // Notified when the thread ends, NULL for none
+    BufferPool *buffer_pool;            // Collector wide pool for the router buffer
+    ParsePool *parse_pool;              // Collector wide BGP parse pool, NULL if not enabled
+    RawRecorder *recorder;              // Collector wide raw BMP recorder, NULL if not enabled
+    std::shared_ptr<RouterLatency> latency; // Latency of the router, NULL if not measured, set by the server
+    std::shared_ptr<RouterMetrics> metrics; // Counters of the router, NULL if the metrics endpoint is disabled
+
+    CpuAffinity *affinity;              // Router thread placement, NULL if not enabled
+    CpuAffinity::placement placement;   // Placement of the router threads, set by the server
+    std::atomic<pid_t> io_tid;          // Thread id of the socket I/O (client) thread, 0 if not running
+    std::atomic<pid_t> parse_tid;       // Thread id of the parse (BMP reader) thread, 0 if not running
+    std::atomic<pid_t> sink_tid;        // Thread id of the message bus (pipeline) thread, 0 if none
+    uint64_t io_ticks;                  // CPU ticks of the I/O thread at the last heartbeat, server only
+    uint64_t parse_ticks;               // CPU ticks of the parse thread at the last heartbeat, server only
+    uint64_t sink_ticks;                // CPU ticks of the message bus thread at the last heartbeat, server only
+};
+
+/**
+ * Client threads that ended, so the server does not have to scan all threads
+ */
+class ThreadCompletionQueue {
+public:
+    ThreadCompletionQueue();
+    ~ThreadCompletionQueue();
+
+    /**
+     * Add a thread that ended, called by the client thread as its last step
+     *
+     * @param [in]  thr     Thread that ended, can be joined
+     */
+    void push(ThreadMgmt *thr);
+
+    /**
+     * Take all threads that ended
+     *
+     * @param [out] threads Threads that ended are appended
+     */
+    void take(std::vector<ThreadMgmt *> &threads);
+
+    /**
+     * File descriptor (eventfd) that is readable when threads ended
+     */
+    int getFd();
+
+private:
+    std::mutex mutex;
+    std::vector<ThreadMgmt *> ended;
+    int efd;
 };
 
 struct ClientThreadInfo {
@@ -39,6 +122,10 @@ struct ClientThreadInfo {
 #else
     std::shared_ptr<MsgBusImpl_redis> redis;
 #endif
+    MsgBusQueued *queued;              // Message bus stage of the pipeline, NULL if not enabled
+    MsgBusInterface *sink;             // Null or counting sink (sink.type), NULL for the message bus
+    RawRecorder *recorder;             // Raw BMP recorder, NULL if not enabled
+    RawRecorder::stream *record;       // Raw BMP recording of the router, NULL if not recording
     BMPListener::ClientInfo *client;
     Logger *log;
 
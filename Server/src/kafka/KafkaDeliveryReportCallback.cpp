@@ -9,6 +9,21 @@
 
 #include "KafkaDeliveryReportCallback.h"
 
+KafkaDeliveryReportCallback::KafkaDeliveryReportCallback(const std::shared_ptr<RouterLatency> &latency) {
+    this->latency = latency;
+}
+
+void KafkaDeliveryReportCallback::setLatency(const std::shared_ptr<RouterLatency> &latency) {
+    this->latency = latency;
+}
+
 void KafkaDeliveryReportCallback::dr_cb (RdKafka::Message &message) {
     //std::cout << "Message delivery for (" << message.len() << " bytes): " << message.errstr() << std::endl;
-}
\ No newline at end of file
+
+    if (latency == NULL or message.err() != RdKafka::ERR_NO_ERROR)
+        return;
+
+    // Latency is in microseconds since produce()
+    latency->recordValue(RouterLatency::STAGE_COMMIT, message.latency());
+    latency->record(RouterLatency::STAGE_TOTAL, (uint64_t)(uintptr_t)message.msg_opaque(), RouterLatency::now());
+}
@@ -11,11 +11,29 @@
 #define OPENBMP_KAFKADELIVERYREPORTCALLBACK_H
 
 #include <librdkafka/rdkafkacpp.h>
+#include <memory>
+#include "RouterLatency.h"
 #include "Logger.h"
 
+/**
+ * Delivery reports of a router producer, records the commit latency of the messages
+ *
+ * \details Registered when latency is measured.  The message opaque is the socket read
+ *          time of the BMP message the Kafka message was encoded from (zero if unknown).
+ */
 class KafkaDeliveryReportCallback : public RdKafka::DeliveryReportCb {
 public:
+    KafkaDeliveryReportCallback(const std::shared_ptr<RouterLatency> &latency);
+
+    /**
+     * Set the latency the reports are recorded to, NULL to not record
+     */
+    void setLatency(const std::shared_ptr<RouterLatency> &latency);
+
     void dr_cb (RdKafka::Message &message);
+
+private:
+    std::shared_ptr<RouterLatency> latency;
 };
 
 #endif //OPENBMP_KAFKADELIVERYREPORTCALLBACK_H
@@ -41,7 +41,7 @@ KafkaTopicSelector::KafkaTopicSelector(Logger *logPtr, Config *cfg,  RdKafka::Pr
  * Destructor for class
  ***********************************************************************/
 KafkaTopicSelector::~KafkaTopicSelector() {
-    SELF_DEBUG("Destory KafkaTopicSeletor");
+    TRACE(TRACE_MSGBUS, "Destory KafkaTopicSeletor");
 
     freeTopicMap();
 
@@ -77,7 +77,7 @@ RdKafka::Topic * KafkaTopicSelector::getTopic(const std::string &topic_var,
         return t_it->second;                                              // Return the existing initialized topic
     }
     else {
-        SELF_DEBUG("Requesting to create topic for key=%s", topic_key.c_str());
+        TRACE(TRACE_MSGBUS, "Requesting to create topic for key=%s", topic_key.c_str());
         return initTopic(topic_var, router_group, peer_group, peer_asn);  // create and return newly created topic
     }
 
@@ -123,7 +123,7 @@ void KafkaTopicSelector::lookupPeerGroup(std::string hostname, std::string ip_ad
             for (std::list<Config::match_type_regex>::iterator lit = it->second.begin();
                     lit != it->second.end(); ++lit) {
                 if (regex_search(hostname, lit->regexp)) {
-                    SELF_DEBUG("Regexp matched hostname %s to peer group '%s'",
+                    TRACE(TRACE_MSGBUS, "Regexp matched hostname %s to peer group '%s'",
                                 hostname.c_str(), it->first.c_str());
                     peer_group_name = it->first;
                     return;
@@ -159,7 +159,7 @@ void KafkaTopicSelector::lookupPeerGroup(std::string hostname, std::string ip_ad
                 prefix[0] >>= bits;
 
                 if (prefix[0] == lit->prefix[0]) {
-                    SELF_DEBUG("IP %s matched peer group %s", ip_addr.c_str(), it->first.c_str());
+                    TRACE(TRACE_MSGBUS, "IP %s matched peer group %s", ip_addr.c_str(), it->first.c_str());
                     peer_group_name = it->first;
                     return;
                 }
@@ -180,7 +180,7 @@ void KafkaTopicSelector::lookupPeerGroup(std::string hostname, std::string ip_ad
                 if (prefix[0] == lit->prefix[0] and prefix[1] == lit->prefix[1]
                         and prefix[2] == lit->prefix[2] and prefix[3] == lit->prefix[3]) {
 
-                    SELF_DEBUG("IP %s matched peer group %s", ip_addr.c_str(), it->first.c_str());
+                    TRACE(TRACE_MSGBUS, "IP %s matched peer group %s", ip_addr.c_str(), it->first.c_str());
                     peer_group_name = it->first;
                     return;
                 }
@@ -200,7 +200,7 @@ void KafkaTopicSelector::lookupPeerGroup(std::string hostname, std::string ip_ad
              lit != it->second.end(); ++lit) {
 
             if (*lit == peer_asn) {
-                SELF_DEBUG("Peer ASN %u matched peer group %s", peer_asn, it->first.c_str());
+                TRACE(TRACE_MSGBUS, "Peer ASN %u matched peer group %s", peer_asn, it->first.c_str());
                 peer_group_name = it->first;
                 return;
             }
@@ -223,7 +223,7 @@ void KafkaTopicSelector::lookupRouterGroup(std::string hostname, std::string ip_
 
     router_group_name = "";
 
-    SELF_DEBUG("router lookup for hostname=%s and ip_addr=%s", hostname.c_str(), ip_addr.c_str());
+    TRACE(TRACE_MSGBUS, "router lookup for hostname=%s and ip_addr=%s", hostname.c_str(), ip_addr.c_str());
 
     /*
      * Match against hostname regexp
@@ -239,8 +239,8 @@ void KafkaTopicSelector::lookupRouterGroup(std::string hostname, std::string ip_
                  lit != it->second.end(); ++lit) {
 
                 if (regex_search(hostname, lit->regexp)) {
-                    SELF_DEBUG("Regexp matched hostname %s to router group '%s'",
-                               hostname.c_str(), it->first.c_str());
+                    TRACE(TRACE_MSGBUS, "Regexp matched hostname %s to router group '%s'",
+                                        hostname.c_str(), it->first.c_str());
                     router_group_name = it->first;
                     return;
                 }
@@ -276,7 +276,7 @@ void KafkaTopicSelector::lookupRouterGroup(std::string hostname, std::string ip_
                 prefix[0] >>= bits;
 
                 if (prefix[0] == lit->prefix[0]) {
-                    SELF_DEBUG("IP %s matched router group %s", ip_addr.c_str(), it->first.c_str());
+                    TRACE(TRACE_MSGBUS, "IP %s matched router group %s", ip_addr.c_str(), it->first.c_str());
                     router_group_name = it->first;
                     return;
                 }
@@ -297,7 +297,7 @@ void KafkaTopicSelector::lookupRouterGroup(std::string hostname, std::string ip_
                 if (prefix[0] == lit->prefix[0] and prefix[1] == lit->prefix[1]
                     and prefix[2] == lit->prefix[2] and prefix[3] == lit->prefix[3]) {
 
-                    SELF_DEBUG("IP %s matched router group %s", ip_addr.c_str(), it->first.c_str());
+                    TRACE(TRACE_MSGBUS, "IP %s matched router group %s", ip_addr.c_str(), it->first.c_str());
                     router_group_name = it->first;
                     return;
                 }
@@ -334,7 +334,7 @@ RdKafka::Topic * KafkaTopicSelector::initTopic(const std::string &topic_var,
      */
     if (topic_name.find("{peer_asn}") != std::string::npos) {
         topic_flags_map[topic_var].include_peerAsn = true;
-        SELF_DEBUG("peer_asn found in topic %s, setting topic flag to include peer ASN", topic_name.c_str());
+        TRACE(TRACE_MSGBUS, "peer_asn found in topic %s, setting topic flag to include peer ASN", topic_name.c_str());
     } else {
         topic_flags_map[topic_var].include_peerAsn = false;
     }
@@ -363,7 +363,7 @@ RdKafka::Topic * KafkaTopicSelector::initTopic(const std::string &topic_var,
         }
     }
 
-    SELF_DEBUG("Creating topic %s (map key=%s)" , topic_name.c_str(), topic_key.c_str());
+    TRACE(TRACE_MSGBUS, "Creating topic %s (map key=%s)" , topic_name.c_str(), topic_key.c_str());
 
     // Delete topic if it already exists
     topic_map::iterator t_it;
@@ -0,0 +1,79 @@
+/*
+ * Copyright (c) 2024 Microsoft, Inc. and others.  All rights reserved.
+ *
+ * This program and the accompanying materials are made available under the
+ * terms of the Eclipse Public License v1.0 which accompanies this distribution,
+ * and is available at http://www.eclipse.org/legal/epl-v10.html
+ *
+ */
+
+#include "MsgBusFile_kafka.h"
+
+using namespace std;
+
+/**
+ * Constructor for class
+ *
+ *  \param [in] logPtr      Pointer to Logger instance
+ *  \param [in] cfg         Pointer to the config instance
+ *  \param [in] c_hash_id   Collector Hash ID
+ *  \param [in] out         File to write the messages to, not closed by the class
+ */
+msgBusFile_kafka::msgBusFile_kafka(Logger *logPtr, Config *cfg, u_char *c_hash_id, FILE *out)
+        : msgBus_kafka(logPtr, cfg, c_hash_id, false) {
+    this->cfg = cfg;
+    this->out = out;
+    messages = 0;
+    failed = false;
+
+    hash_toStr(c_hash_id, collector_hash);
+}
+
+/**
+ * Destructor
+ */
+msgBusFile_kafka::~msgBusFile_kafka() {
+}
+
+/**
+ * Number of messages written
+ */
+uint64_t msgBusFile_kafka::getMessages() {
+    return messages;
+}
+
+/**
+ * Indicates if a write to the file failed
+ */
+bool msgBusFile_kafka::writeFailed() {
+    return failed;
+}
+
+/**
+ * Write the message to the file
+ *
+ * \param [in] topic_var     Topic var MSGBUS_TOPIC_VAR_*
+ * \param [in] msg           message to write
+ * \param [in] msg_size      Length in bytes of the message
+ * \param [in] rows          Number of rows
+ * \param [in] key           Hash key, not written
+ * \param [in] peer_group    Peer group name, not used
+ * \param [in] peer_asn      Peer ASN, not used
+ */
+void msgBusFile_kafka::produce(const char *topic_var, char *msg, size_t msg_size, int rows, string key,
+                               const string *peer_group, uint32_t peer_asn) {
+
+    // Same as KafkaTopicSelector::topicEnabled(), without adding the topic to the map
+    Config::topic_names_map_iter it = cfg->topic_names_map.find(topic_var);
+    if (it == cfg->topic_names_map.end() or it->second.empty() or failed)
+        return;
+
+    if (fprintf(out, "V: %s\nC_HASH_ID: %s\nT: %s\nL: %lu\nR: %d\n\n",
+                MSGBUS_API_VERSION, collector_hash.c_str(), topic_var, msg_size, rows) < 0
+            or fwrite(msg, 1, msg_size, out) != msg_size) {
+        failed = true;
+        return;
+    }
+
+    ++messages;
+}
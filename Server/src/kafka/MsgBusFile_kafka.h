@@ -0,0 +1,69 @@
+/*
+ * Copyright (c) 2024 Microsoft, Inc. and others.  All rights reserved.
+ *
+ * This program and the accompanying materials are made available under the
+ * terms of the Eclipse Public License v1.0 which accompanies this distribution,
+ * and is available at http://www.eclipse.org/legal/epl-v10.html
+ *
+ */
+
+#ifndef MSGBUSFILE_KAFKA_H_
+#define MSGBUSFILE_KAFKA_H_
+
+#include <cstdio>
+#include <string>
+
+#include "MsgBusImpl_kafka.h"
+
+/**
+ * \class   msgBusFile_kafka
+ *
+ * \brief   Kafka message bus that writes the messages to a file
+ * \details
+ *      Messages are encoded as with Kafka and appended to the file, each message is
+ *      the same headers and TSV rows that are produced to Kafka:
+ *          V: <version>\nC_HASH_ID: <hash>\nT: <topic var>\nL: <length>\nR: <rows>\n\n<rows>
+ *
+ *      The L header gives the length of the rows, so the file can be read message by
+ *      message.  Messages of topics that are disabled in the config are not written.
+ *      Raw BMP (bmp_raw) is not written, the capture files are the raw BMP.
+ */
+class msgBusFile_kafka: public msgBus_kafka {
+public:
+    /**
+     * Constructor for class
+     *
+     *  \param [in] logPtr      Pointer to Logger instance
+     *  \param [in] cfg         Pointer to the config instance
+     *  \param [in] c_hash_id   Collector Hash ID
+     *  \param [in] out         File to write the messages to, not closed by the class
+     */
+    msgBusFile_kafka(Logger *logPtr, Config *cfg, u_char *c_hash_id, FILE *out);
+    virtual ~msgBusFile_kafka();
+
+    /**
+     * Number of messages written
+     */
+    uint64_t getMessages();
+
+    /**
+     * Indicates if a write to the file failed
+     */
+    bool writeFailed();
+
+protected:
+    /**
+     * Write the message to the file, see msgBus_kafka::produce()
+     */
+    void produce(const char *topic_var, char *msg, size_t msg_size, int rows,
+                 std::string key, const std::string *peer_group, uint32_t peer_asn);
+
+private:
+    Config          *cfg;                       ///< Pointer to config instance
+    FILE            *out;                       ///< File the messages are written to
+    std::string     collector_hash;             ///< collector hash string value
+    uint64_t        messages;                   ///< Messages written
+    bool            failed;                     ///< A write failed
+};
+
+#endif /* MSGBUSFILE_KAFKA_H_ */
@@ -23,6 +23,7 @@
 #include "KafkaEventCallback.h"
 #include "KafkaDeliveryReportCallback.h"
 #include "KafkaTopicSelector.h"
+#include "Profiler.h"
 
 #include <boost/algorithm/string/replace.hpp>
 
@@ -42,8 +43,21 @@ using namespace std;
  *  \param [in] cfg         Pointer to the config instance
  *  \param [in] c_hash_id   Collector Hash ID
  ********************************************************************/
-msgBus_kafka::msgBus_kafka(Logger *logPtr, Config *cfg, u_char *c_hash_id) {
+msgBus_kafka::msgBus_kafka(Logger *logPtr, Config *cfg, u_char *c_hash_id)
+        : msgBus_kafka(logPtr, cfg, c_hash_id, true) {
+}
+
+/******************************************************************//**
+ * \brief Initialize without a Kafka producer if use_kafka is false
+ *
+ *  \param [in] logPtr      Pointer to Logger instance
+ *  \param [in] cfg         Pointer to the config instance
+ *  \param [in] c_hash_id   Collector Hash ID
+ *  \param [in] use_kafka   False to not create the Kafka producer
+ ********************************************************************/
+msgBus_kafka::msgBus_kafka(Logger *logPtr, Config *cfg, u_char *c_hash_id, bool use_kafka) {
     logger = logPtr;
+    this->use_kafka = use_kafka;
 
     producer_buf = new unsigned char[MSGBUS_WORKING_BUF_SIZE];
     prep_buf = new char[MSGBUS_WORKING_BUF_SIZE];
@@ -62,6 +76,7 @@ msgBus_kafka::msgBus_kafka(Logger *logPtr, Config *cfg, u_char *c_hash_id) {
     peer_seq            = 0L;
     base_attr_seq       = 0L;
     unicast_prefix_seq  = 0L;
+    ribSeq              = 0L;
     l3vpn_seq           = 0L;
     evpn_seq            = 0L;
     ls_node_seq         = 0L;
@@ -75,12 +90,14 @@ msgBus_kafka::msgBus_kafka(Logger *logPtr, Config *cfg, u_char *c_hash_id) {
     event_callback       = NULL;
     delivery_callback    = NULL;
     producer             = NULL;
+    metrics              = NULL;
     topicSel             = NULL;
 
     router_ip.assign("");
     bzero(router_hash, sizeof(router_hash));
 
-    connect();
+    if (use_kafka)
+        connect();
 }
 
 /**
@@ -88,7 +105,7 @@ msgBus_kafka::msgBus_kafka(Logger *logPtr, Config *cfg, u_char *c_hash_id) {
  */
 msgBus_kafka::~msgBus_kafka() {
 
-    SELF_DEBUG("Destory msgBus Kafka instance");
+    TRACE(TRACE_MSGBUS, "Destory msgBus Kafka instance");
 
     // Disconnect/term the router if not already done
     MsgBusInterface::obj_router r_object;
@@ -100,7 +117,7 @@ msgBus_kafka::~msgBus_kafka() {
         }
     }
 
-    if (router_defined) {
+    if (router_defined and use_kafka) {
         bzero(&r_object, sizeof(r_object));
         memcpy(r_object.hash_id, router_hash, sizeof(r_object.hash_id));
         snprintf((char *)r_object.ip_addr, sizeof(r_object.ip_addr), "%s", router_ip.c_str());
@@ -111,7 +128,8 @@ msgBus_kafka::~msgBus_kafka() {
         update_Router(r_object, msgBus_kafka::ROUTER_ACTION_TERM);
     }
 
-    sleep(2);
+    if (use_kafka)
+        sleep(2);
 
     delete [] producer_buf;
     delete [] prep_buf;
@@ -312,15 +330,15 @@ void msgBus_kafka::connect() {
         throw "ERROR: Failed to configure kafka event callback";
     }
 
-    // Register delivery report callback
-    /*
-    delivery_callback = new KafkaDeliveryReportCallback();
+    // Register delivery report callback, only used to measure the commit latency
+    if (cfg->latency_enabled) {
+        delivery_callback = new KafkaDeliveryReportCallback(latency);
 
-    if (conf->set("dr_cb", delivery_callback, errstr) != RdKafka::Conf::CONF_OK) {
-        LOG_ERR("Failed to configure kafka delivery report callback: %s", errstr.c_str());
-        throw "ERROR: Failed to configure kafka delivery report callback";
+        if (conf->set("dr_cb", delivery_callback, errstr) != RdKafka::Conf::CONF_OK) {
+            LOG_ERR("Failed to configure kafka delivery report callback: %s", errstr.c_str());
+            throw "ERROR: Failed to configure kafka delivery report callback";
+        }
     }
-    */
 
 
     // Create producer and connect
@@ -368,9 +386,14 @@ void msgBus_kafka::connect() {
  */
 void msgBus_kafka::produce(const char *topic_var, char *msg, size_t msg_size, int rows, string key,
                            const string *peer_group, uint32_t peer_asn) {
+    PROFILE_SCOPE(SINK_PRODUCE);
+
     size_t len;
     RdKafka::Topic *topic = NULL;
 
+    if (not use_kafka)
+        return;
+
     while (isConnected == false or topicSel == NULL) {
         // Do not attempt to reconnect if this is the main process (router ip is null)
         // Changed on 10/29/15 to support docker startup delay with kafka
@@ -400,15 +423,20 @@ void msgBus_kafka::produce(const char *topic_var, char *msg, size_t msg_size, in
 
     topic = topicSel->getTopic(topic_var, &router_group_name, peer_group, peer_asn);
     if (topic != NULL) {
-        SELF_DEBUG("rtr=%s: Producing message: topic=%s key=%s, msg size = %lu", router_ip.c_str(),
-                   topic->name().c_str(), key.c_str(), msg_size);
+        TRACE(TRACE_MSGBUS, "rtr=%s: Producing message: topic=%s key=%s, msg size = %lu", router_ip.c_str(),
+                            topic->name().c_str(), key.c_str(), msg_size);
 
         RdKafka::ErrorCode resp = producer->produce(topic, RdKafka::Topic::PARTITION_UA,
                                                     RdKafka::Producer::RK_MSG_COPY,
                                                     producer_buf, msg_size + len,
-                                                    (const std::string *) &key, NULL);
+                                                    (const std::string *) &key,
+                                                    (void *)(uintptr_t)msgReadTime);
         if (resp != RdKafka::ERR_NO_ERROR) {
             LOG_ERR("rtr=%s: Failed to produce message: %s", router_ip.c_str(), RdKafka::err2str(resp).c_str());
+
+            if (metrics != NULL)
+                metrics->produce_errors.add();
+
             producer->poll(100);
         }
     } else {
@@ -417,6 +445,9 @@ void msgBus_kafka::produce(const char *topic_var, char *msg, size_t msg_size, in
     }
 
     producer->poll(0);
+
+    if (metrics != NULL)
+        metrics->producer_depth.set(producer->outq_len());
 }
 
 /**
@@ -540,6 +571,7 @@ void msgBus_kafka::update_Router(obj_router &r_object, router_action_code code)
  * Abstract method Implementation - See MsgBusInterface.hpp for details
  */
 void msgBus_kafka::update_Peer(obj_bgp_peer &peer, obj_peer_up_event *up, obj_peer_down_event *down, peer_action_code code) {
+    PROFILE_SCOPE(SINK_PEER);
 
     char buf[4096]; // Misc working buffer
 
@@ -687,6 +719,7 @@ void msgBus_kafka::update_Peer(obj_bgp_peer &peer, obj_peer_up_event *up, obj_pe
  * Abstract method Implementation - See MsgBusInterface.hpp for details
  */
 void msgBus_kafka::update_baseAttribute(obj_bgp_peer &peer, obj_path_attr &attr, base_attr_action_code code) {
+    PROFILE_SCOPE(SINK_ATTR);
 
     prep_buf[0] = 0;
     size_t  buf_len;                    // size of the message in buf
@@ -749,6 +782,7 @@ void msgBus_kafka::update_baseAttribute(obj_bgp_peer &peer, obj_path_attr &attr,
  */
 void msgBus_kafka::update_L3Vpn(obj_bgp_peer &peer, std::vector<obj_vpn> &vpn,
                                 obj_path_attr *attr, vpn_action_code code) {
+    PROFILE_SCOPE(SINK_VPN);
 
     prep_buf[0] = 0;
 
@@ -866,6 +900,7 @@ void msgBus_kafka::update_L3Vpn(obj_bgp_peer &peer, std::vector<obj_vpn> &vpn,
  */
 void msgBus_kafka::update_eVPN(obj_bgp_peer &peer, std::vector<obj_evpn> &vpn,
                               obj_path_attr *attr, vpn_action_code code) {
+    PROFILE_SCOPE(SINK_EVPN);
 
     prep_buf[0] = 0;
 
@@ -979,6 +1014,8 @@ void msgBus_kafka::update_eVPN(obj_bgp_peer &peer, std::vector<obj_evpn> &vpn,
  */
 void msgBus_kafka::update_unicastPrefix(obj_bgp_peer &peer, std::vector<obj_rib> &rib,
                                         obj_path_attr *attr, unicast_prefix_action_code code) {
+    PROFILE_SCOPE(SINK_UNICAST);
+
     //bzero(prep_buf, MSGBUS_WORKING_BUF_SIZE);
     prep_buf[0] = 0;
 
@@ -1124,6 +1161,8 @@ void msgBus_kafka::add_StatReport(obj_bgp_peer &peer, obj_stats_report &stats) {
  */
 void msgBus_kafka::update_LsNode(obj_bgp_peer &peer, obj_path_attr &attr, std::list<MsgBusInterface::obj_ls_node> &nodes,
                                   ls_action_code code) {
+    PROFILE_SCOPE(SINK_LS);
+
     bzero(prep_buf, MSGBUS_WORKING_BUF_SIZE);
 
     char    buf2[8192];                          // Second working buffer
@@ -1237,6 +1276,8 @@ void msgBus_kafka::update_LsNode(obj_bgp_peer &peer, obj_path_attr &attr, std::l
  */
 void msgBus_kafka::update_LsLink(obj_bgp_peer &peer, obj_path_attr &attr, std::list<MsgBusInterface::obj_ls_link> &links,
                                  ls_action_code code) {
+    PROFILE_SCOPE(SINK_LS);
+
     bzero(prep_buf, MSGBUS_WORKING_BUF_SIZE);
 
     char    buf2[8192];                          // Second working buffer
@@ -1406,6 +1447,8 @@ void msgBus_kafka::update_LsLink(obj_bgp_peer &peer, obj_path_attr &attr, std::l
  */
 void msgBus_kafka::update_LsPrefix(obj_bgp_peer &peer, obj_path_attr &attr, std::list<MsgBusInterface::obj_ls_prefix> &prefixes,
                                    ls_action_code code) {
+    PROFILE_SCOPE(SINK_LS);
+
     bzero(prep_buf, MSGBUS_WORKING_BUF_SIZE);
 
     char    buf2[8192];                          // Second working buffer
@@ -1556,7 +1599,7 @@ void msgBus_kafka::send_bmp_raw(u_char *r_hash, obj_bgp_peer &peer, u_char *data
     hash_toStr(peer.hash_id, p_hash_str);
     hash_toStr(r_hash, r_hash_str);
 
-    if (data_len == 0)
+    if (data_len == 0 or not use_kafka)
         return;
 
     while (isConnected == false) {
@@ -1579,25 +1622,33 @@ void msgBus_kafka::send_bmp_raw(u_char *r_hash, obj_bgp_peer &peer, u_char *data
 
     topic = topicSel->getTopic(MSGBUS_TOPIC_VAR_BMP_RAW, &router_group_name, &peer_list[p_hash_str], peer.peer_as);
     if (topic != NULL) {
-        SELF_DEBUG("rtr=%s: Producing bmp raw message: topic=%s key=%s, msg size = %lu", router_ip.c_str(),
-                   topic->name().c_str(), r_hash_str.c_str(), data_len);
+        TRACE(TRACE_MSGBUS, "rtr=%s: Producing bmp raw message: topic=%s key=%s, msg size = %lu", router_ip.c_str(),
+                            topic->name().c_str(), r_hash_str.c_str(), data_len);
 
         RdKafka::ErrorCode resp = producer->produce(topic, RdKafka::Topic::PARTITION_UA,
                                                     RdKafka::Producer::RK_MSG_COPY /* Copy payload */,
                                                     producer_buf, data_len + hdr_len,
-                                                    (const std::string *)&r_hash_str, NULL);
+                                                    (const std::string *)&r_hash_str,
+                                                    (void *)(uintptr_t)msgReadTime);
 
         if (resp != RdKafka::ERR_NO_ERROR) {
             LOG_ERR("rtr=%s: Failed to produce bmp raw message: %s", router_ip.c_str(), RdKafka::err2str(resp).c_str());
+
+            if (metrics != NULL)
+                metrics->produce_errors.add();
+
             producer->poll(100);
         }
     }
     else {
-        SELF_DEBUG("rtr=%s: failed to produce bmp raw message because topic couldn't be found: topic=%s key=%s, msg size = %lu",
-                   router_ip.c_str(), MSGBUS_TOPIC_VAR_BMP_RAW, r_hash_str.c_str(), data_len);
+        TRACE(TRACE_MSGBUS, "rtr=%s: failed to produce bmp raw message because topic couldn't be found: topic=%s key=%s, msg size = %lu",
+                            router_ip.c_str(), MSGBUS_TOPIC_VAR_BMP_RAW, r_hash_str.c_str(), data_len);
     }
 
     producer->poll(0);
+
+    if (metrics != NULL)
+        metrics->producer_depth.set(producer->outq_len());
 }
 
 /**
@@ -1626,6 +1677,43 @@ bool msgBus_kafka::resolveIp(string name, string &hostname) {
     return true;
 }
 
+/**
+ * Forget the router without sending a term message, the router connection was
+ *      handed off to another collector
+ */
+void msgBus_kafka::releaseRouter() {
+    bzero(router_hash, sizeof(router_hash));
+}
+
+/**
+ * Abstract method Implementation - See MsgBusInterface.hpp for details
+ */
+void msgBus_kafka::end_Message() {
+    if (latency != NULL and msgParsedTime != 0)
+        latency->record(RouterLatency::STAGE_ENCODE, msgParsedTime, RouterLatency::now());
+}
+
+/**
+ * Record the latency of the messages produced, requires latency.enabled
+ *
+ * \param [in] routerLatency    Latency of the router
+ */
+void msgBus_kafka::enableLatency(const std::shared_ptr<RouterLatency> &routerLatency) {
+    latency = routerLatency;
+
+    if (delivery_callback != NULL)
+        delivery_callback->setLatency(latency);
+}
+
+/**
+ * Count the produce errors and the producer queue depth of the router
+ *
+ * \param [in] routerMetrics    Counters of the router, must outlive the message bus
+ */
+void msgBus_kafka::enableMetrics(RouterMetrics *routerMetrics) {
+    metrics = routerMetrics;
+}
+
 /*
  * Enable/disable debugs
  */
@@ -26,9 +26,13 @@
 #include "KafkaEventCallback.h"
 #include "KafkaDeliveryReportCallback.h"
 #include "KafkaTopicSelector.h"
+#include "RouterLatency.h"
+#include "RouterMetrics.h"
 
 #include "Config.h"
 
+#include <memory>
+
 /**
  * \class   msgBus_kafka
  *
@@ -49,7 +53,7 @@ public:
      *  \param [in] c_hash_id   Collector Hash ID
      ********************************************************************/
     msgBus_kafka(Logger *logPtr, Config *cfg, u_char *c_hash_id);
-    ~msgBus_kafka();
+    virtual ~msgBus_kafka();
 
     /*
      * abstract methods implemented
@@ -74,11 +78,64 @@ public:
     void update_eVPN(obj_bgp_peer &peer, std::vector<obj_evpn> &vpn, obj_path_attr *attr, vpn_action_code code);
 
     void send_bmp_raw(u_char *r_hash, obj_bgp_peer &peer, u_char *data, size_t data_len);
+    void end_Message();
+
+    /**
+     * Record the latency of the messages produced, requires latency.enabled
+     *
+     * \details The encode stage is recorded at end_Message(), the commit and total stages
+     *          by the delivery reports.
+     *
+     * \param [in] routerLatency    Latency of the router
+     */
+    void enableLatency(const std::shared_ptr<RouterLatency> &routerLatency);
+
+    /**
+     * Count the produce errors and the producer queue depth of the router
+     *
+     * \param [in] routerMetrics    Counters of the router, must outlive the message bus
+     */
+    void enableMetrics(RouterMetrics *routerMetrics);
+
+    /**
+     * Forget the router without sending a term message, the router connection was
+     *      handed off to another collector
+     */
+    void releaseRouter();
 
     // Debug methods
     void enableDebug();
     void disableDebug();
 
+protected:
+    /**
+     * Constructor for a message bus without a Kafka producer
+     *
+     * \details Used by subclasses that take the encoded messages by overriding produce(),
+     *          such as the benchmarks.  Messages are encoded as with Kafka, but nothing is
+     *          sent and the router term message is not encoded at destruction.
+     *
+     *  \param [in] logPtr      Pointer to Logger instance
+     *  \param [in] cfg         Pointer to the config instance
+     *  \param [in] c_hash_id   Collector Hash ID
+     *  \param [in] use_kafka   False to not create the Kafka producer
+     */
+    msgBus_kafka(Logger *logPtr, Config *cfg, u_char *c_hash_id, bool use_kafka);
+
+    /**
+     * produce message to Kafka
+     *
+     * \param [in] topic_var     Topic var to use in KafkaTopicSelector::getTopic()
+     * \param [in] msg           message to produce
+     * \param [in] msg_size      Length in bytes of the message
+     * \param [in] rows          Number of rows in data
+     * \param [in] key           Hash key
+     * \param [in] peer_group    Peer group name - empty/NULL if not set or used
+     * \param [in] peer_asn      Peer ASN
+     */
+    virtual void produce(const char *topic_var, char *msg, size_t msg_size, int rows,
+                         std::string key, const std::string *peer_group, uint32_t);
+
 private:
     char            *prep_buf;                  ///< Large working buffer for message preparation
     unsigned char   *producer_buf;              ///< Producer message buffer
@@ -112,9 +169,13 @@ private:
      * Callback handlers
      */
     KafkaEventCallback              *event_callback;
-    KafkaDeliveryReportCallback     *delivery_callback;
+    KafkaDeliveryReportCallback     *delivery_callback;     ///< NULL if latency is not measured
+
+    std::shared_ptr<RouterLatency>  latency;    ///< Latency of the router, NULL if not measured
+    RouterMetrics                   *metrics;   ///< Counters of the router, NULL if not counted
 
     bool isConnected;                           ///< Indicates if Kafka is connected or not
+    bool use_kafka;                             ///< False if there is no producer, see produce()
 
     // array of hashes
     std::map<std::string, std::string> peer_list;
@@ -139,20 +200,6 @@ private:
      */
     void disconnect(int wait_ms=2000);
 
-    /**
-     * produce message to Kafka
-     *
-     * \param [in] topic_var     Topic var to use in KafkaTopicSelector::getTopic()
-     * \param [in] msg           message to produce
-     * \param [in] msg_size      Length in bytes of the message
-     * \param [in] rows          Number of rows in data
-     * \param [in] key           Hash key
-     * \param [in] peer_group    Peer group name - empty/NULL if not set or used
-     * \param [in] peer_asn      Peer ASN
-     */
-    void produce(const char *topic_var, char *msg, size_t msg_size, int rows,
-                 std::string key, const std::string *peer_group, uint32_t);
-
     /**
     * \brief Method to resolve the IP address to a hostname
     *
@@ -23,11 +23,23 @@
 #include "client_thread.h"
 #include "openbmpd_version.h"
 #include "Config.h"
+#include "RouterAdmission.h"
+#include "Handoff.h"
+#include "WorkerSupervisor.h"
+#include "OfflineParser.h"
+#include "MetricsServer.h"
+#include "Profiler.h"
 
 #include <unistd.h>
 #include <fstream>
 #include <csignal>
 #include <cstring>
+#include <cinttypes>
+#include <algorithm>
+#include <deque>
+#include <set>
+#include <thread>
+#include <poll.h>
 #include <sys/stat.h>
 #include "md5.h"
 
@@ -42,11 +54,28 @@ const char *debug_filename  = NULL;                 // Debug file to log message
 const char *pid_filename    = NULL;                 // PID file to record the daemon pid
 bool        run             = true;                 // Indicates if server should run
 bool        run_foreground  = false;                // Indicates if server should run in forground
+bool        handoff_mode    = false;                // Take over router connections from the running collector
+volatile sig_atomic_t reload_debug = 0;             // Indicates debug config should be reloaded (SIGUSR1)
+volatile sig_atomic_t dump_profile = 0;             // Indicates the profile should be dumped (SIGUSR2)
+volatile sig_atomic_t stop_signal = 0;              // Signal that stops the server, zero to keep running
+volatile sig_atomic_t ignored_signal = 0;           // Last signal ignored, logged by the server loop
+vector<string> offline_files;                       // Capture files to parse offline (-r), empty to run the server
+const char *offline_out_dir = ".";                  // Output directory of the offline parse mode
+int         offline_threads = 0;                    // Streams parsed in parallel offline, 0 is the number of CPUs
 
 
 // Global thread list
 vector<ThreadMgmt *> thr_list(0);
 
+static WorkerSupervisor *supervisor = NULL;         // Worker supervisor, NULL if not running workers
+static ThreadCompletionQueue *completions = NULL;   // Client threads that ended, created per (worker) process
+static BufferPool *buffer_pool = NULL;              // Router buffer pool, created per (worker) process
+static CpuAffinity *affinity = NULL;                // Router thread placement, NULL if not enabled
+static ParsePool *parse_pool = NULL;                // BGP parse pool, NULL if not enabled
+static RawRecorder *recorder = NULL;                // Raw BMP recorder, NULL if not enabled
+static MetricsServer *metrics_server = NULL;        // Metrics endpoint, NULL if not enabled
+static time_t thread_cpu_time = 0;                  // Time of the last thread CPU usage log
+
 static Logger *logger;                              // Local source logger reference
 
 /**
@@ -65,6 +94,20 @@ void Usage(char *prog) {
     cout << "     -l <filename>     Log filename, default is STDOUT" << endl;
     cout << "     -d <filename>     Debug filename, default is log filename" << endl;
     cout << "     -f                Run in foreground instead of daemon (use for upstart)" << endl;
+    cout << "     -handoff          Take over the router connections of the running collector," << endl;
+    cout << "                       requires base.handoff_socket in the config" << endl;
+    cout << "     -w <count>        Number of collector worker processes sharing the BMP port (default is 1)" << endl;
+
+    cout << endl << "  OFFLINE OPTIONS:" << endl;
+    cout << "     -r <file|dir> ... Parse BMP capture files (or the .bmp/.bmp.gz files of directories) to" << endl;
+    cout << "                       local files instead of running the server, then exit" << endl;
+    cout << "     -o <dir>          Output directory of -r (default is the current directory)" << endl;
+#ifndef REDIS_ENABLED
+    cout << "                       Kafka messages are written to <stream>.tsv" << endl;
+#else
+    cout << "                       Redis operations are written to <stream>.redis, load with redis-cli --pipe" << endl;
+#endif
+    cout << "     -j <count>        Number of streams parsed in parallel by -r (default is the number of CPUs)" << endl;
 
     cout << endl << "  OTHER OPTIONS:" << endl;
     cout << "     -v                   Version" << endl;
@@ -76,6 +119,10 @@ void Usage(char *prog) {
     cout << "     -dbgp             Debug BGP parser" <<  endl;
     cout << "     -dbmp             Debug BMP parser" << endl;
     cout << "     -dmsgbus          Debug message bus" << endl;
+    cout << "     -dredis           Debug redis writers" << endl;
+    cout << "     -dprofile         Time the parsers and message bus per thread" << endl;
+    cout << "                       Send SIGUSR1 to reload the debug section of the config file" << endl;
+    cout << "                       Send SIGUSR2 to dump the profile" << endl;
 
     cout << endl << "  DEPRECATED OPTIONS:" << endl;
     cout << endl << "       These options will be removed in a future release. You should switch to use the config file." << endl;
@@ -140,11 +187,12 @@ void daemonize() {
 /**
  * Signal handler
  *
+ * \details Only sets flags, the server loop handles them.  Logging, locks and file
+ *          I/O are not async-signal-safe, the signal may interrupt a thread holding
+ *          the logger or recorder lock.
  */
 void signal_handler(int signum)
 {
-    LOG_NOTICE("Caught signal %d", signum);
-
     /*
      * Respond based on the signal
      */
@@ -154,30 +202,290 @@ void signal_handler(int signum)
         case SIGQUIT :
         case SIGPIPE :
         case SIGINT  :
-        case SIGCHLD : // Handle the child cleanup
+        case SIGCHLD : // Stop the server, handled by the server loop
+            // A second signal exits right away, such as when the loop waits for Kafka
+            if (stop_signal)
+                _exit(EXIT_FAILURE);
 
-            for (size_t i=0; i < thr_list.size(); i++) {
-                if (thr_list.at(i)->running) {
-                    pthread_cancel(thr_list.at(i)->thr);
-                    thr_list.at(i)->running = false;
-                    pthread_join(thr_list.at(i)->thr, NULL);
-                }
-            }
-
-            thr_list.clear();
+            stop_signal = signum;
+            break;
 
-            LOG_INFO("Done closing all active BMP connections");
+        case SIGUSR1 : // Reload debug config, handled by the server loop
+            reload_debug = 1;
+            break;
 
-            run = false;
-            exit(0);
+        case SIGUSR2 : // Dump the profile, handled by the server loop
+            dump_profile = 1;
             break;
 
         default:
-            LOG_INFO("Ignoring signal %d", signum);
+            ignored_signal = signum;
             break;
     }
 }
 
+/**
+ * Stop the router threads, called by the server loop when stopped by a signal
+ */
+static void stopRouters() {
+    for (size_t i=0; i < thr_list.size(); i++) {
+        if (thr_list.at(i)->running) {
+            pthread_cancel(thr_list.at(i)->thr);
+            thr_list.at(i)->running = false;
+            pthread_join(thr_list.at(i)->thr, NULL);
+        }
+    }
+
+    thr_list.clear();
+
+    LOG_INFO("Done closing all active BMP connections");
+}
+
+/**
+ * Start the client thread for a router connection and add it to the thread list
+ *
+ * \param [in] thr    Thread management info, client is the router connection
+ */
+static void startClientThread(ThreadMgmt *thr) {
+    pthread_attr_t thr_attr;            // thread attribute
+    pthread_attr_init(&thr_attr);
+    //pthread_attr_setdetachstate(&thr.thr_attr, PTHREAD_CREATE_DETACHED);
+    pthread_attr_setdetachstate(&thr_attr, PTHREAD_CREATE_JOINABLE);
+    thr->running = 1;
+    thr->buffer_fill = 0;
+    thr->spill_depth = 0;
+    thr->handoff_state = HANDOFF_NONE;
+    thr->completions = completions;
+    thr->buffer_pool = buffer_pool;
+    thr->affinity = affinity;
+    thr->parse_pool = parse_pool;
+    thr->recorder = recorder;
+    thr->io_tid = 0;
+    thr->parse_tid = 0;
+    thr->sink_tid = 0;
+    thr->io_ticks = 0;
+    thr->parse_ticks = 0;
+    thr->sink_ticks = 0;
+
+    // Created before the thread starts, so the heartbeat can read it while the thread runs
+    if (thr->cfg->latency_enabled)
+        thr->latency = std::make_shared<RouterLatency>();
+
+    if (metrics_server != NULL) {
+        thr->metrics = std::make_shared<RouterMetrics>(thr->client.c_ip, thr->latency);
+        metrics_server->addRouter(thr->metrics);
+    }
+
+    if (affinity != NULL)
+        affinity->assign(thr->placement);
+
+    // Start the thread to handle the client connection
+    pthread_create(&thr->thr, &thr_attr,
+                   ClientThread, thr);
+
+    // Add thread to vector
+    thr_list.insert(thr_list.end(), thr);
+
+    // Free attribute
+    pthread_attr_destroy(&thr_attr);
+}
+
+/**
+ * Close the router connections that were accepted but not started
+ *
+ * \param [in,out] pending    Accepted routers waiting for admission, cleared
+ */
+static void closePending(std::deque<ThreadMgmt *> &pending) {
+    for (size_t i=0; i < pending.size(); i++) {
+        LOG_INFO("%s: Closing connection that was not started", pending.at(i)->client.c_ip);
+        close(pending.at(i)->client.c_sock);
+        delete pending.at(i);
+    }
+
+    pending.clear();
+}
+
+/**
+ * Hand off all router connections to the new collector
+ *
+ * \details Each client thread stops its router at a BMP message boundary, then the router
+ *          socket, peer info and unparsed bytes are sent.  Routers that do not stop within
+ *          HANDOFF_TIMEOUT are closed and will reconnect.  All client threads are joined.
+ *
+ * \param [in] handoff    Handoff connected to the new collector
+ *
+ * \return false if the new collector stopped receiving routers
+ */
+static bool handoffRouters(Handoff &handoff) {
+    size_t handed_off = 0;
+    bool rval = true;
+
+    for (size_t i=0; i < thr_list.size(); i++) {
+        if (thr_list.at(i)->running)
+            thr_list.at(i)->handoff_state = HANDOFF_REQUESTED;
+    }
+
+    // Wait for all routers to stop at a message boundary
+    time_t start = time(NULL);
+    bool waiting = true;
+    while (waiting and time(NULL) - start < HANDOFF_TIMEOUT) {
+        waiting = false;
+        for (size_t i=0; i < thr_list.size(); i++) {
+            if (thr_list.at(i)->running and thr_list.at(i)->handoff_state == HANDOFF_REQUESTED)
+                waiting = true;
+        }
+
+        if (waiting)
+            usleep(10000);
+    }
+
+    for (size_t i=0; i < thr_list.size(); i++) {
+        ThreadMgmt *thr = thr_list.at(i);
+        int state = HANDOFF_REQUESTED;
+
+        if (thr->handoff_state.compare_exchange_strong(state, HANDOFF_FAILED)) {
+            LOG_WARN("%s: Router did not stop in time for the handoff, closing connection", thr->client.c_ip);
+            continue;
+        }
+
+        if (state != HANDOFF_READY)
+            continue;
+
+        Handoff::Router router;
+        router.client = thr->client;
+        router.peers.swap(thr->handoff_peers);
+        router.data.swap(thr->handoff_data);
+
+        if (rval and handoff.sendRouter(router)) {
+            thr->handoff_state = HANDOFF_DONE;
+            ++handed_off;
+        } else {
+            rval = false;
+            thr->handoff_state = HANDOFF_FAILED;
+        }
+    }
+
+    for (size_t i=0; i < thr_list.size(); i++) {
+        pthread_join(thr_list.at(i)->thr, NULL);
+
+        if (metrics_server != NULL and thr_list.at(i)->metrics)
+            metrics_server->removeRouter(thr_list.at(i)->metrics);
+
+        delete thr_list.at(i);
+    }
+
+    LOG_NOTICE("Handed off %zu of %zu router connections", handed_off, thr_list.size());
+    thr_list.clear();
+
+    // All threads are joined, drop their completions
+    std::vector<ThreadMgmt *> ended;
+    completions->take(ended);
+
+    return rval;
+}
+
+/**
+ * Take over the router connections of the running collector
+ *
+ * \param [in] cfg        Reference to config options
+ * \param [in] handoff    Handoff, not connected
+ * \param [in] redis      Redis manager
+ *
+ * \return number of router connections taken over
+ */
+#ifndef REDIS_ENABLED
+static int takeoverRouters(Config &cfg, Handoff &handoff) {
+#else
+static int takeoverRouters(Config &cfg, Handoff &handoff, RedisManager *redis) {
+#endif
+    std::vector<Handoff::Router> routers;
+
+    try {
+        handoff.connect();
+
+        if (handoff.receiveRouters(routers))
+            handoff.ack();
+        else
+            LOG_WARN("Collector handoff did not complete, continuing with %zu routers received", routers.size());
+
+    } catch (char const *str) {
+        LOG_WARN("%s, starting without handoff", str);
+        return 0;
+    }
+
+    for (auto &router : routers) {
+        ThreadMgmt *thr = new ThreadMgmt;
+        thr->cfg = &cfg;
+        thr->log = logger;
+#ifdef REDIS_ENABLED
+        thr->redis = redis;
+#endif
+        thr->client = router.client;
+        thr->handed_off = true;
+        thr->handoff_peers.swap(router.peers);
+        thr->handoff_data.swap(router.data);
+
+        // RIB dump was done by the previous collector
+        thr->baselineTimeout = true;
+
+        startClientThread(thr);
+    }
+
+    LOG_NOTICE("Took over %zu router connections from the previous collector", routers.size());
+    return routers.size();
+}
+
+/**
+ * Get the trace categories enabled by the config debug flags
+ *
+ * \param [in] cfg    Reference to config options
+ */
+static uint32_t getTraceMask(const Config &cfg) {
+    uint32_t mask = 0;
+
+    if (cfg.debug_general)  mask |= TRACE_GENERAL;
+    if (cfg.debug_bmp)      mask |= TRACE_BMP;
+    if (cfg.debug_bgp)      mask |= TRACE_BGP;
+    if (cfg.debug_msgbus)   mask |= TRACE_MSGBUS;
+    if (cfg.debug_redis)    mask |= TRACE_REDIS;
+
+    return mask;
+}
+
+/**
+ * Reload the debug config from the config file and update the trace categories
+ *
+ * \details Categories (BMP, BGP and message bus parsing trace) take effect right away.
+ *          Classes that copy the debug flags at init (SELF_DEBUG) pick up the change
+ *          on the next router connection.
+ *
+ * \param [in/out] cfg    Reference to config options
+ */
+static void reloadDebugConfig(Config &cfg) {
+    if (cfg_filename == NULL) {
+        LOG_INFO("No config file, ignoring debug reload");
+        return;
+    }
+
+    try {
+        cfg.reloadDebug(cfg_filename);
+    } catch (char const *str) {
+        LOG_WARN("Failed to reload debug config: %s", str);
+        return;
+    }
+
+    if (cfg.debug_general)
+        logger->enableDebug();
+    else
+        logger->disableDebug();
+
+    trace_mask.store(getTraceMask(cfg), std::memory_order_relaxed);
+    Profiler::enable(cfg.debug_profile);
+
+    LOG_NOTICE("Reloaded debug config, trace mask is 0x%02x, profiling is %s", trace_mask.load(),
+               cfg.debug_profile ? "on" : "off");
+}
+
 /**
  * Parse and handle the command line args
  *
@@ -237,6 +545,21 @@ bool ReadCmdArgs(int argc, char **argv, Config &cfg) {
                 return true;
             }
 
+        } else if (!strcmp(argv[i], "-w")) {
+            if (i + 1 >= argc) {
+                cout << "INVALID ARG: -w expects the number of workers" << endl;
+                return true;
+            }
+
+            cfg.workers = atoi(argv[++i]);
+
+            // Validate range
+            if (cfg.workers < 1 || cfg.workers > MAX_WORKERS) {
+                cout << "INVALID ARG: workers '" << cfg.workers <<
+                                                 "' is out of range, expected range is 1 - " << MAX_WORKERS << endl;
+                return true;
+            }
+
         } else if (!strcmp(argv[i], "-m")) {
             // We expect the next arg to be mode
             if (i + 1 >= argc) {
@@ -303,9 +626,48 @@ bool ReadCmdArgs(int argc, char **argv, Config &cfg) {
             cfg.debug_bmp = true;
         } else if (!strcmp(argv[i], "-dmsgbus")) {
             cfg.debug_msgbus = true;
+        } else if (!strcmp(argv[i], "-dredis")) {
+            cfg.debug_redis = true;
+        } else if (!strcmp(argv[i], "-dprofile")) {
+            cfg.debug_profile = true;
 
         } else if (!strcmp(argv[i], "-f")) {
             run_foreground = true;
+
+        } else if (!strcmp(argv[i], "-handoff")) {
+            handoff_mode = true;
+
+        } else if (!strcmp(argv[i], "-r")) {
+            if (i + 1 >= argc or argv[i + 1][0] == '-') {
+                cout << "INVALID ARG: -r expects one or more capture files or directories" << endl;
+                return true;
+            }
+
+            // Files up to the next option, so that a shell glob can be used
+            while (i + 1 < argc and argv[i + 1][0] != '-')
+                offline_files.push_back(argv[++i]);
+
+        } else if (!strcmp(argv[i], "-o")) {
+            if (i + 1 >= argc) {
+                cout << "INVALID ARG: -o expects the output directory" << endl;
+                return true;
+            }
+
+            offline_out_dir = argv[++i];
+
+        } else if (!strcmp(argv[i], "-j")) {
+            if (i + 1 >= argc) {
+                cout << "INVALID ARG: -j expects the number of streams parsed in parallel" << endl;
+                return true;
+            }
+
+            offline_threads = atoi(argv[++i]);
+
+            // Validate range
+            if (offline_threads < 1 || offline_threads > 1024) {
+                cout << "INVALID ARG: -j '" << offline_threads << "' is out of range, expected range is 1 - 1024" << endl;
+                return true;
+            }
         }
 
         // Config filename
@@ -361,21 +723,164 @@ bool ReadCmdArgs(int argc, char **argv, Config &cfg) {
 }
 
 /**
- * Collector Update Message
+ * Log the CPU usage of the router I/O and parse threads since the last call
  *
- * \param [in] cfg                   Pointer to config instance
- * \param [in] cfg                   Reference to configuration
- * \param [in] code                  reason code for the update
+ * \details Logged when an affinity policy is set (so the placement can be checked) or with
+ *          general debug.
+ */
+static void logThreadCpu(Config &cfg) {
+    time_t now = time(NULL);
+    double ticks = sysconf(_SC_CLK_TCK) * (double)(now - thread_cpu_time);
+
+    if (affinity == NULL and not cfg.debug_general) {
+        thread_cpu_time = now;
+        return;
+    }
+
+    for (size_t i=0; i < thr_list.size(); i++) {
+        ThreadMgmt *thr = thr_list.at(i);
+        uint64_t io_ticks = 0, parse_ticks = 0, sink_ticks = 0;
+        int io_cpu = -1, parse_cpu = -1, sink_cpu = -1;
+
+        // The threads may have ended, their usage is then not logged
+        if (thr->io_tid == 0 or not CpuAffinity::getThreadCpu(thr->io_tid, io_ticks, io_cpu))
+            continue;
+
+        if (thr->parse_tid == 0 or not CpuAffinity::getThreadCpu(thr->parse_tid, parse_ticks, parse_cpu))
+            continue;
+
+        // Pipeline message bus thread, if enabled
+        bool sink = thr->sink_tid != 0 and CpuAffinity::getThreadCpu(thr->sink_tid, sink_ticks, sink_cpu);
+
+        // Usage of a new thread is since it started
+        if (thread_cpu_time > 0 and ticks > 0) {
+            char sink_usage[64] = "";
+
+            if (sink)
+                snprintf(sink_usage, sizeof(sink_usage), ", msgbus thread cpu %d %.1f%%",
+                         sink_cpu, 100 * (sink_ticks - thr->sink_ticks) / ticks);
+
+            LOG_INFO("%s: node %d, io thread cpu %d %.1f%%, parse thread cpu %d %.1f%%%s", thr->client.c_ip,
+                     affinity != NULL ? affinity->getNodeId(thr->placement) : -1,
+                     io_cpu, 100 * (io_ticks - thr->io_ticks) / ticks,
+                     parse_cpu, 100 * (parse_ticks - thr->parse_ticks) / ticks, sink_usage);
+        }
+
+        thr->io_ticks = io_ticks;
+        thr->parse_ticks = parse_ticks;
+        thr->sink_ticks = sink_ticks;
+    }
+
+    thread_cpu_time = now;
+}
+
+/**
+ * Log the latency histograms of the routers, since they connected
+ */
+static void logRouterLatency() {
+    for (size_t i=0; i < thr_list.size(); i++) {
+        if (thr_list.at(i)->latency)
+            thr_list.at(i)->latency->logLatency(logger, thr_list.at(i)->client.c_ip);
+    }
+}
+
+/**
+ * Log the routers with bytes in their buffer spill file
+ */
+static void logSpillDepth() {
+    size_t depth = 0;
+    int spilling = 0;
+
+    for (size_t i=0; i < thr_list.size(); i++) {
+        size_t thr_depth = thr_list.at(i)->spill_depth.load(std::memory_order_relaxed);
+
+        if (thr_depth > 0) {
+            depth += thr_depth;
+            spilling++;
+        }
+    }
+
+    if (spilling > 0)
+        LOG_NOTICE("%d routers spilling to disk, spill depth %zu MB", spilling, depth / (1024 * 1024));
+}
+
+/**
+ * Log the bytes the raw recorder dropped since the last heartbeat
  */
+static void logRecorderDrops() {
+    static uint64_t last_dropped = 0;
+
+    if (recorder == NULL)
+        return;
+
+    uint64_t dropped = recorder->getDropped();
+
+    if (dropped > last_dropped)
+        LOG_NOTICE("Raw recording dropped %" PRIu64 " KB, disk used %" PRIu64 " MB",
+                   (dropped - last_dropped) / 1024, recorder->getDiskUsed() / (1024 * 1024));
+
+    last_dropped = dropped;
+}
+
+/**
+ * Write the collector wide metrics, served by the metrics endpoint
+ *
+ * \param [out] out    Metrics are appended
+ * \param [in] redis   Redis connections (Redis build)
+ */
+#ifndef REDIS_ENABLED
+static void writeCollectorMetrics(std::string &out) {
+#else
+static void writeCollectorMetrics(std::string &out, RedisManager *redis) {
+#endif
+    if (recorder != NULL) {
+        MetricsServer::addFamily(out, "openbmp_recorder_dropped_bytes_total", "counter",
+                                 "Bytes the raw recorder dropped");
+        MetricsServer::addSample(out, "openbmp_recorder_dropped_bytes_total", "", recorder->getDropped());
+    }
+
 #ifdef REDIS_ENABLED
-void collector_update_msg(Config &cfg,
-                          MsgBusInterface::collector_action_code code) {
-    MsgBusInterface::obj_collector oc;
+    RedisManager::WriterStats stats;
+    redis->GetWriterStats(stats);
 
-    snprintf(oc.admin_id, sizeof(oc.admin_id), "%s", cfg.admin_id);
+    MetricsServer::addFamily(out, "openbmp_redis_ops_total", "counter", "Operations committed to Redis");
+    MetricsServer::addSample(out, "openbmp_redis_ops_total", "", stats.ops_committed);
 
-    oc.router_count = thr_list.size();
+    MetricsServer::addFamily(out, "openbmp_redis_queue_full_total", "counter",
+                             "Times a router waited on a full Redis writer queue");
+    MetricsServer::addSample(out, "openbmp_redis_queue_full_total", "", stats.queue_full);
+
+    MetricsServer::addFamily(out, "openbmp_redis_queue_depth", "gauge", "Operations queued to the Redis writers");
+    MetricsServer::addSample(out, "openbmp_redis_queue_depth", "", stats.queue_depth);
+
+    MetricsServer::addFamily(out, "openbmp_redis_queue_capacity", "gauge", "Capacity of the Redis writer queues");
+    MetricsServer::addSample(out, "openbmp_redis_queue_capacity", "", stats.queue_capacity);
 
+    MetricsServer::addFamily(out, "openbmp_redis_batch_size", "summary", "Operations per Redis pipeline flush");
+    MetricsServer::addSample(out, "openbmp_redis_batch_size", "quantile=\"0.5\"", stats.batch_p50);
+    MetricsServer::addSample(out, "openbmp_redis_batch_size", "quantile=\"0.99\"", stats.batch_p99);
+    MetricsServer::addSample(out, "openbmp_redis_batch_size_count", "", stats.batch_count);
+
+    MetricsServer::addFamily(out, "openbmp_redis_commit_latency_us", "summary",
+                             "Redis operation latency from enqueue to pipeline flush");
+    MetricsServer::addSample(out, "openbmp_redis_commit_latency_us", "quantile=\"0.5\"", stats.latency_p50_us);
+    MetricsServer::addSample(out, "openbmp_redis_commit_latency_us", "quantile=\"0.99\"", stats.latency_p99_us);
+    MetricsServer::addSample(out, "openbmp_redis_commit_latency_us", "quantile=\"1\"", stats.latency_max_us);
+    MetricsServer::addSample(out, "openbmp_redis_commit_latency_us_count", "", stats.latency_count);
+#endif
+}
+
+/**
+ * Get the connected routers for the collector message
+ *
+ * \details With workers, the routers of this worker are published to the other workers
+ *          and only worker 0 sends the collector messages, with the routers of all workers.
+ *
+ * \param [out] oc          Collector object, router count and routers are updated
+ *
+ * \return false if this worker does not send collector messages
+ */
+static bool collector_routers(MsgBusInterface::obj_collector &oc) {
     string router_ips;
     for (int i=0; i < thr_list.size(); i++) {
         //MsgBusInterface::hash_toStr(thr_list.at(i)->client.hash_id, hash_str);
@@ -385,7 +890,38 @@ void collector_update_msg(Config &cfg,
         router_ips.append(thr_list.at(i)->client.c_ip);
     }
 
+    oc.router_count = thr_list.size();
+
+    if (supervisor != NULL) {
+        supervisor->setRouters(oc.router_count, router_ips);
+
+        if (supervisor->getWorker() != 0)
+            return false;
+
+        supervisor->getRouters(oc.router_count, router_ips);
+    }
+
     snprintf(oc.routers, sizeof(oc.routers), "%s", router_ips.c_str());
+    return true;
+}
+
+/**
+ * Collector Update Message
+
+ *
+ * \param [in] cfg                   Pointer to config instance
+ * \param [in] cfg                   Reference to configuration
+ * \param [in] code                  reason code for the update
+ */
+#ifdef REDIS_ENABLED
+void collector_update_msg(Config &cfg,
+                          MsgBusInterface::collector_action_code code) {
+    MsgBusInterface::obj_collector oc;
+
+    snprintf(oc.admin_id, sizeof(oc.admin_id), "%s", cfg.admin_id);
+
+    if (not collector_routers(oc))
+        return;
 
     timeval tv;
     gettimeofday(&tv, NULL);
@@ -408,18 +944,8 @@ void collector_update_msg(msgBus_kafka *kafka, Config &cfg,
 
     snprintf(oc.admin_id, sizeof(oc.admin_id), "%s", cfg.admin_id);
 
-    oc.router_count = thr_list.size();
-
-    string router_ips;
-    for (int i=0; i < thr_list.size(); i++) {
-        //MsgBusInterface::hash_toStr(thr_list.at(i)->client.hash_id, hash_str);
-        if (router_ips.size() > 0)
-            router_ips.append(", ");
-
-        router_ips.append(thr_list.at(i)->client.c_ip);
-    }
-
-    snprintf(oc.routers, sizeof(oc.routers), "%s", router_ips.c_str());
+    if (not collector_routers(oc))
+        return;
 
     timeval tv;
     gettimeofday(&tv, NULL);
@@ -430,6 +956,81 @@ void collector_update_msg(msgBus_kafka *kafka, Config &cfg,
 }
 #endif
 
+/**
+ * Define the collector hash from the admin ID
+ *
+ * \param [in/out] cfg    Reference to the config options, c_hash_id is set
+ */
+static void setCollectorHash(Config &cfg) {
+    MD5 hash;
+    hash.update((unsigned char *)cfg.admin_id, strlen(cfg.admin_id));
+    hash.finalize();
+
+    // Save the hash
+    unsigned char *hash_raw = hash.raw_digest();
+    memcpy(cfg.c_hash_id, hash_raw, 16);
+    delete[] hash_raw;
+}
+
+/**
+ * Signal handler of the offline parse mode, parsing stops and the output files are closed
+ */
+static void offline_signal_handler(int signum) {
+    run = false;
+}
+
+/**
+ * Parse the capture files to local files (-r) instead of running the server
+ *
+ * \param [in]  cfg    Reference to the config options
+ *
+ * \returns exit code of the program
+ */
+static int runOffline(Config &cfg) {
+    setCollectorHash(cfg);
+
+    OfflineParser parser(logger, &cfg, offline_out_dir);
+
+    for (size_t i = 0; i < offline_files.size(); i++) {
+        try {
+            parser.addFile(offline_files[i]);
+        } catch (char const *str) {
+            LOG_ERR("%s %s: %s", str, offline_files[i].c_str(), strerror(errno));
+            return 2;
+        }
+    }
+
+    if (parser.getStreams() == 0) {
+        LOG_ERR("No capture files to parse");
+        return 2;
+    }
+
+    struct sigaction sigact;
+    sigact.sa_handler = offline_signal_handler;
+    sigact.sa_flags = 0;
+    sigemptyset( &sigact.sa_mask);
+
+    sigaction(SIGTERM, &sigact, NULL);
+    sigaction(SIGQUIT, &sigact, NULL);
+    sigaction(SIGINT, &sigact, NULL);
+
+    // The profile is dumped when parsing is done, a dump request must not stop the parse
+    sigact.sa_handler = SIG_IGN;
+    sigaction(SIGUSR2, &sigact, NULL);
+
+    int threads = offline_threads > 0 ? offline_threads : std::thread::hardware_concurrency();
+    if (threads < 1)
+        threads = 1;
+
+    int rval = parser.run(threads, run) == 0 ? 0 : 1;
+
+    // The parse threads ended, their times are in the profile
+    if (cfg.debug_profile)
+        Profiler::dump(logger, cfg.profile_file);
+
+    return rval;
+}
+
 /**
  * Run Server loop
  *
@@ -438,31 +1039,92 @@ void collector_update_msg(msgBus_kafka *kafka, Config &cfg,
 void runServer(Config &cfg) {
 #ifndef REDIS_ENABLED
     msgBus_kafka *kafka;
+#else
+    RedisManager *redis;
 #endif
     int active_connections = 0;                 // Number of active connections/threads
-    int concurrent_routers = 0;			// Number of concurrent routers
     time_t last_heartbeat_time = 0;
    
     LOG_INFO("Initializing server");
 
     try {
-        // Define the collector hash
-        MD5 hash;
-        hash.update((unsigned char *)cfg.admin_id, strlen(cfg.admin_id));
-        hash.finalize();
-
-        // Save the hash
-        unsigned char *hash_raw = hash.raw_digest();
-        memcpy(cfg.c_hash_id, hash_raw, 16);
-        delete[] hash_raw;
+        setCollectorHash(cfg);
 
 #ifndef REDIS_ENABLED
         // Kafka connection
         kafka = new msgBus_kafka(logger, &cfg, cfg.c_hash_id);
+#else
+        // Redis connections, shared by all router sessions
+        redis = new RedisManager();
+        redis->Setup(logger, &cfg);
+        redis->InitBMPConfig();
+#endif
+
+        completions = new ThreadCompletionQueue();
+        buffer_pool = new BufferPool(logger, &cfg);
+
+        if (cfg.affinity_policy != AFFINITY_POLICY_NONE)
+            affinity = new CpuAffinity(logger, &cfg, supervisor != NULL ? supervisor->getWorker() : 0);
+
+        if (cfg.parse_pool_workers > 0)
+            parse_pool = new ParsePool(logger, cfg.parse_pool_workers);
+
+        if (cfg.record_dir.size()) {
+            try {
+                recorder = new RawRecorder(logger, cfg.record_dir, cfg.record_segment_size, cfg.record_max_disk,
+                                           cfg.record_queue_size, cfg.record_compress);
+            } catch (char const *str) {
+                LOG_WARN("%s %s, raw recording disabled", str, cfg.record_dir.c_str());
+            }
+        }
+
+        // Each worker serves its own routers on the next port
+        if (cfg.metrics_port > 0) {
+            try {
+                metrics_server = new MetricsServer(logger, cfg.metrics_address,
+                                                   cfg.metrics_port + (supervisor != NULL ? supervisor->getWorker() : 0));
+#ifndef REDIS_ENABLED
+                metrics_server->setCollectorMetrics(writeCollectorMetrics);
+#else
+                metrics_server->setCollectorMetrics(std::bind(writeCollectorMetrics, std::placeholders::_1, redis));
+#endif
+            } catch (char const *str) {
+                LOG_WARN("%s %s port %d, metrics disabled", str, cfg.metrics_address.c_str(), cfg.metrics_port);
+            }
+        }
+
+        // Load the router baselines saved by the previous run
+        if (cfg.baseline_file.size()) {
+            cfg.router_baseline.setStateFile(cfg.baseline_file);
+            LOG_INFO("Loaded %zu router baselines from %s", cfg.router_baseline.load(), cfg.baseline_file.c_str());
+        }
+
+        RouterAdmission admission(logger, &cfg);
+        std::deque<ThreadMgmt *> pending;           // Accepted routers waiting for admission
+        std::set<ThreadMgmt *> dumping;             // Started routers still dumping their RIB
+        std::vector<ThreadMgmt *> ended;            // Threads that ended, taken from completions
+        Handoff handoff(logger, &cfg);
+        bool handoff_sent = false;
+
+        // Take over the routers before listening, the previous collector stops listening first
+        if (handoff_mode) {
+#ifndef REDIS_ENABLED
+            active_connections = takeoverRouters(cfg, handoff);
+#else
+            active_connections = takeoverRouters(cfg, handoff, redis);
 #endif
+        }
 
-        // allocate and start a new bmp server
-        BMPListener *bmp_svr = new BMPListener(logger, &cfg);
+        if (cfg.handoff_socket.size()) {
+            try {
+                handoff.listen();
+            } catch (char const *str) {
+                LOG_WARN(str);
+            }
+        }
+
+        // allocate and start a new bmp server, workers use the listener opened by the supervisor
+        BMPListener *bmp_svr = supervisor ? supervisor->getListener() : new BMPListener(logger, &cfg);
 
 #ifndef REDIS_ENABLED
         collector_update_msg(kafka, cfg, MsgBusInterface::COLLECTOR_ACTION_STARTED);
@@ -475,139 +1137,258 @@ void runServer(Config &cfg) {
 
         // Loop to accept new connections
         while (run) {
+            if (stop_signal) {
+                LOG_NOTICE("Caught signal %d, stopping", (int)stop_signal);
+                break;
+            }
+
+            if (ignored_signal) {
+                LOG_INFO("Ignoring signal %d", (int)ignored_signal);
+                ignored_signal = 0;
+            }
+
+            if (reload_debug) {
+                reload_debug = 0;
+                reloadDebugConfig(cfg);
+            }
+
+            if (dump_profile) {
+                dump_profile = 0;
+                Profiler::dump(logger, cfg.profile_file);
+            }
+
+            // A new collector is taking over, stop accepting routers and hand off the connections
+            if (handoff.acceptRequest()) {
+                delete bmp_svr;
+
+                // Routers not started yet reconnect to the new collector
+                closePending(pending);
+                dumping.clear();
+
+                if (handoffRouters(handoff)) {
+                    handoff_sent = true;
+                    break;
+                }
+
+                LOG_WARN("Collector handoff failed, resuming");
+                active_connections = 0;
+                bmp_svr = new BMPListener(logger, &cfg);
+
+                try {
+                    handoff.listen();
+                } catch (char const *str) {
+                    LOG_WARN(str);
+                }
+            }
+
             /*
-             * Check for any stale threads/connections
+             * Join the threads that ended, each thread reports its own completion
              */
-             for (size_t i=0; i < thr_list.size(); i++) {
+            completions->take(ended);
+            for (size_t i=0; i < ended.size(); i++) {
+                ThreadMgmt *thr = ended.at(i);
+
+                // Join the thread to clean up
+                pthread_join(thr->thr, NULL);
+                --active_connections;
 
-                // If thread is not running, it means it terminated, so close it out
-                if (!thr_list.at(i)->running) {
+                // free the vector entry
+                dumping.erase(thr);
+                thr_list.erase(std::find(thr_list.begin(), thr_list.end(), thr));
 
-                    // Join the thread to clean up
-                    pthread_join(thr_list.at(i)->thr, NULL);
-                    --active_connections;
+                if (affinity != NULL)
+                    affinity->release(thr->placement);
 
-                    if (!thr_list.at(i)->baselineTimeout)
-                        --concurrent_routers;
+                if (thr->latency)
+                    thr->latency->logLatency(logger, thr->client.c_ip);
 
-                    // free the vector entry
-                    delete thr_list.at(i);
-                    thr_list.erase(thr_list.begin() + i);
+                if (metrics_server != NULL and thr->metrics)
+                    metrics_server->removeRouter(thr->metrics);
+
+                delete thr;
 
 #ifndef REDIS_ENABLED
-                    collector_update_msg(kafka, cfg,
-                                         MsgBusInterface::COLLECTOR_ACTION_CHANGE);
+                collector_update_msg(kafka, cfg,
+                                     MsgBusInterface::COLLECTOR_ACTION_CHANGE);
 #else
-                    collector_update_msg(cfg,
-                                         MsgBusInterface::COLLECTOR_ACTION_CHANGE);
+                collector_update_msg(cfg,
+                                     MsgBusInterface::COLLECTOR_ACTION_CHANGE);
 #endif
-                }
-
-		        else if (!thr_list.at(i)->baselineTimeout) {
+            }
+            ended.clear();
 
-                    int initial_time = cfg.initial_router_time;
-                    string hash(reinterpret_cast<char*>(thr_list.at(i)->client.hash_id), 16);
+            double dump_load = 0;                   // Concurrent router slots used by routers still dumping
+            int buffer_fill = 0;                    // Max buffer fill of routers still dumping
+            time_t now = time(NULL);
 
-                    //if calculate_baseline is true and the baseline time for the router is calculated, use the baseline time
-                    if (cfg.calculate_baseline && cfg.router_baseline_time.find(hash) != cfg.router_baseline_time.end())
-                        initial_time = cfg.router_baseline_time[hash];
+            /*
+             * Only routers still dumping count against the concurrent router limit
+             */
+            for (auto it = dumping.begin(); it != dumping.end(); ) {
+                ThreadMgmt *thr = *it;
 
-                    timeval now;
-                    gettimeofday(&now, NULL);
+                //If past the baseline time, the router is no longer counted in the concurrent routers
+                if (now - thr->client.startTime.tv_sec >= admission.getDumpTime(thr->client.hash_id)) {
+                    thr->baselineTimeout = true;
+                    it = dumping.erase(it);
 
-                    //If past the baseline time, decrement concurrent router count
-                    if(now.tv_sec - thr_list.at(i)->client.startTime.tv_sec >= initial_time) {
-                        --concurrent_routers;
-                    thr_list.at(i)->baselineTimeout = true;		// Indicating that this router is not counted in the concurrent routers count
-                    }
-		        }
+                } else {
+                    dump_load += admission.getWeight(thr->client.hash_id);
+                    buffer_fill = max(buffer_fill, thr->buffer_fill.load(std::memory_order_relaxed));
+                    ++it;
+                }
 
                 //TODO: Add code to check for a socket that is open, but not really connected/half open
             }
 
+            int queue_fill = 0;
+#ifdef REDIS_ENABLED
+            RedisManager::WriterStats stats;
+            redis->GetWriterStats(stats);
+            if (stats.queue_capacity)
+                queue_fill = 100 * stats.queue_depth / stats.queue_capacity;
+#endif
+            // Router buffers share the pool budget, a full pool holds back dumping routers as well
+            buffer_fill = max(buffer_fill, buffer_pool->getFill());
+
+            admission.updateLoad(dump_load, buffer_fill, queue_fill);
+
             /*
-             * Create a new client thread if we aren't at the max number of active sessions
+             * Start the accepted routers while below the concurrent router limit
              */
-            if(concurrent_routers < cfg.max_concurrent_routers)
-            {
-                if (active_connections <= MAX_THREADS) {
-                    ThreadMgmt *thr = new ThreadMgmt;
-                    thr->cfg = &cfg;
-                    thr->log = logger;
-
-                    // wait for a new connection and accept
-                    if (bmp_svr->wait_and_accept_connection(thr->client, 500)) {
-                        // Bump the current thread count
-                        ++active_connections;
+            while (not pending.empty() and admission.admit(dump_load)) {
+                ThreadMgmt *thr = pending.front();
+                pending.pop_front();
 
-                        // Bump the concurrent router count
-                        ++concurrent_routers;
-                        LOG_INFO("Accepted new connection; active connections = %d", active_connections);
+                // Bump the current thread count
+                ++active_connections;
 
-                        /*
-                         * Start a new thread for every new router connection
-                         */
-                        LOG_INFO("Client Connected => %s:%s, sock = %d",
-                                 thr->client.c_ip, thr->client.c_port, thr->client.c_sock);
+                LOG_INFO("Starting router %s:%s; active connections = %d, pending = %zu",
+                         thr->client.c_ip, thr->client.c_port, active_connections, pending.size());
 
-                        pthread_attr_t thr_attr;            // thread attribute
-                        pthread_attr_init(&thr_attr);
-                        //pthread_attr_setdetachstate(&thr.thr_attr, PTHREAD_CREATE_DETACHED);
-                        pthread_attr_setdetachstate(&thr_attr, PTHREAD_CREATE_JOINABLE);
-                        thr->running = 1;
-                        thr->baselineTimeout = false;
+                // The RIB dump time is measured from the start, not from the accept
+                gettimeofday(&thr->client.startTime, NULL);
 
-                        // Start the thread to handle the client connection
-                        pthread_create(&thr->thr, &thr_attr,
-                                       ClientThread, thr);
+                /*
+                 * Start a new thread for every new router connection
+                 */
+                thr->baselineTimeout = false;
+                thr->handed_off = false;
+                startClientThread(thr);
 
-                        // Add thread to vector
-                        thr_list.insert(thr_list.end(), thr);
+                dumping.insert(thr);
+                dump_load += admission.getWeight(thr->client.hash_id);
 
-                        // Free attribute
-                        pthread_attr_destroy(&thr_attr);
+#ifndef REDIS_ENABLED
+                collector_update_msg(kafka, cfg,
+                                     MsgBusInterface::COLLECTOR_ACTION_CHANGE);
+#else
+                collector_update_msg(cfg,
+                                     MsgBusInterface::COLLECTOR_ACTION_CHANGE);
+#endif
+                last_heartbeat_time = time(NULL);
+            }
 
+            // Routers of another worker changed
+            if (supervisor and supervisor->getWorker() == 0 and supervisor->routersChanged()) {
 #ifndef REDIS_ENABLED
-                        collector_update_msg(kafka, cfg,
-                                             MsgBusInterface::COLLECTOR_ACTION_CHANGE);
+                collector_update_msg(kafka, cfg, MsgBusInterface::COLLECTOR_ACTION_CHANGE);
 #else
-                        collector_update_msg(cfg,
-                                             MsgBusInterface::COLLECTOR_ACTION_CHANGE);
+                collector_update_msg(cfg, MsgBusInterface::COLLECTOR_ACTION_CHANGE);
 #endif
-                        last_heartbeat_time = time(NULL);
+                last_heartbeat_time = time(NULL);
+            }
 
-                    } else {
-                        delete thr;
+            // Send heartbeat if needed
+            if ( (time(NULL) - last_heartbeat_time) >= cfg.heartbeat_interval) {
+                logSpillDepth();
+                logRecorderDrops();
+                logThreadCpu(cfg);
+                logRouterLatency();
 
-                        // Send heartbeat if needed
-                        if ( (time(NULL) - last_heartbeat_time) >= cfg.heartbeat_interval) {
 #ifndef REDIS_ENABLED
-                            collector_update_msg(kafka, cfg, MsgBusInterface::COLLECTOR_ACTION_HEARTBEAT);
+                collector_update_msg(kafka, cfg, MsgBusInterface::COLLECTOR_ACTION_HEARTBEAT);
 #else
-                            collector_update_msg(cfg, MsgBusInterface::COLLECTOR_ACTION_HEARTBEAT);
+                collector_update_msg(cfg, MsgBusInterface::COLLECTOR_ACTION_HEARTBEAT);
+#endif
+                last_heartbeat_time = time(NULL);
+            }
+
+            /*
+             * Accept all pending connections right away, so the listen backlog does not overflow
+             * when many routers reconnect.  They are started above once admitted.
+             */
+            if (active_connections + pending.size() >= MAX_THREADS) {
+                LOG_WARN("Reached max number of threads, cannot accept new BMP connections at this time. ");
+
+                pollfd pfd = { completions->getFd(), POLLIN, 0 };
+                poll(&pfd, 1, 1000);
+
+            } else if (bmp_svr->wait(500, completions->getFd())) {
+                while (active_connections + pending.size() < MAX_THREADS) {
+                    ThreadMgmt *thr = new ThreadMgmt;
+                    thr->cfg = &cfg;
+                    thr->log = logger;
+#ifdef REDIS_ENABLED
+                    thr->redis = redis;
 #endif
-                            last_heartbeat_time = time(NULL);
-                        }
 
-                        usleep(10000);
+                    if (not bmp_svr->accept_pending(thr->client)) {
+                        delete thr;
+                        break;
                     }
 
-                } else {
-                    LOG_WARN("Reached max number of threads, cannot accept new BMP connections at this time. ");
-                    sleep (1);
+                    pending.push_back(thr);
+
+                    LOG_INFO("Client Connected => %s:%s, sock = %d; pending admission = %zu",
+                             thr->client.c_ip, thr->client.c_port, thr->client.c_sock, pending.size());
                 }
-	        }
+            }
 	    }
 
+        // Routers that were not started yet will reconnect
+        closePending(pending);
+
+        // Router threads are canceled, their recordings are closed and flushed below
+        if (stop_signal)
+            stopRouters();
+
+        // Stopped before the Redis connections it reads
+        delete metrics_server;
+        metrics_server = NULL;
+
 #ifndef REDIS_ENABLED
         collector_update_msg(kafka, cfg, MsgBusInterface::COLLECTOR_ACTION_STOPPED);
         delete kafka;
 #else
         collector_update_msg(cfg, MsgBusInterface::COLLECTOR_ACTION_STOPPED);
+        redis->ExitRedisManager();
+        delete redis;
 #endif
+
+        // All parsed messages are committed, the new collector can continue parsing
+        if (handoff_sent) {
+            if (handoff.finish())
+                LOG_NOTICE("New collector took over");
+            else
+                LOG_WARN("New collector did not acknowledge the handoff");
+        }
     } catch (char const *str) {
         LOG_WARN(str);
     }
+
+    /*
+     * Closed router recordings are written before exit, also when the server failed.  The
+     * recorder is stopped once no router thread is left writing to it.
+     */
+    if (recorder != NULL) {
+        recorder->flush();
+
+        if (thr_list.empty()) {
+            delete recorder;
+            recorder = NULL;
+        }
+    }
 }
 
 /**
@@ -631,6 +1412,21 @@ int main(int argc, char **argv) {
         }
     }
 
+    if (cfg.workers > 1 and cfg.handoff_socket.size()) {
+        if (handoff_mode) {
+            cout << "ERROR: -handoff is not supported with multiple workers" << endl;
+            return 2;
+        }
+
+        cout << "WARNING: base.handoff_socket is not supported with multiple workers, handoff is disabled" << endl;
+        cfg.handoff_socket.clear();
+    }
+
+    if (handoff_mode and cfg.handoff_socket.empty()) {
+        cout << "ERROR: -handoff requires base.handoff_socket in the configuration file" << endl;
+        return 2;
+    }
+
     // Make sure we have the required ARGS
     if (strlen(cfg.admin_id) <= 0) {
         cout << "ERROR: Missing required 'admin ID', use -c <config> or -a <string> to set the collector admin ID" << endl;
@@ -649,16 +1445,54 @@ int main(int argc, char **argv) {
     logger->setWidthFilename(15);
     logger->setWidthFunction(18);
 
+    trace_mask.store(getTraceMask(cfg), std::memory_order_relaxed);
+    Profiler::enable(cfg.debug_profile);
+
     if (cfg.debug_general)
         logger->enableDebug();
 
-    else if (not run_foreground){
+    // Offline parse mode runs in the foreground and exits when done
+    if (offline_files.size()) {
+        int rc = runOffline(cfg);
+
+        LOG_NOTICE("Program ended %s", rc == 0 ? "normally" : "with errors");
+        logger->flush();
+        return rc;
+    }
+
+    if (not cfg.debug_general and not run_foreground) {
         /*
         * Become a daemon if debug is not enabled
         */
         daemonize();
     }
 
+    // Fork the workers, the supervisor returns here when stopped
+    if (cfg.workers > 1) {
+        try {
+            supervisor = new WorkerSupervisor(logger, &cfg);
+
+            if (supervisor->run() < 0) {
+                delete supervisor;
+
+                LOG_NOTICE("Program ended normally");
+                logger->flush();
+                return 0;
+            }
+
+            LOG_INFO("Worker %d running, pid %d", supervisor->getWorker(), getpid());
+
+        } catch (char const *str) {
+            LOG_ERR(str);
+            logger->flush();
+            return 2;
+        }
+    }
+
+    // Threads do not survive fork(), so async logging is started after daemonize and forking the workers
+    if (cfg.log_async)
+        logger->enableAsync(cfg.log_flush_ms, (size_t)cfg.log_ring_kb * 1024);
+
     /*
      * Setup the signal handlers
      */
@@ -680,6 +1514,7 @@ int main(int argc, char **argv) {
     runServer(cfg);
 
 	LOG_NOTICE("Program ended normally");
+	logger->flush();
 
 	return 0;
 }
@@ -12,6 +12,7 @@
 
 #include "MsgBusImpl_redis.h"
 #include "RedisManager.h"
+#include "Profiler.h"
 
 using namespace std;
 
@@ -22,19 +23,26 @@ using namespace std;
  *
  *  \param [in] logPtr      Pointer to Logger instance
  *  \param [in] cfg         Pointer to the config instance
+ *  \param [in] redisMgr    Pointer to the collector wide redis manager
+ *  \param [in] client      Pointer to the router client info
  ********************************************************************/
-MsgBusImpl_redis::MsgBusImpl_redis(Logger *logPtr, Config *cfg, BMPListener::ClientInfo *client) {
+MsgBusImpl_redis::MsgBusImpl_redis(Logger *logPtr, Config *cfg, RedisManager *redisMgr, BMPListener::ClientInfo *client) {
     logger = logPtr;
     this->cfg = cfg;
-    redisMgr_.Setup(logPtr);
-    redisMgr_.InitBMPConfig();
+    redisMgr_ = redisMgr;
+    shard_ = redisMgr_->GetShard(client->hash_id);
+    memcpy(routerHashId_, client->hash_id, HASH_SIZE);
+    fedTables_ = 0;
+
+    for (int i = 0; i < RedisManager::BMP_TABLE_ID_MAX; i++)
+        resyncGen_[i] = redisMgr_->GetResyncGeneration((RedisManager::BMP_TABLE_ID)i);
+    ribSeq = 0;
 }
 
 /**
  * Destructor
  */
 MsgBusImpl_redis::~MsgBusImpl_redis() {
-    redisMgr_.ExitRedisManager();
 }
 
 /**
@@ -43,13 +51,76 @@ MsgBusImpl_redis::~MsgBusImpl_redis() {
  * \param [in] N/A
  */
 void MsgBusImpl_redis::ResetAllTables() {
-    redisMgr_.ResetAllTables();
+    redisMgr_->ResetAllTables();
+}
+
+/**
+ * Indicates if a table the session feeds was enabled at runtime and the BMP session should
+ * be restarted to resync
+ *
+ * \param [in] N/A
+ */
+bool MsgBusImpl_redis::ResyncRequested() {
+    uint32_t fed = fedTables_.load(std::memory_order_relaxed);
+
+    for (int i = 0; i < RedisManager::BMP_TABLE_ID_MAX; i++) {
+        if ((fed & (1U << i)) and redisMgr_->GetResyncGeneration((RedisManager::BMP_TABLE_ID)i) != resyncGen_[i])
+            return true;
+    }
+
+    return false;
+}
+
+/**
+ * Record that the session is closed to resync, the reconnect of the router does not reset the tables
+ *
+ * \param [in] N/A
+ */
+void MsgBusImpl_redis::MarkResyncReconnect() {
+    redisMgr_->SetResyncReconnect(routerHashId_);
+}
+
+/**
+ * Indicates if the session is the reconnect of a router closed to resync
+ *
+ * \param [in] N/A
+ */
+bool MsgBusImpl_redis::IsResyncReconnect() {
+    return redisMgr_->TakeResyncReconnect(routerHashId_);
+}
+
+/**
+ * Record the latency of the messages written, requires latency.enabled
+ *
+ * \param [in] latency     Latency of the router
+ */
+void MsgBusImpl_redis::EnableLatency(const std::shared_ptr<RouterLatency> &latency) {
+    latency_ = latency;
+}
+
+/**
+ * Abstract method Implementation - See MsgBusInterface.hpp for details
+ */
+void MsgBusImpl_redis::end_Message() {
+    if (latency_ == NULL)
+        return;
+
+    if (msgParsedTime != 0)
+        latency_->record(RouterLatency::STAGE_ENCODE, msgParsedTime, RouterLatency::now());
+
+    redisMgr_->MarkCommit(shard_, latency_, msgReadTime);
 }
 
 /**
  * Abstract method Implementation - See MsgBusInterface.hpp for details
  */
 void MsgBusImpl_redis::update_Peer(obj_bgp_peer &peer, obj_peer_up_event *up, obj_peer_down_event *down, peer_action_code code) {
+    PROFILE_SCOPE(SINK_PEER);
+
+    FeedTable(RedisManager::BMP_TABLE_ID_NEI);
+
+    if (not redisMgr_->IsTableEnabled(RedisManager::BMP_TABLE_ID_NEI))
+        return;
 
     // Below attributes will be populated if exists, and no matter bgp neighbor is up or down
     vector<swss::FieldValueTuple> fieldValues;
@@ -78,13 +149,15 @@ void MsgBusImpl_redis::update_Peer(obj_bgp_peer &peer, obj_peer_up_event *up, ob
         }
         break;
     }
-    for (const auto& fieldValue : fieldValues) {
-        const std::string& field = std::get<0>(fieldValue);
-        const std::string& value = std::get<1>(fieldValue);
-        DEBUG("MsgBusImpl_redis update_Peer field = %s, value = %s", field.c_str(), value.c_str());
+    if (TRACE_ENABLED(TRACE_REDIS)) {
+        for (const auto& fieldValue : fieldValues) {
+            const std::string& field = std::get<0>(fieldValue);
+            const std::string& value = std::get<1>(fieldValue);
+            TRACE(TRACE_REDIS, "MsgBusImpl_redis update_Peer field = %s, value = %s", field.c_str(), value.c_str());
+        }
     }
 
-    redisMgr_.WriteBMPTable(BMP_TABLE_NEI, keys, fieldValues);
+    redisMgr_->WriteBMPTable(shard_, BMP_TABLE_NEI, keys, std::move(fieldValues));
 }
 
 
@@ -93,71 +166,104 @@ void MsgBusImpl_redis::update_Peer(obj_bgp_peer &peer, obj_peer_up_event *up, ob
  */
 void MsgBusImpl_redis::update_unicastPrefix(obj_bgp_peer &peer, vector<obj_rib> &rib,
                                         obj_path_attr *attr, unicast_prefix_action_code code) {
-    if (attr == NULL)
+    PROFILE_SCOPE(SINK_UNICAST);
+
+    ribSeq += rib.size();
+
+    RedisManager::BMP_TABLE_ID tableId = peer.isAdjIn ? RedisManager::BMP_TABLE_ID_RIB_IN : RedisManager::BMP_TABLE_ID_RIB_OUT;
+    FeedTable(tableId);
+
+    if (not redisMgr_->IsTableEnabled(tableId))
+        return;
+
+    // Withdrawn prefixes do not carry path attributes
+    if (attr == NULL && code == UNICAST_PREFIX_ACTION_ADD)
+        return;
+
+    const string table = peer.isAdjIn ? BMP_TABLE_RIB_IN : BMP_TABLE_RIB_OUT;
+    const string separator = redisMgr_->GetKeySeparator();
+
+    // Attributes are shared by all prefixes of the update, so build them once
+    vector<swss::FieldValueTuple> addFieldValues;
+    if (code == UNICAST_PREFIX_ACTION_ADD) {
+        addFieldValues.reserve(MAX_ATTRIBUTES_COUNT);
+        addFieldValues.emplace_back(make_pair("origin", attr->origin));
+        addFieldValues.emplace_back(make_pair("as_path", attr->as_path));
+        addFieldValues.emplace_back(make_pair("as_path_count", to_string(attr->as_path_count)));
+        addFieldValues.emplace_back(make_pair("origin_as", to_string(attr->origin_as)));
+        addFieldValues.emplace_back(make_pair("next_hop", attr->next_hop));
+        addFieldValues.emplace_back(make_pair("local_pref", to_string(attr->local_pref)));
+        addFieldValues.emplace_back(make_pair("community_list", attr->community_list));
+        addFieldValues.emplace_back(make_pair("ext_community_list", attr->ext_community_list));
+        addFieldValues.emplace_back(make_pair("large_community_list", attr->large_community_list));
+        addFieldValues.emplace_back(make_pair("originator_id", attr->originator_id));
+
+        if (TRACE_ENABLED(TRACE_REDIS)) {
+            for (const auto& fieldValue : addFieldValues) {
+                const std::string& field = std::get<0>(fieldValue);
+                const std::string& value = std::get<1>(fieldValue);
+                TRACE(TRACE_REDIS, "MsgBusImpl_redis update_unicastPrefix field = %s, value = %s",
+                      field.c_str(), value.c_str());
+            }
+        }
+    }
+
+    if (redisMgr_->IsCompactSchema()) {
+        // compact schema as BGP_RIB_OUT_TABLE|10.0.0.59 -> { 192.181.168.0/25: <attr id> }
+        vector<string> prefixes;
+        prefixes.reserve(rib.size());
+        for (size_t i = 0; i < rib.size(); i++) {
+            string redisMgr_pfx = rib[i].prefix;
+            redisMgr_pfx += "/";
+            redisMgr_pfx += to_string(rib[i].prefix_len);
+            prefixes.emplace_back(std::move(redisMgr_pfx));
+        }
+
+        if (prefixes.empty())
+            return;
+
+        switch (code) {
+            case UNICAST_PREFIX_ACTION_ADD:
+                redisMgr_->WriteRibCompact(shard_, table, peer.peer_addr, prefixes, addFieldValues);
+                break;
+
+            case UNICAST_PREFIX_ACTION_DEL:
+                redisMgr_->RemoveRibCompact(shard_, table, peer.peer_addr, prefixes);
+                break;
+        }
         return;
+    }
 
     vector<string> del_keys;
     string neigh = peer.peer_addr;
 
     for (size_t i = 0; i < rib.size(); i++) {
         // Loop through the vector array of rib entries
-        vector<swss::FieldValueTuple> addFieldValues;
-        addFieldValues.reserve(MAX_ATTRIBUTES_COUNT);
 
         // rib table schema as BGP_RIB_OUT_TABLE|192.181.168.0/25|10.0.0.59
-        vector<string> keys;
         string redisMgr_pfx = rib[i].prefix;
         redisMgr_pfx += "/";
         redisMgr_pfx += to_string(rib[i].prefix_len);
-        keys.reserve(MAX_ATTRIBUTES_COUNT);
-        keys.emplace_back(redisMgr_pfx);
-        keys.emplace_back(peer.peer_addr);
 
         switch (code) {
 
             case UNICAST_PREFIX_ACTION_ADD:
             {
-                addFieldValues.emplace_back(make_pair("origin", attr->origin));
-                addFieldValues.emplace_back(make_pair("as_path", attr->as_path));
-                addFieldValues.emplace_back(make_pair("as_path_count", to_string(attr->as_path_count)));
-                addFieldValues.emplace_back(make_pair("origin_as", to_string(attr->origin_as)));
-                addFieldValues.emplace_back(make_pair("next_hop", attr->next_hop));
-                addFieldValues.emplace_back(make_pair("local_pref", to_string(attr->local_pref)));
-                addFieldValues.emplace_back(make_pair("community_list", attr->community_list));
-                addFieldValues.emplace_back(make_pair("ext_community_list", attr->ext_community_list));
-                addFieldValues.emplace_back(make_pair("large_community_list", attr->large_community_list));
-                addFieldValues.emplace_back(make_pair("originator_id", attr->originator_id));
-
-                for (const auto& fieldValue : addFieldValues) {
-                    const std::string& field = std::get<0>(fieldValue);
-                    const std::string& value = std::get<1>(fieldValue);
-                    DEBUG("MsgBusImpl_redis update_unicastPrefix field = %s, value = %s", field.c_str(), value.c_str());
-                }
-                if(peer.isAdjIn)
-                {
-                    redisMgr_.WriteBMPTable(BMP_TABLE_RIB_IN, keys, addFieldValues);
-                }
-                else
-                {
-                    redisMgr_.WriteBMPTable(BMP_TABLE_RIB_OUT, keys, addFieldValues);
-                }
+                vector<string> keys;
+                keys.reserve(2);
+                keys.emplace_back(redisMgr_pfx);
+                keys.emplace_back(peer.peer_addr);
+
+                redisMgr_->WriteBMPTable(shard_, table, keys, addFieldValues);
             }
                 break;
 
             case UNICAST_PREFIX_ACTION_DEL:
             {
-                string com_key;
-                if(peer.isAdjIn)
-                {
-                    com_key = BMP_TABLE_RIB_IN;
-                }
-                else
-                {
-                    com_key = BMP_TABLE_RIB_OUT;
-                }
-                com_key += redisMgr_.GetKeySeparator();
+                string com_key = table;
+                com_key += separator;
                 com_key += redisMgr_pfx;
-                com_key += redisMgr_.GetKeySeparator();
+                com_key += separator;
                 com_key += neigh;
                 del_keys.push_back(com_key);
             }
@@ -166,7 +272,7 @@ void MsgBusImpl_redis::update_unicastPrefix(obj_bgp_peer &peer, vector<obj_rib>
     }
 
     if (!del_keys.empty()) {
-        redisMgr_.RemoveEntityFromBMPTable(del_keys);
+        redisMgr_->RemoveEntityFromBMPTable(shard_, del_keys);
     }
 }
 
@@ -12,6 +12,7 @@
 #include <map>
 #include <vector>
 #include <ctime>
+#include <memory>
 
 
 
@@ -33,8 +34,10 @@ public:
      *
      *  \param [in] logPtr      Pointer to Logger instance
      *  \param [in] cfg         Pointer to the config instance
+     *  \param [in] redisMgr    Pointer to the collector wide redis manager
+     *  \param [in] client      Pointer to the router client info
      ********************************************************************/
-    MsgBusImpl_redis(Logger *logPtr, Config *cfg, BMPListener::ClientInfo *client);
+    MsgBusImpl_redis(Logger *logPtr, Config *cfg, RedisManager *redisMgr, BMPListener::ClientInfo *client);
     ~MsgBusImpl_redis();
 
     /**
@@ -44,6 +47,28 @@ public:
      */
     void ResetAllTables();
 
+    /**
+     * Indicates if a table the session feeds was enabled at runtime and the BMP session should
+     * be restarted to resync
+     *
+     * \param [in] N/A
+     */
+    bool ResyncRequested();
+
+    /**
+     * Record that the session is closed to resync, the reconnect of the router does not reset the tables
+     *
+     * \param [in] N/A
+     */
+    void MarkResyncReconnect();
+
+    /**
+     * Indicates if the session is the reconnect of a router closed to resync
+     *
+     * \param [in] N/A
+     */
+    bool IsResyncReconnect();
+
     /*
      * abstract methods implemented
      * See MsgBusInterface.hpp for method details
@@ -67,11 +92,37 @@ public:
     void update_eVPN(obj_bgp_peer &peer, std::vector<obj_evpn> &vpn, obj_path_attr *attr, vpn_action_code code);
 
     void send_bmp_raw(u_char *r_hash, obj_bgp_peer &peer, u_char *data, size_t data_len);
+    void end_Message();
+
+    /**
+     * Record the latency of the messages written, requires latency.enabled
+     *
+     * \details The encode stage is recorded at end_Message(), the commit and total stages
+     *          once the writer flushed the operations of the message.
+     *
+     * \param [in] latency     Latency of the router
+     */
+    void EnableLatency(const std::shared_ptr<RouterLatency> &latency);
 
 private:
     Logger          *logger;                    ///< Logging class pointer
     Config          *cfg;                       ///< Pointer to config instance
-    RedisManager    redisMgr_;
+    RedisManager    *redisMgr_;                 ///< Collector wide redis manager, shared by all sessions
+    size_t          shard_;                     ///< Redis writer shard used by this session
+    u_char          routerHashId_[HASH_SIZE];   ///< Hash id of the router
+    uint64_t        resyncGen_[RedisManager::BMP_TABLE_ID_MAX]; ///< Resync generations at session start
+    std::atomic<uint32_t> fedTables_;           ///< Bit per table id the router sent data for
+
+    /**
+     * Record that the router sent data for the table, whether the table is enabled or not
+     *
+     * \param [in] id       Table id
+     */
+    inline void FeedTable(RedisManager::BMP_TABLE_ID id) {
+        if (not (fedTables_.load(std::memory_order_relaxed) & (1U << id)))
+            fedTables_.fetch_or(1U << id, std::memory_order_relaxed);
+    }
+    std::shared_ptr<RouterLatency> latency_;    ///< Latency of the router, NULL if not measured
 };
 
 #endif /* MSGBUSIMPL_REDIS_H_ */
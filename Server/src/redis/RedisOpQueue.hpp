@@ -0,0 +1,213 @@
+/*
+ * Copyright (c) 2024 Microsoft, Inc. and others.  All rights reserved.
+ *
+ * This program and the accompanying materials are made available under the
+ * terms of the Eclipse Public License v1.0 which accompanies this distribution,
+ * and is available at http://www.eclipse.org/legal/epl-v10.html
+ *
+ */
+#ifndef REDISOPQUEUE_HPP_
+#define REDISOPQUEUE_HPP_
+
+#include <atomic>
+#include <memory>
+#include <cstdint>
+#include <cstddef>
+
+/**
+ * \class   BoundedOpQueue
+ *
+ * \brief   Bounded lock-free multi-producer/multi-consumer queue
+ * \details
+ *      Array based queue where each cell carries a sequence number that tells producers
+ *      and consumers if the cell is free to write or ready to read (D. Vyukov's bounded
+ *      MPMC queue). Push and pop never block; callers decide how to wait when the queue is
+ *      full or empty.
+ *
+ *      The size is rounded up to a power of two.
+ */
+template <typename T>
+class BoundedOpQueue {
+public:
+    explicit BoundedOpQueue(size_t size) {
+        size_t cap = 2;
+        while (cap < size)
+            cap <<= 1;
+
+        mask = cap - 1;
+        buffer.reset(new Cell[cap]);
+        for (size_t i = 0; i < cap; i++)
+            buffer[i].seq.store(i, std::memory_order_relaxed);
+
+        enqueue_pos.store(0, std::memory_order_relaxed);
+        dequeue_pos.store(0, std::memory_order_relaxed);
+    }
+
+    BoundedOpQueue(const BoundedOpQueue &) = delete;
+    BoundedOpQueue &operator=(const BoundedOpQueue &) = delete;
+
+    /**
+     * Push entry to the queue
+     *
+     * \param [in] data     Entry to push, moved into the queue on success
+     *
+     * \return true if pushed, false if the queue is full
+     */
+    bool tryPush(T &data) {
+        Cell *cell;
+        size_t pos = enqueue_pos.load(std::memory_order_relaxed);
+
+        for (;;) {
+            cell = &buffer[pos & mask];
+            size_t seq = cell->seq.load(std::memory_order_acquire);
+            intptr_t dif = (intptr_t)seq - (intptr_t)pos;
+
+            if (dif == 0) {
+                if (enqueue_pos.compare_exchange_weak(pos, pos + 1, std::memory_order_relaxed))
+                    break;
+            } else if (dif < 0) {
+                return false;
+            } else {
+                pos = enqueue_pos.load(std::memory_order_relaxed);
+            }
+        }
+
+        cell->data = std::move(data);
+        cell->seq.store(pos + 1, std::memory_order_release);
+        return true;
+    }
+
+    /**
+     * Pop entry from the queue
+     *
+     * \param [out] data    Entry popped
+     *
+     * \return true if popped, false if the queue is empty
+     */
+    bool tryPop(T &data) {
+        Cell *cell;
+        size_t pos = dequeue_pos.load(std::memory_order_relaxed);
+
+        for (;;) {
+            cell = &buffer[pos & mask];
+            size_t seq = cell->seq.load(std::memory_order_acquire);
+            intptr_t dif = (intptr_t)seq - (intptr_t)(pos + 1);
+
+            if (dif == 0) {
+                if (dequeue_pos.compare_exchange_weak(pos, pos + 1, std::memory_order_relaxed))
+                    break;
+            } else if (dif < 0) {
+                return false;
+            } else {
+                pos = dequeue_pos.load(std::memory_order_relaxed);
+            }
+        }
+
+        data = std::move(cell->data);
+        cell->seq.store(pos + mask + 1, std::memory_order_release);
+        return true;
+    }
+
+    /**
+     * Approximate number of entries in the queue
+     */
+    size_t depth() const {
+        size_t enq = enqueue_pos.load(std::memory_order_relaxed);
+        size_t deq = dequeue_pos.load(std::memory_order_relaxed);
+        return enq > deq ? enq - deq : 0;
+    }
+
+    /**
+     * Number of entries the queue can hold
+     */
+    size_t capacity() const {
+        return mask + 1;
+    }
+
+private:
+    struct Cell {
+        std::atomic<size_t> seq;
+        T                   data;
+    };
+
+    std::unique_ptr<Cell[]> buffer;
+    size_t                  mask;
+
+    // Producer and consumer positions are kept on separate cache lines.  Padded rather than
+    // alignas(64), the queue is allocated with new, which does not honour extended alignment
+    char                    pad0[64];
+    std::atomic<size_t>     enqueue_pos;
+    char                    pad1[64 - sizeof(std::atomic<size_t>)];
+    std::atomic<size_t>     dequeue_pos;
+};
+
+
+/**
+ * \class   LatencyHistogram
+ *
+ * \brief   Lock-free power of two histogram
+ * \details
+ *      Bucket N counts values in [2^(N-1), 2^N), bucket 0 counts zero.  Values are recorded
+ *      by one thread and may be read by any other thread.
+ */
+class LatencyHistogram {
+public:
+    enum { BUCKETS = 40 };
+
+    LatencyHistogram() {
+        reset();
+    }
+
+    void record(uint64_t value) {
+        int bucket = 0;
+        while (value && bucket < BUCKETS - 1) {
+            value >>= 1;
+            bucket++;
+        }
+        counts[bucket].fetch_add(1, std::memory_order_relaxed);
+    }
+
+    /**
+     * Get the value (upper bound of the bucket) at the given percentile
+     *
+     * \param [in] pct      Percentile 0 - 100
+     */
+    uint64_t percentile(double pct) const {
+        uint64_t total = count();
+        if (total == 0)
+            return 0;
+
+        uint64_t target = (uint64_t)(total * pct / 100.0);
+        if (target == 0)
+            target = 1;
+
+        uint64_t seen = 0;
+        for (int i = 0; i < BUCKETS; i++) {
+            seen += counts[i].load(std::memory_order_relaxed);
+            if (seen >= target)
+                return i == 0 ? 0 : (1ULL << i) - 1;
+        }
+        return (1ULL << (BUCKETS - 1)) - 1;
+    }
+
+    uint64_t count() const {
+        uint64_t total = 0;
+        for (int i = 0; i < BUCKETS; i++)
+            total += counts[i].load(std::memory_order_relaxed);
+        return total;
+    }
+
+    uint64_t bucket(int i) const {
+        return counts[i].load(std::memory_order_relaxed);
+    }
+
+    void reset() {
+        for (int i = 0; i < BUCKETS; i++)
+            counts[i].store(0, std::memory_order_relaxed);
+    }
+
+private:
+    std::atomic<uint64_t> counts[BUCKETS];
+};
+
+#endif /* REDISOPQUEUE_HPP_ */
@@ -9,23 +9,28 @@
 #ifndef SAFEQUEUE_HPP_
 #define SAFEQUEUE_HPP_
 
-#include <pthread.h>
-#include <unistd.h>
-
 #include <cstdlib>
+#include <cstdint>
 #include <queue>
+#include <mutex>
+#include <condition_variable>
 
 namespace std {
 /**
  * Extends std::queue to make it thread safe
  *
+ * push() blocks while the queue is at its limit and wait() blocks while the queue is
+ *    empty, both without polling.
+ *
  * At this point we are not making the operator overloads thread safe, therefore
  *    they should not be used.
  */
 template <typename type>
 class safeQueue : public queue<type> {
 private:
-    pthread_mutex_t mutex;              // Pthread mutex lock for reading and modifying the trie.
+    mutex               queue_mutex;        // Lock for reading and modifying the queue
+    condition_variable  not_full;           // Signaled when an element is removed
+    condition_variable  not_empty;          // Signaled when an element is added
 
     uint32_t        limit;
 
@@ -42,55 +47,38 @@ public:
     safeQueue(uint32_t limit=0) : queue<type>() {
 
         this->limit = limit;
-
-        // Initialize the mutex variable
-        pthread_mutex_init(&mutex, NULL);
-    }
-
-    ~safeQueue(){
-        // Free the mutex
-        pthread_mutex_destroy(&mutex);
     }
 
     void push(type const &elem) {
-        // Lock
-        pthread_mutex_lock (&mutex);
+        unique_lock<mutex> guard(queue_mutex);
 
         /*
          * Wait/block if limit has been reached
          */
-        if (limit and size() >= limit) {
-            pthread_mutex_unlock (&mutex);
-
-            while (size() >= limit) {
-                usleep(10000);
-            }
-
-            pthread_mutex_lock (&mutex);
-        }
+        not_full.wait(guard, [this] { return not limit or queue<type>::size() < limit; });
 
         // Add
         queue<type>::push(elem);
 
-        // Unlock
-        pthread_mutex_unlock (&mutex);
+        guard.unlock();
+        not_empty.notify_one();
     }
 
     void pop() {
-
-        // Lock
-        pthread_mutex_lock (&mutex);
+        unique_lock<mutex> guard(queue_mutex);
 
         // Before getting element, check if there are any
         if (queue<type>::size() > 0) {
             queue<type>::pop();
-        }
 
-        // Unlock
-        pthread_mutex_unlock (&mutex);
+            guard.unlock();
+            not_full.notify_one();
+        }
     }
 
     size_t size() {
+        lock_guard<mutex> guard(queue_mutex);
+
         return  queue<type>::size();
     }
 
@@ -106,24 +94,17 @@ public:
     *     true if the value was updated, false if not
     */
     bool front(type &value) {
-        bool rval = true;
-
-        // Lock
-        pthread_mutex_lock (&mutex);
+        lock_guard<mutex> guard(queue_mutex);
 
         // Before getting element, check if there are any
         if (queue<type>::size() > 0) {
 
             // get front
             value = queue<type>::front();
+            return true;
+        }
 
-        } else
-            rval = false;
-
-        // Unlock
-        pthread_mutex_unlock (&mutex);
-
-        return rval;
+        return false;
     }
 
 
@@ -139,17 +120,15 @@ public:
      *     true if the value was updated, false if not
      */
     bool back(type &value) {
+        lock_guard<mutex> guard(queue_mutex);
 
-        // Lock
-        pthread_mutex_lock (&mutex);
-
-        // get back
-        value = queue<type>::back();
-
-        // Unlock
-        pthread_mutex_unlock (&mutex);
+        if (queue<type>::size() > 0) {
+            // get back
+            value = queue<type>::back();
+            return true;
+        }
 
-        return true;
+        return false;
     }
 
     /**
@@ -163,10 +142,7 @@ public:
      *     true if the value was updated, false if not
      */
     bool popFront(type &value) {
-        bool rval = true;
-
-        // Lock
-        pthread_mutex_lock (&mutex);
+        unique_lock<mutex> guard(queue_mutex);
 
         // Before getting element, check if there are any
         if (queue<type>::size() > 0) {
@@ -176,29 +152,55 @@ public:
             // pop the front object
             queue<type>::pop();
 
-        } else
-            rval = false;
-
-        // Unlock
-        pthread_mutex_unlock (&mutex);
+            guard.unlock();
+            not_full.notify_one();
+            return true;
+        }
 
-        return rval;
+        return false;
     }
 
     /**
-     * new method to wait for the mutex lock.  When the queue is empty the lock is on.
+     * Wait for the queue to have entries
      *    calling this method will cause the caller to block until there are new entries
      */
     bool wait() {
-        while (size() <= 0) {
-            usleep(10000);
-        }
+        unique_lock<mutex> guard(queue_mutex);
+
+        not_empty.wait(guard, [this] { return queue<type>::size() > 0; });
 
         return true;
     }
 
+    /**
+     * Wait and pop the front object, for a single consumer
+     *
+     * ARGS:
+     *    value = reference to allocated <type>
+     */
+    void waitPopFront(type &value) {
+        unique_lock<mutex> guard(queue_mutex);
+
+        not_empty.wait(guard, [this] { return queue<type>::size() > 0; });
+
+        value = queue<type>::front();
+        queue<type>::pop();
+
+        guard.unlock();
+        not_full.notify_one();
+    }
+
     void setLimit(uint32_t limit) {
-        this->limit = limit;
+        {
+            lock_guard<mutex> guard(queue_mutex);
+            this->limit = limit;
+        }
+
+        not_full.notify_all();
+    }
+
+    uint32_t getLimit() {
+        return limit;
     }
 };
 
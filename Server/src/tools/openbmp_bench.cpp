@@ -0,0 +1,1118 @@
+/*
+ * Copyright (c) 2024 Microsoft, Inc. and others.  All rights reserved.
+ *
+ * This program and the accompanying materials are made available under the
+ * terms of the Eclipse Public License v1.0 which accompanies this distribution,
+ * and is available at http://www.eclipse.org/legal/epl-v10.html
+ *
+ */
+
+/**
+ * \file    openbmp_bench.cpp
+ *
+ * \brief   Microbenchmarks of the collector parsers, encoders and hashing
+ * \details Runs against a corpus of BMP streams, the .bmp files in bench/corpus made with openbmp_gen.
+ *          Each benchmark runs one operation per corpus item in turn until the minimum
+ *          time is reached, and reports ns/op, allocations/op (global operator new) and
+ *          bytes/s.  Operations are:
+ *
+ *              bmp_header/<corpus>       parseBMP common and peer header of a route monitoring
+ *                                        message, read from a socket as the collector does
+ *              update/<corpus>           UpdateMsg::parseUpdateMsg of an UPDATE
+ *              update/<corpus>-big       Same, UPDATEs with long AS paths or many communities
+ *              ext_community/<corpus>    ExtCommunity decode of an extended communities attribute
+ *              linkstate/<corpus>        MPLinkState parse of a BGP-LS MP_REACH_NLRI
+ *              kafka_encode/<corpus>     msgBus_kafka row encoding of a message bus call (Kafka build)
+ *              redis_keys/<corpus>       RedisManager keys of the prefixes of a call (Redis build)
+ *              redis_attr_id/<corpus>    RedisManager compact schema attribute id (Redis build)
+ *              md5/<size>                MD5 hash of size bytes
+ *
+ *          The encoder benchmarks replay the message bus calls made by BMPReader for the corpus.
+ *          Results can be written as JSON and compared to the JSON of another commit.
+ */
+
+#include <sys/types.h>
+#include <sys/socket.h>
+#include <sys/time.h>
+#include <arpa/inet.h>
+#include <dirent.h>
+#include <unistd.h>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <cstdint>
+#include <ctime>
+
+#include <iostream>
+#include <fstream>
+#include <sstream>
+#include <string>
+#include <vector>
+#include <list>
+#include <map>
+#include <new>
+#include <atomic>
+#include <thread>
+#include <chrono>
+#include <functional>
+#include <algorithm>
+
+#include "Logger.h"
+#include "Config.h"
+#include "md5.h"
+#include "BMPReader.h"
+#include "parseBMP.h"
+#include "UpdateMsg.h"
+#include "ExtCommunity.h"
+#include "MPReachAttr.h"
+#include "MPLinkState.h"
+
+#ifndef REDIS_ENABLED
+ #include "MsgBusImpl_kafka.h"
+#else
+ #include "RedisManager.h"
+#endif
+
+using namespace std;
+
+#ifndef BENCH_CORPUS_DIR
+ #define BENCH_CORPUS_DIR       "bench/corpus"
+#endif
+
+#define BMP_BATCH_BYTES         (64 * 1024)     // Max bytes of route monitoring written to the socket at once
+#define BMP_PEER_HDR_OFFSET     6               // Common header length
+#define BMP_MSG_HDR_LEN         48              // Common and peer header length
+#define BGP_HDR_LEN             19
+
+typedef chrono::steady_clock clock_type;
+
+/*
+ * Allocations by global operator new, counted for allocations/op
+ */
+static atomic<uint64_t> alloc_count(0);
+static atomic<uint64_t> alloc_bytes(0);
+
+static inline void *countedAlloc(size_t size) {
+    alloc_count.fetch_add(1, memory_order_relaxed);
+    alloc_bytes.fetch_add(size, memory_order_relaxed);
+
+    return malloc(size ? size : 1);
+}
+
+void *operator new(size_t size) {
+    void *p = countedAlloc(size);
+    if (p == NULL)
+        throw bad_alloc();
+    return p;
+}
+
+void *operator new[](size_t size) {
+    void *p = countedAlloc(size);
+    if (p == NULL)
+        throw bad_alloc();
+    return p;
+}
+
+void *operator new(size_t size, const nothrow_t &) noexcept { return countedAlloc(size); }
+void *operator new[](size_t size, const nothrow_t &) noexcept { return countedAlloc(size); }
+void operator delete(void *p) noexcept { free(p); }
+void operator delete[](void *p) noexcept { free(p); }
+void operator delete(void *p, size_t) noexcept { free(p); }
+void operator delete[](void *p, size_t) noexcept { free(p); }
+void operator delete(void *p, const nothrow_t &) noexcept { free(p); }
+void operator delete[](void *p, const nothrow_t &) noexcept { free(p); }
+
+/*
+ * Message bus call made by BMPReader, replayed to the encoders
+ */
+struct bus_call {
+    enum { BASE_ATTR, UNICAST, L3VPN, EVPN, LS_NODE, LS_LINK, LS_PREFIX } type;
+    int                                             code;
+    MsgBusInterface::obj_bgp_peer                   peer;
+    MsgBusInterface::obj_path_attr                  attr;
+    bool                                            has_attr;
+    vector<MsgBusInterface::obj_rib>                rib;
+    vector<MsgBusInterface::obj_vpn>                vpn;
+    vector<MsgBusInterface::obj_evpn>               evpn;
+    list<MsgBusInterface::obj_ls_node>              ls_nodes;
+    list<MsgBusInterface::obj_ls_link>              ls_links;
+    list<MsgBusInterface::obj_ls_prefix>            ls_prefixes;
+};
+
+/*
+ * Message bus that records the calls
+ */
+class RecordingBus : public MsgBusInterface {
+public:
+    vector<bus_call> calls;
+
+    RecordingBus() { ribSeq = 0; }
+
+    void update_Collector(obj_collector &c_obj, collector_action_code action_code) { }
+    void update_Router(obj_router &r_entry, router_action_code code) { }
+    void update_Peer(obj_bgp_peer &peer, obj_peer_up_event *up, obj_peer_down_event *down, peer_action_code code) { }
+    void add_StatReport(obj_bgp_peer &peer, obj_stats_report &stats) { }
+    void send_bmp_raw(u_char *r_hash, obj_bgp_peer &peer, u_char *data, size_t data_len) { }
+
+    void update_baseAttribute(obj_bgp_peer &peer, obj_path_attr &attr, base_attr_action_code code) {
+        add(bus_call::BASE_ATTR, code, peer, &attr);
+    }
+
+    void update_unicastPrefix(obj_bgp_peer &peer, vector<obj_rib> &rib, obj_path_attr *attr,
+                              unicast_prefix_action_code code) {
+        ribSeq += rib.size();
+        add(bus_call::UNICAST, code, peer, attr).rib = rib;
+    }
+
+    void update_L3Vpn(obj_bgp_peer &peer, vector<obj_vpn> &vpn, obj_path_attr *attr, vpn_action_code code) {
+        add(bus_call::L3VPN, code, peer, attr).vpn = vpn;
+    }
+
+    void update_eVPN(obj_bgp_peer &peer, vector<obj_evpn> &vpn, obj_path_attr *attr, vpn_action_code code) {
+        add(bus_call::EVPN, code, peer, attr).evpn = vpn;
+    }
+
+    void update_LsNode(obj_bgp_peer &peer, obj_path_attr &attr, list<obj_ls_node> &nodes, ls_action_code code) {
+        add(bus_call::LS_NODE, code, peer, &attr).ls_nodes = nodes;
+    }
+
+    void update_LsLink(obj_bgp_peer &peer, obj_path_attr &attr, list<obj_ls_link> &links, ls_action_code code) {
+        add(bus_call::LS_LINK, code, peer, &attr).ls_links = links;
+    }
+
+    void update_LsPrefix(obj_bgp_peer &peer, obj_path_attr &attr, list<obj_ls_prefix> &prefixes,
+                         ls_action_code code) {
+        add(bus_call::LS_PREFIX, code, peer, &attr).ls_prefixes = prefixes;
+    }
+
+private:
+    bus_call &add(int type, int code, obj_bgp_peer &peer, obj_path_attr *attr) {
+        calls.emplace_back();
+
+        bus_call &c = calls.back();
+        c.type = (decltype(c.type))type;
+        c.code = code;
+        c.peer = peer;
+        c.has_attr = attr != NULL;
+        if (attr != NULL)
+            c.attr = *attr;
+
+        return c;
+    }
+};
+
+#ifndef REDIS_ENABLED
+/*
+ * Kafka message bus without a producer, counts the encoded bytes
+ */
+class EncodeOnlyKafka : public msgBus_kafka {
+public:
+    uint64_t bytes;
+
+    EncodeOnlyKafka(Logger *logPtr, Config *cfg, u_char *c_hash_id)
+            : msgBus_kafka(logPtr, cfg, c_hash_id, false) {
+        bytes = 0;
+    }
+
+protected:
+    void produce(const char *topic_var, char *msg, size_t msg_size, int rows,
+                 string key, const string *peer_group, uint32_t peer_asn) {
+        bytes += msg_size;
+    }
+};
+#endif
+
+/*
+ * UPDATE of the corpus
+ */
+struct corpus_update {
+    u_char                  *data;              // UPDATE after the BGP header
+    size_t                  len;
+    BMPReader::peer_info    *peer;
+    string                  *peer_addr;
+};
+
+/*
+ * Path attribute of the corpus
+ */
+struct corpus_attr {
+    u_char                  *data;
+    size_t                  len;
+    string                  *peer_addr;
+};
+
+/*
+ * BMP stream of the corpus, split for the benchmarks
+ */
+struct corpus {
+    string                          name;
+    vector<u_char>                  data;           // Whole file
+    string                          route_mon;      // Route monitoring messages, back to back
+    vector<size_t>                  route_mon_ends; // End offset of each message in route_mon
+    vector<corpus_update>           updates;
+    vector<corpus_update>           big_updates;
+    vector<corpus_attr>             ext_communities;
+    vector<corpus_attr>             ls_reach;
+    map<string, BMPReader::peer_info> peers;        // By peer RD and address
+    map<string, string>             peer_addrs;     // Printed peer address by peer RD and address
+    vector<bus_call>                calls;
+};
+
+/*
+ * Benchmark, op(i) runs the operation on item i and returns the bytes processed
+ */
+struct bench {
+    string                          name;
+    size_t                          items;
+    size_t                          batch;          // Max items per timed batch
+    function<size_t(size_t, size_t)> prepare;       // Untimed, before a batch of items (first, count),
+                                                    //   returns the items prepared (at least one)
+    function<size_t(size_t)>        op;
+};
+
+struct bench_result {
+    string      name;
+    uint64_t    ops;
+    double      ns_op;
+    double      allocs_op;
+    double      alloc_bytes_op;
+    double      bytes_op;
+    double      mbytes_sec;
+};
+
+static const char  *corpus_dir  = BENCH_CORPUS_DIR;
+static const char  *filter      = NULL;         // Substring of the benchmarks to run
+static double       min_ms      = 500;          // Min time of a benchmark
+static const char  *log_file    = "/dev/null";
+static Logger      *logger;
+
+/**
+ * Usage of the program
+ */
+void Usage(char *prog) {
+    cout << "Usage: " << prog << " <options>" << endl;
+    cout << endl << "  Microbenchmarks of the parsers, encoders and hashing on a corpus of BMP streams" << endl;
+
+    cout << endl << "  OPTIONS:" << endl;
+    cout << "     -c <dir>          Corpus directory of .bmp files (default is " << BENCH_CORPUS_DIR << ")" << endl;
+    cout << "     -f <text>         Run only the benchmarks with text in their name" << endl;
+    cout << "     -t <ms>           Min time of each benchmark (default is 500)" << endl;
+    cout << "     -j <file>         Write the results as JSON to file, - for stdout" << endl;
+    cout << "     -n <label>        Label of the results in the JSON, for example the commit" << endl;
+    cout << "     -b <file>         Compare to the results of a JSON file (baseline)" << endl;
+    cout << "     -l <file>         Log file of the collector classes (default is /dev/null)" << endl;
+    cout << "     -h                Help" << endl;
+    cout << endl;
+}
+
+static inline uint16_t get16(const u_char *p) {
+    return (p[0] << 8) | p[1];
+}
+
+static inline uint32_t get32(const u_char *p) {
+    return ((uint32_t)p[0] << 24) | (p[1] << 16) | (p[2] << 8) | p[3];
+}
+
+/**
+ * Set the capabilities of an OPEN in the peer info
+ *
+ * \param [in] sent     OPEN sent by the monitored router
+ *
+ * \return length of the OPEN, 0 if invalid
+ */
+static size_t parseOpen(const u_char *open, size_t avail, BMPReader::peer_info &info, bool sent) {
+    if (avail < BGP_HDR_LEN + 10)
+        return 0;
+
+    size_t len = get16(open + 16);
+    if (len < BGP_HDR_LEN + 10 or len > avail or open[18] != 1)
+        return 0;
+
+    const u_char *p = open + BGP_HDR_LEN + 10;
+    const u_char *end = min(p + open[BGP_HDR_LEN + 9], open + len);
+
+    while (p + 2 <= end) {
+        const u_char *cap = p + 2;
+        const u_char *cap_end = min(cap + p[1], end);
+        bool caps = p[0] == 2;
+        p = cap_end;
+
+        if (not caps)
+            continue;
+
+        while (cap + 2 <= cap_end) {
+            int code = cap[0];
+            int cap_len = cap[1];
+            const u_char *value = cap + 2;
+            cap = value + cap_len;
+
+            if (cap > cap_end)
+                break;
+
+            if (code == 65) {                   // 4-octet ASN
+                if (sent)
+                    info.sent_four_octet_asn = true;
+                else
+                    info.recv_four_octet_asn = true;
+
+            } else if (code == 69) {            // ADD-PATH
+                for (int i = 0; i + 4 <= cap_len; i += 4)
+                    info.add_path_capability.addAddPath(get16(value + i), value[i + 2], value[i + 3], sent);
+            }
+        }
+    }
+
+    return len;
+}
+
+/**
+ * Add an UPDATE to the corpus, with its extended communities and BGP-LS attributes
+ */
+static void addUpdate(corpus &c, u_char *bgp, size_t len, const string &peer_key) {
+    corpus_update u;
+    u.data = bgp + BGP_HDR_LEN;
+    u.len = len - BGP_HDR_LEN;
+    u.peer = &c.peers[peer_key];
+    u.peer_addr = &c.peer_addrs[peer_key];
+
+    u_char *ptr = u.data;
+    u_char *end = u.data + u.len;
+    int as_count = 0;
+    int communities = 0;
+    int asn_size = u.peer->using_2_octet_asn ? 2 : 4;
+
+    if (u.len < 4)
+        return;
+
+    ptr += 2 + get16(ptr);                      // Withdrawn
+    if (ptr + 2 > end)
+        return;
+
+    u_char *attr_end = ptr + 2 + get16(ptr);
+    ptr += 2;
+    if (attr_end > end)
+        return;
+
+    while (ptr + 3 <= attr_end) {
+        u_char flags = ptr[0];
+        u_char type = ptr[1];
+        size_t a_len;
+
+        if (flags & 0x10) {
+            a_len = get16(ptr + 2);
+            ptr += 4;
+        } else {
+            a_len = ptr[2];
+            ptr += 3;
+        }
+
+        if (ptr + a_len > attr_end)
+            break;
+
+        corpus_attr a = { ptr, a_len, u.peer_addr };
+
+        switch (type) {
+            case 2 :                            // AS_PATH
+                for (u_char *seg = ptr; seg + 2 <= ptr + a_len; seg += 2 + seg[1] * asn_size)
+                    as_count += seg[1];
+                break;
+
+            case 8 :                            // COMMUNITIES
+                communities += a_len / 4;
+                break;
+
+            case 16 :                           // EXTENDED COMMUNITIES
+                c.ext_communities.push_back(a);
+                break;
+
+            case 14 :                           // MP_REACH_NLRI
+                if (a_len > 5 and get16(ptr) == bgp::BGP_AFI_BGPLS)
+                    c.ls_reach.push_back(a);
+                break;
+        }
+
+        ptr += a_len;
+    }
+
+    c.updates.push_back(u);
+    if (as_count >= 16 or communities >= 32)
+        c.big_updates.push_back(u);
+}
+
+/**
+ * Record the message bus calls BMPReader makes for the stream
+ */
+static void recordCalls(corpus &c, Config *cfg) {
+    int fds[2];
+    if (socketpair(PF_LOCAL, SOCK_STREAM, 0, fds) != 0) {
+        cerr << "ERROR: socketpair: " << strerror(errno) << endl;
+        exit(1);
+    }
+
+    thread writer([&] {
+        size_t off = 0;
+        while (off < c.data.size()) {
+            ssize_t written = write(fds[1], c.data.data() + off, c.data.size() - off);
+            if (written <= 0)
+                break;
+            off += written;
+        }
+        close(fds[1]);
+    });
+
+    BMPListener::ClientInfo client;
+    bzero(&client, sizeof(client));
+    strcpy(client.c_ip, "192.0.2.1");
+    client.c_sock = -1;
+    client.pipe_sock = fds[0];
+    client.initRec = true;
+    gettimeofday(&client.startTime, NULL);
+
+    RecordingBus bus;
+    BMPReader reader(logger, cfg);
+    bool run = true;
+
+    reader.readerThreadLoop(run, &client, &bus);
+
+    writer.join();
+    close(fds[0]);
+
+    c.calls.swap(bus.calls);
+}
+
+/**
+ * Load a BMP stream into the corpus
+ */
+static bool loadCorpus(const string &path, const string &name, corpus &c, Config *cfg) {
+    ifstream in(path.c_str(), ios::binary);
+    if (not in) {
+        cerr << "ERROR: Cannot open " << path << endl;
+        return false;
+    }
+
+    c.name = name;
+    c.data.assign(istreambuf_iterator<char>(in), istreambuf_iterator<char>());
+
+    // Updates point into data, it is not resized after this
+    size_t off = 0;
+    while (off + BMP_MSG_HDR_LEN <= c.data.size()) {
+        u_char *msg = c.data.data() + off;
+        size_t len = get32(msg + 1);
+
+        if (msg[0] != 3 or len < BMP_PEER_HDR_OFFSET or off + len > c.data.size()) {
+            cerr << "ERROR: " << path << " is not a BMP v3 stream at offset " << off << endl;
+            return false;
+        }
+        off += len;
+
+        u_char type = msg[5];
+        if (type > 3 or len < BMP_MSG_HDR_LEN)
+            continue;
+
+        string peer_key((char *)msg + 8, 24);       // Peer RD and address
+        u_char peer_flags = msg[7];
+
+        if (c.peers.find(peer_key) == c.peers.end()) {
+            BMPReader::peer_info &info = c.peers[peer_key];
+            info.sent_four_octet_asn = info.recv_four_octet_asn = false;
+            info.using_2_octet_asn = peer_flags & 0x20;
+            info.endOfRIB = false;
+
+            char addr[INET6_ADDRSTRLEN];
+            if (peer_flags & 0x80)
+                inet_ntop(AF_INET6, msg + 16, addr, sizeof(addr));
+            else
+                inet_ntop(AF_INET, msg + 28, addr, sizeof(addr));
+            c.peer_addrs[peer_key] = addr;
+        }
+
+        u_char *body = msg + BMP_MSG_HDR_LEN;
+        size_t body_len = len - BMP_MSG_HDR_LEN;
+
+        if (type == 0) {
+            c.route_mon.append((char *)msg, len);
+            c.route_mon_ends.push_back(c.route_mon.size());
+
+            if (body_len >= BGP_HDR_LEN and body[18] == 2 and get16(body + 16) <= body_len)
+                addUpdate(c, body, get16(body + 16), peer_key);
+
+        } else if (type == 3 and body_len > 20) {
+            size_t sent = parseOpen(body + 20, body_len - 20, c.peers[peer_key], true);
+            if (sent)
+                parseOpen(body + 20 + sent, body_len - 20 - sent, c.peers[peer_key], false);
+        }
+    }
+
+    recordCalls(c, cfg);
+    return true;
+}
+
+/**
+ * Load the .bmp files of the corpus directory, sorted by name
+ */
+static bool loadCorpusDir(vector<corpus *> &corpora, Config *cfg) {
+    DIR *dir = opendir(corpus_dir);
+    if (dir == NULL) {
+        cerr << "ERROR: Cannot open the corpus directory " << corpus_dir << ": " << strerror(errno) << endl;
+        return false;
+    }
+
+    vector<string> names;
+    struct dirent *ent;
+    while ((ent = readdir(dir)) != NULL) {
+        string name = ent->d_name;
+        if (name.size() > 4 and name.compare(name.size() - 4, 4, ".bmp") == 0)
+            names.push_back(name);
+    }
+    closedir(dir);
+
+    sort(names.begin(), names.end());
+
+    for (size_t i = 0; i < names.size(); i++) {
+        corpus *c = new corpus;
+        if (not loadCorpus(string(corpus_dir) + "/" + names[i], names[i].substr(0, names[i].size() - 4), *c, cfg))
+            return false;
+
+        corpora.push_back(c);
+    }
+
+    if (corpora.empty()) {
+        cerr << "ERROR: No .bmp files in the corpus directory " << corpus_dir << endl;
+        return false;
+    }
+
+    return true;
+}
+
+/**
+ * Run a benchmark until the min time is reached
+ */
+static bench_result runBench(const bench &b) {
+    bench_result r;
+    double ns = 0;
+    uint64_t bytes = 0, allocs = 0, alloc_size = 0;
+    size_t next = 0;
+
+    r.name = b.name;
+    r.ops = 0;
+
+    // One untimed pass to warm up the caches
+    for (size_t i = 0; i < b.items; ) {
+        size_t n = min(b.batch, b.items - i);
+        if (b.prepare)
+            n = b.prepare(i, n);
+        for (size_t k = 0; k < n; k++)
+            b.op(i + k);
+        i += n;
+    }
+
+    while (ns < min_ms * 1000000) {
+        size_t n = min(b.batch, b.items - next);
+        if (b.prepare)
+            n = b.prepare(next, n);
+
+        uint64_t count = alloc_count.load(memory_order_relaxed);
+        uint64_t size = alloc_bytes.load(memory_order_relaxed);
+        clock_type::time_point start = clock_type::now();
+
+        for (size_t k = 0; k < n; k++)
+            bytes += b.op(next + k);
+
+        ns += chrono::duration<double, nano>(clock_type::now() - start).count();
+        allocs += alloc_count.load(memory_order_relaxed) - count;
+        alloc_size += alloc_bytes.load(memory_order_relaxed) - size;
+
+        r.ops += n;
+        next = (next + n) % b.items;
+    }
+
+    r.ns_op = ns / r.ops;
+    r.allocs_op = (double)allocs / r.ops;
+    r.alloc_bytes_op = (double)alloc_size / r.ops;
+    r.bytes_op = (double)bytes / r.ops;
+    r.mbytes_sec = bytes / ns * 1000000000 / 1000000;
+
+    return r;
+}
+
+/**
+ * Add the benchmarks of a corpus
+ */
+static void addCorpusBenchmarks(vector<bench> &benches, corpus &c, Config *cfg) {
+    static MsgBusInterface::obj_bgp_peer p_entry;
+    bench b;
+
+    /*
+     * parseBMP, route monitoring messages are written to a socket and read by the parser
+     */
+    if (c.route_mon_ends.size()) {
+        int *fds = new int[2];
+        if (socketpair(PF_LOCAL, SOCK_STREAM, 0, fds) != 0) {
+            cerr << "ERROR: socketpair: " << strerror(errno) << endl;
+            exit(1);
+        }
+
+        int buf_size = 4 * BMP_BATCH_BYTES;
+        setsockopt(fds[0], SOL_SOCKET, SO_RCVBUF, &buf_size, sizeof(buf_size));
+        setsockopt(fds[1], SOL_SOCKET, SO_SNDBUF, &buf_size, sizeof(buf_size));
+
+        corpus *cp = &c;
+        b.name = "bmp_header/" + c.name;
+        b.items = c.route_mon_ends.size();
+        b.batch = 256;
+
+        // Write whole messages up to the batch bytes
+        b.prepare = [cp, fds](size_t first, size_t n) -> size_t {
+            size_t start = first ? cp->route_mon_ends[first - 1] : 0;
+            size_t count = 1;
+
+            while (count < n and cp->route_mon_ends[first + count] - start <= BMP_BATCH_BYTES)
+                count++;
+
+            size_t end = cp->route_mon_ends[first + count - 1];
+            for (size_t off = start; off < end; ) {
+                ssize_t written = write(fds[1], cp->route_mon.data() + off, end - off);
+                if (written <= 0) {
+                    cerr << "ERROR: write: " << strerror(errno) << endl;
+                    exit(1);
+                }
+                off += written;
+            }
+
+            return count;
+        };
+
+        b.op = [cp, fds](size_t i) -> size_t {
+            parseBMP *pBMP = new parseBMP(logger, &p_entry);
+            pBMP->handleMessage(fds[0]);
+            pBMP->bufferBMPMessage(fds[0]);
+            delete pBMP;
+
+            return cp->route_mon_ends[i] - (i ? cp->route_mon_ends[i - 1] : 0);
+        };
+
+        benches.push_back(b);
+    }
+
+    /*
+     * UpdateMsg
+     */
+    vector<corpus_update> *sets[] = { &c.updates, &c.big_updates };
+    const char *suffix[] = { "", "-big" };
+
+    for (int s = 0; s < 2; s++) {
+        if (sets[s]->empty())
+            continue;
+
+        vector<corpus_update> *updates = sets[s];
+        b = bench();
+        b.name = "update/" + c.name + suffix[s];
+        b.items = updates->size();
+        b.batch = 256;
+        b.op = [updates](size_t i) -> size_t {
+            corpus_update &u = (*updates)[i];
+            bgp_msg::UpdateMsg::parsed_update_data parsed_data;
+            bgp_msg::UpdateMsg uMsg(logger, *u.peer_addr, "192.0.2.1", u.peer, false);
+
+            uMsg.parseUpdateMsg(u.data, u.len, parsed_data);
+            return u.len;
+        };
+
+        benches.push_back(b);
+    }
+
+    /*
+     * ExtCommunity
+     */
+    if (c.ext_communities.size()) {
+        vector<corpus_attr> *attrs = &c.ext_communities;
+        b = bench();
+        b.name = "ext_community/" + c.name;
+        b.items = attrs->size();
+        b.batch = 256;
+        b.op = [attrs](size_t i) -> size_t {
+            corpus_attr &a = (*attrs)[i];
+            bgp_msg::UpdateMsg::parsed_update_data parsed_data;
+            bgp_msg::ExtCommunity ec(logger, *a.peer_addr, false);
+
+            ec.parseExtCommunities(a.len, a.data, parsed_data);
+            return a.len;
+        };
+
+        benches.push_back(b);
+    }
+
+    /*
+     * MPLinkState
+     */
+    if (c.ls_reach.size()) {
+        vector<corpus_attr> *attrs = &c.ls_reach;
+        b = bench();
+        b.name = "linkstate/" + c.name;
+        b.items = attrs->size();
+        b.batch = 256;
+        b.op = [attrs](size_t i) -> size_t {
+            corpus_attr &a = (*attrs)[i];
+            bgp_msg::UpdateMsg::parsed_update_data parsed_data;
+            bgp_msg::MPReachAttr::mp_reach_nlri nlri;
+
+            nlri.afi = get16(a.data);
+            nlri.safi = a.data[2];
+            nlri.nh_len = a.data[3];
+            nlri.next_hop = a.data + 4;
+            nlri.reserved = a.data[4 + nlri.nh_len];
+            nlri.nlri_data = a.data + 5 + nlri.nh_len;
+            nlri.nlri_len = a.len - 5 - nlri.nh_len;
+
+            bgp_msg::MPLinkState ls(logger, *a.peer_addr, &parsed_data, false);
+            ls.parseReachLinkState(nlri);
+            return a.len;
+        };
+
+        benches.push_back(b);
+    }
+
+    if (c.calls.empty())
+        return;
+
+    vector<bus_call> *calls = &c.calls;
+
+#ifndef REDIS_ENABLED
+    /*
+     * msgBus_kafka row encoding of the recorded calls
+     */
+    u_char c_hash[16] = { 0 };
+    EncodeOnlyKafka *kafka = new EncodeOnlyKafka(logger, cfg, c_hash);
+
+    b = bench();
+    b.name = "kafka_encode/" + c.name;
+    b.items = calls->size();
+    b.batch = 256;
+    b.op = [calls, kafka](size_t i) -> size_t {
+        bus_call &call = (*calls)[i];
+        MsgBusInterface::obj_path_attr *attr = call.has_attr ? &call.attr : NULL;
+        uint64_t before = kafka->bytes;
+
+        switch (call.type) {
+            case bus_call::BASE_ATTR :
+                kafka->update_baseAttribute(call.peer, call.attr,
+                                            (MsgBusInterface::base_attr_action_code)call.code);
+                break;
+            case bus_call::UNICAST :
+                kafka->update_unicastPrefix(call.peer, call.rib, attr,
+                                            (MsgBusInterface::unicast_prefix_action_code)call.code);
+                break;
+            case bus_call::L3VPN :
+                kafka->update_L3Vpn(call.peer, call.vpn, attr, (MsgBusInterface::vpn_action_code)call.code);
+                break;
+            case bus_call::EVPN :
+                kafka->update_eVPN(call.peer, call.evpn, attr, (MsgBusInterface::vpn_action_code)call.code);
+                break;
+            case bus_call::LS_NODE :
+                kafka->update_LsNode(call.peer, call.attr, call.ls_nodes, (MsgBusInterface::ls_action_code)call.code);
+                break;
+            case bus_call::LS_LINK :
+                kafka->update_LsLink(call.peer, call.attr, call.ls_links, (MsgBusInterface::ls_action_code)call.code);
+                break;
+            case bus_call::LS_PREFIX :
+                kafka->update_LsPrefix(call.peer, call.attr, call.ls_prefixes,
+                                       (MsgBusInterface::ls_action_code)call.code);
+                break;
+        }
+
+        return kafka->bytes - before;
+    };
+
+    benches.push_back(b);
+
+#else
+    /*
+     * RedisManager keys of the unicast prefixes, as MsgBusImpl_redis::update_unicastPrefix()
+     */
+    vector<bus_call *> *unicast = new vector<bus_call *>;
+    vector<vector<swss::FieldValueTuple> > *attr_values = new vector<vector<swss::FieldValueTuple> >;
+
+    for (size_t i = 0; i < calls->size(); i++) {
+        bus_call &call = (*calls)[i];
+        if (call.type != bus_call::UNICAST or call.rib.empty())
+            continue;
+
+        unicast->push_back(&call);
+
+        if (call.has_attr and call.code == MsgBusInterface::UNICAST_PREFIX_ACTION_ADD) {
+            MsgBusInterface::obj_path_attr &attr = call.attr;
+            vector<swss::FieldValueTuple> values;
+            values.emplace_back(make_pair("origin", attr.origin));
+            values.emplace_back(make_pair("as_path", attr.as_path));
+            values.emplace_back(make_pair("as_path_count", to_string(attr.as_path_count)));
+            values.emplace_back(make_pair("origin_as", to_string(attr.origin_as)));
+            values.emplace_back(make_pair("next_hop", attr.next_hop));
+            values.emplace_back(make_pair("local_pref", to_string(attr.local_pref)));
+            values.emplace_back(make_pair("community_list", attr.community_list));
+            values.emplace_back(make_pair("ext_community_list", attr.ext_community_list));
+            values.emplace_back(make_pair("large_community_list", attr.large_community_list));
+            values.emplace_back(make_pair("originator_id", attr.originator_id));
+            attr_values->push_back(values);
+        }
+    }
+
+    if (unicast->size()) {
+        b = bench();
+        b.name = "redis_keys/" + c.name;
+        b.items = unicast->size();
+        b.batch = 256;
+        b.op = [unicast](size_t i) -> size_t {
+            bus_call &call = *(*unicast)[i];
+            const string table = call.peer.isAdjIn ? BMP_TABLE_RIB_IN : BMP_TABLE_RIB_OUT;
+            size_t bytes = 0;
+
+            for (size_t k = 0; k < call.rib.size(); k++) {
+                string pfx = call.rib[k].prefix;
+                pfx += "/";
+                pfx += to_string(call.rib[k].prefix_len);
+
+                vector<string> keys;
+                keys.reserve(2);
+                keys.emplace_back(pfx);
+                keys.emplace_back(call.peer.peer_addr);
+
+                string key;
+                RedisManager::BuildKey(table, keys, "|", key);
+                bytes += key.size();
+            }
+
+            return bytes;
+        };
+
+        benches.push_back(b);
+    }
+
+    if (attr_values->size()) {
+        b = bench();
+        b.name = "redis_attr_id/" + c.name;
+        b.items = attr_values->size();
+        b.batch = 256;
+        b.op = [attr_values](size_t i) -> size_t {
+            vector<swss::FieldValueTuple> &values = (*attr_values)[i];
+            string attr_id;
+            size_t bytes = 0;
+
+            RedisManager::GetAttrId(values, attr_id);
+
+            for (size_t k = 0; k < values.size(); k++)
+                bytes += get<1>(values[k]).size() + 1;
+
+            return bytes;
+        };
+
+        benches.push_back(b);
+    }
+#endif
+}
+
+/**
+ * Add the MD5 benchmarks, over bytes of the corpus
+ */
+static void addMd5Benchmarks(vector<bench> &benches, corpus &c) {
+    static const size_t sizes[] = { 16, 64, 256, 1500 };
+
+    for (size_t s = 0; s < sizeof(sizes) / sizeof(sizes[0]); s++) {
+        size_t size = sizes[s];
+        if (c.data.size() < size)
+            continue;
+
+        corpus *cp = &c;
+        bench b;
+        b.name = "md5/" + to_string(size);
+        b.items = min((size_t)1024, c.data.size() / size);
+        b.batch = 256;
+        b.op = [cp, size](size_t i) -> size_t {
+            MD5 hash;
+
+            hash.update(cp->data.data() + i * size, size);
+            hash.finalize();
+
+            unsigned char *digest = hash.raw_digest();
+            delete[] digest;
+            return size;
+        };
+
+        benches.push_back(b);
+    }
+}
+
+/**
+ * Read the results of a JSON file written by writeJson()
+ */
+static bool readJson(const char *path, map<string, bench_result> &results) {
+    ifstream in(path);
+    if (not in) {
+        cerr << "ERROR: Cannot open " << path << endl;
+        return false;
+    }
+
+    string line;
+    while (getline(in, line)) {
+        size_t pos = line.find("\"name\": \"");
+        if (pos == string::npos)
+            continue;
+
+        pos += 9;
+        size_t end = line.find('"', pos);
+        if (end == string::npos)
+            continue;
+
+        bench_result r;
+        r.name = line.substr(pos, end - pos);
+
+        pos = line.find("\"ns_per_op\": ");
+        if (pos == string::npos)
+            continue;
+
+        r.ns_op = atof(line.c_str() + pos + 13);
+
+        pos = line.find("\"allocs_per_op\": ");
+        r.allocs_op = pos != string::npos ? atof(line.c_str() + pos + 17) : 0;
+
+        results[r.name] = r;
+    }
+
+    return true;
+}
+
+/**
+ * Write the results as JSON, one result per line
+ */
+static bool writeJson(const char *path, const char *label, const vector<bench_result> &results) {
+    FILE *out = strcmp(path, "-") ? fopen(path, "w") : stdout;
+    if (out == NULL) {
+        cerr << "ERROR: Cannot write " << path << ": " << strerror(errno) << endl;
+        return false;
+    }
+
+    char ts[32];
+    time_t now = time(NULL);
+    strftime(ts, sizeof(ts), "%Y-%m-%dT%H:%M:%SZ", gmtime(&now));
+
+    fprintf(out, "{\n  \"label\": \"%s\",\n  \"time\": \"%s\",\n  \"corpus\": \"%s\",\n",
+            label, ts, corpus_dir);
+#ifndef REDIS_ENABLED
+    fprintf(out, "  \"build\": \"kafka\",\n");
+#else
+    fprintf(out, "  \"build\": \"redis\",\n");
+#endif
+    fprintf(out, "  \"results\": [\n");
+
+    for (size_t i = 0; i < results.size(); i++) {
+        const bench_result &r = results[i];
+        fprintf(out, "    { \"name\": \"%s\", \"ops\": %llu, \"ns_per_op\": %.1f, \"allocs_per_op\": %.2f, "
+                     "\"alloc_bytes_per_op\": %.1f, \"bytes_per_op\": %.1f, \"bytes_per_sec\": %.0f }%s\n",
+                r.name.c_str(), (unsigned long long)r.ops, r.ns_op, r.allocs_op, r.alloc_bytes_op,
+                r.bytes_op, r.mbytes_sec * 1000000, i + 1 < results.size() ? "," : "");
+    }
+
+    fprintf(out, "  ]\n}\n");
+
+    if (out != stdout)
+        fclose(out);
+
+    return true;
+}
+
+int main(int argc, char **argv) {
+    const char *json = NULL;
+    const char *label = "";
+    const char *baseline_file = NULL;
+    map<string, bench_result> baseline;
+
+    for (int i = 1; i < argc; i++) {
+        if (not strcmp(argv[i], "-h")) {
+            Usage(argv[0]);
+            exit(0);
+
+        } else if (argv[i][0] == '-' and argv[i][1] != 0 and argv[i][2] == 0 and strchr("cftjnbl", argv[i][1])) {
+            if (i + 1 >= argc) {
+                cerr << "INVALID ARG: " << argv[i] << " requires a value" << endl;
+                return 1;
+            }
+
+            char opt = argv[i][1];
+            const char *value = argv[++i];
+
+            switch (opt) {
+                case 'c' : corpus_dir = value; break;
+                case 'f' : filter = value; break;
+                case 't' : min_ms = atof(value); break;
+                case 'j' : json = value; break;
+                case 'n' : label = value; break;
+                case 'b' : baseline_file = value; break;
+                case 'l' : log_file = value; break;
+            }
+
+        } else {
+            cerr << "INVALID ARG: " << argv[i] << endl;
+            Usage(argv[0]);
+            return 1;
+        }
+    }
+
+    if (min_ms <= 0) {
+        cerr << "INVALID ARG: -t must be more than 0" << endl;
+        return 1;
+    }
+
+    if (baseline_file != NULL and not readJson(baseline_file, baseline))
+        return 1;
+
+    try {
+        logger = new Logger(log_file, log_file);
+    } catch (char const *str) {
+        cerr << "ERROR: Cannot open the log file " << log_file << ": " << str << endl;
+        return 1;
+    }
+
+    Config *cfg = new Config();
+
+    vector<corpus *> corpora;
+    if (not loadCorpusDir(corpora, cfg))
+        return 1;
+
+    vector<bench> benches;
+    for (size_t i = 0; i < corpora.size(); i++)
+        addCorpusBenchmarks(benches, *corpora[i], cfg);
+
+    addMd5Benchmarks(benches, *corpora[0]);
+
+    // Text results go to stderr when the JSON goes to stdout
+    ostream &out = json != NULL and not strcmp(json, "-") ? cerr : cout;
+    char line[256];
+
+    snprintf(line, sizeof(line), "%-28s %10s %10s %10s %12s %10s%s", "benchmark", "ops", "ns/op", "allocs/op",
+             "alloc B/op", "MB/s", baseline.size() ? "   vs base" : "");
+    out << line << endl;
+
+    vector<bench_result> results;
+    for (size_t i = 0; i < benches.size(); i++) {
+        if (filter != NULL and benches[i].name.find(filter) == string::npos)
+            continue;
+
+        bench_result r = runBench(benches[i]);
+        results.push_back(r);
+
+        snprintf(line, sizeof(line), "%-28s %10llu %10.1f %10.2f %12.1f %10.1f", r.name.c_str(),
+                 (unsigned long long)r.ops, r.ns_op, r.allocs_op, r.alloc_bytes_op, r.mbytes_sec);
+        out << line;
+
+        map<string, bench_result>::iterator base = baseline.find(r.name);
+        if (base != baseline.end() and base->second.ns_op > 0) {
+            snprintf(line, sizeof(line), " %+9.1f%%", (r.ns_op / base->second.ns_op - 1) * 100);
+            out << line;
+        }
+        out << endl;
+    }
+
+    if (json != NULL and not writeJson(json, label, results))
+        return 1;
+
+    return 0;
+}
@@ -0,0 +1,1090 @@
+/*
+ * Copyright (c) 2024 Microsoft, Inc. and others.  All rights reserved.
+ *
+ * This program and the accompanying materials are made available under the
+ * terms of the Eclipse Public License v1.0 which accompanies this distribution,
+ * and is available at http://www.eclipse.org/legal/epl-v10.html
+ *
+ */
+
+/**
+ * \file    openbmp_gen.cpp
+ *
+ * \brief   Generates synthetic BMP streams for scale testing
+ * \details Each router sends INIT, a PEER_UP per peer (OPENs with 4-octet AS and
+ *          optionally ADD-PATH capabilities), the RIB of each peer as route monitoring
+ *          UPDATEs followed by End-of-RIB and a STATS report, then churn (announcements
+ *          with new attributes and withdrawals) at a rate, and TERM.
+ *
+ *          The RIB is split over IPv4, IPv6, VPNv4, EVPN and BGP-LS by a mix.  All peers
+ *          of a router have the same prefixes, with per peer attributes.  Prefixes of an
+ *          UPDATE share one of the attribute sets (AS path length, communities, MED,...).
+ *
+ *          The streams are sent to a collector, one connection per router, or written to
+ *          one file per router (replayable with openbmp_replay).
+ */
+
+#include <sys/types.h>
+#include <sys/socket.h>
+#include <netinet/in.h>
+#include <arpa/inet.h>
+#include <netdb.h>
+#include <unistd.h>
+#include <csignal>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <cerrno>
+#include <cstdint>
+#include <ctime>
+
+#include <iostream>
+#include <string>
+#include <vector>
+#include <thread>
+#include <chrono>
+#include <random>
+#include <algorithm>
+
+using namespace std;
+
+#define BGP_MAX_LEN             4096            // Max BGP message size
+#define OUT_BLOCK_SIZE          (256 * 1024)    // Bytes generated before they are sent/written
+#define ROUTER_AS               65000           // AS of the routers
+#define AS_TRANS                23456
+
+typedef chrono::steady_clock clock_type;
+
+/*
+ * Address families of the RIB, BGP-LS has node and prefix NLRIs
+ */
+enum gen_family {
+    FAM_IPV4 = 0,
+    FAM_IPV6,
+    FAM_VPNV4,
+    FAM_EVPN,
+    FAM_LS_NODE,
+    FAM_LS_PREFIX,
+    FAM_COUNT
+};
+
+static const char     *fam_names[FAM_COUNT] = { "ipv4", "ipv6", "vpnv4", "evpn", "ls", "ls" };
+static const uint16_t  fam_afi[FAM_COUNT]   = { 1, 2, 1, 25, 16388, 16388 };
+static const uint8_t   fam_safi[FAM_COUNT]  = { 1, 1, 128, 70, 71, 71 };
+
+/*
+ * BGP peer of a router
+ */
+struct gen_peer {
+    uint32_t    addr;                           // IPv4 address, also the BGP ID
+    uint32_t    as;
+};
+
+/*
+ * Generated stream of one router
+ */
+struct gen_router {
+    int         index;
+    string      source;                         // Source address, empty for any
+    string      path;                           // Output file, empty to send to the collector
+    int         sock;
+    FILE        *file;
+    string      buf;                            // Generated bytes not sent/written yet
+    vector<gen_peer> peers;
+    mt19937     rng;
+
+    uint32_t    ts_sec;                         // Per peer header timestamp
+    uint32_t    ts_usec;
+
+    uint64_t    messages;
+    uint64_t    prefixes;                       // Prefixes/NLRIs announced or withdrawn
+    uint64_t    bytes;
+    double      secs;
+    string      error;
+};
+
+static const char *host         = "127.0.0.1"; // Collector address
+static const char *port         = "5000";      // Collector BMP port
+static int         peers        = 4;           // Peers per router
+static uint32_t    prefixes     = 10000;       // RIB size of each peer
+static int         per_update   = 10;          // Max prefixes per UPDATE
+static int         attr_sets    = 100;         // Attribute sets per peer
+static int         add_paths    = 0;           // Paths per IPv4/IPv6 prefix with ADD-PATH, 0 for none
+static double      churn_rate   = 0;           // Churn UPDATEs per second per router
+static double      churn_secs   = 10;          // Churn duration
+static int         withdraw_pct = 20;          // Percent of churn UPDATEs that withdraw
+static double      stats_secs   = 0;           // STATS interval during churn, 0 for none
+static unsigned    seed         = 1;
+static bool        verbose      = false;
+
+static uint32_t    fam_count[FAM_COUNT];        // Prefixes of each family per peer
+
+/**
+ * Usage of the program
+ */
+void Usage(char *prog) {
+    cout << "Usage: " << prog << " <options>" << endl;
+    cout << endl << "  Generates synthetic BMP streams and sends them to a collector or writes them to files" << endl;
+
+    cout << endl << "  OPTIONS:" << endl;
+    cout << "     -n <count>        Number of routers (default is 1)" << endl;
+    cout << "     -P <count>        Peers per router (default is 4)" << endl;
+    cout << "     -x <count>        Prefixes per peer (default is 10000)" << endl;
+    cout << "     -u <count>        Max prefixes per UPDATE, less when the UPDATE is full (default is 10)" << endl;
+    cout << "     -a <count>        Attribute sets per peer (default is 100)" << endl;
+    cout << "     -m <mix>          Address family mix in percent of the prefixes, for example" << endl;
+    cout << "                       ipv4=60,ipv6=30,vpnv4=5,evpn=3,ls=2 (default is ipv4=100)" << endl;
+    cout << "     -A <paths>        ADD-PATH for IPv4/IPv6 with this many paths per prefix (default is 0, off)" << endl;
+    cout << "     -c <rate>         Churn UPDATEs per second per router after the RIB (default is 0)" << endl;
+    cout << "     -t <seconds>      Churn duration (default is 10)" << endl;
+    cout << "     -w <percent>      Percent of churn UPDATEs that withdraw (default is 20)" << endl;
+    cout << "     -S <seconds>      STATS report interval during churn, 0 for after the RIB only (default is 0)" << endl;
+    cout << "     -r <seed>         Random seed (default is 1)" << endl;
+    cout << "     -o <dir>          Write each router to <dir>/router<N>.bmp instead of sending" << endl;
+    cout << "     -d <host>         Collector address (default is 127.0.0.1)" << endl;
+    cout << "     -p <port>         Collector BMP port (default is 5000)" << endl;
+    cout << "     -b <address>      Source IPv4 address of the first router, the next routers use the" << endl;
+    cout << "                       next addresses (for example 127.0.1.1)" << endl;
+    cout << "     -v                Report each router" << endl;
+    cout << "     -h                Help" << endl;
+    cout << endl;
+}
+
+static inline void put8(string &s, uint8_t v) {
+    s += (char)v;
+}
+
+static inline void put16(string &s, uint16_t v) {
+    s += (char)(v >> 8);
+    s += (char)v;
+}
+
+static inline void put32(string &s, uint32_t v) {
+    put16(s, v >> 16);
+    put16(s, v);
+}
+
+static inline void put64(string &s, uint64_t v) {
+    put32(s, v >> 32);
+    put32(s, v);
+}
+
+static inline void patch16(string &s, size_t pos, uint16_t v) {
+    s[pos] = (char)(v >> 8);
+    s[pos + 1] = (char)v;
+}
+
+static inline void patch32(string &s, size_t pos, uint32_t v) {
+    patch16(s, pos, v >> 16);
+    patch16(s, pos + 2, v);
+}
+
+/**
+ * Start a BMP message, ended by endBmp()
+ *
+ * \return position of the message
+ */
+static size_t beginBmp(string &s, uint8_t type) {
+    size_t pos = s.size();
+
+    put8(s, 3);
+    put32(s, 0);
+    put8(s, type);
+
+    return pos;
+}
+
+static void endBmp(string &s, size_t pos) {
+    patch32(s, pos + 1, s.size() - pos);
+}
+
+/**
+ * Start a BGP message, ended by endBgp()
+ */
+static size_t beginBgp(string &s, uint8_t type) {
+    size_t pos = s.size();
+
+    s.append(16, (char)0xff);
+    put16(s, 0);
+    put8(s, type);
+
+    return pos;
+}
+
+static void endBgp(string &s, size_t pos) {
+    patch16(s, pos + 16, s.size() - pos);
+}
+
+/**
+ * Start a path attribute (extended length), ended by endAttr()
+ */
+static size_t beginAttr(string &s, uint8_t flags, uint8_t type) {
+    size_t pos = s.size();
+
+    put8(s, flags | 0x10);
+    put8(s, type);
+    put16(s, 0);
+
+    return pos;
+}
+
+static void endAttr(string &s, size_t pos) {
+    patch16(s, pos + 2, s.size() - pos - 4);
+}
+
+/**
+ * Add an MPLS label with the bottom of stack bit
+ */
+static void putLabel(string &s, uint32_t label) {
+    put8(s, label >> 12);
+    put8(s, label >> 4);
+    put8(s, (label << 4) | 1);
+}
+
+/**
+ * Indicates if a family is in the OPEN capabilities and has an End-of-RIB, BGP-LS by FAM_LS_NODE
+ */
+static bool familyUsed(int fam) {
+    return fam == FAM_IPV4 or fam_count[fam] or (fam == FAM_LS_NODE and fam_count[FAM_LS_PREFIX]);
+}
+
+/**
+ * Add a TLV with a string value
+ */
+static void putTlv(string &s, uint16_t type, const string &value) {
+    put16(s, type);
+    put16(s, value.size());
+    s += value;
+}
+
+static void putPeerHeader(string &s, gen_router &r, const gen_peer &peer) {
+    put8(s, 0);                                 // Global instance peer
+    put8(s, 0);                                 // IPv4, pre-policy, 4-octet AS path
+    s.append(8, 0);                             // Peer distinguisher
+    s.append(12, 0);
+    put32(s, peer.addr);
+    put32(s, peer.as);
+    put32(s, peer.addr);                        // BGP ID
+    put32(s, r.ts_sec);
+    put32(s, r.ts_usec);
+}
+
+/**
+ * Add a BGP OPEN with the capabilities of the generated families
+ */
+static void putOpen(string &s, uint32_t as, uint32_t bgp_id) {
+    size_t pos = beginBgp(s, 1);
+
+    put8(s, 4);
+    put16(s, as > 0xffff ? AS_TRANS : as);
+    put16(s, 180);
+    put32(s, bgp_id);
+
+    size_t params = s.size();
+    put8(s, 0);
+    put8(s, 2);                                 // Capabilities
+    put8(s, 0);
+
+    for (int f = 0; f < FAM_LS_PREFIX; f++) {
+        if (not familyUsed(f))
+            continue;
+
+        put8(s, 1);                             // Multiprotocol
+        put8(s, 4);
+        put16(s, fam_afi[f]);
+        put8(s, 0);
+        put8(s, fam_safi[f]);
+    }
+
+    put8(s, 2);                                 // Route refresh
+    put8(s, 0);
+
+    put8(s, 65);                                // 4-octet AS
+    put8(s, 4);
+    put32(s, as);
+
+    if (add_paths > 0) {
+        put8(s, 69);                            // ADD-PATH, send and receive
+        put8(s, 8);
+        put16(s, 1);
+        put8(s, 1);
+        put8(s, 3);
+        put16(s, 2);
+        put8(s, 1);
+        put8(s, 3);
+    }
+
+    s[params] = (char)(s.size() - params - 1);
+    s[params + 2] = (char)(s.size() - params - 3);
+
+    endBgp(s, pos);
+}
+
+/**
+ * Add the local node descriptors of a BGP-LS node
+ */
+static void putLsNode(string &s, uint32_t node) {
+    put16(s, 256);
+    put16(s, 24);
+    put16(s, 512);                              // AS
+    put16(s, 4);
+    put32(s, ROUTER_AS);
+    put16(s, 513);                              // BGP-LS identifier
+    put16(s, 4);
+    put32(s, 0);
+    put16(s, 515);                              // IGP router ID (OSPF)
+    put16(s, 4);
+    put32(s, 0x0a800000 + node);
+}
+
+/**
+ * Add the NLRI of prefix i of a family
+ *
+ * \param [in] path_id  ADD-PATH path identifier, 0 for none
+ */
+static void putNlri(string &s, int fam, uint32_t i, uint32_t path_id, bool withdraw) {
+    uint32_t addr;
+    size_t pos;
+
+    if (path_id)
+        put32(s, path_id);
+
+    switch (fam) {
+        case FAM_IPV4 :
+            addr = 0x01000000 + (i << 8);
+            put8(s, 24);
+            put8(s, addr >> 24);
+            put8(s, addr >> 16);
+            put8(s, addr >> 8);
+            break;
+
+        case FAM_IPV6 :
+            put8(s, 48);
+            put16(s, 0x2a0b);
+            put32(s, i);
+            break;
+
+        case FAM_VPNV4 :
+            addr = 0x0a000000 + ((i / 64) << 8);
+            put8(s, 24 + 64 + 24);
+            if (withdraw) {
+                put16(s, 0x8000);
+                put8(s, 0);
+            } else {
+                putLabel(s, 16 + i % 1000);
+            }
+            put16(s, 0);                        // RD type 0
+            put16(s, ROUTER_AS);
+            put32(s, 1 + i % 64);
+            put8(s, addr >> 24);
+            put8(s, addr >> 16);
+            put8(s, addr >> 8);
+            break;
+
+        case FAM_EVPN :
+            put8(s, 2);                         // MAC/IP advertisement
+            put8(s, 37);
+            put16(s, 0);
+            put16(s, ROUTER_AS);
+            put32(s, 1 + i % 64);
+            s.append(10, 0);                    // ESI
+            put32(s, 0);                        // Ethernet tag
+            put8(s, 48);
+            put16(s, 0x0200);
+            put32(s, i);
+            put8(s, 32);
+            put32(s, 0x64400000 + i);
+            putLabel(s, 100 + i % 1000);
+            break;
+
+        case FAM_LS_NODE :
+            put16(s, 1);
+            pos = s.size();
+            put16(s, 0);
+            put8(s, 3);                         // OSPFv2
+            put64(s, 0);
+            putLsNode(s, i);
+            patch16(s, pos, s.size() - pos - 2);
+            break;
+
+        case FAM_LS_PREFIX :
+            addr = 0x0b000000 + (i << 8);
+            put16(s, 3);
+            pos = s.size();
+            put16(s, 0);
+            put8(s, 3);
+            put64(s, 0);
+            putLsNode(s, i / 16);
+            put16(s, 265);                      // IP reachability
+            put16(s, 4);
+            put8(s, 24);
+            put8(s, addr >> 24);
+            put8(s, addr >> 16);
+            put8(s, addr >> 8);
+            patch16(s, pos, s.size() - pos - 2);
+            break;
+    }
+}
+
+/**
+ * Add the path attributes of an attribute set, other than MP_REACH_NLRI
+ */
+static void putAttrs(string &s, const gen_peer &peer, int fam, uint32_t k) {
+    bool big = k % 16 == 15;                    // Long prepended AS path, many communities
+    int as_count = big ? 24 : 1 + k % 6;
+    int communities = big ? 40 : k % 7;
+    size_t pos;
+
+    pos = beginAttr(s, 0x40, 1);                // ORIGIN
+    put8(s, k % 3);
+    endAttr(s, pos);
+
+    pos = beginAttr(s, 0x40, 2);                // AS_PATH, AS_SEQUENCE
+    put8(s, 2);
+    put8(s, as_count);
+    put32(s, peer.as);
+    for (int j = 1; j < as_count; j++) {
+        if (big and j > 4)
+            put32(s, 4200000000U + k % 10000);
+        else if ((k + j) % 3 == 0)
+            put32(s, 4200000000U + (k * 31 + j) % 10000);
+        else
+            put32(s, 64512 + (k * 13 + j) % 1000);
+    }
+    endAttr(s, pos);
+
+    if (fam == FAM_IPV4) {
+        pos = beginAttr(s, 0x40, 3);            // NEXT_HOP
+        put32(s, peer.addr);
+        endAttr(s, pos);
+    }
+
+    pos = beginAttr(s, 0x80, 4);                // MED
+    put32(s, k * 10);
+    endAttr(s, pos);
+
+    if (communities) {
+        pos = beginAttr(s, 0xc0, 8);
+        for (int j = 0; j < communities; j++)
+            put32(s, (ROUTER_AS << 16) | ((k + j) & 0xffff));
+        endAttr(s, pos);
+    }
+
+    if (fam == FAM_VPNV4 or fam == FAM_EVPN) {
+        pos = beginAttr(s, 0xc0, 16);           // Extended communities
+        put8(s, 0);                             // Route target, 2-octet AS
+        put8(s, 2);
+        put16(s, ROUTER_AS);
+        put32(s, 1 + k % 64);
+
+        if (k % 2) {
+            put8(s, 2);                         // Route target, 4-octet AS
+            put8(s, 2);
+            put32(s, 4200000000U + k % 10000);
+            put16(s, 1 + k % 64);
+        }
+
+        put8(s, 1);                             // Route origin, IPv4 address
+        put8(s, 3);
+        put32(s, peer.addr);
+        put16(s, k % 16);
+
+        if (fam == FAM_EVPN) {
+            put8(s, 3);                         // Encapsulation, VXLAN
+            put8(s, 0x0c);
+            put32(s, 0);
+            put16(s, 8);
+
+            put8(s, 6);                         // MAC mobility
+            put8(s, 0);
+            put8(s, k % 2);
+            put8(s, 0);
+            put32(s, k);
+        }
+        endAttr(s, pos);
+
+    } else if (k % 4 == 1 and (fam == FAM_IPV4 or fam == FAM_IPV6)) {
+        pos = beginAttr(s, 0xc0, 16);           // Route origin, 4-octet AS
+        put8(s, 2);
+        put8(s, 3);
+        put32(s, peer.as);
+        put16(s, k % 16);
+        endAttr(s, pos);
+    }
+
+    if (fam == FAM_LS_NODE) {
+        pos = beginAttr(s, 0x80, 29);
+        putTlv(s, 1026, "gen-node-" + to_string(k));
+        endAttr(s, pos);
+
+    } else if (fam == FAM_LS_PREFIX) {
+        pos = beginAttr(s, 0x80, 29);
+        put16(s, 1155);                         // Prefix metric
+        put16(s, 4);
+        put32(s, k);
+        endAttr(s, pos);
+    }
+}
+
+/**
+ * Add a BGP UPDATE of prefixes first, first + stride, ...
+ *
+ * \details A withdraw without prefixes is the End-of-RIB of the family
+ *
+ * \param [in] count    Max prefixes, less are added when the UPDATE is full
+ * \param [in] k        Attribute set
+ * \param [in] path_id  ADD-PATH path identifier, 0 for none
+ *
+ * \return number of prefixes added
+ */
+static uint32_t putUpdate(string &s, const gen_peer &peer, int fam, uint32_t first, uint32_t count,
+                          uint32_t stride, uint32_t k, uint32_t path_id, bool withdraw) {
+    size_t bgp = beginBgp(s, 2);
+    size_t max_end = bgp + BGP_MAX_LEN;
+    uint32_t n = 0;
+
+    auto nlris = [&] {
+        while (n < count) {
+            size_t before = s.size();
+            putNlri(s, fam, first + n * stride, path_id, withdraw);
+
+            if (s.size() > max_end) {
+                s.resize(before);
+                break;
+            }
+            n++;
+        }
+    };
+
+    size_t pos = s.size();
+    put16(s, 0);
+    if (fam == FAM_IPV4 and withdraw) {
+        nlris();
+        patch16(s, pos, s.size() - pos - 2);
+    }
+
+    pos = s.size();
+    put16(s, 0);
+
+    if (not withdraw)
+        putAttrs(s, peer, fam, k);
+
+    if (fam != FAM_IPV4) {
+        size_t mp = beginAttr(s, 0x80, withdraw ? 15 : 14);
+        put16(s, fam_afi[fam]);
+        put8(s, fam_safi[fam]);
+
+        if (not withdraw) {
+            switch (fam) {
+                case FAM_IPV6 :
+                    put8(s, 16);
+                    put32(s, 0x20010db8);
+                    put64(s, 0);
+                    put32(s, peer.addr);
+                    break;
+
+                case FAM_VPNV4 :
+                    put8(s, 12);
+                    put64(s, 0);                // RD of the next hop
+                    put32(s, peer.addr);
+                    break;
+
+                default :
+                    put8(s, 4);
+                    put32(s, peer.addr);
+                    break;
+            }
+            put8(s, 0);                         // Reserved
+        }
+
+        nlris();
+        endAttr(s, mp);
+    }
+
+    patch16(s, pos, s.size() - pos - 2);
+
+    if (fam == FAM_IPV4 and not withdraw)
+        nlris();
+
+    endBgp(s, bgp);
+    return n;
+}
+
+/**
+ * Send or write the generated bytes
+ *
+ * \param [in] all      Write all bytes, else only when a block is generated
+ *
+ * \return false on error
+ */
+static bool output(gen_router &r, bool all = false) {
+    if (r.buf.empty() or (not all and r.buf.size() < OUT_BLOCK_SIZE))
+        return r.error.empty();
+
+    if (r.file != NULL) {
+        if (fwrite(r.buf.data(), 1, r.buf.size(), r.file) != r.buf.size())
+            r.error = string("write ") + r.path + ": " + strerror(errno);
+
+    } else {
+        const char *data = r.buf.data();
+        size_t len = r.buf.size();
+
+        while (len > 0 and r.error.empty()) {
+            ssize_t sent = send(r.sock, data, len, 0);
+
+            if (sent < 0 and errno != EINTR)
+                r.error = strerror(errno);
+            else if (sent > 0) {
+                data += sent;
+                len -= sent;
+            }
+        }
+    }
+
+    r.bytes += r.buf.size();
+    r.buf.clear();
+
+    return r.error.empty();
+}
+
+/**
+ * Connect to the collector
+ *
+ * \return socket, -1 on error
+ */
+static int connectCollector(const string &source, string &error) {
+    addrinfo hints, *res;
+
+    memset(&hints, 0, sizeof(hints));
+    hints.ai_family = source.size() ? AF_INET : AF_UNSPEC;
+    hints.ai_socktype = SOCK_STREAM;
+
+    int rc = getaddrinfo(host, port, &hints, &res);
+    if (rc != 0) {
+        error = gai_strerror(rc);
+        return -1;
+    }
+
+    int sock = socket(res->ai_family, res->ai_socktype, res->ai_protocol);
+
+    if (sock >= 0 and source.size()) {
+        sockaddr_in addr;
+        memset(&addr, 0, sizeof(addr));
+        addr.sin_family = AF_INET;
+        inet_pton(AF_INET, source.c_str(), &addr.sin_addr);
+
+        if (bind(sock, (sockaddr *)&addr, sizeof(addr)) != 0) {
+            error = string("bind ") + source + ": " + strerror(errno);
+            close(sock);
+            sock = -1;
+        }
+    }
+
+    if (sock >= 0 and connect(sock, res->ai_addr, res->ai_addrlen) != 0) {
+        error = strerror(errno);
+        close(sock);
+        sock = -1;
+    }
+
+    freeaddrinfo(res);
+    return sock;
+}
+
+/**
+ * Add a route monitoring message
+ */
+static uint32_t putRouteMon(gen_router &r, const gen_peer &peer, int fam, uint32_t first, uint32_t count,
+                            uint32_t stride, uint32_t k, uint32_t path_id, bool withdraw) {
+    size_t pos = beginBmp(r.buf, 0);
+
+    putPeerHeader(r.buf, r, peer);
+    uint32_t n = putUpdate(r.buf, peer, fam, first, count, stride, k, path_id, withdraw);
+    endBmp(r.buf, pos);
+
+    r.messages++;
+    r.prefixes += n;
+    return n;
+}
+
+/**
+ * Add a STATS report of a peer
+ */
+static void putStats(gen_router &r, const gen_peer &peer, uint64_t routes) {
+    size_t pos = beginBmp(r.buf, 1);
+
+    putPeerHeader(r.buf, r, peer);
+    put32(r.buf, 2);
+    put16(r.buf, 0);                            // Prefixes rejected by inbound policy
+    put16(r.buf, 4);
+    put32(r.buf, 0);
+    put16(r.buf, 7);                            // Routes in Adj-RIBs-In
+    put16(r.buf, 8);
+    put64(r.buf, routes);
+    endBmp(r.buf, pos);
+
+    r.messages++;
+}
+
+/**
+ * Paths of a prefix of a family
+ */
+static uint32_t familyPaths(int fam) {
+    return add_paths > 0 and (fam == FAM_IPV4 or fam == FAM_IPV6) ? add_paths : 1;
+}
+
+/**
+ * Generate the stream of a router, runs on its own thread
+ */
+static void generateRouter(gen_router *r, clock_type::time_point start) {
+    time_t now = time(NULL);
+    uint32_t router_addr = 0x0aff0000 + r->index;
+    uint64_t routes = 0;
+    size_t pos;
+
+    r->ts_sec = now;
+    r->ts_usec = 0;
+
+    for (int f = 0; f < FAM_COUNT; f++)
+        routes += (uint64_t)fam_count[f] * familyPaths(f);
+
+    if (r->path.size()) {
+        if ((r->file = fopen(r->path.c_str(), "w")) == NULL) {
+            r->error = string("open ") + r->path + ": " + strerror(errno);
+            return;
+        }
+
+    } else if ((r->sock = connectCollector(r->source, r->error)) < 0) {
+        return;
+    }
+
+    pos = beginBmp(r->buf, 4);                  // INIT
+    putTlv(r->buf, 1, "openbmp_gen synthetic router");
+    putTlv(r->buf, 2, "gen-router-" + to_string(r->index));
+    endBmp(r->buf, pos);
+    r->messages++;
+
+    for (size_t p = 0; p < r->peers.size(); p++) {
+        gen_peer &peer = r->peers[p];
+
+        pos = beginBmp(r->buf, 3);              // PEER_UP
+        putPeerHeader(r->buf, *r, peer);
+        r->buf.append(12, 0);
+        put32(r->buf, router_addr);             // Local address
+        put16(r->buf, 179);
+        put16(r->buf, 30000 + p % 30000);
+        putOpen(r->buf, ROUTER_AS, router_addr);
+        putOpen(r->buf, peer.as, peer.addr);
+        endBmp(r->buf, pos);
+        r->messages++;
+    }
+
+    /*
+     * RIB, the UPDATEs of the peers are interleaved
+     */
+    for (int f = 0; f < FAM_COUNT and r->error.empty(); f++) {
+        for (uint32_t path = 1; path <= familyPaths(f); path++) {
+            for (uint32_t k = 0; k < (uint32_t)attr_sets and k < fam_count[f]; k++) {
+                uint32_t group = (fam_count[f] - 1 - k) / attr_sets + 1;
+                uint32_t attr = (k + path - 1) % attr_sets;
+
+                for (uint32_t m = 0; m < group and output(*r); ) {
+                    uint32_t n = min((uint32_t)per_update, group - m);
+
+                    for (size_t p = 0; p < r->peers.size(); p++)
+                        n = putRouteMon(*r, r->peers[p], f, k + m * attr_sets, n, attr_sets, attr,
+                                        familyPaths(f) > 1 ? path : 0, false);
+                    m += n;
+                }
+            }
+        }
+    }
+
+    for (size_t p = 0; p < r->peers.size() and r->error.empty(); p++) {
+        for (int f = 0; f < FAM_LS_PREFIX; f++) {
+            if (familyUsed(f))
+                putRouteMon(*r, r->peers[p], f, 0, 0, 1, 0, 0, true);     // End-of-RIB
+        }
+
+        putStats(*r, r->peers[p], routes);
+    }
+
+    /*
+     * Churn, paced when sending
+     */
+    uint64_t churn = churn_rate * churn_secs;
+    uint32_t total_weight = 0;
+    uint64_t stats_count = 0;
+
+    for (int f = 0; f < FAM_COUNT; f++)
+        total_weight += fam_count[f];
+
+    clock_type::time_point churn_start = clock_type::now();
+
+    for (uint64_t c = 0; c < churn and total_weight and output(*r); c++) {
+        double offset = c / churn_rate;
+
+        r->ts_sec = now + (uint32_t)offset;
+        r->ts_usec = (offset - (uint32_t)offset) * 1000000;
+
+        if (r->file == NULL) {
+            clock_type::time_point due = churn_start + chrono::microseconds((uint64_t)(offset * 1000000));
+
+            if (clock_type::now() + chrono::milliseconds(1) < due) {
+                output(*r, true);
+                this_thread::sleep_until(due);
+            }
+        }
+
+        if (stats_secs > 0 and offset >= (stats_count + 1) * stats_secs) {
+            for (size_t p = 0; p < r->peers.size(); p++)
+                putStats(*r, r->peers[p], routes);
+            stats_count++;
+        }
+
+        int f = 0;
+        for (uint32_t w = r->rng() % total_weight; w >= fam_count[f]; f++)
+            w -= fam_count[f];
+
+        uint32_t first = r->rng() % fam_count[f];
+        uint32_t count = min((uint32_t)per_update, fam_count[f] - first);
+        bool withdraw = (int)(r->rng() % 100) < withdraw_pct;
+        uint32_t path_id = familyPaths(f) > 1 ? 1 + r->rng() % familyPaths(f) : 0;
+
+        putRouteMon(*r, r->peers[r->rng() % r->peers.size()], f, first, count, 1, r->rng() % attr_sets,
+                    path_id, withdraw);
+    }
+
+    pos = beginBmp(r->buf, 5);                  // TERM, administratively closed
+    putTlv(r->buf, 0, "openbmp_gen done");
+    put16(r->buf, 1);
+    put16(r->buf, 2);
+    put16(r->buf, 0);
+    endBmp(r->buf, pos);
+    r->messages++;
+
+    output(*r, true);
+    r->secs = chrono::duration<double>(clock_type::now() - start).count();
+
+    if (r->file != NULL)
+        fclose(r->file);
+    else
+        close(r->sock);
+}
+
+/**
+ * Parse the address family mix, such as ipv4=60,ipv6=40
+ *
+ * \return false if not valid
+ */
+static bool parseMix(const char *mix) {
+    uint32_t weights[FAM_COUNT] = { 0 };
+    uint32_t total = 0;
+    string s = mix;
+    size_t start = 0;
+
+    while (start < s.size()) {
+        size_t end = s.find(',', start);
+        if (end == string::npos)
+            end = s.size();
+
+        string item = s.substr(start, end - start);
+        size_t eq = item.find('=');
+        int f;
+
+        for (f = 0; f < FAM_LS_PREFIX; f++) {
+            if (eq != string::npos and item.compare(0, eq, fam_names[f]) == 0)
+                break;
+        }
+
+        if (f == FAM_LS_PREFIX)
+            return false;
+
+        weights[f] = atoi(item.c_str() + eq + 1);
+        total += weights[f];
+        start = end + 1;
+    }
+
+    if (total == 0)
+        return false;
+
+    // BGP-LS is half nodes and half prefixes
+    weights[FAM_LS_PREFIX] = weights[FAM_LS_NODE] - weights[FAM_LS_NODE] / 2;
+    weights[FAM_LS_NODE] /= 2;
+
+    uint32_t assigned = 0;
+    for (int f = 0; f < FAM_COUNT; f++) {
+        fam_count[f] = (uint64_t)prefixes * weights[f] / total;
+        assigned += fam_count[f];
+    }
+
+    // Rounding goes to the first family of the mix
+    for (int f = 0; f < FAM_COUNT; f++) {
+        if (weights[f]) {
+            fam_count[f] += prefixes - assigned;
+            break;
+        }
+    }
+
+    return true;
+}
+
+int main(int argc, char **argv) {
+    const char *mix = "ipv4=100";
+    int routers = 1;
+    string source;
+    string dir;
+
+    for (int i = 1; i < argc; i++) {
+        if (not strcmp(argv[i], "-h")) {
+            Usage(argv[0]);
+            exit(0);
+
+        } else if (not strcmp(argv[i], "-v")) {
+            verbose = true;
+
+        } else if (argv[i][0] == '-' and argv[i][1] != 0 and argv[i][2] == 0 and strchr("nPxuamActwSrodpb", argv[i][1])) {
+            if (i + 1 >= argc) {
+                cerr << "INVALID ARG: " << argv[i] << " requires a value" << endl;
+                return 1;
+            }
+
+            char opt = argv[i][1];
+            const char *value = argv[++i];
+
+            switch (opt) {
+                case 'n' : routers = atoi(value); break;
+                case 'P' : peers = atoi(value); break;
+                case 'x' : prefixes = strtoul(value, NULL, 10); break;
+                case 'u' : per_update = atoi(value); break;
+                case 'a' : attr_sets = atoi(value); break;
+                case 'm' : mix = value; break;
+                case 'A' : add_paths = atoi(value); break;
+                case 'c' : churn_rate = atof(value); break;
+                case 't' : churn_secs = atof(value); break;
+                case 'w' : withdraw_pct = atoi(value); break;
+                case 'S' : stats_secs = atof(value); break;
+                case 'r' : seed = strtoul(value, NULL, 10); break;
+                case 'o' : dir = value; break;
+                case 'd' : host = value; break;
+                case 'p' : port = value; break;
+                case 'b' : source = value; break;
+            }
+
+        } else {
+            cerr << "INVALID ARG: " << argv[i] << endl;
+            Usage(argv[0]);
+            return 1;
+        }
+    }
+
+    if (routers < 1 or routers > 100000 or peers < 1 or peers > 100000) {
+        cerr << "INVALID ARG: routers and peers must be within 1 - 100000" << endl;
+        return 1;
+    }
+
+    if (prefixes > 0xffffff or per_update < 1 or attr_sets < 1 or add_paths < 0 or add_paths > 64 or
+            withdraw_pct < 0 or withdraw_pct > 100 or churn_rate < 0 or churn_secs < 0 or stats_secs < 0) {
+        cerr << "INVALID ARG: prefixes max is 16777215, add-path paths max is 64, withdraw is a percent" << endl;
+        return 1;
+    }
+
+    if (not parseMix(mix)) {
+        cerr << "INVALID ARG: -m " << mix << ", families are ipv4, ipv6, vpnv4, evpn and ls" << endl;
+        return 1;
+    }
+
+    in_addr first_addr;
+    if (source.size() and inet_pton(AF_INET, source.c_str(), &first_addr) != 1) {
+        cerr << "INVALID ARG: -b " << source << " is not an IPv4 address" << endl;
+        return 1;
+    }
+
+    signal(SIGPIPE, SIG_IGN);
+
+    vector<gen_router> gens(routers);
+
+    for (int i = 0; i < routers; i++) {
+        gen_router &r = gens[i];
+
+        r.index = i;
+        r.sock = -1;
+        r.file = NULL;
+        r.rng.seed(seed + i);
+        r.messages = r.prefixes = r.bytes = 0;
+        r.secs = 0;
+
+        if (dir.size())
+            r.path = dir + "/router" + to_string(i) + ".bmp";
+
+        if (source.size()) {
+            char buf[INET_ADDRSTRLEN];
+            in_addr addr;
+            addr.s_addr = htonl(ntohl(first_addr.s_addr) + i);
+            r.source = inet_ntop(AF_INET, &addr, buf, sizeof(buf));
+        }
+
+        // Half of the peers have 4-octet AS numbers
+        for (int p = 0; p < peers; p++) {
+            gen_peer peer;
+            peer.addr = 0xac100001 + p;         // 172.16.0.1
+            peer.as = p % 2 ? 4200000000U + p : 64512 + p % 1000;
+            r.peers.push_back(peer);
+        }
+    }
+
+    cout << "Generating " << routers << " routers x " << peers << " peers x " << prefixes << " prefixes (";
+    for (int f = 0; f < FAM_COUNT; f++) {
+        if (fam_count[f])
+            cout << (f ? " " : "") << fam_names[f] << "=" << fam_count[f];
+    }
+    cout << ")";
+    if (churn_rate > 0)
+        cout << ", churn " << churn_rate << "/s for " << churn_secs << " s";
+    cout << (dir.size() ? ", to " + dir : string(", to ") + host + ":" + port) << endl;
+
+    clock_type::time_point start = clock_type::now();
+    vector<thread> threads;
+
+    for (int i = 0; i < routers; i++)
+        threads.push_back(thread(generateRouter, &gens[i], start));
+
+    for (size_t i = 0; i < threads.size(); i++)
+        threads[i].join();
+
+    uint64_t bytes = 0, messages = 0, total_prefixes = 0;
+    double secs = 0;
+    int failed = 0;
+
+    for (int i = 0; i < routers; i++) {
+        gen_router &r = gens[i];
+
+        if (r.error.size()) {
+            cerr << "ERROR: router " << i << ": " << r.error << endl;
+            failed++;
+            continue;
+        }
+
+        bytes += r.bytes;
+        messages += r.messages;
+        total_prefixes += r.prefixes;
+        secs = max(secs, r.secs);
+
+        if (verbose)
+            printf("router %d%s%s: %lu messages, %lu prefixes, %lu KB in %.3f s\n", i,
+                   r.source.size() ? " from " : "", r.source.c_str(), (unsigned long)r.messages,
+                   (unsigned long)r.prefixes, (unsigned long)r.bytes / 1024, r.secs);
+    }
+
+    if (secs <= 0)
+        secs = 1e-9;
+
+    printf("%lu messages, %lu prefixes, %.1f MB in %.3f s\n", (unsigned long)messages,
+           (unsigned long)total_prefixes, bytes / 1048576.0, secs);
+    printf("%.0f messages/s, %.0f prefixes/s, %.1f MB/s\n", messages / secs, total_prefixes / secs,
+           bytes / secs / 1048576);
+
+    if (failed)
+        printf("%d of %d routers failed\n", failed, routers);
+
+    return failed ? 1 : 0;
+}
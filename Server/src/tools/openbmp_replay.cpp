@@ -0,0 +1,520 @@
+/*
+ * Copyright (c) 2024 Microsoft, Inc. and others.  All rights reserved.
+ *
+ * This program and the accompanying materials are made available under the
+ * terms of the Eclipse Public License v1.0 which accompanies this distribution,
+ * and is available at http://www.eclipse.org/legal/epl-v10.html
+ *
+ */
+
+/**
+ * \file    openbmp_replay.cpp
+ *
+ * \brief   Replays recorded BMP streams to a collector
+ * \details Each file is the BMP byte stream of one router, as read from the router
+ *          connection.  Each router is replayed on its own TCP connection, at line rate
+ *          or paced by the BMP per peer header timestamps with a speed multiplier.
+ *
+ *          The report has the messages and prefixes per second from the start until
+ *          all routers are drained.  A router is drained when the collector has read
+ *          all its bytes (the connection send queue is empty).
+ */
+
+#include <sys/types.h>
+#include <sys/socket.h>
+#include <sys/stat.h>
+#include <sys/mman.h>
+#include <sys/ioctl.h>
+#include <linux/sockios.h>
+#include <netinet/in.h>
+#include <arpa/inet.h>
+#include <netdb.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <csignal>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <cerrno>
+#include <cstdint>
+
+#include <iostream>
+#include <string>
+#include <vector>
+#include <thread>
+#include <chrono>
+
+using namespace std;
+
+#define BMP_HDR_LEN             6               // BMP v3 common header
+#define BMP_PEER_HDR_LEN        42              // BMP per peer header
+#define BMP_PEER_HDR_TS_OFFSET  34              // Timestamp seconds in the per peer header
+#define BGP_HDR_LEN             19
+#define SEND_BLOCK_SIZE         (64 * 1024)     // Max bytes per send
+
+typedef chrono::steady_clock clock_type;
+
+/*
+ * BMP message of a file with a timestamp, used to pace the replay
+ */
+struct timed_msg {
+    size_t      offset;                         // Offset of the message
+    uint64_t    ts_us;                          // Per peer header timestamp in microseconds
+};
+
+/*
+ * Recorded BMP stream of a router
+ */
+struct replay_file {
+    string      name;
+    const u_char *data;
+    size_t      len;
+    uint64_t    messages;
+    uint64_t    prefixes;                       // Unicast prefixes announced or withdrawn
+    vector<timed_msg> timed;
+};
+
+/*
+ * Replay of one router connection
+ */
+struct router_run {
+    replay_file *file;
+    string      source;                         // Source address, empty for any
+    double      send_secs;                      // Time to send all bytes
+    double      drain_secs;                     // Time until the collector read all bytes
+    string      error;
+};
+
+static const char *host     = "127.0.0.1";     // Collector address
+static const char *port     = "5000";          // Collector BMP port
+static double      speed    = 0;               // Speed multiplier, 0 is line rate
+static bool        verbose  = false;
+
+/**
+ * Usage of the program
+ */
+void Usage(char *prog) {
+    cout << "Usage: " << prog << " <options> <file> [file ...]" << endl;
+    cout << endl << "  Replays recorded BMP streams (one file per router) to a collector" << endl;
+
+    cout << endl << "  OPTIONS:" << endl;
+    cout << "     -d <host>         Collector address (default is 127.0.0.1)" << endl;
+    cout << "     -p <port>         Collector BMP port (default is 5000)" << endl;
+    cout << "     -n <count>        Number of routers (default is the number of files), files are" << endl;
+    cout << "                       used in order for the routers" << endl;
+    cout << "     -s <speed>        Speed multiplier of the BMP timestamps, 0 is line rate (default is 0)" << endl;
+    cout << "     -b <address>      Source IPv4 address of the first router, the next routers use the" << endl;
+    cout << "                       next addresses (for example 127.0.1.1).  The collector identifies" << endl;
+    cout << "                       routers by address, routers from the same address share a router hash" << endl;
+    cout << "     -v                Report each router" << endl;
+    cout << "     -h                Help" << endl;
+    cout << endl;
+}
+
+/**
+ * Count the prefixes of NLRI or withdrawn routes
+ *
+ * \param [in] data     Prefixes
+ * \param [in] len      Length of the prefixes
+ * \param [in] max_bits Max prefix length of the address family
+ *
+ * \return number of prefixes, stops at the first invalid prefix
+ */
+static uint64_t countPrefixes(const u_char *data, size_t len, int max_bits) {
+    uint64_t count = 0;
+    size_t pos = 0;
+
+    while (pos < len and data[pos] <= max_bits) {
+        pos += 1 + (data[pos] + 7) / 8;
+        count++;
+    }
+
+    return count;
+}
+
+/**
+ * Count the unicast prefixes of a BGP update
+ *
+ * \details ADD-PATH path identifiers are not supported, such prefixes are not counted
+ */
+static uint64_t countUpdatePrefixes(const u_char *bgp, size_t len) {
+    if (len < BGP_HDR_LEN + 4 or bgp[18] != 2)
+        return 0;
+
+    const u_char *ptr = bgp + BGP_HDR_LEN;
+    const u_char *end = bgp + len;
+    uint64_t count = 0;
+
+    size_t wd_len = (ptr[0] << 8) | ptr[1];
+    ptr += 2;
+    if (ptr + wd_len + 2 > end)
+        return 0;
+
+    count += countPrefixes(ptr, wd_len, 32);
+    ptr += wd_len;
+
+    size_t attr_len = (ptr[0] << 8) | ptr[1];
+    ptr += 2;
+    if (ptr + attr_len > end)
+        return count;
+
+    const u_char *attr_end = ptr + attr_len;
+    count += countPrefixes(attr_end, end - attr_end, 32);
+
+    // MP_REACH_NLRI and MP_UNREACH_NLRI of IPv4/IPv6 unicast
+    while (ptr + 3 <= attr_end) {
+        u_char flags = ptr[0];
+        u_char type = ptr[1];
+        size_t a_len;
+
+        if (flags & 0x10) {
+            if (ptr + 4 > attr_end)
+                break;
+            a_len = (ptr[2] << 8) | ptr[3];
+            ptr += 4;
+        } else {
+            a_len = ptr[2];
+            ptr += 3;
+        }
+
+        if (ptr + a_len > attr_end)
+            break;
+
+        if ((type == 14 or type == 15) and a_len >= 3) {
+            int afi = (ptr[0] << 8) | ptr[1];
+            int bits = afi == 2 ? 128 : 32;
+
+            if ((afi == 1 or afi == 2) and ptr[2] == 1) {
+                if (type == 15) {
+                    count += countPrefixes(ptr + 3, a_len - 3, bits);
+
+                } else if (a_len >= 5 and (size_t)5 + ptr[3] <= a_len) {
+                    size_t nlri = 5 + ptr[3];               // afi, safi, nh len, next hop, reserved
+                    count += countPrefixes(ptr + nlri, a_len - nlri, bits);
+                }
+            }
+        }
+
+        ptr += a_len;
+    }
+
+    return count;
+}
+
+/**
+ * Map a recorded BMP stream and count its messages and prefixes
+ *
+ * \return false if the file cannot be read
+ */
+static bool loadFile(const char *name, replay_file &file) {
+    int fd = open(name, O_RDONLY);
+    struct stat st;
+
+    if (fd < 0 or fstat(fd, &st) != 0) {
+        cerr << "ERROR: Cannot read " << name << ": " << strerror(errno) << endl;
+        if (fd >= 0)
+            close(fd);
+        return false;
+    }
+
+    file.name = name;
+    file.len = st.st_size;
+    file.data = NULL;
+    file.messages = 0;
+    file.prefixes = 0;
+
+    if (file.len > 0) {
+        void *addr = mmap(NULL, file.len, PROT_READ, MAP_PRIVATE, fd, 0);
+        if (addr == MAP_FAILED) {
+            cerr << "ERROR: Cannot map " << name << ": " << strerror(errno) << endl;
+            close(fd);
+            return false;
+        }
+
+        file.data = (const u_char *)addr;
+        madvise(addr, file.len, MADV_SEQUENTIAL);
+    }
+    close(fd);
+
+    size_t pos = 0;
+    while (pos + BMP_HDR_LEN <= file.len) {
+        const u_char *msg = file.data + pos;
+        uint32_t msg_len;
+
+        memcpy(&msg_len, msg + 1, 4);
+        msg_len = ntohl(msg_len);
+
+        if (msg[0] != 3 or msg_len < BMP_HDR_LEN or pos + msg_len > file.len)
+            break;
+
+        u_char type = msg[5];
+
+        // Route monitoring, stats, peer down, peer up and route mirroring have a per peer header
+        if ((type <= 3 or type == 6) and msg_len >= BMP_HDR_LEN + BMP_PEER_HDR_LEN) {
+            uint32_t ts[2];
+            memcpy(ts, msg + BMP_HDR_LEN + BMP_PEER_HDR_TS_OFFSET, sizeof(ts));
+
+            timed_msg t = { pos, ntohl(ts[0]) * 1000000ULL + ntohl(ts[1]) };
+            file.timed.push_back(t);
+
+            if (type == 0)
+                file.prefixes += countUpdatePrefixes(msg + BMP_HDR_LEN + BMP_PEER_HDR_LEN,
+                                                     msg_len - BMP_HDR_LEN - BMP_PEER_HDR_LEN);
+        }
+
+        file.messages++;
+        pos += msg_len;
+    }
+
+    if (pos < file.len)
+        cerr << "WARN: " << name << ": not a BMP v3 message at offset " << pos
+             << ", the rest of the file is sent but not counted" << endl;
+
+    return true;
+}
+
+/**
+ * Connect to the collector
+ *
+ * \return socket, -1 on error
+ */
+static int connectCollector(const string &source, string &error) {
+    addrinfo hints, *res;
+
+    memset(&hints, 0, sizeof(hints));
+    hints.ai_family = source.size() ? AF_INET : AF_UNSPEC;
+    hints.ai_socktype = SOCK_STREAM;
+
+    int rc = getaddrinfo(host, port, &hints, &res);
+    if (rc != 0) {
+        error = gai_strerror(rc);
+        return -1;
+    }
+
+    int sock = socket(res->ai_family, res->ai_socktype, res->ai_protocol);
+
+    if (sock >= 0 and source.size()) {
+        sockaddr_in addr;
+        memset(&addr, 0, sizeof(addr));
+        addr.sin_family = AF_INET;
+        inet_pton(AF_INET, source.c_str(), &addr.sin_addr);
+
+        if (bind(sock, (sockaddr *)&addr, sizeof(addr)) != 0) {
+            error = string("bind ") + source + ": " + strerror(errno);
+            close(sock);
+            sock = -1;
+        }
+    }
+
+    if (sock >= 0 and connect(sock, res->ai_addr, res->ai_addrlen) != 0) {
+        error = strerror(errno);
+        close(sock);
+        sock = -1;
+    }
+
+    freeaddrinfo(res);
+    return sock;
+}
+
+/**
+ * Send bytes of the file
+ *
+ * \return false if the connection failed
+ */
+static bool sendAll(int sock, const u_char *data, size_t len, string &error) {
+    while (len > 0) {
+        ssize_t sent = send(sock, data, len > SEND_BLOCK_SIZE ? SEND_BLOCK_SIZE : len, 0);
+
+        if (sent < 0) {
+            if (errno == EINTR)
+                continue;
+
+            error = strerror(errno);
+            return false;
+        }
+
+        data += sent;
+        len -= sent;
+    }
+
+    return true;
+}
+
+/**
+ * Replay a router, runs on its own thread
+ */
+static void replayRouter(router_run *run, clock_type::time_point start) {
+    replay_file *file = run->file;
+    int sock = connectCollector(run->source, run->error);
+
+    if (sock < 0)
+        return;
+
+    size_t sent = 0;
+
+    // Paced by the timestamps, the bytes due are sent together
+    if (speed > 0 and file->timed.size()) {
+        uint64_t first_ts = file->timed[0].ts_us;
+
+        for (size_t i = 0; i < file->timed.size(); i++) {
+            uint64_t offset_us = file->timed[i].ts_us > first_ts ? file->timed[i].ts_us - first_ts : 0;
+            clock_type::time_point due = start + chrono::microseconds((uint64_t)(offset_us / speed));
+
+            if (clock_type::now() < due) {
+                if (not sendAll(sock, file->data + sent, file->timed[i].offset - sent, run->error))
+                    break;
+
+                sent = file->timed[i].offset;
+                this_thread::sleep_until(due);
+            }
+        }
+    }
+
+    if (run->error.empty())
+        sendAll(sock, file->data + sent, file->len - sent, run->error);
+
+    run->send_secs = chrono::duration<double>(clock_type::now() - start).count();
+
+    // The collector read everything once the send queue is empty
+    int queued = 1;
+    while (run->error.empty() and ioctl(sock, SIOCOUTQ, &queued) == 0 and queued > 0)
+        this_thread::sleep_for(chrono::milliseconds(1));
+
+    run->drain_secs = chrono::duration<double>(clock_type::now() - start).count();
+
+    close(sock);
+}
+
+int main(int argc, char **argv) {
+    vector<replay_file> files;
+    int routers = 0;
+    string source;
+
+    for (int i = 1; i < argc; i++) {
+        if (not strcmp(argv[i], "-h")) {
+            Usage(argv[0]);
+            exit(0);
+
+        } else if (not strcmp(argv[i], "-v")) {
+            verbose = true;
+
+        } else if (argv[i][0] == '-' and argv[i][1] != 0 and argv[i][2] == 0 and strchr("dpnsb", argv[i][1])) {
+            if (i + 1 >= argc) {
+                cerr << "INVALID ARG: " << argv[i] << " requires a value" << endl;
+                return 1;
+            }
+
+            char opt = argv[i][1];
+            const char *value = argv[++i];
+
+            switch (opt) {
+                case 'd' : host = value; break;
+                case 'p' : port = value; break;
+                case 'n' : routers = atoi(value); break;
+                case 's' : speed = atof(value); break;
+                case 'b' : source = value; break;
+            }
+
+        } else if (argv[i][0] == '-') {
+            cerr << "INVALID ARG: " << argv[i] << endl;
+            Usage(argv[0]);
+            return 1;
+
+        } else {
+            replay_file file;
+            if (not loadFile(argv[i], file))
+                return 1;
+
+            files.push_back(file);
+        }
+    }
+
+    if (files.empty()) {
+        Usage(argv[0]);
+        return 1;
+    }
+
+    if (routers <= 0)
+        routers = files.size();
+
+    in_addr first_addr;
+    if (source.size() and inet_pton(AF_INET, source.c_str(), &first_addr) != 1) {
+        cerr << "INVALID ARG: -b " << source << " is not an IPv4 address" << endl;
+        return 1;
+    }
+
+    signal(SIGPIPE, SIG_IGN);
+
+    vector<router_run> runs(routers);
+    uint64_t bytes = 0, messages = 0, prefixes = 0;
+
+    for (int i = 0; i < routers; i++) {
+        runs[i].file = &files[i % files.size()];
+        runs[i].send_secs = runs[i].drain_secs = 0;
+
+        if (source.size()) {
+            char buf[INET_ADDRSTRLEN];
+            in_addr addr;
+            addr.s_addr = htonl(ntohl(first_addr.s_addr) + i);
+            runs[i].source = inet_ntop(AF_INET, &addr, buf, sizeof(buf));
+        }
+
+        bytes += runs[i].file->len;
+        messages += runs[i].file->messages;
+        prefixes += runs[i].file->prefixes;
+    }
+
+    cout << "Replaying " << routers << " routers to " << host << ":" << port << ", "
+         << bytes / 1024 << " KB, " << messages << " messages, " << prefixes << " prefixes, ";
+    if (speed > 0)
+        cout << "speed " << speed << "x" << endl;
+    else
+        cout << "line rate" << endl;
+
+    clock_type::time_point start = clock_type::now();
+    vector<thread> threads;
+
+    for (int i = 0; i < routers; i++)
+        threads.push_back(thread(replayRouter, &runs[i], start));
+
+    for (size_t i = 0; i < threads.size(); i++)
+        threads[i].join();
+
+    double send_secs = 0, drain_secs = 0;
+    int failed = 0;
+
+    for (int i = 0; i < routers; i++) {
+        router_run &run = runs[i];
+
+        if (run.error.size()) {
+            cerr << "ERROR: router " << i << " (" << run.file->name << "): " << run.error << endl;
+            bytes -= run.file->len;
+            messages -= run.file->messages;
+            prefixes -= run.file->prefixes;
+            failed++;
+            continue;
+        }
+
+        send_secs = max(send_secs, run.send_secs);
+        drain_secs = max(drain_secs, run.drain_secs);
+
+        if (verbose)
+            printf("router %d %s%s%s: %lu messages, %lu prefixes, sent in %.3f s, drained in %.3f s\n", i,
+                   run.file->name.c_str(), run.source.size() ? " from " : "", run.source.c_str(),
+                   (unsigned long)run.file->messages, (unsigned long)run.file->prefixes,
+                   run.send_secs, run.drain_secs);
+    }
+
+    if (drain_secs <= 0)
+        drain_secs = 1e-9;
+
+    printf("sent in %.3f s, drained in %.3f s (%.3f s after the last byte was sent)\n",
+           send_secs, drain_secs, drain_secs - send_secs);
+    printf("%.0f messages/s, %.0f prefixes/s, %.1f MB/s\n", messages / drain_secs, prefixes / drain_secs,
+           bytes / drain_secs / 1048576);
+
+    if (failed)
+        printf("%d of %d routers failed, the rates are of the other routers\n", failed, routers);
+
+    return failed ? 1 : 0;
+}
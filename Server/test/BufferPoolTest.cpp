@@ -0,0 +1,258 @@
+/*
+ * Copyright (c) 2024 Microsoft, Inc. and others.  All rights reserved.
+ *
+ * This program and the accompanying materials are made available under the
+ * terms of the Eclipse Public License v1.0 which accompanies this distribution,
+ * and is available at http://www.eclipse.org/legal/epl-v10.html
+ *
+ */
+
+#include <gtest/gtest.h>
+#include <algorithm>
+#include <vector>
+
+#include "BufferPool.h"
+
+#define CHUNK                   ((size_t)BUFFER_POOL_CHUNK_SIZE)
+
+/*
+ * Config.cpp needs the message bus libraries, the pool only reads the buffer settings
+ */
+Config::Config() {
+    debug_general           = false;
+    workers                 = 1;
+    bmp_buffer_size         = 8 * CHUNK;
+    bmp_buffer_min          = CHUNK;
+    bmp_buffer_pool_size    = 4 * CHUNK;
+}
+
+namespace {
+
+/**
+ * Pool with a budget of four chunks and a router minimum of one chunk
+ */
+class BufferPoolTest : public ::testing::Test {
+protected:
+    BufferPoolTest() : logger(NULL, NULL), pool(&logger, &cfg) { }
+
+    Logger      logger;
+    Config      cfg;
+    BufferPool  pool;
+};
+
+/**
+ * Append a byte sequence to the buffer, stops at max or when the buffer is full
+ *
+ * \return bytes appended
+ */
+size_t writeSeq(RouterBuffer &buffer, uint8_t &seq, size_t max) {
+    size_t written = 0;
+    unsigned char *ptr;
+    size_t len;
+
+    while (written < max and (len = buffer.writable(ptr)) > 0) {
+        len = std::min(len, max - written);
+
+        for (size_t i = 0; i < len; i++)
+            ptr[i] = seq++;
+
+        buffer.commit(len);
+        written += len;
+    }
+
+    return written;
+}
+
+/**
+ * Read bytes from the buffer and check they continue the sequence
+ *
+ * \return bytes read
+ */
+size_t readSeq(RouterBuffer &buffer, uint8_t &seq, size_t max) {
+    size_t read = 0;
+    unsigned char *ptr;
+    size_t len;
+
+    while (read < max and (len = buffer.readable(ptr)) > 0) {
+        len = std::min(len, max - read);
+
+        for (size_t i = 0; i < len; i++) {
+            if (ptr[i] != seq++) {
+                ADD_FAILURE() << "Byte " << read + i << " is out of sequence";
+                return read;
+            }
+        }
+
+        buffer.consume(len);
+        read += len;
+    }
+
+    return read;
+}
+
+} // namespace
+
+TEST_F(BufferPoolTest, RouterMinIsReserved) {
+    EXPECT_EQ(pool.getRouterMin(), CHUNK);
+    EXPECT_EQ(pool.getFill(), 0);
+
+    pool.addRouter();
+    EXPECT_EQ(pool.getFill(), 25);
+
+    // The first chunk is within the minimum, it is not taken from the budget again
+    unsigned char *chunk = pool.alloc(0, -1);
+    ASSERT_NE(chunk, (unsigned char *)NULL);
+    EXPECT_EQ(pool.getFill(), 25);
+
+    pool.free(chunk, CHUNK, -1);
+    EXPECT_EQ(pool.getFill(), 25);
+
+    pool.removeRouter();
+    EXPECT_EQ(pool.getFill(), 0);
+}
+
+TEST_F(BufferPoolTest, BudgetLimitsChunksAboveMin) {
+    std::vector<unsigned char *> chunks;
+    unsigned char *chunk;
+
+    pool.addRouter();
+
+    while ((chunk = pool.alloc(chunks.size() * CHUNK, -1)) != NULL)
+        chunks.push_back(chunk);
+
+    EXPECT_EQ(chunks.size(), 4U);
+    EXPECT_EQ(pool.getFill(), 100);
+
+    // Forced allocations go over the budget
+    chunk = pool.alloc(chunks.size() * CHUNK, -1, true);
+    ASSERT_NE(chunk, (unsigned char *)NULL);
+    chunks.push_back(chunk);
+    EXPECT_EQ(pool.getFill(), 125);
+
+    while (chunks.size()) {
+        pool.free(chunks.back(), chunks.size() * CHUNK, -1);
+        chunks.pop_back();
+    }
+
+    EXPECT_EQ(pool.getFill(), 25);
+    pool.removeRouter();
+}
+
+TEST_F(BufferPoolTest, RouterMinAvailableWhenBudgetIsUsed) {
+    std::vector<unsigned char *> chunks;
+    unsigned char *chunk;
+
+    pool.addRouter();
+    pool.addRouter();
+
+    // The first router takes the budget left after both minimums
+    while ((chunk = pool.alloc(chunks.size() * CHUNK, -1)) != NULL)
+        chunks.push_back(chunk);
+
+    EXPECT_EQ(chunks.size(), 3U);
+
+    // The second router still gets its minimum, but nothing above it
+    unsigned char *min_chunk = pool.alloc(0, -1);
+    ASSERT_NE(min_chunk, (unsigned char *)NULL);
+    EXPECT_EQ(pool.alloc(CHUNK, -1), (unsigned char *)NULL);
+
+    pool.free(min_chunk, CHUNK, -1);
+
+    while (chunks.size()) {
+        pool.free(chunks.back(), chunks.size() * CHUNK, -1);
+        chunks.pop_back();
+    }
+
+    pool.removeRouter();
+    pool.removeRouter();
+    EXPECT_EQ(pool.getFill(), 0);
+}
+
+TEST_F(BufferPoolTest, RouterBufferKeepsOrder) {
+    uint8_t wseq = 0, rseq = 0;
+
+    {
+        RouterBuffer buffer(&pool, cfg.bmp_buffer_size);
+
+        // Odd sizes so that reads and writes cross chunks at any offset
+        for (int i = 0; i < 20; i++) {
+            writeSeq(buffer, wseq, CHUNK + 12345);
+            ASSERT_LE(buffer.size(), 4 * CHUNK);
+
+            readSeq(buffer, rseq, buffer.size() / 2 + 1);
+        }
+
+        readSeq(buffer, rseq, SIZE_MAX);
+        EXPECT_EQ(rseq, wseq);
+        EXPECT_EQ(buffer.size(), 0U);
+
+        // A drained buffer holds no chunks above the minimum
+        EXPECT_EQ(pool.getFill(), 25);
+    }
+
+    EXPECT_EQ(pool.getFill(), 0);
+}
+
+TEST_F(BufferPoolTest, RouterBufferStopsAtBudget) {
+    RouterBuffer buffer(&pool, cfg.bmp_buffer_size);
+    uint8_t wseq = 0, rseq = 0;
+    unsigned char *ptr;
+
+    // Max size is 8 chunks, the budget stops the buffer at 4
+    EXPECT_EQ(writeSeq(buffer, wseq, SIZE_MAX), 4 * CHUNK);
+    EXPECT_EQ(buffer.writable(ptr), 0U);
+    EXPECT_EQ(buffer.getFill(), 50);
+
+    // Reading a chunk returns it to the pool, so the router can read again
+    EXPECT_EQ(readSeq(buffer, rseq, CHUNK), CHUNK);
+    EXPECT_EQ(writeSeq(buffer, wseq, SIZE_MAX), CHUNK);
+
+    EXPECT_EQ(readSeq(buffer, rseq, SIZE_MAX), 4 * CHUNK);
+}
+
+TEST_F(BufferPoolTest, RouterBufferStopsAtMaxSize) {
+    RouterBuffer buffer(&pool, 2 * CHUNK);
+    uint8_t wseq = 0;
+    unsigned char *ptr;
+
+    EXPECT_EQ(writeSeq(buffer, wseq, SIZE_MAX), 2 * CHUNK);
+    EXPECT_EQ(buffer.writable(ptr), 0U);
+    EXPECT_EQ(buffer.getFill(), 100);
+}
+
+TEST_F(BufferPoolTest, AppendIgnoresBudget) {
+    RouterBuffer buffer(&pool, cfg.bmp_buffer_size);
+    std::vector<unsigned char> data(6 * CHUNK, 0x5a);
+
+    EXPECT_TRUE(buffer.append(data.data(), data.size()));
+    EXPECT_EQ(buffer.size(), 6 * CHUNK);
+    EXPECT_EQ(pool.getFill(), 150);
+
+    // Max size still applies
+    EXPECT_FALSE(buffer.append(data.data(), 3 * CHUNK));
+}
+
+TEST_F(BufferPoolTest, RouterBufferSpillsInOrder) {
+    RouterBuffer buffer(&pool, cfg.bmp_buffer_size);
+    uint8_t wseq = 0, rseq = 0;
+
+    buffer.enableSpill("/tmp", SPILL_SEGMENT_SIZE);
+
+    // Bytes over the budget go to the spill file
+    EXPECT_EQ(writeSeq(buffer, wseq, 4 * CHUNK + 1000), 4 * CHUNK + 1000);
+    EXPECT_EQ(buffer.getSpillDepth(), 1000U);
+    EXPECT_EQ(buffer.getFill(), 100);
+
+    // Until the file is drained, bytes are spilled even with chunks available
+    EXPECT_EQ(readSeq(buffer, rseq, CHUNK), CHUNK);
+    EXPECT_EQ(writeSeq(buffer, wseq, 1000), 1000U);
+    EXPECT_EQ(buffer.getSpillDepth(), 2000U);
+
+    EXPECT_EQ(readSeq(buffer, rseq, SIZE_MAX), 3 * CHUNK + 2000);
+    EXPECT_EQ(buffer.size(), 0U);
+
+    // Drained, bytes go to the chunks again
+    EXPECT_EQ(writeSeq(buffer, wseq, 1000), 1000U);
+    EXPECT_EQ(buffer.getSpillDepth(), 0U);
+    EXPECT_EQ(readSeq(buffer, rseq, SIZE_MAX), 1000U);
+}
@@ -0,0 +1,188 @@
+/*
+ * Copyright (c) 2024 Microsoft, Inc. and others.  All rights reserved.
+ *
+ * This program and the accompanying materials are made available under the
+ * terms of the Eclipse Public License v1.0 which accompanies this distribution,
+ * and is available at http://www.eclipse.org/legal/epl-v10.html
+ *
+ */
+
+#include <gtest/gtest.h>
+#include <unistd.h>
+#include <cstdlib>
+#include <algorithm>
+#include <thread>
+#include <fstream>
+#include <string>
+#include <vector>
+
+#include "Logger.h"
+
+#define LOGGER_TEST_FLUSH_MS    (3600 * 1000)   ///< Writer thread does not drain during a test
+
+namespace {
+
+/**
+ * Logger writing to a temporary file, records are only written by flush()
+ */
+class AsyncLog {
+public:
+    explicit AsyncLog(size_t ring_size) {
+        char path[] = "/tmp/openbmpd-logtest-XXXXXX";
+        int fd = mkstemp(path);
+
+        if (fd >= 0)
+            close(fd);
+
+        filename = path;
+        logger = new Logger(filename.c_str(), NULL);
+        logger->enableAsync(LOGGER_TEST_FLUSH_MS, ring_size);
+    }
+
+    ~AsyncLog() {
+        delete logger;
+        unlink(filename.c_str());
+    }
+
+    /**
+     * Get the message column of the lines written so far
+     */
+    std::vector<std::string> messages() {
+        std::vector<std::string> msgs;
+        std::ifstream in(filename);
+        std::string line;
+
+        while (std::getline(in, line)) {
+            size_t pos = line.rfind(" | ");
+            msgs.push_back(pos == std::string::npos ? line : line.substr(pos + 3));
+        }
+
+        return msgs;
+    }
+
+    Logger      *logger;
+    std::string filename;
+};
+
+/**
+ * Message of a given length, starting with its sequence number
+ */
+std::string message(int seq, size_t len) {
+    std::string msg = "msg " + std::to_string(seq) + " ";
+    msg.resize(std::max(len, msg.size()), 'x');
+    return msg;
+}
+
+} // namespace
+
+TEST(Logger, RecordsWrapInOrder) {
+    AsyncLog log(1024);
+    Logger *logger = log.logger;
+    std::vector<std::string> expected;
+
+    // Record sizes vary so the end of the ring is reached at any offset, both with room
+    // for a skip marker and without
+    for (int i = 0; i < 500; i++) {
+        std::string msg = message(i, 1 + (i * 37) % 300);
+
+        LOG_INFO("%s", msg.c_str());
+        expected.push_back(msg);
+
+        if (i % 2)
+            logger->flush();
+    }
+
+    logger->flush();
+
+    EXPECT_EQ(logger->getDropCount(), 0U);
+    EXPECT_EQ(log.messages(), expected);
+}
+
+TEST(Logger, FullRingDropsAndCounts) {
+    AsyncLog log(1024);
+    Logger *logger = log.logger;
+    std::vector<std::string> expected;
+    int queued = 0;
+
+    for (int i = 0; i < 20; i++) {
+        std::string msg = message(i, 100);
+
+        LOG_INFO("%s", msg.c_str());
+
+        if (logger->getDropCount() == 0) {
+            expected.push_back(msg);
+            queued++;
+        }
+    }
+
+    // A record is sized to its message, so a 1KB ring holds a few 100 byte messages
+    EXPECT_GT(queued, 3);
+    EXPECT_LT(queued, 10);
+    EXPECT_EQ(logger->getDropCount(), (uint64_t)(20 - queued));
+
+    logger->flush();
+
+    std::vector<std::string> msgs = log.messages();
+    ASSERT_EQ(msgs.size(), expected.size() + 1);
+
+    // The drops are reported once the ring is drained
+    EXPECT_EQ(msgs.back(), "dropped " + std::to_string(20 - queued) + " log messages, ring full");
+    msgs.pop_back();
+    EXPECT_EQ(msgs, expected);
+
+    // Drained, the ring takes records again
+    LOG_INFO("after drain");
+    logger->flush();
+
+    EXPECT_EQ(logger->getDropCount(), (uint64_t)(20 - queued));
+    EXPECT_EQ(log.messages().back(), "after drain");
+}
+
+TEST(Logger, LongMessageIsTruncated) {
+    AsyncLog log(4096);
+    Logger *logger = log.logger;
+
+    LOG_INFO("%s", std::string(2 * LOGGER_MSG_MAX, 'y').c_str());
+    logger->flush();
+
+    std::vector<std::string> msgs = log.messages();
+    ASSERT_EQ(msgs.size(), 1U);
+    EXPECT_EQ(msgs[0], std::string(LOGGER_MSG_MAX - 1, 'y'));
+}
+
+TEST(Logger, RingPerLogger) {
+    AsyncLog log_a(1024);
+    AsyncLog log_b(1024);
+    Logger *logger;
+
+    // Filling the ring of one logger does not use the ring of another
+    logger = log_a.logger;
+    for (int i = 0; i < 20; i++)
+        LOG_INFO("%s", message(i, 100).c_str());
+
+    EXPECT_GT(log_a.logger->getDropCount(), 0U);
+
+    logger = log_b.logger;
+    LOG_INFO("to b");
+    logger->flush();
+
+    EXPECT_EQ(log_b.logger->getDropCount(), 0U);
+    EXPECT_EQ(log_b.messages(), std::vector<std::string>(1, "to b"));
+}
+
+TEST(Logger, RecordsOfEndedThreadAreWritten) {
+    AsyncLog log(1024);
+    Logger *logger = log.logger;
+
+    std::thread thread([logger]() {
+        LOG_INFO("from thread");
+    });
+    thread.join();
+
+    logger->flush();
+    EXPECT_EQ(log.messages(), std::vector<std::string>(1, "from thread"));
+
+    // The orphaned ring is freed once drained
+    logger->flush();
+    EXPECT_EQ(log.messages().size(), 1U);
+}
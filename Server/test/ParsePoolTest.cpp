@@ -0,0 +1,153 @@
+/*
+ * Copyright (c) 2024 Microsoft, Inc. and others.  All rights reserved.
+ *
+ * This program and the accompanying materials are made available under the
+ * terms of the Eclipse Public License v1.0 which accompanies this distribution,
+ * and is available at http://www.eclipse.org/legal/epl-v10.html
+ *
+ */
+
+#include <gtest/gtest.h>
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <mutex>
+#include <vector>
+
+#include "ParsePool.h"
+
+namespace {
+
+/**
+ * Counts the jobs that ran, the test waits until all posted jobs ran
+ */
+struct job_count {
+    std::mutex              mutex;
+    std::condition_variable cond;
+    int                     done;
+
+    job_count() : done(0) { }
+
+    void add() {
+        std::lock_guard<std::mutex> lock(mutex);
+        done++;
+        cond.notify_all();
+    }
+
+    bool wait(int count) {
+        std::unique_lock<std::mutex> lock(mutex);
+        return cond.wait_for(lock, std::chrono::seconds(30), [this, count] { return done >= count; });
+    }
+};
+
+/**
+ * Jobs run by a strand, in the order they ran
+ */
+struct strand_log {
+    ParsePool::strand       *s;
+    std::vector<int>        ran;            ///< Only written by the job running on the strand
+    std::atomic<int>        running;        ///< Jobs of the strand running at the same time
+
+    strand_log() : s(NULL), running(0) { }
+};
+
+} // namespace
+
+class ParsePoolTest : public ::testing::Test {
+protected:
+    ParsePoolTest() : logger(NULL, NULL) { }
+
+    Logger      logger;
+};
+
+TEST_F(ParsePoolTest, StrandRunsJobsInPostOrder) {
+    const int strands = 16;
+    const int jobs = 2000;
+    ParsePool pool(&logger, 4);
+    std::vector<strand_log> logs(strands);
+    std::atomic<int> overlaps(0);
+    job_count count;
+
+    for (auto &log : logs)
+        log.s = pool.addStrand();
+
+    // Interleave the strands so that the workers take strands from each other
+    for (int i = 0; i < jobs; i++) {
+        for (auto &log : logs) {
+            strand_log *l = &log;
+
+            pool.post(l->s, [l, i, &overlaps, &count] {
+                if (l->running++ != 0)
+                    overlaps++;
+
+                l->ran.push_back(i);
+
+                l->running--;
+                count.add();
+            });
+        }
+    }
+
+    ASSERT_TRUE(count.wait(strands * jobs));
+    EXPECT_EQ(overlaps, 0);
+
+    for (auto &log : logs) {
+        ASSERT_EQ(log.ran.size(), (size_t)jobs);
+
+        for (int i = 0; i < jobs; i++)
+            ASSERT_EQ(log.ran[i], i);
+
+        pool.removeStrand(log.s);
+    }
+}
+
+TEST_F(ParsePoolTest, StrandsRunConcurrently) {
+    ParsePool pool(&logger, 2);
+    ParsePool::strand *first = pool.addStrand();
+    ParsePool::strand *second = pool.addStrand();
+    std::mutex mutex;
+    std::condition_variable cond;
+    int arrived = 0;
+    std::atomic<int> met(0);
+    job_count count;
+
+    // Each job waits for the job of the other strand, only returns in time if both run at once
+    auto job = [&] {
+        std::unique_lock<std::mutex> lock(mutex);
+        arrived++;
+        cond.notify_all();
+
+        if (cond.wait_for(lock, std::chrono::seconds(10), [&arrived] { return arrived == 2; }))
+            met++;
+
+        lock.unlock();
+        count.add();
+    };
+
+    pool.post(first, job);
+    pool.post(second, job);
+
+    ASSERT_TRUE(count.wait(2));
+    EXPECT_EQ(met, 2);
+
+    pool.removeStrand(first);
+    pool.removeStrand(second);
+}
+
+TEST_F(ParsePoolTest, DestructorRunsPostedJobs) {
+    std::atomic<int> ran(0);
+    ParsePool::strand *s;
+
+    {
+        ParsePool pool(&logger, 2);
+        s = pool.addStrand();
+
+        for (int i = 0; i < 1000; i++)
+            pool.post(s, [&ran] { ran++; });
+    }
+
+    EXPECT_EQ(ran, 1000);
+
+    // Released by the worker, removeStrand() would only wait for that
+    delete s;
+}
@@ -0,0 +1,165 @@
+/*
+ * Copyright (c) 2024 Microsoft, Inc. and others.  All rights reserved.
+ *
+ * This program and the accompanying materials are made available under the
+ * terms of the Eclipse Public License v1.0 which accompanies this distribution,
+ * and is available at http://www.eclipse.org/legal/epl-v10.html
+ *
+ */
+
+#include <gtest/gtest.h>
+#include <unistd.h>
+#include <cstdio>
+#include <cstdlib>
+#include <string>
+
+#include "RouterBaseline.h"
+
+namespace {
+
+/**
+ * State file in a temporary directory, removed with the directory
+ */
+class RouterBaselineFile : public ::testing::Test {
+protected:
+    void SetUp() override {
+        char tmpl[] = "/tmp/openbmpd-baseline-XXXXXX";
+
+        ASSERT_NE(mkdtemp(tmpl), (char *)NULL);
+        dir = tmpl;
+        filename = dir + "/baselines";
+    }
+
+    void TearDown() override {
+        unlink(filename.c_str());
+        unlink((filename + ".lock").c_str());
+        unlink((filename + ".tmp").c_str());
+        rmdir(dir.c_str());
+    }
+
+    void write(const char *content) {
+        FILE *fp = fopen(filename.c_str(), "w");
+
+        ASSERT_NE(fp, (FILE *)NULL);
+        fputs(content, fp);
+        fclose(fp);
+    }
+
+    std::string dir;
+    std::string filename;
+};
+
+/**
+ * Router hash id with all bytes set to a value
+ */
+struct HashId {
+    u_char  id[16];
+
+    explicit HashId(u_char value) {
+        for (int i = 0; i < 16; i++)
+            id[i] = value;
+    }
+};
+
+} // namespace
+
+TEST_F(RouterBaselineFile, MissingFileIsEmpty) {
+    RouterBaseline baselines;
+
+    baselines.setStateFile(filename);
+    EXPECT_EQ(baselines.load(), 0U);
+    EXPECT_EQ(baselines.size(), 0U);
+}
+
+TEST_F(RouterBaselineFile, SavedBaselinesAreLoaded) {
+    RouterBaseline saved;
+    RouterBaseline::entry entry;
+
+    saved.setStateFile(filename);
+    EXPECT_TRUE(saved.set(HashId(0x01).id, 12.5, 800000));
+    EXPECT_TRUE(saved.set(HashId(0xab).id, 300, 2000000));
+
+    // Setting a router again replaces its baseline
+    EXPECT_TRUE(saved.set(HashId(0x01).id, 20.5, 900000));
+
+    RouterBaseline loaded;
+    loaded.setStateFile(filename);
+    EXPECT_EQ(loaded.load(), 2U);
+
+    ASSERT_TRUE(loaded.get(HashId(0x01).id, entry));
+    EXPECT_FLOAT_EQ(entry.dump_secs, 20.5);
+    EXPECT_EQ(entry.dump_prefixes, 900000U);
+
+    ASSERT_TRUE(loaded.get(HashId(0xab).id, entry));
+    EXPECT_FLOAT_EQ(entry.dump_secs, 300);
+    EXPECT_EQ(entry.dump_prefixes, 2000000U);
+
+    EXPECT_FALSE(loaded.get(HashId(0x02).id, entry));
+}
+
+TEST_F(RouterBaselineFile, InvalidLinesAreSkipped) {
+    RouterBaseline baselines;
+    RouterBaseline::entry entry;
+
+    write("# comment\n"
+          "01010101010101010101010101010101 10.0 100\n"
+          "0202020202020202020202020202020 10.0 100\n"          // Short hash
+          "03030303030303030303030303030303 0 100\n"            // No dump time
+          "04040404040404040404040404040404 10.0\n"             // No prefixes
+          "garbage\n"
+          "06060606060606060606060606060606 5.5 42\n");
+
+    baselines.setStateFile(filename);
+    EXPECT_EQ(baselines.load(), 2U);
+
+    EXPECT_TRUE(baselines.get(HashId(0x01).id, entry));
+    EXPECT_FALSE(baselines.get(HashId(0x03).id, entry));
+
+    ASSERT_TRUE(baselines.get(HashId(0x06).id, entry));
+    EXPECT_FLOAT_EQ(entry.dump_secs, 5.5);
+    EXPECT_EQ(entry.dump_prefixes, 42U);
+}
+
+TEST_F(RouterBaselineFile, SaveMergesOtherWorkers) {
+    RouterBaseline worker_a, worker_b, loaded;
+    RouterBaseline::entry entry;
+
+    worker_a.setStateFile(filename);
+    worker_b.setStateFile(filename);
+    worker_a.load();
+    worker_b.load();
+
+    EXPECT_TRUE(worker_a.set(HashId(0x0a).id, 10, 100));
+    EXPECT_TRUE(worker_b.set(HashId(0x0b).id, 20, 200));
+
+    // Worker b kept the baseline worker a wrote after b loaded the file
+    EXPECT_EQ(worker_b.size(), 2U);
+
+    // Each worker's own baseline wins over the file when it is set again
+    write("0a0a0a0a0a0a0a0a0a0a0a0a0a0a0a0a 99.0 999\n"
+          "0b0b0b0b0b0b0b0b0b0b0b0b0b0b0b0b 20.0 200\n");
+    EXPECT_TRUE(worker_a.set(HashId(0x0c).id, 30, 300));
+
+    loaded.setStateFile(filename);
+    EXPECT_EQ(loaded.load(), 3U);
+
+    ASSERT_TRUE(loaded.get(HashId(0x0a).id, entry));
+    EXPECT_FLOAT_EQ(entry.dump_secs, 10);
+    EXPECT_EQ(entry.dump_prefixes, 100U);
+
+    ASSERT_TRUE(loaded.get(HashId(0x0b).id, entry));
+    EXPECT_FLOAT_EQ(entry.dump_secs, 20);
+
+    ASSERT_TRUE(loaded.get(HashId(0x0c).id, entry));
+    EXPECT_FLOAT_EQ(entry.dump_secs, 30);
+}
+
+TEST(RouterBaseline, NoStateFile) {
+    RouterBaseline baselines;
+    RouterBaseline::entry entry;
+
+    EXPECT_EQ(baselines.load(), 0U);
+    EXPECT_TRUE(baselines.set(HashId(0x01).id, 1, 1));
+    EXPECT_TRUE(baselines.get(HashId(0x01).id, entry));
+    EXPECT_EQ(baselines.size(), 1U);
+}
@@ -0,0 +1,132 @@
+/*
+ * Copyright (c) 2024 Microsoft, Inc. and others.  All rights reserved.
+ *
+ * This program and the accompanying materials are made available under the
+ * terms of the Eclipse Public License v1.0 which accompanies this distribution,
+ * and is available at http://www.eclipse.org/legal/epl-v10.html
+ *
+ */
+
+#include <gtest/gtest.h>
+#include <unistd.h>
+#include <memory>
+
+#include "RouterLatency.h"
+
+namespace {
+
+/**
+ * Get the upper bound of the bucket a value is counted in
+ */
+uint64_t bucketMax(HdrHistogram &hist, uint64_t value) {
+    hist.reset();
+    hist.record(value);
+
+    // The largest value, so the percentile is not capped by max()
+    hist.record((1ULL << HdrHistogram::MAX_BITS) - 1);
+
+    return hist.percentile(50);
+}
+
+} // namespace
+
+TEST(HdrHistogram, SmallValuesAreExact) {
+    HdrHistogram hist;
+
+    for (uint64_t value = 0; value < HdrHistogram::SUB_BUCKETS; value++)
+        EXPECT_EQ(bucketMax(hist, value), value);
+}
+
+TEST(HdrHistogram, BucketsAreContiguous) {
+    HdrHistogram hist;
+    uint64_t prev = bucketMax(hist, 0);
+
+    for (uint64_t value = 1; value < (1 << 16); value++) {
+        uint64_t max = bucketMax(hist, value);
+
+        ASSERT_GE(max, value);
+        ASSERT_GE(max, prev);
+
+        // A new bucket starts right after the previous one ended
+        if (max != prev) {
+            ASSERT_EQ(prev, value - 1) << "value " << value;
+        }
+
+        prev = max;
+    }
+}
+
+TEST(HdrHistogram, BucketWithinOneSixteenth) {
+    HdrHistogram hist;
+
+    for (int bits = HdrHistogram::SUB_BITS; bits < HdrHistogram::MAX_BITS; bits++) {
+        uint64_t base = 1ULL << bits;
+
+        for (uint64_t value : { base - 1, base, base + 1, base + base / 3, 2 * base - 1 }) {
+            uint64_t max = bucketMax(hist, value);
+
+            EXPECT_GE(max, value) << "value " << value;
+            EXPECT_LE(max - value, value / 16) << "value " << value;
+        }
+    }
+}
+
+TEST(HdrHistogram, Percentiles) {
+    HdrHistogram hist;
+
+    for (uint64_t value = 1; value <= 10000; value++)
+        hist.record(value);
+
+    EXPECT_EQ(hist.count(), 10000U);
+    EXPECT_EQ(hist.max(), 10000U);
+
+    EXPECT_GE(hist.percentile(50), 5000U);
+    EXPECT_LE(hist.percentile(50), 5000U + 5000 / 16);
+    EXPECT_GE(hist.percentile(99), 9900U);
+    EXPECT_LE(hist.percentile(99), 9900U + 9900 / 16);
+    EXPECT_EQ(hist.percentile(100), 10000U);
+
+    hist.reset();
+    EXPECT_EQ(hist.count(), 0U);
+    EXPECT_EQ(hist.percentile(50), 0U);
+}
+
+TEST(HdrHistogram, LargeValuesAreCapped) {
+    HdrHistogram hist;
+    uint64_t cap = (1ULL << HdrHistogram::MAX_BITS) - 1;
+
+    hist.record(1ULL << 50);
+
+    EXPECT_EQ(hist.max(), cap);
+    EXPECT_EQ(hist.percentile(100), cap);
+}
+
+TEST(RouterLatency, ReadTimeOfMessage) {
+    std::unique_ptr<RouterLatency> latency(new RouterLatency());
+
+    latency->markRead(100);
+    usleep(1000);
+    latency->markRead(250);
+
+    // The last byte of the message was read by the first read, then by the second
+    uint64_t first = latency->getReadTime(100);
+    uint64_t second = latency->getReadTime(101);
+
+    EXPECT_NE(first, 0U);
+    EXPECT_GT(second, first);
+
+    // Not read yet
+    EXPECT_EQ(latency->getReadTime(251), 0U);
+}
+
+TEST(RouterLatency, RecordStage) {
+    std::unique_ptr<RouterLatency> latency(new RouterLatency());
+
+    // Not measured
+    latency->record(RouterLatency::STAGE_PARSE, 0, 5000);
+    EXPECT_EQ(latency->getHistogram(RouterLatency::STAGE_PARSE).count(), 0U);
+
+    latency->record(RouterLatency::STAGE_PARSE, 1000, 5000);
+    EXPECT_EQ(latency->getHistogram(RouterLatency::STAGE_PARSE).count(), 1U);
+    EXPECT_EQ(latency->getHistogram(RouterLatency::STAGE_PARSE).max(), 4U);
+}
@@ -0,0 +1,129 @@
+/*
+ * Copyright (c) 2024 Microsoft, Inc. and others.  All rights reserved.
+ *
+ * This program and the accompanying materials are made available under the
+ * terms of the Eclipse Public License v1.0 which accompanies this distribution,
+ * and is available at http://www.eclipse.org/legal/epl-v10.html
+ *
+ */
+
+#include <gtest/gtest.h>
+#include <atomic>
+#include <chrono>
+#include <thread>
+#include <vector>
+
+#include "safeQueue.hpp"
+
+#define QUEUE_TEST_WAIT         std::chrono::milliseconds(50)   ///< Time a blocked call is given to return
+
+TEST(SafeQueue, Fifo) {
+    std::safeQueue<int> queue;
+    int value;
+
+    for (int i = 0; i < 10; i++)
+        queue.push(i);
+
+    EXPECT_EQ(queue.size(), 10U);
+    EXPECT_TRUE(queue.front(value));
+    EXPECT_EQ(value, 0);
+    EXPECT_TRUE(queue.back(value));
+    EXPECT_EQ(value, 9);
+
+    for (int i = 0; i < 10; i++) {
+        ASSERT_TRUE(queue.popFront(value));
+        EXPECT_EQ(value, i);
+    }
+
+    EXPECT_FALSE(queue.popFront(value));
+    EXPECT_FALSE(queue.front(value));
+}
+
+TEST(SafeQueue, PushBlocksAtLimit) {
+    std::safeQueue<int> queue(2);
+    std::atomic<bool> pushed(false);
+    int value;
+
+    queue.push(1);
+    queue.push(2);
+
+    std::thread producer([&] { queue.push(3); pushed = true; });
+
+    std::this_thread::sleep_for(QUEUE_TEST_WAIT);
+    EXPECT_FALSE(pushed);
+
+    ASSERT_TRUE(queue.popFront(value));
+    producer.join();
+
+    EXPECT_TRUE(pushed);
+    EXPECT_EQ(queue.size(), 2U);
+}
+
+TEST(SafeQueue, SetLimitWakesProducer) {
+    std::safeQueue<int> queue(1);
+    std::atomic<bool> pushed(false);
+
+    queue.push(1);
+
+    std::thread producer([&] { queue.push(2); pushed = true; });
+
+    std::this_thread::sleep_for(QUEUE_TEST_WAIT);
+    EXPECT_FALSE(pushed);
+
+    queue.setLimit(0);
+    producer.join();
+
+    EXPECT_TRUE(pushed);
+    EXPECT_EQ(queue.size(), 2U);
+}
+
+TEST(SafeQueue, WaitPopFrontBlocksWhileEmpty) {
+    std::safeQueue<int> queue;
+    std::atomic<bool> popped(false);
+    int value = 0;
+
+    std::thread consumer([&] { queue.waitPopFront(value); popped = true; });
+
+    std::this_thread::sleep_for(QUEUE_TEST_WAIT);
+    EXPECT_FALSE(popped);
+
+    queue.push(7);
+    consumer.join();
+
+    EXPECT_TRUE(popped);
+    EXPECT_EQ(value, 7);
+    EXPECT_EQ(queue.size(), 0U);
+}
+
+TEST(SafeQueue, ProducersAndConsumers) {
+    const int producers = 4;
+    const int per_producer = 20000;
+    std::safeQueue<int> queue(64);
+    std::atomic<long> sum(0);
+    std::vector<std::thread> threads;
+
+    for (int p = 0; p < producers; p++) {
+        threads.emplace_back([&queue] {
+            for (int i = 1; i <= per_producer; i++)
+                queue.push(i);
+        });
+    }
+
+    // Two consumers, each takes half of the values, -1 is never pushed
+    for (int c = 0; c < 2; c++) {
+        threads.emplace_back([&queue, &sum] {
+            int value = -1;
+
+            for (int i = 0; i < producers * per_producer / 2; i++) {
+                queue.waitPopFront(value);
+                sum += value;
+            }
+        });
+    }
+
+    for (auto &thread : threads)
+        thread.join();
+
+    EXPECT_EQ(sum, (long)producers * per_producer * (per_producer + 1) / 2);
+    EXPECT_EQ(queue.size(), 0U);
+}
@@ -0,0 +1,129 @@
+/*
+ * Copyright (c) 2024 Microsoft, Inc. and others.  All rights reserved.
+ *
+ * This program and the accompanying materials are made available under the
+ * terms of the Eclipse Public License v1.0 which accompanies this distribution,
+ * and is available at http://www.eclipse.org/legal/epl-v10.html
+ *
+ */
+
+#include <gtest/gtest.h>
+#include <algorithm>
+
+#include "SpillFile.h"
+
+#define SPILL_TEST_DIR          "/tmp"
+#define SPILL_TEST_QUOTA        (2 * SPILL_SEGMENT_SIZE)
+
+namespace {
+
+/**
+ * Write a byte sequence to the file, stops at max or when the file is full
+ *
+ * \return bytes written
+ */
+size_t writeSeq(SpillFile &spill, uint8_t &seq, size_t max) {
+    size_t written = 0;
+    unsigned char *ptr;
+    size_t len;
+
+    while (written < max and (len = spill.writable(ptr)) > 0) {
+        len = std::min(len, max - written);
+
+        for (size_t i = 0; i < len; i++)
+            ptr[i] = seq++;
+
+        spill.commit(len);
+        written += len;
+    }
+
+    return written;
+}
+
+/**
+ * Read bytes from the file and check they continue the sequence
+ *
+ * \return bytes read
+ */
+size_t readSeq(SpillFile &spill, uint8_t &seq, size_t max) {
+    size_t read = 0;
+    unsigned char *ptr;
+    size_t len;
+
+    while (read < max and (len = spill.readable(ptr)) > 0) {
+        len = std::min(len, max - read);
+
+        for (size_t i = 0; i < len; i++) {
+            if (ptr[i] != seq++) {
+                ADD_FAILURE() << "Byte " << read + i << " is out of sequence";
+                return read;
+            }
+        }
+
+        spill.consume(len);
+        read += len;
+    }
+
+    return read;
+}
+
+} // namespace
+
+TEST(SpillFile, QuotaBelowSegmentThrows) {
+    EXPECT_THROW(SpillFile(SPILL_TEST_DIR, SPILL_SEGMENT_SIZE - 1), const char *);
+}
+
+TEST(SpillFile, QuotaBoundsUnreadBytes) {
+    SpillFile spill(SPILL_TEST_DIR, SPILL_TEST_QUOTA);
+    uint8_t wseq = 0, rseq = 0;
+    unsigned char *ptr;
+
+    EXPECT_EQ(writeSeq(spill, wseq, SIZE_MAX), (size_t)SPILL_TEST_QUOTA);
+    EXPECT_EQ(spill.size(), (size_t)SPILL_TEST_QUOTA);
+    EXPECT_EQ(spill.writable(ptr), 0U);
+
+    // A read segment is released and written again
+    EXPECT_EQ(readSeq(spill, rseq, SPILL_SEGMENT_SIZE), (size_t)SPILL_SEGMENT_SIZE);
+    EXPECT_EQ(writeSeq(spill, wseq, SIZE_MAX), (size_t)SPILL_SEGMENT_SIZE);
+    EXPECT_EQ(spill.size(), (size_t)SPILL_TEST_QUOTA);
+
+    EXPECT_EQ(readSeq(spill, rseq, SIZE_MAX), (size_t)SPILL_TEST_QUOTA);
+    EXPECT_EQ(spill.size(), 0U);
+}
+
+TEST(SpillFile, WrapsInOrder) {
+    SpillFile spill(SPILL_TEST_DIR, SPILL_TEST_QUOTA);
+    uint8_t wseq = 0, rseq = 0;
+    size_t total = 0;
+
+    // Odd sizes so that reads and writes cross the end of the file at any offset
+    for (int i = 0; i < 40; i++) {
+        writeSeq(spill, wseq, 3 * 1000 * 1000 + 7);
+        ASSERT_LE(spill.size(), (size_t)SPILL_TEST_QUOTA);
+
+        total += readSeq(spill, rseq, spill.size() / 2 + 1);
+    }
+
+    total += readSeq(spill, rseq, SIZE_MAX);
+
+    EXPECT_GT(total, 2U * SPILL_TEST_QUOTA);
+    EXPECT_EQ(spill.size(), 0U);
+}
+
+TEST(SpillFile, DrainStartsOver) {
+    SpillFile spill(SPILL_TEST_DIR, SPILL_TEST_QUOTA);
+    uint8_t wseq = 0, rseq = 0;
+    unsigned char *start, *ptr;
+
+    ASSERT_GT(spill.writable(start), 0U);
+
+    writeSeq(spill, wseq, SPILL_SEGMENT_SIZE + 100);
+    readSeq(spill, rseq, SIZE_MAX);
+
+    EXPECT_EQ(spill.size(), 0U);
+    EXPECT_EQ(spill.readable(ptr), 0U);
+
+    // Drained, the writes start at the beginning of the file with a new segment
+    EXPECT_EQ(spill.writable(ptr), (size_t)SPILL_SEGMENT_SIZE);
+    EXPECT_EQ(ptr, start);
+}